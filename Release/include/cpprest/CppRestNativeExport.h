@@ -1,6 +1,8 @@
 #pragma once
-#ifdef CPPRESTNATIVE_EXPORT
+#if !defined(_WIN32)
+#define CPPRESTNATIVE_API
+#elif defined(CPPRESTNATIVE_EXPORT)
 #define CPPRESTNATIVE_API __declspec(dllexport)
 #else
 #define CPPRESTNATIVE_API __declspec(dllimport)
-#endif
\ No newline at end of file
+#endif
@@ -1,7 +1,8 @@
 #pragma once
-#pragma once
-#ifdef CPPRESTPROXY_EXPORT
+#if !defined(_WIN32)
+#define CPPRESTPROXY_API
+#elif defined(CPPRESTPROXY_EXPORT)
 #define CPPRESTPROXY_API __declspec(dllexport)
 #else
 #define CPPRESTPROXY_API __declspec(dllimport)
-#endif
\ No newline at end of file
+#endif
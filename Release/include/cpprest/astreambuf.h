@@ -92,6 +92,9 @@ namespace streams
             return reinterpret_cast<unsigned char*>(std::char_traits<char>::move(reinterpret_cast<char*>(left), reinterpret_cast<const char*>(right), n));
         }
 
+        static int_type to_int_type(const unsigned char& ch) { return static_cast<int_type>(ch); }
+        static unsigned char to_char_type(const int_type& ch) { return static_cast<unsigned char>(ch); }
+
         static int_type requires_async() { return eof() - 1; }
     };
 #endif
@@ -21,8 +21,8 @@
 /*#include <locale.h>
 
 #include "pplx/pplxtasks.h"*/
-#include "..\..\include\cpprest\details/basic_types.h"
-#include "..\..\include\cpprest\CppRestNativeExport.h"
+#include "cpprest/details/basic_types.h"
+#include "cpprest/CppRestNativeExport.h"
 
 #if !defined(_WIN32) || (_MSC_VER >= 1700)
 #include <chrono>
@@ -19,8 +19,8 @@
 #include <vector>
 #include <functional>
 
-#include "..\..\include\cpprest\asyncrt_utils.h"
-#include "..\..\include\cpprest\details\basic_types.h"
+#include "cpprest/asyncrt_utils.h"
+#include "cpprest/details/basic_types.h"
 
 namespace web {
     namespace details
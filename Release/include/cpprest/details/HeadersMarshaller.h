@@ -1,5 +1,5 @@
 #pragma once
-#include "..\..\include\cpprest/http_headers.h"
+#include "cpprest/http_headers.h"
 #include <msclr/marshal_cppstd.h>
 #include <msclr/marshal.h>
 
@@ -17,7 +17,7 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
-#include "..\..\..\include\cpprest\details\cpprest_compat.h"
+#include "cpprest/details/cpprest_compat.h"
 
 #ifndef _WIN32
 # define __STDC_LIMIT_MACROS
@@ -26,7 +26,7 @@
 #include <cstdint>
 #endif
 
-#include "..\..\..\include\cpprest\details\SafeInt3.hpp"
+#include "cpprest/details/SafeInt3.hpp"
 
 namespace utility
 {
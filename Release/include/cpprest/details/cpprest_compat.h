@@ -37,6 +37,7 @@
 #define __assume(x) do { if (!(x)) __builtin_unreachable(); } while (false)
 #define CASABLANCA_UNREFERENCED_PARAMETER(x) (void)x
 #define CPPREST_NOEXCEPT noexcept
+#define __FUNCSIG__ __PRETTY_FUNCTION__
 
 #include <assert.h>
 #define _ASSERTE(x) assert(x)
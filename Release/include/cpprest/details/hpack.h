@@ -0,0 +1,109 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* HPACK header compression for HTTP/2 (RFC 7541).
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace web { namespace http { namespace details { namespace hpack {
+
+/// <summary>
+/// Header fields in wire order. Names are expected in lower case, as HTTP/2 requires.
+/// </summary>
+typedef std::vector<std::pair<std::string, std::string>> header_list;
+
+/// <summary>
+/// Default size of the dynamic table, until SETTINGS_HEADER_TABLE_SIZE says otherwise.
+/// </summary>
+const size_t default_table_size = 4096;
+
+/// <summary>
+/// Dynamic table shared by the encoder and the decoder logic. Entry 0 is the newest one.
+/// </summary>
+class dynamic_table
+{
+public:
+    explicit dynamic_table(size_t max_size = default_table_size) : m_size(0), m_max_size(max_size) {}
+
+    size_t size() const { return m_size; }
+    size_t max_size() const { return m_max_size; }
+    size_t count() const { return m_entries.size(); }
+    const std::pair<std::string, std::string>& at(size_t index) const { return m_entries[index]; }
+
+    void set_max_size(size_t max_size);
+    void add(const std::string& name, const std::string& value);
+
+    /// <summary>
+    /// Size of an entry as accounted by RFC 7541 section 4.1.
+    /// </summary>
+    static size_t entry_size(const std::string& name, const std::string& value) { return name.size() + value.size() + 32; }
+
+private:
+    void evict(size_t needed);
+
+    std::deque<std::pair<std::string, std::string>> m_entries;
+    size_t m_size;
+    size_t m_max_size;
+};
+
+/// <summary>
+/// Encodes header blocks. One instance per connection, header blocks must be encoded in the order they are sent.
+/// </summary>
+class encoder
+{
+public:
+    encoder() : m_pending_size_update(false) {}
+
+    /// <summary>
+    /// Applies the SETTINGS_HEADER_TABLE_SIZE announced by the peer, signalled at the start of the next block.
+    /// </summary>
+    void set_max_table_size(size_t max_size);
+
+    void encode(const header_list& headers, std::vector<uint8_t>& out);
+
+private:
+    dynamic_table m_table;
+    bool m_pending_size_update;
+};
+
+/// <summary>
+/// Decodes header blocks. One instance per connection, header blocks must be decoded in the order they arrive.
+/// </summary>
+class decoder
+{
+public:
+    explicit decoder(size_t max_table_size = default_table_size) : m_table(max_table_size), m_settings_table_size(max_table_size) {}
+
+    /// <summary>
+    /// Decodes a complete header block (HEADERS plus CONTINUATION payloads).
+    /// </summary>
+    /// <returns>False on a malformed block; the connection must then fail with COMPRESSION_ERROR.</returns>
+    bool decode(const uint8_t* data, size_t size, header_list& out);
+
+private:
+    dynamic_table m_table;
+    size_t m_settings_table_size;
+};
+
+// Primitive representations (RFC 7541 section 5), exposed for the frame layer.
+void encode_integer(uint64_t value, uint8_t prefix_bits, uint8_t first_byte_flags, std::vector<uint8_t>& out);
+bool decode_integer(const uint8_t*& pos, const uint8_t* end, uint8_t prefix_bits, uint64_t& value);
+void huffman_encode(const std::string& input, std::vector<uint8_t>& out);
+size_t huffman_encoded_size(const std::string& input);
+bool huffman_decode(const uint8_t* data, size_t size, std::string& out);
+
+}}}} // namespace web::http::details::hpack
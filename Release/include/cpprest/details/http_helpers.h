@@ -15,8 +15,8 @@
 ****/
 #pragma once
 
-#include "..\..\..\include\cpprest\details\basic_types.h"
-#include "..\..\..\include\cpprest\CppRestNativeExport.h"
+#include "cpprest/details/basic_types.h"
+#include "cpprest/CppRestNativeExport.h"
 
 namespace web { namespace http
 {
@@ -29,7 +29,7 @@ namespace web { namespace http
 	public:
 #define _METHODS
 #define DAT(a,b) CPPRESTNATIVE_API const static method a;
-#include "..\..\..\include\cpprest\details\http_constants.dat"
+#include "cpprest/details/http_constants.dat"
 #undef _METHODS
 #undef DAT
 	};
@@ -42,7 +42,7 @@ namespace web { namespace http
 	public:
 #define _PHRASES
 #define DAT(a,b,c) CPPRESTNATIVE_API const static status_code a=b;
-#include "..\..\..\include\cpprest\details\http_constants.dat"
+#include "cpprest/details/http_constants.dat"
 #undef _PHRASES
 #undef DAT
 	};
@@ -55,7 +55,7 @@ namespace web { namespace http
 	public:
 #define _HEADER_NAMES
 #define DAT(a,b) CPPRESTNATIVE_API const static utility::string_t a;
-#include "..\..\..\include\cpprest\details\http_constants.dat"
+#include "cpprest/details/http_constants.dat"
 #undef _HEADER_NAMES
 #undef DAT
 	};
@@ -70,7 +70,7 @@ namespace web { namespace http
 		public:
 #define _MIME_TYPES
 #define DAT(a,b) CPPRESTNATIVE_API const static utility::string_t a;
-#include "..\..\..\include\cpprest\details\http_constants.dat"
+#include "cpprest/details/http_constants.dat"
 #undef _MIME_TYPES
 #undef DAT
 		};
@@ -83,7 +83,7 @@ namespace web { namespace http
 		public:
 #define _CHARSET_TYPES
 #define DAT(a,b) CPPRESTNATIVE_API const static utility::string_t a;
-#include "..\..\..\include\cpprest\details\http_constants.dat"
+#include "cpprest/details/http_constants.dat"
 #undef _CHARSET_TYPES
 #undef DAT
 		};
@@ -116,18 +116,24 @@ namespace details
         { 
             deflate = 15,
             gzip = 31,
+            zstd = 100,
             invalid = 9999
         };
 
         using data_buffer = std::vector<uint8_t>;
 
+        /// <summary>
+        /// Content coding names of the supported algorithms, most preferred first, as sent in Accept-Encoding.
+        /// </summary>
+        CPPRESTNATIVE_API utility::string_t __cdecl supported_encodings();
+
         class stream_decompressor
         {
         public:
 
             static compression_algorithm to_compression_algorithm(const utility::string_t& alg)
             {
-                if (U("gzip") == alg)
+                if (U("gzip") == alg || U("x-gzip") == alg)
                 {
                     return compression_algorithm::gzip;
                 }
@@ -135,12 +141,21 @@ namespace details
                 {
                     return compression_algorithm::deflate;
                 }
+                else if (U("zstd") == alg)
+                {
+                    return compression_algorithm::zstd;
+                }
 
                 return compression_algorithm::invalid;
             }
 
             CPPRESTNATIVE_API static bool __cdecl is_supported();
 
+            /// <summary>
+            /// Checks if this build has a codec for the algorithm.
+            /// </summary>
+            CPPRESTNATIVE_API static bool __cdecl is_supported(compression_algorithm alg);
+
             CPPRESTNATIVE_API stream_decompressor(compression_algorithm alg);
 
             CPPRESTNATIVE_API data_buffer decompress(const data_buffer& input);
@@ -149,6 +164,12 @@ namespace details
 
             CPPRESTNATIVE_API bool has_error() const;
 
+            /// <summary>
+            /// Checks if the compressed stream reached its end marker. A stream given no input yet counts as complete,
+            /// so an empty body is accepted. At the end of a body anything else means it was truncated.
+            /// </summary>
+            CPPRESTNATIVE_API bool is_complete() const;
+
         private:
             class stream_decompressor_impl;
             std::shared_ptr<stream_decompressor_impl> m_pimpl;
@@ -160,8 +181,13 @@ namespace details
 
             CPPRESTNATIVE_API static bool __cdecl is_supported();
 
+            CPPRESTNATIVE_API static bool __cdecl is_supported(compression_algorithm alg);
+
             CPPRESTNATIVE_API stream_compressor(compression_algorithm alg);
 
+            /// <summary>
+            /// Compresses the next part of the stream. Input may be empty when finish is set, to end the stream.
+            /// </summary>
             CPPRESTNATIVE_API data_buffer compress(const data_buffer& input, bool finish);
 
             CPPRESTNATIVE_API data_buffer compress(const uint8_t* input, size_t input_size, bool finish);
@@ -1,6 +1,7 @@
 #pragma once
-#include "..\..\include\cpprest\CppRestNativeExport.h"
-#include "..\..\include\cpprest\details\basic_types.h"
+#include <memory>
+#include "cpprest/CppRestNativeExport.h"
+#include "cpprest/details/basic_types.h"
 
 namespace web::http::details
 {
@@ -1,15 +1,25 @@
 #pragma once
-#include "..\..\include\cpprest\CppRestProxyExport.h"
+#include "cpprest/CppRestProxyExport.h"
 #include <memory>
 #include "http_request_base.h"
-#include "..\..\include\cpprest\details\http_msg_native_base.h"
-#include "..\..\include\cpprest\base_uri.h"
-#include "..\..\include\cpprest\http_client_config.h"
-#include "..\..\include\cpprest\http_headers.h"
+#include "cpprest/details/http_msg_native_base.h"
+#include "cpprest/base_uri.h"
+#include "cpprest/http_client_config.h"
+#include "cpprest/http_headers.h"
 #include "http_response_proxy.h"
-#include "..\..\include\cpprest/istreambuf_type_erasure.h"
+#include "cpprest/istreambuf_type_erasure.h"
 #include <optional>
 
+#if !defined(_WIN32)
+#include "pplx/pplxtasks.h"
+
+namespace web::http::client::details
+{
+	class asio_context;
+	class asio_h2_session;
+}
+#endif
+
 namespace web::http::details
 {
 	class _http_request;
@@ -20,15 +30,23 @@ namespace web::http::details
 		virtual void _response_explicit_stream_writer(std::shared_ptr<Concurrency::streams::istreambuf_type_erasure> streambuf) = 0;
 		virtual std::optional<int64_t> _request_stream_length() = 0;
 		virtual bool _has_explicit_response_stream() = 0;
+		virtual void _set_timings(const http::http_timings& timings) = 0;
 
 	protected:
 		CPPRESTPROXY_API http_request_proxy();
 		virtual CPPRESTPROXY_API ~http_request_proxy();
+		//.Net bridge (CppRestNetProxy). Blocks the calling thread until the response headers are in, and the body too
+		//when it goes to an explicit response stream
 		std::shared_ptr<http::details::http_response_proxy> CPPRESTPROXY_API get_response_cli();
 
+#if !defined(_WIN32)
+		//Native transport (http_client_asio.cpp). The task is completed from the socket handlers, so no thread waits while the exchange is in flight
+		pplx::task<std::shared_ptr<http::details::http_response_proxy>> get_response_async();
+#endif
+
 		virtual std::shared_ptr<details::_http_request> _request_impl_from_this() = 0;
 
-		virtual method &method() = 0;
+		virtual http::method &method() = 0;
 		virtual uri absolute_uri() const = 0;
 		virtual web::http::client::http_client_config &client_config() = 0;
 		virtual const web::http::client::http_client_config &client_config() const = 0;
@@ -42,7 +60,14 @@ namespace web::http::details
 
 		std::shared_ptr<http::details::http_response_proxy> processRequest();
 		std::shared_ptr<http::details::http_response_proxy> processResponse();
+		void publishTimings(const http::http_timings& timings, http::details::http_response_proxy* response);
 
 		std::weak_ptr<http::details::http_response_proxy> _response;
+
+#if !defined(_WIN32)
+		friend class web::http::client::details::asio_context;
+		friend class web::http::client::details::asio_h2_session;
+		std::weak_ptr<web::http::client::details::asio_context> _context;
+#endif
 	};
 }
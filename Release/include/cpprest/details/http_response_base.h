@@ -1,5 +1,5 @@
 #pragma once
-#include "..\..\include\cpprest\CppRestNativeExport.h"
+#include "cpprest/CppRestNativeExport.h"
 #include "http_msg_native_base.h"
 
 namespace web::http::details
@@ -1,8 +1,9 @@
 #pragma once
-#include "..\..\include\cpprest\CppRestProxyExport.h"
+#include "cpprest/CppRestProxyExport.h"
 #include "http_response_base.h"
-#include "..\..\include\cpprest\http_headers.h"
-#include "..\..\include\cpprest\istreambuf_type_erasure.h"
+#include "cpprest/http_headers.h"
+#include "cpprest/http_timings.h"
+#include "cpprest/istreambuf_type_erasure.h"
 
 namespace web::http::details
 {
@@ -14,6 +15,7 @@ namespace web::http::details
 		virtual void _set_response_body(const std::shared_ptr<Concurrency::streams::istreambuf_type_erasure> &streambuf, utility::size64_t contentLength, const utf16string &contentType) = 0;
 		virtual void _set_content_ready(uint64_t contentSize) = 0;
 		virtual http::http_headers& headers() = 0;
+		virtual void _set_timings(const http::http_timings& timings) = 0;
 
 		CPPRESTPROXY_API ~http_response_proxy();
 	};
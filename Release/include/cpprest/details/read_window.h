@@ -0,0 +1,114 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Read-ahead window of the stream buffers that adapt a blocking source, such as a .Net Stream.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace Concurrency { namespace streams { namespace details {
+
+/// <summary>
+/// Native ring buffer that a source is read ahead into. Consuming only moves the head; the ring grows, by doubling,
+/// only when a single request is larger than its capacity.
+/// </summary>
+class read_window
+{
+public:
+    static const size_t initial_capacity = 64 * 1024;
+
+    /// <summary>
+    /// Bytes read ahead and not consumed yet.
+    /// </summary>
+    size_t size() const { return m_size; }
+
+    size_t capacity() const { return m_window.size(); }
+
+    /// <summary>
+    /// Reads from the source until at least <paramref name="size"/> bytes are buffered or the source ends.
+    /// <c>read(ptr, count)</c> stores up to count bytes at ptr and returns how many it stored, 0 at the end of the source.
+    /// </summary>
+    template<typename Read>
+    void fill(size_t size, Read&& read)
+    {
+        if (m_size >= size || m_source_ended)
+            return;
+        grow(size);
+        while (m_size < size)
+        {
+            // One read per contiguous free segment of the ring
+            const auto tail = (m_head + m_size) % m_window.size();
+            const auto contiguous_free = (std::min)(m_window.size() - m_size, m_window.size() - tail);
+            const size_t stored = read(m_window.data() + tail, contiguous_free);
+            if (stored == 0)
+            {
+                m_source_ended = true;
+                return;
+            }
+            m_size += stored;
+        }
+    }
+
+    /// <summary>
+    /// Copies the first <paramref name="size"/> buffered bytes, which must not be more than size().
+    /// </summary>
+    void copy_to(void* ptr, size_t size) const
+    {
+        if (size == 0)
+            return;
+        const auto first = (std::min)(size, m_window.size() - m_head);
+        std::memcpy(ptr, m_window.data() + m_head, first);
+        std::memcpy(static_cast<uint8_t*>(ptr) + first, m_window.data(), size - first);
+    }
+
+    /// <summary>
+    /// The buffered bytes that follow the head without wrapping, for in-place reads.
+    /// </summary>
+    const uint8_t* contiguous(size_t& count) const
+    {
+        count = m_size == 0 ? 0 : (std::min)(m_size, m_window.size() - m_head);
+        return count > 0 ? m_window.data() + m_head : nullptr;
+    }
+
+    /// <summary>
+    /// Drops the first <paramref name="size"/> buffered bytes, which must not be more than size().
+    /// </summary>
+    void consume(size_t size)
+    {
+        m_size -= size;
+        m_head = m_size == 0 ? 0 : (m_head + size) % m_window.size();
+    }
+
+private:
+    void grow(size_t capacity)
+    {
+        auto new_capacity = (std::max)(m_window.size(), static_cast<size_t>(initial_capacity));
+        while (new_capacity < capacity)
+            new_capacity *= 2;
+        if (new_capacity == m_window.size())
+            return;
+        std::vector<uint8_t> window(new_capacity);
+        copy_to(window.data(), m_size);
+        m_window.swap(window);
+        m_head = 0;
+    }
+
+    std::vector<uint8_t> m_window;
+    size_t m_head = 0;
+    size_t m_size = 0;
+    bool m_source_ended = false;
+};
+
+}}}
@@ -1,8 +1,9 @@
 #pragma once
-#include "..\..\include\cpprest\istreambuf_type_erasure.h"
+#include "cpprest/istreambuf_type_erasure.h"
 #include <optional>
 #include <msclr/gcroot.h>
-#include "..\..\include\cpprest\details\CpprestManagedTryCatch.h"
+#include "cpprest/details/CpprestManagedTryCatch.h"
+#include "cpprest/details/read_window.h"
 
 namespace Concurrency::streams::details
 {
@@ -32,15 +33,21 @@ namespace Concurrency::streams::details
 
 		pos_type pubseekpos(pos_type pos, std::ios_base::openmode mode) override;
 
+		bool acquire(const void*& ptr, size_type& count) override;
+
+		void release(const void* ptr, size_type count) override;
+
 		~streambuf_from_Stream() override;
 
 	private:
-		size_type ReadWholeBuffer(array<System::Byte>^ buffer, size_type bufferOffset);
+		//Reads the source ahead into the native ring buffer
+		void FillWindow(size_t size);
 		void CursorMoveForward(size_type size);
 
 		std::optional<size_type> _contentLength;
 		msclr::gcroot<System::IO::Stream^> _source;
-		msclr::gcroot<array<System::Byte>^> _last_read_buffer;
+		msclr::gcroot<array<System::Byte>^> _readChunk;
+		read_window _window;
 		std::shared_ptr<void> _holder;
 	};
 }
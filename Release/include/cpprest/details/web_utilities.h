@@ -10,7 +10,7 @@
 ****/
 #pragma once
 
-#include "..\..\include\cpprest\asyncrt_utils.h"
+#include "cpprest/asyncrt_utils.h"
 
 namespace web
 {
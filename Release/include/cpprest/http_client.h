@@ -46,7 +46,7 @@ typedef void* native_handle;}}}
 #include "cpprest/details/basic_types.h"
 #include "cpprest/asyncrt_utils.h"
 
-#include <cpprest\http_client_config.h>
+#include <cpprest/http_client_config.h>
 
 /// The web namespace contains functionality common to multiple protocols like HTTP and WebSockets.
 namespace web
@@ -64,6 +64,28 @@ namespace client
 using web::credentials;
 using web::web_proxy;
 
+#if !defined(_WIN32)
+/// <summary>
+/// Snapshot of the connections kept for one host (scheme, host, port and proxy).
+/// </summary>
+struct connection_pool_stats
+{
+    /// <summary>Connections parked in the pool, ready to be reused.</summary>
+    size_t idle_connections = 0;
+    /// <summary>Connections currently carrying a request, including ones still being established.</summary>
+    size_t active_connections = 0;
+    /// <summary>Requests waiting because max_connections_per_host was reached.</summary>
+    size_t waiting_requests = 0;
+    /// <summary>Connections opened since the pool for the host was created. The pool, with its counters, is dropped
+    /// once the host has no connections and no waiting requests left.</summary>
+    uint64_t connections_created = 0;
+    /// <summary>Requests served by an already established connection.</summary>
+    uint64_t connections_reused = 0;
+    /// <summary>Idle connections closed because of the idle timeout or the maximum lifetime.</summary>
+    uint64_t connections_expired = 0;
+};
+#endif
+
 /// <summary>
 /// HTTP client class, used to maintain a connection to an HTTP service for an extended session.
 /// </summary>
@@ -103,6 +125,20 @@ public:
     /// <returns>A reference to the client configuration object.</returns>
     _ASYNCRTIMP const http_client_config& client_config() const;
 
+#if !defined(_WIN32)
+    /// <summary>
+    /// Opens connections to the base URI ahead of the first requests, so they skip TCP and TLS setup.
+    /// </summary>
+    /// <param name="count">Number of idle connections the pool should hold, bounded by max_connections_per_host.</param>
+    /// <returns>A task that is completed once the connections are established.</returns>
+    _ASYNCRTIMP pplx::task<void> prewarm_connections(size_t count) const;
+
+    /// <summary>
+    /// Gets the statistics of the connection pool used for the base URI.
+    /// </summary>
+    _ASYNCRTIMP connection_pool_stats pool_stats() const;
+#endif
+
     /// <summary>
     /// Asynchronously sends an HTTP request.
     /// </summary>
@@ -383,6 +419,12 @@ namespace details {
 extern const utility::char_t * get_with_body_err_msg;
 #endif
 
+#if !defined(_WIN32)
+// Connection pool of the native transport (http_client_asio.cpp).
+pplx::task<void> prewarm_connections(const uri &base_uri, const http_client_config &client_config, size_t count);
+http::client::connection_pool_stats get_connection_pool_stats(const uri &base_uri, const http_client_config &client_config);
+#endif
+
 }
 
 }}}
@@ -1,9 +1,15 @@
 #pragma once
-#include "..\..\include\cpprest\details\web_utilities.h"
+#include "cpprest/details/web_utilities.h"
+#include "cpprest/http_timings.h"
+#include <functional>
 #include <list>
 #include <vector>
 #include <string>
 
+#if !defined(_WIN32) && !defined(__cplusplus_winrt) || defined(CPPREST_FORCE_HTTP_CLIENT_ASIO)
+#include <boost/asio/ssl.hpp>
+#endif
+
 namespace web::http::client
 {
 
@@ -13,6 +19,21 @@ namespace web::http::client
 	using web::credentials;
 	using web::web_proxy;
 
+#if !defined(_WIN32) && !defined(__cplusplus_winrt) || defined(CPPREST_FORCE_HTTP_CLIENT_ASIO)
+	/// <summary>
+	/// How the client uses HTTP/2.
+	/// </summary>
+	enum class http2_mode
+	{
+		/// <summary>Always HTTP/1.1.</summary>
+		disabled,
+		/// <summary>Offer h2 through TLS ALPN for https and fall back to HTTP/1.1; plain http stays on HTTP/1.1.</summary>
+		negotiate,
+		/// <summary>Assume the server speaks HTTP/2: h2c for http, h2 without fallback for https.</summary>
+		prior_knowledge
+	};
+#endif
+
 	/// <summary>
 /// HTTP client configuration class, used to set the possible configuration options
 /// used to create an http_client instance.
@@ -24,12 +45,17 @@ namespace web::http::client
 			m_guarantee_order(false),
 			m_timeout(std::chrono::seconds(30)),
 			m_chunksize(0),
-			m_request_compressed(false)
+			m_request_compressed(false),
+			m_max_connections_per_host(0),
+			m_connection_idle_timeout(std::chrono::seconds(30)),
+			m_connection_idle_timeout_set(false),
+			m_connection_max_lifetime(0)
 #if !defined(__cplusplus_winrt)
 			, m_validate_certificates(true)
 #endif
 #if !defined(_WIN32) && !defined(__cplusplus_winrt) || defined(CPPREST_FORCE_HTTP_CLIENT_ASIO)
 			, m_tlsext_sni_enabled(true)
+			, m_http2_mode(http2_mode::disabled)
 #endif
 #if defined(_WIN32) && !defined(__cplusplus_winrt)
 			, m_buffer_request(false)
@@ -202,12 +228,125 @@ namespace web::http::client
 		/// The response body is internally decompressed before the consumer receives the data.
 		/// </summary>
 		/// <param name="request_compressed">True to turn on response body compression, false otherwise.</param>
-		/// <remarks>Please note there is a performance cost due to copying the request data. Currently only supported on Windows and OSX.</remarks>
+		/// <remarks>Accept-Encoding lists every coding of the build unless the request sets it explicitly, in which case
+		/// the body is left as received. Currently only supported by the native transport.</remarks>
 		void set_request_compressed_response(bool request_compressed)
 		{
 			m_request_compressed = request_compressed;
 		}
 
+		/// <summary>
+		/// Gets the content coding applied to request bodies, empty when they are sent as is.
+		/// </summary>
+		const utility::string_t& request_body_compression() const
+		{
+			return m_request_body_compression;
+		}
+
+		/// <summary>
+		/// Compresses request bodies while they are read from the request stream, and labels them with Content-Encoding.
+		/// </summary>
+		/// <param name="encoding">"gzip", "deflate" or "zstd"; empty to send bodies as is.</param>
+		/// <remarks>Requests that set Content-Encoding themselves are sent as is. Only use it with servers known to accept
+		/// the coding, there is no negotiation for request bodies. The compressed length is not known up front, so these
+		/// bodies are sent chunked over HTTP/1.1. Currently only supported by the native transport.</remarks>
+		void set_request_body_compression(const utility::string_t& encoding)
+		{
+			m_request_body_compression = encoding;
+		}
+
+		/// <summary>
+		/// Receives the target and the phase timings of every request completed through the client, failed ones included.
+		/// </summary>
+		typedef std::function<void(const uri&, const http_timings&)> timings_observer;
+
+		/// <summary>
+		/// Gets the observer of request phase timings, empty if none.
+		/// </summary>
+		const timings_observer& get_timings_observer() const
+		{
+			return m_timings_observer;
+		}
+
+		/// <summary>
+		/// Sets an observer called with the phase timings of each request, once it completes or fails.
+		/// </summary>
+		/// <param name="observer">The observer; empty to stop observing.</param>
+		/// <remarks>The observer runs on the transport thread that completed the request and must neither block nor throw.
+		/// The same record is available afterwards from http_request::timings and http_response::timings.</remarks>
+		void set_timings_observer(const timings_observer& observer)
+		{
+			m_timings_observer = observer;
+		}
+
+		/// <summary>
+		/// Get the maximum number of simultaneous connections to one host (scheme, host, port and proxy).
+		/// </summary>
+		/// <returns>The connection limit, 0 if the platform default is used.</returns>
+		size_t max_connections_per_host() const
+		{
+			return m_max_connections_per_host;
+		}
+
+		/// <summary>
+		/// Set the maximum number of simultaneous connections to one host (scheme, host, port and proxy).
+		/// Requests above the limit wait for a connection to be released.
+		/// </summary>
+		/// <param name="max_connections">The connection limit, 0 to use the platform default.</param>
+		void set_max_connections_per_host(size_t max_connections)
+		{
+			m_max_connections_per_host = max_connections;
+		}
+
+		/// <summary>
+		/// Get the time a kept-alive connection may stay unused before it is closed.
+		/// </summary>
+		template <class T>
+		T connection_idle_timeout() const
+		{
+			return std::chrono::duration_cast<T>(m_connection_idle_timeout);
+		}
+
+		/// <summary>
+		/// Set the time a kept-alive connection may stay unused before it is closed.
+		/// </summary>
+		/// <param name="timeout">The idle timeout, zero keeps connections until the server closes them.</param>
+		template <class T>
+		void set_connection_idle_timeout(const T &timeout)
+		{
+			m_connection_idle_timeout = std::chrono::duration_cast<std::chrono::microseconds>(timeout);
+			m_connection_idle_timeout_set = true;
+		}
+
+		/// <summary>
+		/// Checks if the idle timeout was set explicitly rather than left at its default.
+		/// </summary>
+		/// <returns>True if set_connection_idle_timeout was called, false otherwise.</returns>
+		bool is_connection_idle_timeout_set() const
+		{
+			return m_connection_idle_timeout_set;
+		}
+
+		/// <summary>
+		/// Get the time after which a connection is no longer reused, regardless of activity.
+		/// </summary>
+		template <class T>
+		T connection_max_lifetime() const
+		{
+			return std::chrono::duration_cast<T>(m_connection_max_lifetime);
+		}
+
+		/// <summary>
+		/// Set the time after which a connection is no longer reused, regardless of activity.
+		/// This lets long running clients pick up DNS and load balancer changes.
+		/// </summary>
+		/// <param name="lifetime">The maximum lifetime, zero for no limit.</param>
+		template <class T>
+		void set_connection_max_lifetime(const T &lifetime)
+		{
+			m_connection_max_lifetime = std::chrono::duration_cast<std::chrono::microseconds>(lifetime);
+		}
+
 		typedef std::list<std::pair<std::string, bool>> certificates_t;
 
 		void add_client_certificate(const std::string& thumb, bool isUserStorage)
@@ -351,6 +490,24 @@ namespace web::http::client
 		{
 			m_tlsext_sni_enabled = tlsext_sni_enabled;
 		}
+
+		/// <summary>
+		/// Gets how the client uses HTTP/2.
+		/// </summary>
+		http2_mode http2() const
+		{
+			return m_http2_mode;
+		}
+
+		/// <summary>
+		/// Sets how the client uses HTTP/2. Over HTTP/2 all requests to one host share a single connection.
+		/// </summary>
+		/// <param name="mode">The HTTP/2 mode, HTTP/1.1 only by default.</param>
+		/// <remarks>Requests through a proxy use HTTP/2 only for https, inside the CONNECT tunnel.</remarks>
+		void set_http2(http2_mode mode)
+		{
+			m_http2_mode = mode;
+		}
 #endif
 
 	private:
@@ -367,6 +524,13 @@ namespace web::http::client
 		std::chrono::microseconds m_timeout;
 		size_t m_chunksize;
 		bool m_request_compressed;
+		utility::string_t m_request_body_compression;
+		timings_observer m_timings_observer;
+
+		size_t m_max_connections_per_host;
+		std::chrono::microseconds m_connection_idle_timeout;
+		bool m_connection_idle_timeout_set;
+		std::chrono::microseconds m_connection_max_lifetime;
 
 #if !defined(__cplusplus_winrt)
 		// IXmlHttpRequest2 doesn't allow configuration of certificate verification.
@@ -379,6 +543,7 @@ namespace web::http::client
 #if !defined(_WIN32) && !defined(__cplusplus_winrt) || defined(CPPREST_FORCE_HTTP_CLIENT_ASIO)
 		std::function<void(boost::asio::ssl::context&)> m_ssl_context_callback;
 		bool m_tlsext_sni_enabled;
+		http2_mode m_http2_mode;
 #endif
 #if defined(_WIN32) && !defined(__cplusplus_winrt)
 		bool m_buffer_request;
@@ -1,8 +1,8 @@
 #pragma once
 #include <exception>
 #include <string>
-#include "..\..\include\cpprest\CppRestNativeExport.h"
-#include "..\..\include\cpprest\details\basic_types.h"
+#include "cpprest/CppRestNativeExport.h"
+#include "cpprest/details/basic_types.h"
 
 class CPPRESTNATIVE_API http_exception : public std::exception
 {
@@ -56,7 +56,7 @@ public:
 	/// Gets a string identifying the cause of the exception.
 	/// </summary>
 	/// <returns>A null terminated character string.</returns>
-	const char* what() const override;
+	const char* what() const throw() override;
 
 	/// <summary>
 	/// Retrieves the underlying error code causing this exception.
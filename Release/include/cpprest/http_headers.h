@@ -15,7 +15,7 @@
 #include <string>
 #include <vector>
 #include <system_error>
-#include "..\..\include\cpprest\asyncrt_utils.h"
+#include "cpprest/asyncrt_utils.h"
 
 namespace web { namespace http {
 
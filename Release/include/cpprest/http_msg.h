@@ -27,11 +27,14 @@
 #include "cpprest/asyncrt_utils.h"
 #include "cpprest/streams.h"
 #include "cpprest/containerstream.h"
+#include "cpprest/producerconsumerstream.h"
 #include "details/http_response_proxy.h"
 #include "cpprest/http_exception.h"
 #include "details/http_request_proxy.h"
 #include "cpprest/details/http_helpers.h"
+#if defined(_WIN32)
 #include <pplinterface.h>
+#endif
 
 namespace web
 {
@@ -194,7 +197,7 @@ protected:
     std::atomic<utility::size64_t> m_data_available = {};
 };
 
-#include "..\..\include\cpprest\details\http_msg_realization.h"
+#include "cpprest/details/http_msg_realization.h"
 namespace 
 {
 	pplx::task<http_response> _http_response_to_http_response(std::weak_ptr<details::_http_response> response);
@@ -237,9 +240,14 @@ public:
 
 	pplx::task<utility::size64_t> _get_data_available() const override { return pplx::task_from_result(m_data_available.load()); }
 
+	void _set_timings(const http::http_timings& timings) override { m_timings = timings; }
+
+	const http::http_timings& timings() const { return m_timings; }
+
 private:
     http::status_code m_status_code = {};
     http::reason_phrase m_reason_phrase;
+	http::http_timings m_timings;
 	std::weak_ptr<_http_request> m_request;
 };
 
@@ -530,6 +538,12 @@ public:
 
 	using pimpl_type = std::shared_ptr<http::details::_http_response>;
 
+    /// <summary>
+    /// Gets the phase timings of the request that produced this response.
+    /// </summary>
+    /// <returns>The timings, recorded once the response has been received; phases the transport does not observe stay unset.</returns>
+    const http::http_timings& timings() const { return _m_impl->timings(); }
+
     /// <summary>
     /// Signals the user (client) when all the data for this response message has been received.
     /// </summary>
@@ -595,14 +609,26 @@ public:
 
 	_ASYNCRTIMP void _request_stream_writer(std::shared_ptr<Concurrency::streams::istreambuf_type_erasure> streambuf_te, std::optional<Concurrency::streams::istreambuf_type_erasure::size_type> contentSize) override;
 
+	//Continuation based body pump of the native transport. The synchronous writer above waits on it, since the .Net
+	//bridge calls it from an HttpWebRequest thread that has to block anyway
+	_ASYNCRTIMP pplx::task<void> _request_stream_writer_async(std::shared_ptr<Concurrency::streams::istreambuf_type_erasure> streambuf_te, std::optional<Concurrency::streams::istreambuf_type_erasure::size_type> contentSize);
+
 	bool _has_explicit_response_stream() override
 	{
 		return m_response_stream;
 	}
 
+	//Called once by the transport when the request completes or fails
+	_ASYNCRTIMP void _set_timings(const http::http_timings& timings) override;
+
+	const http::http_timings& timings() const { return m_timings; }
+
 	_ASYNCRTIMP void _response_explicit_stream_writer(
 		std::shared_ptr<Concurrency::streams::istreambuf_type_erasure> streambuf_te) override;
 
+	_ASYNCRTIMP pplx::task<void> _response_explicit_stream_writer_async(
+		std::shared_ptr<Concurrency::streams::istreambuf_type_erasure> streambuf_te);
+
     _ASYNCRTIMP utility::string_t to_string() const;
 
 	_ASYNCRTIMP pplx::task<http_response> get_response();
@@ -620,6 +646,10 @@ public:
 
     const concurrency::streams::ostream & _response_stream() const { return m_response_stream; }
 
+    void set_priority_weight(uint8_t weight) { m_priority_weight = weight; }
+
+    uint8_t priority_weight() const { return m_priority_weight; }
+
     //const std::shared_ptr<progress_handler> & _progress_handler() const { return m_progress_handler; }
 
     void _set_base_uri(const http::uri &base_uri) { m_base_uri = base_uri; }
@@ -660,6 +690,11 @@ private:
 
     concurrency::streams::ostream m_response_stream;
 
+    // HTTP/2 stream weight minus one, as sent on the wire; 15 is the protocol default of 16.
+    uint8_t m_priority_weight = 15;
+
+	http::http_timings m_timings;
+
     //std::shared_ptr<progress_handler> m_progress_handler;
 
     //utility::string_t m_remote_address;
@@ -991,6 +1026,24 @@ public:
         return _m_impl->set_response_stream(stream);
     }
 
+    /// <summary>
+    /// Sets the relative weight of the request among the concurrent requests multiplexed on one HTTP/2 connection.
+    /// </summary>
+    /// <param name="weight">Weight minus one as sent on the wire, 0 to 255 for weights 1 to 256; 15 by default.</param>
+    /// <remarks>Requests sent over HTTP/1.1 ignore the weight.</remarks>
+    void set_priority_weight(uint8_t weight)
+    {
+        _m_impl->set_priority_weight(weight);
+    }
+
+    /// <summary>
+    /// Gets the HTTP/2 weight of the request.
+    /// </summary>
+    uint8_t priority_weight() const
+    {
+        return _m_impl->priority_weight();
+    }
+
 	///  
     /// <summary>
     /// Defines a callback function that will be invoked for every chunk of data uploaded or downloaded
@@ -1062,6 +1115,12 @@ public:
     /// Otherwise just the headers will be present.</remarks>
     utility::string_t to_string() const { return _m_impl->to_string(); }
 
+    /// <summary>
+    /// Gets the phase timings of the last send of this request.
+    /// </summary>
+    /// <returns>The timings, recorded once the request has completed or failed.</returns>
+    const http::http_timings& timings() const { return _m_impl->timings(); }
+
     const std::shared_ptr<http::details::_http_request> & _get_impl() const { return _m_impl; }
 
     void _set_cancellation_token(const pplx::cancellation_token &token)
@@ -0,0 +1,56 @@
+#pragma once
+#include <chrono>
+
+namespace web::http
+{
+	/// <summary>
+	/// Phase timestamps of one request, taken from a monotonic clock. A phase that did not happen
+	/// (no DNS lookup or connect on a reused connection, no TLS for http) keeps a default constructed time point.
+	/// </summary>
+	struct http_timings
+	{
+		typedef std::chrono::steady_clock clock;
+		typedef clock::time_point time_point;
+		typedef clock::duration duration;
+
+		//Request handed to the transport
+		time_point start;
+		time_point dns_start;
+		time_point dns_end;
+		time_point connect_start;
+		time_point connect_end;
+		time_point tls_start;
+		time_point tls_end;
+		//First byte of the request written, the connection is ready at this point
+		time_point request_start;
+		//Last byte of the request written
+		time_point request_end;
+		//Status line and headers of the final response received
+		time_point first_byte;
+		//Body received, or the request failed
+		time_point complete;
+
+		//The request went over a pooled connection (or an HTTP/2 session opened by another request)
+		bool connection_reused = false;
+		bool http2 = false;
+		bool failed = false;
+
+		static bool recorded(time_point point) { return point != time_point(); }
+
+		/// <summary>
+		/// Time between two phases, zero when one of them was not recorded.
+		/// </summary>
+		static duration between(time_point from, time_point to)
+		{
+			return recorded(from) && recorded(to) ? to - from : duration::zero();
+		}
+
+		duration dns() const { return between(dns_start, dns_end); }
+		duration connect() const { return between(connect_start, connect_end); }
+		duration tls() const { return between(tls_start, tls_end); }
+		duration request_write() const { return between(request_start, request_end); }
+		duration time_to_first_byte() const { return between(request_end, first_byte); }
+		duration body_transfer() const { return between(first_byte, complete); }
+		duration total() const { return between(start, complete); }
+	};
+}
@@ -18,6 +18,14 @@ namespace Concurrency::streams
 		virtual size_type snextcn(void* ptr, size_type size) = 0;
 		virtual pos_type pubseekoff(pos_type pos, std::ios_base::seekdir cur, std::ios_base::openmode mode) = 0;
 		virtual pos_type pubseekpos(pos_type pos, std::ios_base::openmode mode) = 0;
+
+		//Zero-copy access, same contract as basic_streambuf acquire/release and alloc/commit.
+		//Buffers without contiguous storage keep the defaults and are served through the copying calls above.
+		virtual bool acquire(const void*& ptr, size_type& count) { ptr = nullptr; count = 0; return false; }
+		virtual void release(const void* ptr, size_type count) { (void)ptr; (void)count; }
+		virtual void* alloc(size_type count) { (void)count; return nullptr; }
+		virtual void commit(size_type count) { (void)count; }
+
 		virtual CPPRESTNATIVE_API ~istreambuf_type_erasure();
 	};
 }
@@ -32,10 +32,6 @@ namespace json
     // Various forward declarations.
     namespace details
     {
-        class _Value;
-        class _Number;
-        class _Null;
-        class _Boolean;
         class _String;
         class _Object;
         class _Array;
@@ -55,15 +51,195 @@ namespace json
     /// <remarks>Note this is a global setting and affects all JSON parsing done.</remarks>
     void _ASYNCRTIMP __cdecl keep_object_element_order(bool keep_order);
 
-#ifdef _WIN32
-#ifdef _DEBUG
-#define ENABLE_JSON_VALUE_VISUALIZER
+    class array;
+    class object;
+    class document_value;
+
+    /// <summary>
+    /// A JSON number represented as a C++ class.
+    /// </summary>
+    class number
+    {
+        // Note that these constructors make sure that only negative integers are stored as signed int64 (while others convert to unsigned int64).
+        // This helps handling number objects e.g. comparing two numbers.
+
+        number(double value)  : m_value(value), m_type(double_type) { }
+        number(int32_t value) : m_intval(value), m_type(value < 0 ? signed_type : unsigned_type) { }
+        number(uint32_t value) : m_intval(value), m_type(unsigned_type) { }
+        number(int64_t value) : m_intval(value), m_type(value < 0 ? signed_type : unsigned_type) { }
+        number(uint64_t value) : m_uintval(value), m_type(unsigned_type) { }
+
+    public:
+
+        /// <summary>
+        /// Does the number fit into int32?
+        /// </summary>
+        /// <returns><c>true</c> if the number fits into int32, <c>false</c> otherwise</returns>
+        _ASYNCRTIMP bool is_int32() const;
+
+        /// <summary>
+        /// Does the number fit into unsigned int32?
+        /// </summary>
+        /// <returns><c>true</c> if the number fits into unsigned int32, <c>false</c> otherwise</returns>
+        _ASYNCRTIMP bool is_uint32() const;
+
+        /// <summary>
+        /// Does the number fit into int64?
+        /// </summary>
+        /// <returns><c>true</c> if the number fits into int64, <c>false</c> otherwise</returns>
+        _ASYNCRTIMP bool is_int64() const;
+
+        /// <summary>
+        /// Does the number fit into unsigned int64?
+        /// </summary>
+        /// <returns><c>true</c> if the number fits into unsigned int64, <c>false</c> otherwise</returns>
+        bool is_uint64() const
+        {
+            switch (m_type)
+            {
+            case signed_type : return m_intval >= 0;
+            case unsigned_type : return true;
+            case double_type :
+            default :
+                return false;
+            }
+        }
+
+        /// <summary>
+        /// Converts the JSON number to a C++ double.
+        /// </summary>
+        /// <returns>A double representation of the number</returns>
+        double to_double() const
+        {
+            switch (m_type)
+            {
+            case double_type : return m_value;
+            case signed_type : return static_cast<double>(m_intval);
+            case unsigned_type : return static_cast<double>(m_uintval);
+            default : return false;
+            }
+        }
+
+        /// <summary>
+        /// Converts the JSON number to int32.
+        /// </summary>
+        /// <returns>An int32 representation of the number</returns>
+        int32_t to_int32() const
+        {
+            if (m_type == double_type)
+                return static_cast<int32_t>(m_value);
+            else
+                return static_cast<int32_t>(m_intval);
+        }
+
+        /// <summary>
+        /// Converts the JSON number to unsigned int32.
+        /// </summary>
+        /// <returns>An usigned int32 representation of the number</returns>
+        uint32_t to_uint32() const
+        {
+            if (m_type == double_type)
+                return static_cast<uint32_t>(m_value);
+            else
+                return static_cast<uint32_t>(m_intval);
+        }
+
+        /// <summary>
+        /// Converts the JSON number to int64.
+        /// </summary>
+        /// <returns>An int64 representation of the number</returns>
+        int64_t to_int64() const
+        {
+            if (m_type == double_type)
+                return static_cast<int64_t>(m_value);
+            else
+                return static_cast<int64_t>(m_intval);
+        }
+
+        /// <summary>
+        /// Converts the JSON number to unsigned int64.
+        /// </summary>
+        /// <returns>An unsigned int64 representation of the number</returns>
+        uint64_t to_uint64() const
+        {
+            if (m_type == double_type)
+                return static_cast<uint64_t>(m_value);
+            else
+                return static_cast<uint64_t>(m_intval);
+        }
+
+        /// <summary>
+        /// Is the number represented internally as an integral type?
+        /// </summary>
+        /// <returns><c>true</c> if the number is represented as an integral type, <c>false</c> otherwise</returns>
+        bool is_integral() const
+        {
+            return m_type != double_type;
+        }
+
+        /// <summary>
+        /// Compares two JSON numbers for equality.
+        /// </summary>
+        /// <param name="other">The JSON number to compare with.</param>
+        /// <returns>True iff the numbers are equal.</returns>
+        bool operator==(const number &other) const
+        {
+            if (m_type != other.m_type)
+                return false;
+
+            switch (m_type)
+            {
+            case json::number::type::signed_type :
+                return m_intval == other.m_intval;
+            case json::number::type::unsigned_type :
+                return m_uintval == other.m_uintval;
+            case json::number::type::double_type :
+                return m_value == other.m_value;
+            default :
+                break;
+            }
+            __assume(0);
+            // Absence of this return statement provokes a warning from Intel
+            // compiler, but its presence results in a warning from MSVC, so
+            // we have to resort to conditional compilation to keep both happy.
+#ifdef __INTEL_COMPILER
+            return false;
 #endif
+        }
+
+    private:
+        // A json::value is a number whose type says what else it holds, so that
+        // it takes 16 bytes and still hands out references to its number.
+        number() : m_uintval(0), m_type(null_type) { }
+
+        void format(std::basic_string<char>& stream) const;
+#ifdef _WIN32
+        void format(std::basic_string<wchar_t>& stream) const;
 #endif
 
-    class number;
-    class array;
-    class object;
+        union
+        {
+            int64_t m_intval;
+            uint64_t m_uintval;
+            double  m_value;
+
+            // Other kinds of json::value.
+            bool m_bool;
+            details::_String* m_string;
+            details::_Object* m_object;
+            details::_Array* m_array;
+        };
+
+        enum type
+        {
+            signed_type=0, unsigned_type, double_type,
+            null_type, boolean_type, string_type, object_type, array_type
+        } m_type;
+
+        friend class value;
+        friend class details::_Object;
+        friend class document_value;
+    };
 
     /// <summary>
     /// A JSON value represented as a C++ class.
@@ -208,6 +384,15 @@ namespace json
         /// <returns>The JSON value object that contains the result of the assignment.</returns>
         _ASYNCRTIMP value &operator=(value &&) CPPREST_NOEXCEPT ;
 
+        /// <summary>
+        /// Destructor
+        /// </summary>
+        ~value()
+        {
+            if (has_storage())
+                release();
+        }
+
         // Static factories
 
         /// <summary>
@@ -327,7 +512,11 @@ public:
         /// Accesses the type of JSON value the current value instance is
         /// </summary>
         /// <returns>The value's type</returns>
-        _ASYNCRTIMP json::value::value_type type() const;
+        json::value::value_type type() const
+        {
+            static const value_type types[] = { Number, Number, Number, Null, Boolean, String, Object, Array };
+            return types[m_number.m_type];
+        }
 
         /// <summary>
         /// Is the current value a null value?
@@ -594,10 +783,9 @@ public:
 		_ASYNCRTIMP bool has_object_field(const utility::string_t &key) const;
 
         /// <summary>
-        /// Accesses a field of a JSON object.
+        /// Accesses a field of a JSON object. Always throws a json_exception, use at() instead.
         /// </summary>
         /// <param name="key">The name of the field</param>
-        /// <returns>The value kept in the field; null if the field does not exist</returns>
         CASABLANCA_DEPRECATED("This API is deprecated and will be removed in a future release, use json::value::at() instead.")
         value get(const utility::string_t &key) const;
 
@@ -660,10 +848,9 @@ public:
 #endif
 
         /// <summary>
-        /// Accesses an element of a JSON array.
+        /// Accesses an element of a JSON array. Always throws a json_exception, use at() instead.
         /// </summary>
         /// <param name="index">The index of an element in the JSON array</param>
-        /// <returns>The value kept at the array index; null if outside the boundaries of the array</returns>
         CASABLANCA_DEPRECATED("This API is deprecated and will be removed in a future release, use json::value::at() instead.")
         value get(size_t index) const;
 
@@ -692,17 +879,41 @@ public:
         /// <param name="string">The string that the JSON representation should be written to</param>
         _ASYNCRTIMP void format(std::basic_string<char>& string) const;
 
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-        explicit value(std::unique_ptr<details::_Value> v, value_type kind) : m_value(std::move(v)), m_kind(kind)
-#else
-        explicit value(std::unique_ptr<details::_Value> v) : m_value(std::move(v))
-#endif
-        {}
+        /// <summary>
+        /// Estimates the length of the serialized value, to reserve it up front.
+        /// </summary>
+        size_t get_reserve_size() const;
 
-        std::unique_ptr<details::_Value> m_value;
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-        value_type m_kind;
-#endif
+        explicit value(details::_String* string)
+        {
+            m_number.m_string = string;
+            m_number.m_type = json::number::string_type;
+        }
+
+        explicit value(details::_Object* object)
+        {
+            m_number.m_object = object;
+            m_number.m_type = json::number::object_type;
+        }
+
+        explicit value(details::_Array* array)
+        {
+            m_number.m_array = array;
+            m_number.m_type = json::number::array_type;
+        }
+
+        /// <summary>
+        /// Frees the string, array or object the value owns.
+        /// </summary>
+        _ASYNCRTIMP void release();
+
+        bool has_storage() const
+        {
+            return m_number.m_type >= json::number::string_type;
+        }
+
+        // Null, booleans and numbers are kept inline; strings, objects and arrays are owned through a pointer.
+        json::number m_number;
     };
 
     /// <summary>
@@ -996,6 +1207,11 @@ public:
     /// <summary>
     /// A JSON object represented as a C++ class.
     /// </summary>
+    /// <remarks>
+    /// Fields are kept in a vector, sorted by key unless the object keeps the order of its fields.
+    /// An object that keeps the order and grows past a few dozen fields also keeps a hash index of
+    /// its keys, so keys must not be changed through iterators.
+    /// </remarks>
     class object
     {
         typedef std::vector<std::pair<utility::string_t, json::value>> storage_type;
@@ -1014,6 +1230,7 @@ public:
             if (!keep_order) {
                 sort(m_elements.begin(), m_elements.end(), compare_pairs);
             }
+            reindex();
         }
 
     public:
@@ -1133,7 +1350,12 @@ public:
         /// <remarks>GCC doesn't support erase with const_iterator on vector yet. In the future this should be changed.</remarks>
         iterator erase(iterator position)
         {
-            return m_elements.erase(position);
+            auto next = m_elements.erase(position);
+            if (!m_index.empty())
+            {
+                reindex();
+            }
+            return next;
         }
 
         /// <summary>
@@ -1149,6 +1371,10 @@ public:
             }
 
             m_elements.erase(iter);
+            if (!m_index.empty())
+            {
+                reindex();
+            }
         }
 
         /// <summary>
@@ -1194,7 +1420,21 @@ public:
 
             if (iter == m_elements.end() || key != iter->first)
             {
-                return m_elements.insert(iter, std::pair<utility::string_t, value>(key, value()))->second;
+                if (!m_keep_order)
+                {
+                    return m_elements.insert(iter, std::pair<utility::string_t, value>(key, value()))->second;
+                }
+
+                m_elements.push_back(std::pair<utility::string_t, value>(key, value()));
+                if (2 * m_elements.size() > m_index.size())
+                {
+                    reindex();
+                }
+                else
+                {
+                    add_to_index(m_elements.size() - 1);
+                }
+                return m_elements.back().second;
             }
 
             return iter->second;
@@ -1240,7 +1480,11 @@ public:
 
         storage_type::iterator find_insert_location(const utility::string_t &key)
         {
-            if (m_keep_order)
+            if (!m_index.empty())
+            {
+                return m_elements.begin() + find_in_index(key);
+            }
+            else if (m_keep_order)
             {
                 return std::find_if(m_elements.begin(), m_elements.end(),
                     [&key](const std::pair<utility::string_t, value>& p) {
@@ -1255,7 +1499,11 @@ public:
 
         storage_type::const_iterator find_by_key(const utility::string_t& key) const
         {
-            if (m_keep_order)
+            if (!m_index.empty())
+            {
+                return m_elements.begin() + find_in_index(key);
+            }
+            else if (m_keep_order)
             {
                 return std::find_if(m_elements.begin(), m_elements.end(),
                     [&key](const std::pair<utility::string_t, value>& p) {
@@ -1283,338 +1531,79 @@ public:
             return iter;
         }
 
+        // Objects that keep the order of their fields are searched linearly up to this size.
+        static const size_type index_threshold = 32;
+
+        // Position of the first field with the key, or the size of the object if there is none.
+        size_type find_in_index(const utility::string_t& key) const
+        {
+            const size_t mask = m_index.size() - 1;
+            for (size_t slot = std::hash<utility::string_t>()(key) & mask; m_index[slot] != 0; slot = (slot + 1) & mask)
+            {
+                const size_type position = m_index[slot] - 1;
+                if (m_elements[position].first == key)
+                {
+                    return position;
+                }
+            }
+            return m_elements.size();
+        }
+
+        // Adds the field at a position to the index, unless an earlier field has the same key.
+        void add_to_index(size_type position)
+        {
+            const utility::string_t& key = m_elements[position].first;
+            const size_t mask = m_index.size() - 1;
+            size_t slot = std::hash<utility::string_t>()(key) & mask;
+            for (; m_index[slot] != 0; slot = (slot + 1) & mask)
+            {
+                if (m_elements[m_index[slot] - 1].first == key)
+                {
+                    return;
+                }
+            }
+            m_index[slot] = static_cast<uint32_t>(position + 1);
+        }
+
+        // Builds the index anew, with at least twice as many slots as fields, or drops it
+        // if the object is sorted or small.
+        void reindex()
+        {
+            m_index.clear();
+            if (!m_keep_order || m_elements.size() < index_threshold)
+            {
+                return;
+            }
+
+            size_t slots = 2 * index_threshold;
+            while (slots < 2 * m_elements.size())
+            {
+                slots *= 2;
+            }
+            m_index.assign(slots, 0);
+            for (size_type position = 0; position < m_elements.size(); ++position)
+            {
+                add_to_index(position);
+            }
+        }
+
         storage_type m_elements;
         bool m_keep_order;
+
+        // Open addressing with linear probing; each slot holds a position plus one, or zero if free.
+        std::vector<uint32_t> m_index;
+
         friend class details::_Object;
 
         template<typename CharType> friend class json::details::JSON_Parser;
    };
 
-    /// <summary>
-    /// A JSON number represented as a C++ class.
-    /// </summary>
-    class number
+
+    namespace details
     {
-        // Note that these constructors make sure that only negative integers are stored as signed int64 (while others convert to unsigned int64).
-        // This helps handling number objects e.g. comparing two numbers.
-
-        number(double value)  : m_value(value), m_type(double_type) { }
-        number(int32_t value) : m_intval(value), m_type(value < 0 ? signed_type : unsigned_type) { }
-        number(uint32_t value) : m_intval(value), m_type(unsigned_type) { }
-        number(int64_t value) : m_intval(value), m_type(value < 0 ? signed_type : unsigned_type) { }
-        number(uint64_t value) : m_uintval(value), m_type(unsigned_type) { }
-
-    public:
-
-        /// <summary>
-        /// Does the number fit into int32?
-        /// </summary>
-        /// <returns><c>true</c> if the number fits into int32, <c>false</c> otherwise</returns>
-        _ASYNCRTIMP bool is_int32() const;
-
-        /// <summary>
-        /// Does the number fit into unsigned int32?
-        /// </summary>
-        /// <returns><c>true</c> if the number fits into unsigned int32, <c>false</c> otherwise</returns>
-        _ASYNCRTIMP bool is_uint32() const;
-
-        /// <summary>
-        /// Does the number fit into int64?
-        /// </summary>
-        /// <returns><c>true</c> if the number fits into int64, <c>false</c> otherwise</returns>
-        _ASYNCRTIMP bool is_int64() const;
-
-        /// <summary>
-        /// Does the number fit into unsigned int64?
-        /// </summary>
-        /// <returns><c>true</c> if the number fits into unsigned int64, <c>false</c> otherwise</returns>
-        bool is_uint64() const
-        {
-            switch (m_type)
-            {
-            case signed_type : return m_intval >= 0;
-            case unsigned_type : return true;
-            case double_type :
-            default :
-                return false;
-            }
-        }
-
-        /// <summary>
-        /// Converts the JSON number to a C++ double.
-        /// </summary>
-        /// <returns>A double representation of the number</returns>
-        double to_double() const
-        {
-            switch (m_type)
-            {
-            case double_type : return m_value;
-            case signed_type : return static_cast<double>(m_intval);
-            case unsigned_type : return static_cast<double>(m_uintval);
-            default : return false;
-            }
-        }
-
-        /// <summary>
-        /// Converts the JSON number to int32.
-        /// </summary>
-        /// <returns>An int32 representation of the number</returns>
-        int32_t to_int32() const
-        {
-            if (m_type == double_type)
-                return static_cast<int32_t>(m_value);
-            else
-                return static_cast<int32_t>(m_intval);
-        }
-
-        /// <summary>
-        /// Converts the JSON number to unsigned int32.
-        /// </summary>
-        /// <returns>An usigned int32 representation of the number</returns>
-        uint32_t to_uint32() const
-        {
-            if (m_type == double_type)
-                return static_cast<uint32_t>(m_value);
-            else
-                return static_cast<uint32_t>(m_intval);
-        }
-
-        /// <summary>
-        /// Converts the JSON number to int64.
-        /// </summary>
-        /// <returns>An int64 representation of the number</returns>
-        int64_t to_int64() const
-        {
-            if (m_type == double_type)
-                return static_cast<int64_t>(m_value);
-            else
-                return static_cast<int64_t>(m_intval);
-        }
-
-        /// <summary>
-        /// Converts the JSON number to unsigned int64.
-        /// </summary>
-        /// <returns>An unsigned int64 representation of the number</returns>
-        uint64_t to_uint64() const
-        {
-            if (m_type == double_type)
-                return static_cast<uint64_t>(m_value);
-            else
-                return static_cast<uint64_t>(m_intval);
-        }
-
-        /// <summary>
-        /// Is the number represented internally as an integral type?
-        /// </summary>
-        /// <returns><c>true</c> if the number is represented as an integral type, <c>false</c> otherwise</returns>
-        bool is_integral() const
-        {
-            return m_type != double_type;
-        }
-
-        /// <summary>
-        /// Compares two JSON numbers for equality.
-        /// </summary>
-        /// <param name="other">The JSON number to compare with.</param>
-        /// <returns>True iff the numbers are equal.</returns>
-        bool operator==(const number &other) const
-        {
-            if (m_type != other.m_type)
-                return false;
-
-            switch (m_type)
-            {
-            case json::number::type::signed_type :
-                return m_intval == other.m_intval;
-            case json::number::type::unsigned_type :
-                return m_uintval == other.m_uintval;
-            case json::number::type::double_type :
-                return m_value == other.m_value;
-            }
-            __assume(0);
-            // Absence of this return statement provokes a warning from Intel
-            // compiler, but its presence results in a warning from MSVC, so
-            // we have to resort to conditional compilation to keep both happy.
-#ifdef __INTEL_COMPILER
-            return false;
-#endif
-        }
-
-    private:
-        union
-        {
-            int64_t m_intval;
-            uint64_t m_uintval;
-            double  m_value;
-        };
-
-        enum type
-        {
-            signed_type=0, unsigned_type, double_type
-        } m_type;
-
-        friend class details::_Number;
-    };
-
-    namespace details
-    {
-        class _Value
-        {
-        public:
-            virtual std::unique_ptr<_Value> _copy_value() = 0;
-
-            virtual bool has_field(const utility::string_t &) const { return false; }
-            virtual value get_field(const utility::string_t &) const { throw json_exception(_XPLATSTR("not an object")); }
-            virtual value get_element(array::size_type) const { throw json_exception(_XPLATSTR("not an array")); }
-
-            virtual value &index(const utility::string_t &) { throw json_exception(_XPLATSTR("not an object")); }
-            virtual value &index(array::size_type) { throw json_exception(_XPLATSTR("not an array")); }
-
-            virtual const value &cnst_index(const utility::string_t &) const { throw json_exception(_XPLATSTR("not an object")); }
-            virtual const value &cnst_index(array::size_type) const { throw json_exception(_XPLATSTR("not an array")); }
-
-            // Common function used for serialization to strings and streams.
-            virtual void serialize_impl(std::string& str) const
-            {
-                format(str);
-            }
-#ifdef _WIN32
-            virtual void serialize_impl(std::wstring& str) const
-            {
-                format(str);
-            }
-#endif
-
-            virtual utility::string_t to_string() const
-            {
-                utility::string_t str;
-                serialize_impl(str);
-                return str;
-            }
-
-            virtual json::value::value_type type() const { return json::value::Null; }
-
-            virtual bool is_integer() const { throw json_exception(_XPLATSTR("not a number")); }
-            virtual bool is_double() const { throw json_exception(_XPLATSTR("not a number")); }
-
-            virtual const json::number& as_number() { throw json_exception(_XPLATSTR("not a number")); }
-            virtual double as_double() const { throw json_exception(_XPLATSTR("not a number")); }
-            virtual int as_integer() const { throw json_exception(_XPLATSTR("not a number")); }
-            virtual bool as_bool() const { throw json_exception(_XPLATSTR("not a boolean")); }
-            virtual json::array& as_array() { throw json_exception(_XPLATSTR("not an array")); }
-            virtual const json::array& as_array() const { throw json_exception(_XPLATSTR("not an array")); }
-            virtual json::object& as_object() { throw json_exception(_XPLATSTR("not an object")); }
-            virtual const json::object& as_object() const { throw json_exception(_XPLATSTR("not an object")); }
-            virtual const utility::string_t& as_string() const { throw json_exception(_XPLATSTR("not a string")); }
-
-            virtual size_t size() const { return 0; }
-
-            virtual ~_Value() {}
-
-        protected:
-            _Value() {}
-
-            virtual void format(std::basic_string<char>& stream) const
-            {
-                stream.append("null");
-            }
-#ifdef _WIN32
-            virtual void format(std::basic_string<wchar_t>& stream) const
-            {
-                stream.append(L"null");
-            }
-#endif
-        private:
-
-            friend class web::json::value;
-        };
-
-        class _Null : public _Value
-        {
-        public:
-            virtual std::unique_ptr<_Value> _copy_value()
-            {
-                return utility::details::make_unique<_Null>();
-            }
-            virtual json::value::value_type type() const { return json::value::Null; }
-        };
-
-        class _Number : public _Value
-        {
-        public:
-            _Number(double value)  : m_number(value) { }
-            _Number(int32_t value) : m_number(value) { }
-            _Number(uint32_t value) : m_number(value) { }
-            _Number(int64_t value) : m_number(value) { }
-            _Number(uint64_t value) : m_number(value) { }
-
-            virtual std::unique_ptr<_Value> _copy_value()
-            {
-                return utility::details::make_unique<_Number>(*this);
-            }
-
-            virtual json::value::value_type type() const { return json::value::Number; }
-
-            virtual bool is_integer() const { return m_number.is_integral(); }
-            virtual bool is_double() const { return !m_number.is_integral(); }
-
-            virtual double as_double() const
-            {
-                return m_number.to_double();
-            }
-
-            virtual int as_integer() const
-            {
-                return m_number.to_int32();
-            }
-
-            virtual const number& as_number() { return m_number; }
-
-        protected:
-            virtual void format(std::basic_string<char>& stream) const ;
-#ifdef _WIN32
-            virtual void format(std::basic_string<wchar_t>& stream) const;
-#endif
-        private:
-            template<typename CharType> friend class json::details::JSON_Parser;
-
-            json::number m_number;
-        };
-
-        class _Boolean : public _Value
-        {
-        public:
-            _Boolean(bool value) : m_value(value) { }
-
-            virtual std::unique_ptr<_Value> _copy_value()
-            {
-                return utility::details::make_unique<_Boolean>(*this);
-            }
-
-            virtual json::value::value_type type() const { return json::value::Boolean; }
-
-            virtual bool as_bool() const { return m_value; }
-
-        protected:
-            virtual void format(std::basic_string<char>& stream) const
-            {
-                stream.append(m_value ? "true" : "false");
-            }
-
-#ifdef _WIN32
-            virtual void format(std::basic_string<wchar_t>& stream) const
-            {
-                stream.append(m_value ? L"true" : L"false");
-            }
-#endif
-        private:
-            template<typename CharType> friend class json::details::JSON_Parser;
-            bool m_value;
-        };
-
-        class _String : public _Value
-        {
-        public:
+        class _String
+        {
+        public:
 
             _String(utility::string_t value) : m_string(std::move(value))
             {
@@ -1636,50 +1625,23 @@ public:
             { }
 #endif
 
-            virtual std::unique_ptr<_Value> _copy_value()
+            const utility::string_t & as_string() const
             {
-                return utility::details::make_unique<_String>(*this);
+                return m_string;
             }
 
-            virtual json::value::value_type type() const { return json::value::String; }
-
-            virtual const utility::string_t & as_string() const;
-
-            virtual void serialize_impl(std::string& str) const
-            {
-                 serialize_impl_char_type(str);
-            }
-#ifdef _WIN32
-            virtual void serialize_impl(std::wstring& str) const
+            size_t get_reserve_size() const
             {
-                serialize_impl_char_type(str);
+                // size of string + 2 for quotes
+                return m_string.size() + 2;
             }
-#endif
 
-        protected:
-            virtual void format(std::basic_string<char>& str) const;
+            void format(std::basic_string<char>& str) const;
 #ifdef _WIN32
-            virtual void format(std::basic_string<wchar_t>& str) const;
+            void format(std::basic_string<wchar_t>& str) const;
 #endif
 
         private:
-            friend class _Object;
-            friend class _Array;
-
-            size_t get_reserve_size() const
-            {
-                return m_string.size() + 2;
-            }
-
-            template <typename CharType>
-            void serialize_impl_char_type(std::basic_string<CharType>& str) const
-            {
-                // To avoid repeated allocations reserve some space all up front.
-                // size of string + 2 for quotes
-                str.reserve(get_reserve_size());
-                format(str);
-            }
-
             std::string as_utf8_string() const;
             utf16string as_utf16_string() const;
 
@@ -1700,28 +1662,13 @@ public:
         void format_string(const utility::string_t& key, std::string& str);
 #endif
 
-        class _Object : public _Value
+        class _Object
         {
         public:
 
             _Object(bool keep_order) : m_object(keep_order) { }
             _Object(object::storage_type fields, bool keep_order) : m_object(std::move(fields), keep_order) { }
 
-            virtual std::unique_ptr<_Value> _copy_value()
-            {
-                return utility::details::make_unique<_Object>(*this);
-            }
-
-            virtual json::object& as_object() { return m_object; }
-
-            virtual const json::object& as_object() const { return m_object; }
-
-            virtual json::value::value_type type() const { return json::value::Object; }
-
-            virtual bool has_field(const utility::string_t &) const;
-
-            virtual json::value &index(const utility::string_t &key);
-
             bool is_equal(const _Object* other) const
             {
                 if (m_object.size() != other->m_object.size())
@@ -1730,41 +1677,8 @@ public:
                 return std::equal(std::begin(m_object), std::end(m_object), std::begin(other->m_object));
             }
 
-            virtual void serialize_impl(std::string& str) const
-            {
-                // To avoid repeated allocations reserve some space all up front.
-                str.reserve(get_reserve_size());
-                format(str);
-            }
-#ifdef _WIN32
-            virtual void serialize_impl(std::wstring& str) const
-            {
-                // To avoid repeated allocations reserve some space all up front.
-                str.reserve(get_reserve_size());
-                format(str);
-            }
-#endif
-            size_t size() const { return m_object.size(); }
-
-        protected:
-            virtual void format(std::basic_string<char>& str) const
-            {
-                format_impl(str);
-            }
-#ifdef _WIN32
-            virtual void format(std::basic_string<wchar_t>& str) const
-            {
-                format_impl(str);
-            }
-#endif
-
-        private:
-            json::object m_object;
-
-            template<typename CharType> friend class json::details::JSON_Parser;
-
             template<typename CharType>
-            void format_impl(std::basic_string<CharType>& str) const
+            void format(std::basic_string<CharType>& str) const
             {
                 str.push_back('{');
                 if(!m_object.empty())
@@ -1796,9 +1710,9 @@ public:
                     size_t valueSize = iter->second.size() * 20; // Multipler by each object/array element
                     if(valueSize == 0)
                     {
-                        if(iter->second.type() == json::value::String)
+                        if(iter->second.is_string())
                         {
-                            valueSize = static_cast<_String *>(iter->second.m_value.get())->get_reserve_size();
+                            valueSize = iter->second.m_number.m_string->get_reserve_size();
                         }
                         else
                         {
@@ -1809,30 +1723,20 @@ public:
                 }
                 return reserveSize;
             }
+
+        private:
+            friend class web::json::value;
+
+            json::object m_object;
         };
 
-        class _Array : public _Value
+        class _Array
         {
         public:
             _Array() {}
             _Array(array::size_type size) : m_array(size) {}
             _Array(array::storage_type elements) : m_array(std::move(elements)) { }
 
-            virtual std::unique_ptr<_Value> _copy_value()
-            {
-                return utility::details::make_unique<_Array>(*this);
-            }
-
-            virtual json::value::value_type type() const { return json::value::Array; }
-
-            virtual json::array& as_array() { return m_array; }
-            virtual const json::array& as_array() const { return m_array; }
-
-            virtual json::value &index(json::array::size_type index)
-            {
-                return m_array[index];
-            }
-
             bool is_equal(const _Array* other) const
             {
                 if ( m_array.size() != other->m_array.size())
@@ -1852,40 +1756,8 @@ public:
                 return true;
             }
 
-            virtual void serialize_impl(std::string& str) const
-            {
-                // To avoid repeated allocations reserve some space all up front.
-                str.reserve(get_reserve_size());
-                format(str);
-            }
-#ifdef _WIN32
-            virtual void serialize_impl(std::wstring& str) const
-            {
-                // To avoid repeated allocations reserve some space all up front.
-                str.reserve(get_reserve_size());
-                format(str);
-            }
-#endif
-            size_t size() const { return m_array.size(); }
-
-        protected:
-            virtual void format(std::basic_string<char>& str) const
-            {
-                format_impl(str);
-            }
-#ifdef _WIN32
-            virtual void format(std::basic_string<wchar_t>& str) const
-            {
-                format_impl(str);
-            }
-#endif
-        private:
-            json::array m_array;
-
-            template<typename CharType> friend class json::details::JSON_Parser;
-
             template<typename CharType>
-            void format_impl(std::basic_string<CharType>& str) const
+            void format(std::basic_string<CharType>& str) const
             {
                 str.push_back('[');
                 if(!m_array.m_elements.empty())
@@ -1917,6 +1789,11 @@ public:
                 }
                 return reserveSize;
             }
+
+        private:
+            friend class web::json::value;
+
+            json::array m_array;
         };
     } // namespace details
 
@@ -1926,7 +1803,12 @@ public:
     /// <returns>The number of children. 0 for all non-composites.</returns>
     inline size_t json::value::size() const
     {
-        return m_value->size();
+        switch (m_number.m_type)
+        {
+        case json::number::object_type: return m_number.m_object->m_object.size();
+        case json::number::array_type: return m_number.m_array->m_array.size();
+        default: return 0;
+        }
     }
 
     /// <summary>
@@ -1936,27 +1818,28 @@ public:
     /// <returns>True if the field exists, false otherwise.</returns>
     inline bool json::value::has_field(const utility::string_t& key) const
     {
-        return m_value->has_field(key);
+        if (!is_object())
+            return false;
+        const json::object &fields = m_number.m_object->m_object;
+        return fields.find(key) != fields.end();
     }
 
     /// <summary>
-    /// Access a field of a JSON object.
+    /// Access a field of a JSON object. Kept throwing for every value, as callers of the deprecated API rely on it.
     /// </summary>
     /// <param name="key">The name of the field</param>
-    /// <returns>The value kept in the field; null if the field does not exist</returns>
-    inline json::value json::value::get(const utility::string_t& key) const
+    inline json::value json::value::get(const utility::string_t&) const
     {
-        return m_value->get_field(key);
+        throw json_exception(_XPLATSTR("not an object"));
     }
 
     /// <summary>
-    /// Access an element of a JSON array.
+    /// Access an element of a JSON array. Kept throwing for every value, as callers of the deprecated API rely on it.
     /// </summary>
     /// <param name="index">The index of an element in the JSON array</param>
-    /// <returns>The value kept at the array index; null if outside the boundaries of the array</returns>
-    inline json::value json::value::get(size_t index) const
+    inline json::value json::value::get(size_t) const
     {
-        return m_value->get_element(index);
+        throw json_exception(_XPLATSTR("not an array"));
     }
 
     /// <summary>
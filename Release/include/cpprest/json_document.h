@@ -0,0 +1,249 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* HTTP Library: read-only JSON documents allocated from an arena
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string_view>
+#include "cpprest/json.h"
+#include "cpprest/json_reader.h"
+
+namespace web
+{
+namespace json
+{
+    namespace details
+    {
+        /// <summary>
+        /// Monotonic memory the nodes, names and strings of a document are carved from.
+        /// Nothing is released before the arena itself, which frees its few blocks at once.
+        /// </summary>
+        class _Document_arena
+        {
+        public:
+            _ASYNCRTIMP explicit _Document_arena(size_t initial_size);
+            _ASYNCRTIMP ~_Document_arena();
+
+            _ASYNCRTIMP void* allocate(size_t size, size_t alignment);
+
+            template <typename T>
+            T* allocate_array(size_t count)
+            {
+                return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+            }
+
+            /// <summary>
+            /// Number of bytes reserved from the system.
+            /// </summary>
+            size_t reserved() const { return m_reserved; }
+
+        private:
+            _Document_arena(const _Document_arena&);
+            _Document_arena& operator=(const _Document_arena&);
+
+            struct _Block
+            {
+                _Block* m_next;
+            };
+
+            _Block* m_blocks;
+            char* m_cursor;
+            char* m_end;
+            size_t m_next_size;
+            size_t m_reserved;
+        };
+
+        struct _Document_field;
+        class _Document_builder;
+
+        /// <summary>
+        /// One value of a document. Containers point to their children, laid out contiguously in the arena.
+        /// </summary>
+        struct _Document_node
+        {
+            enum number_type : uint8_t
+            {
+                signed_type = 0, unsigned_type, double_type
+            };
+
+            union
+            {
+                int64_t m_intval;
+                uint64_t m_uintval;
+                double m_double;
+                bool m_bool;
+                const utility::char_t* m_string;
+                const _Document_node* m_elements;
+                const _Document_field* m_fields;
+            };
+
+            // Characters of a string, elements of an array or fields of an object.
+            uint32_t m_size;
+            uint8_t m_type;
+            number_type m_number_type;
+        };
+
+        struct _Document_field
+        {
+            const utility::char_t* m_name;
+            uint32_t m_name_size;
+            _Document_node m_value;
+        };
+    }
+
+    /// <summary>
+    /// A read-only view of one value of a <see cref="document"/>. It is only valid as long as the document is.
+    /// </summary>
+    class document_value
+    {
+    public:
+        typedef std::basic_string_view<utility::char_t> string_view_t;
+
+        /// <summary>
+        /// Constructs a null value that belongs to no document.
+        /// </summary>
+        document_value() : m_node(nullptr) { }
+
+        json::value::value_type type() const
+        {
+            return m_node == nullptr ? json::value::Null : static_cast<json::value::value_type>(m_node->m_type);
+        }
+
+        bool is_null() const { return type() == json::value::Null; }
+        bool is_number() const { return type() == json::value::Number; }
+        bool is_boolean() const { return type() == json::value::Boolean; }
+        bool is_string() const { return type() == json::value::String; }
+        bool is_array() const { return type() == json::value::Array; }
+        bool is_object() const { return type() == json::value::Object; }
+
+        /// <summary>
+        /// Is the current value a number without a fraction or an exponent?
+        /// </summary>
+        bool is_integer() const { return as_number().is_integral(); }
+
+        /// <summary>
+        /// Is the current value a number with a fraction or an exponent?
+        /// </summary>
+        bool is_double() const { return !as_number().is_integral(); }
+
+        /// <summary>
+        /// Number of elements of an array or fields of an object. 0 for all non-composites.
+        /// </summary>
+        size_t size() const
+        {
+            return is_array() || is_object() ? m_node->m_size : 0;
+        }
+
+        _ASYNCRTIMP json::number as_number() const;
+
+        double as_double() const { return as_number().to_double(); }
+
+        int as_integer() const { return as_number().to_int32(); }
+
+        _ASYNCRTIMP bool as_bool() const;
+
+        /// <summary>
+        /// The characters of a string value, stored in the document.
+        /// </summary>
+        _ASYNCRTIMP string_view_t as_string() const;
+
+        /// <summary>
+        /// Accesses an element of an array.
+        /// </summary>
+        /// <remarks>Throws a <see cref="json_exception"/> if the value is not an array or the index is out of range.</remarks>
+        _ASYNCRTIMP document_value at(size_t index) const;
+
+        /// <summary>
+        /// Accesses a field of an object. Fields keep the order of the document and are searched linearly.
+        /// </summary>
+        /// <remarks>Throws a <see cref="json_exception"/> if the value is not an object or has no such field.</remarks>
+        _ASYNCRTIMP document_value at(string_view_t key) const;
+
+        /// <summary>
+        /// Tests for the presence of a field. Always false if the value is not an object.
+        /// </summary>
+        _ASYNCRTIMP bool has_field(string_view_t key) const;
+
+        /// <summary>
+        /// Name of the field at a position of an object, in document order.
+        /// </summary>
+        _ASYNCRTIMP string_view_t field_name(size_t index) const;
+
+        /// <summary>
+        /// Value of the field at a position of an object, in document order.
+        /// </summary>
+        _ASYNCRTIMP document_value field_value(size_t index) const;
+
+        /// <summary>
+        /// Copies the value and everything under it to a mutable <see cref="json::value"/>.
+        /// </summary>
+        _ASYNCRTIMP json::value to_value() const;
+
+    private:
+        friend class document;
+
+        explicit document_value(const details::_Document_node* node) : m_node(node) { }
+
+        const details::_Document_field* find_field(string_view_t key) const;
+
+        const details::_Document_node* m_node;
+    };
+
+    /// <summary>
+    /// A parsed JSON document whose nodes, field names and strings all live in one arena it owns.
+    /// </summary>
+    /// <remarks>
+    /// Parsing into a document allocates a few growing blocks instead of one object per value,
+    /// name and string, and destroying it releases those blocks without walking the tree.
+    /// Documents cannot be modified; use <see cref="document_value::to_value"/> for a mutable copy.
+    /// Copies share the arena, and concurrent reads of one document are safe.
+    /// </remarks>
+    class document
+    {
+    public:
+        /// <summary>
+        /// Constructs an empty document, whose root is null.
+        /// </summary>
+        document() : m_root(nullptr) { }
+
+        /// <summary>
+        /// The top-level value of the document.
+        /// </summary>
+        document_value root() const { return document_value(m_root); }
+
+        /// <summary>
+        /// Number of bytes the document holds, including the unused end of its last block.
+        /// </summary>
+        size_t memory_size() const { return m_arena ? m_arena->reserved() : 0; }
+
+        /// <summary>
+        /// Parses a string into a document.
+        /// </summary>
+        /// <remarks>Malformed input is reported by throwing <see cref="json_exception"/>, as <c>value::parse</c> does.</remarks>
+        _ASYNCRTIMP static document __cdecl parse(const utility::string_t &value);
+
+        /// <summary>
+        /// Parses a UTF-8 document from an asynchronous stream, a chunk at a time as data arrives.
+        /// </summary>
+        /// <param name="stream">The stream to read the document from.</param>
+        /// <returns>A task that completes with the document, or with a <see cref="json_exception"/> if it is malformed.</returns>
+        _ASYNCRTIMP static pplx::task<document> __cdecl parse(concurrency::streams::istream stream);
+
+    private:
+        friend class details::_Document_builder;
+
+        std::shared_ptr<details::_Document_arena> m_arena;
+        const details::_Document_node* m_root;
+    };
+}
+}
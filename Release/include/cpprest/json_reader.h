@@ -0,0 +1,130 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* HTTP Library: event based JSON reader
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+#pragma once
+
+#include <cstdint>
+#include "cpprest/json.h"
+#include "cpprest/streams.h"
+
+namespace web
+{
+namespace json
+{
+    /// <summary>
+    /// Receives the events of a JSON document read by <see cref="json_reader"/>, in document order.
+    /// </summary>
+    /// <remarks>
+    /// Every event returns <c>true</c> to continue reading and <c>false</c> to stop. The default
+    /// implementations ignore the event, so a handler only overrides the events it is interested in.
+    /// </remarks>
+    class json_handler
+    {
+    public:
+        virtual ~json_handler() {}
+
+        /// <summary>
+        /// An object starts. Its fields follow as a key event and a value each, then <c>end_object</c>.
+        /// </summary>
+        virtual bool start_object() { return true; }
+
+        /// <summary>
+        /// The name of the next field of the current object.
+        /// </summary>
+        virtual bool key(const utility::string_t &name) { (void)name; return true; }
+
+        /// <summary>
+        /// The current object ends.
+        /// </summary>
+        virtual bool end_object() { return true; }
+
+        /// <summary>
+        /// An array starts. Its elements follow, then <c>end_array</c>.
+        /// </summary>
+        virtual bool start_array() { return true; }
+
+        /// <summary>
+        /// The current array ends.
+        /// </summary>
+        virtual bool end_array() { return true; }
+
+        /// <summary>
+        /// A string value, with its escape sequences already resolved.
+        /// </summary>
+        virtual bool string_value(const utility::string_t &value) { (void)value; return true; }
+
+        /// <summary>
+        /// An integral number that fits a signed 64-bit integer and is negative.
+        /// </summary>
+        virtual bool number_value(int64_t value) { (void)value; return true; }
+
+        /// <summary>
+        /// A non-negative integral number that fits an unsigned 64-bit integer.
+        /// </summary>
+        virtual bool number_value(uint64_t value) { (void)value; return true; }
+
+        /// <summary>
+        /// A number with a fraction or an exponent, or an integer too large for 64 bits.
+        /// </summary>
+        virtual bool number_value(double value) { (void)value; return true; }
+
+        /// <summary>
+        /// A <c>true</c> or <c>false</c> literal.
+        /// </summary>
+        virtual bool boolean_value(bool value) { (void)value; return true; }
+
+        /// <summary>
+        /// A <c>null</c> literal.
+        /// </summary>
+        virtual bool null_value() { return true; }
+    };
+
+    /// <summary>
+    /// Reads JSON documents as a sequence of <see cref="json_handler"/> events, without building
+    /// a <see cref="value"/>.
+    /// </summary>
+    /// <remarks>
+    /// Memory use does not depend on the size of the document: only the nesting of the containers
+    /// is kept, and the longest string, number or comment bounds the input buffered at once.
+    /// Malformed input is reported by throwing <see cref="json_exception"/>, as <c>value::parse</c> does.
+    /// </remarks>
+    class json_reader
+    {
+    public:
+        /// <summary>
+        /// Default number of bytes requested from the stream at a time.
+        /// </summary>
+        static const size_t default_chunk_size = 64 * 1024;
+
+        /// <summary>
+        /// Reads one UTF-8 JSON document from an asynchronous stream, a chunk at a time as data arrives.
+        /// </summary>
+        /// <param name="stream">The stream to read the document from.</param>
+        /// <param name="handler">Receives the events. It must outlive the returned task.</param>
+        /// <param name="chunk_size">Number of bytes requested from the stream at a time.</param>
+        /// <returns>
+        /// A task that completes with <c>true</c> once the whole document was read, or with <c>false</c>
+        /// when the handler stopped the reading. In the latter case the stream is left somewhere after
+        /// the last event delivered.
+        /// </returns>
+        _ASYNCRTIMP static pplx::task<bool> __cdecl read(concurrency::streams::istream stream, json_handler &handler, size_t chunk_size = default_chunk_size);
+
+        /// <summary>
+        /// Reads one JSON document from a string.
+        /// </summary>
+        /// <param name="value">The JSON text.</param>
+        /// <param name="handler">Receives the events.</param>
+        /// <returns><c>true</c> once the whole document was read, <c>false</c> when the handler stopped the reading.</returns>
+        _ASYNCRTIMP static bool __cdecl read(const utility::string_t &value, json_handler &handler);
+    };
+}
+}
@@ -0,0 +1,194 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Library-wide counters and latency histograms, readable as a JSON snapshot.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include "cpprest/details/cpprest_compat.h"
+
+namespace web { namespace json { class value; } }
+
+namespace utility { namespace metrics {
+
+/// <summary>
+/// Number of slots every metric is spread over, so that threads updating the same metric
+/// do not contend on one cache line.
+/// </summary>
+const size_t shard_count = 8;
+
+namespace details
+{
+    /// <summary>
+    /// Slot of the calling thread. Threads are assigned round robin on their first update.
+    /// </summary>
+    inline size_t current_shard()
+    {
+        static std::atomic<size_t> next_shard(0);
+        thread_local const size_t shard = next_shard.fetch_add(1, std::memory_order_relaxed) % shard_count;
+        return shard;
+    }
+}
+
+/// <summary>
+/// Signed counter; also used as a gauge (values in flight, bytes buffered) through add and sub.
+/// </summary>
+/// <remarks>Updates are relaxed atomic additions on the slot of the calling thread, reads sum all slots.</remarks>
+class counter
+{
+public:
+    counter() {}
+    counter(const counter&) = delete;
+    counter& operator=(const counter&) = delete;
+
+    void add(int64_t amount = 1) { m_shards[details::current_shard()].value.fetch_add(amount, std::memory_order_relaxed); }
+
+    void sub(int64_t amount = 1) { add(-amount); }
+
+    int64_t value() const
+    {
+        int64_t total = 0;
+        for (const auto& shard : m_shards)
+            total += shard.value.load(std::memory_order_relaxed);
+        return total;
+    }
+
+private:
+    struct alignas(64) slot
+    {
+        std::atomic<int64_t> value { 0 };
+    };
+
+    slot m_shards[shard_count];
+};
+
+/// <summary>
+/// Summary of a histogram at one point in time. Percentiles are upper bounds of the bucket holding them.
+/// </summary>
+struct histogram_summary
+{
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+    uint64_t p50 = 0;
+    uint64_t p90 = 0;
+    uint64_t p99 = 0;
+    uint64_t p999 = 0;
+};
+
+/// <summary>
+/// Log-linear histogram in the HDR style: every power of two is split into 8 buckets, so a recorded value
+/// is known within 12.5% from 0 up to the full 64-bit range.
+/// </summary>
+class histogram
+{
+public:
+    static const unsigned sub_bucket_bits = 3;
+    static const size_t sub_bucket_count = size_t(1) << sub_bucket_bits;
+    static const size_t bucket_count = (64 - sub_bucket_bits + 1) * sub_bucket_count;
+
+    histogram() {}
+    histogram(const histogram&) = delete;
+    histogram& operator=(const histogram&) = delete;
+
+    _ASYNCRTIMP void record(uint64_t value);
+
+    /// <summary>
+    /// Records a duration in microseconds, the unit of every latency histogram of the library.
+    /// </summary>
+    template<typename Rep, typename Period>
+    void record(std::chrono::duration<Rep, Period> elapsed)
+    {
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(elapsed).count();
+        record(us > 0 ? static_cast<uint64_t>(us) : 0);
+    }
+
+    _ASYNCRTIMP histogram_summary summary() const;
+
+    _ASYNCRTIMP static size_t bucket_index(uint64_t value);
+
+    /// <summary>
+    /// Largest value that falls into a bucket.
+    /// </summary>
+    _ASYNCRTIMP static uint64_t bucket_upper_bound(size_t index);
+
+private:
+    struct alignas(64) slot
+    {
+        std::atomic<uint64_t> buckets[bucket_count] = {};
+        std::atomic<uint64_t> sum { 0 };
+    };
+
+    slot m_shards[shard_count];
+};
+
+/// <summary>
+/// The metrics maintained by the library. Names in the snapshot are given next to each member.
+/// </summary>
+struct library_metrics
+{
+    // http.requests_in_flight: requests sent and not completed yet.
+    counter http_requests_in_flight;
+    // http.requests_completed, http.requests_failed.
+    counter http_requests_completed;
+    counter http_requests_failed;
+    // http.request_body_bytes, http.response_body_bytes: message bodies handed to and received from the transport.
+    counter http_request_body_bytes;
+    counter http_response_body_bytes;
+    // http.pool_hits, http.pool_misses: requests served by a kept-alive connection (or HTTP/2 session), or needing a new one.
+    counter http_pool_hits;
+    counter http_pool_misses;
+    // http.request_duration_us: from sending the request to its completion.
+    histogram http_request_duration;
+
+    // pplx.queue_depth: tasks scheduled and not started yet.
+    counter pplx_queue_depth;
+    // pplx.tasks_executed.
+    counter pplx_tasks_executed;
+    // pplx.task_execution_us.
+    histogram pplx_task_execution;
+    // pplx.blocking_waits: waits of pool threads on a pplx event (task::wait, task::get) that had to block.
+    counter pplx_blocking_waits;
+    // pplx.threads_blocked: pool threads blocked in such a wait right now.
+    counter pplx_threads_blocked;
+    // pplx.compensating_threads_started: threads added to the shared pool because its threads were blocked.
+    counter pplx_compensating_threads_started;
+    // pplx.timers_pending: timers of the timer service started and not fired or canceled yet.
+    counter pplx_timers_pending;
+    // pplx.timers_fired.
+    counter pplx_timers_fired;
+
+    // streams.producer_consumer_buffered_bytes: written to producer_consumer_buffers and not read yet.
+    counter streams_buffered_bytes;
+
+    // json.documents_parsed, json.bytes_parsed, json.parse_duration_us.
+    counter json_documents_parsed;
+    counter json_bytes_parsed;
+    histogram json_parse_duration;
+};
+
+/// <summary>
+/// The metrics of the library, shared by the whole process.
+/// </summary>
+_ASYNCRTIMP library_metrics& library();
+
+/// <summary>
+/// Serializes every metric: {"counters": {name: value}, "histograms": {name: {count, sum, max, p50, p90, p99, p999}}}.
+/// </summary>
+/// <remarks>Slots are read one by one while other threads keep updating them, so related values may be
+/// slightly out of step with each other.</remarks>
+_ASYNCRTIMP web::json::value snapshot();
+
+}} // namespace utility::metrics
@@ -23,6 +23,7 @@
 
 #include "pplx/pplxtasks.h"
 #include "cpprest/astreambuf.h"
+#include "cpprest/metrics.h"
 
 namespace Concurrency { namespace streams {
 
@@ -66,6 +67,7 @@ namespace Concurrency { namespace streams {
                 this->_close_write();
 
                 _ASSERTE(m_requests.empty());
+                utility::metrics::library().streams_buffered_bytes.sub(static_cast<int64_t>(m_total * sizeof(_CharType)));
                 m_blocks.clear();
             }
 
@@ -359,6 +361,7 @@ namespace Concurrency { namespace streams {
             {
                 m_total += count;
                 m_total_written += count;
+                utility::metrics::library().streams_buffered_bytes.add(static_cast<int64_t>(count * sizeof(_CharType)));
                 fulfill_outstanding();
             }
 
@@ -615,6 +618,7 @@ namespace Concurrency { namespace streams {
             {
                 m_total -= count;
                 m_total_read += count;
+                utility::metrics::library().streams_buffered_bytes.sub(static_cast<int64_t>(count * sizeof(_CharType)));
 
                 if ( m_synced > 0 )
                     m_synced = (m_synced > count) ? (m_synced-count) : 0;
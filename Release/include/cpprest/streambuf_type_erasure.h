@@ -103,7 +103,7 @@ namespace Concurrency::streams
 		}
 		virtual pplx::task<int_type> _ungetc()
 		{
-			throw std::logic_error("Not implemented " __FUNCSIG__);
+			throw std::logic_error(std::string("Not implemented ") + __FUNCSIG__);
 			/*return pplx::task_from_result<int_type>(m_buffer->sungetc());*/
 		}
 
@@ -111,16 +111,24 @@ namespace Concurrency::streams
 		virtual pos_type seekpos(pos_type pos, std::ios_base::openmode mode) { return m_buffer->pubseekpos(pos*sizeof(_CharType), mode); }
 		virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode mode) { return m_buffer->pubseekoff(off, dir, mode)/sizeof(_CharType); }
 
-		virtual _CharType* _alloc(size_t) { return nullptr; }
-		virtual void _commit(size_t) { throw std::logic_error("Not implemented " __FUNCSIG__); }
+		virtual _CharType* _alloc(size_t count) { return this->can_write() ? static_cast<_CharType*>(m_buffer->alloc(count * sizeof(_CharType))) : nullptr; }
+		virtual void _commit(size_t count) { m_buffer->commit(count * sizeof(_CharType)); }
 
 		virtual bool acquire(_CharType*& ptr, size_t& count) 
 		{
-			ptr = nullptr;
-			count = 0;
-			return false;
+			const void* data = nullptr;
+			istreambuf_type_erasure::size_type available = 0;
+			if (!this->can_read() || !m_buffer->acquire(data, available))
+			{
+				ptr = nullptr;
+				count = 0;
+				return false;
+			}
+			ptr = const_cast<_CharType*>(static_cast<const _CharType*>(data));
+			count = static_cast<size_t>(available) / sizeof(_CharType);
+			return true;
 		}
-		virtual void release(_CharType *, size_t) { throw std::logic_error("Not implemented " __FUNCSIG__); }
+		virtual void release(_CharType *ptr, size_t count) { m_buffer->release(ptr, count * sizeof(_CharType)); }
 
 		template<typename CharType> friend class concurrency::streams::stdio_ostream;
 		template<typename CharType> friend class concurrency::streams::stdio_istream;
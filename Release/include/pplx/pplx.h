@@ -51,7 +51,10 @@
 
 // Common implementation across all the non-concrt versions
 #include "pplx/pplxcancellation_token.h"
+#include <cstddef>
 #include <functional>
+#include <memory>
+#include <new>
 
 // conditional expression is constant
 #if defined(_MSC_VER)
@@ -92,6 +95,53 @@ namespace details
         _Interruption_exception(){}
     };
 
+    /// <summary>
+    /// Allocates from per-thread pools of small blocks, for the task impls, continuation handles and completion
+    /// events created by every then(). Blocks of up to 512 bytes come from slabs that are kept for the life of the
+    /// process, larger ones from operator new. The block must be freed with the size it was allocated with.
+    /// </summary>
+    _PPLXIMP void* _pplx_cdecl _Allocate_pooled(size_t _Size);
+
+    _PPLXIMP void _pplx_cdecl _Free_pooled(void* _Ptr, size_t _Size);
+
+    template<typename _Ty>
+    struct _Pool_allocator
+    {
+        typedef _Ty value_type;
+
+        _Pool_allocator() {}
+
+        template<typename _Other>
+        _Pool_allocator(const _Pool_allocator<_Other>&) {}
+
+        _Ty* allocate(size_t _Count)
+        {
+            if (alignof(_Ty) > alignof(std::max_align_t))
+                return std::allocator<_Ty>().allocate(_Count);
+            return static_cast<_Ty*>(_Allocate_pooled(_Count * sizeof(_Ty)));
+        }
+
+        void deallocate(_Ty* _Ptr, size_t _Count)
+        {
+            if (alignof(_Ty) > alignof(std::max_align_t))
+                std::allocator<_Ty>().deallocate(_Ptr, _Count);
+            else
+                _Free_pooled(_Ptr, _Count * sizeof(_Ty));
+        }
+
+        template<typename _Other>
+        bool operator==(const _Pool_allocator<_Other>&) const { return true; }
+
+        template<typename _Other>
+        bool operator!=(const _Pool_allocator<_Other>&) const { return false; }
+    };
+
+    template<typename _Ty, typename... _Args>
+    std::shared_ptr<_Ty> _Make_pooled_shared(_Args&&... _As)
+    {
+        return std::allocate_shared<_Ty>(_Pool_allocator<_Ty>(), std::forward<_Args>(_As)...);
+    }
+
     template<typename _T>
     struct _AutoDeleter
     {
@@ -109,6 +159,28 @@ namespace details
         virtual ~_TaskProcHandle() {}
         virtual void invoke() const = 0;
 
+        // Handles are created for every task and continuation, and deleted once they have run.
+        static void* operator new(size_t _Size)
+        {
+            return _Allocate_pooled(_Size);
+        }
+
+        static void operator delete(void* _Ptr, size_t _Size)
+        {
+            _Free_pooled(_Ptr, _Size);
+        }
+
+        // Functors aligned beyond the pool blocks get their own allocation.
+        static void* operator new(size_t _Size, std::align_val_t _Align)
+        {
+            return ::operator new(_Size, _Align);
+        }
+
+        static void operator delete(void* _Ptr, size_t _Size, std::align_val_t _Align)
+        {
+            ::operator delete(_Ptr, _Size, _Align);
+        }
+
         static void _pplx_cdecl _RunChoreBridge(void * _Parameter)
         {
             auto _PTaskHandle = static_cast<_TaskProcHandle *>(_Parameter);
@@ -121,12 +193,44 @@ namespace details
     {
         // Disable inline scheduling
         _NoInline = 0,
-        // Let runtime decide whether to do inline scheduling or not
+        // Let runtime decide whether to do inline scheduling or not. Continuations attached to completed tasks run
+        // inline unless this many tasks already run inline on the thread's stack, everything else is scheduled
         _DefaultAutoInline = 16,
         // Always do inline scheduling
         _ForceInline = -1,
     };
 
+    /// <summary>
+    /// Counts the tasks running inline on the current thread.
+    /// </summary>
+    struct _Inline_depth
+    {
+        _Inline_depth()
+        {
+            ++_Value();
+        }
+
+        ~_Inline_depth()
+        {
+            --_Value();
+        }
+
+        static int& _Value()
+        {
+            static thread_local int _Depth = 0;
+            return _Depth;
+        }
+
+        static bool _Can_inline(_TaskInliningMode _InliningMode)
+        {
+            return _InliningMode == _ForceInline || (_InliningMode != _NoInline && _Value() < _InliningMode);
+        }
+
+    private:
+        _Inline_depth(const _Inline_depth&);
+        _Inline_depth& operator=(const _Inline_depth&);
+    };
+
     // This is an abstraction that is built on top of the scheduler to provide these additional functionalities
     // - Ability to wait on a work item
     // - Ability to cancel a work item
@@ -146,6 +250,7 @@ namespace details
         {
             if (_InliningMode == _ForceInline)
             {
+                _Inline_depth _Depth;
                 _TaskProcHandle_t::_RunChoreBridge(_PTaskHandle);
             }
             else
@@ -185,6 +290,7 @@ namespace details
         {
             if (_InliningMode == _ForceInline)
             {
+                _Inline_depth _Depth;
                 _Proc(_Parameter);
             }
             else
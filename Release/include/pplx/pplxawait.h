@@ -0,0 +1,245 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* C++20 coroutine support for pplx tasks: co_await on task<T>, and task<T> as a coroutine return type.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#pragma once
+
+#ifndef _PPLXAWAIT_H
+#define _PPLXAWAIT_H
+
+#include "pplx/pplxtasks.h"
+
+// Only standard coroutines are supported. With Visual Studio's /await, use <pplawait.h> instead; do not include both.
+#if defined(__cpp_impl_coroutine) && __cpp_impl_coroutine >= 201902L
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+namespace pplx
+{
+namespace details
+{
+    /// <summary>
+    /// Set while a coroutine returning a task completes that task. The first coroutine resumed by the completion
+    /// is parked here instead of being resumed in place, and the completing coroutine transfers to it once done,
+    /// so that a chain of coroutines completing each other runs in a loop rather than in ever deeper calls.
+    /// </summary>
+    struct _Coroutine_transfer_slot
+    {
+        std::coroutine_handle<> _M_handle;
+    };
+
+    inline _Coroutine_transfer_slot*& _Current_transfer_slot()
+    {
+        static thread_local _Coroutine_transfer_slot* _Slot = nullptr;
+        return _Slot;
+    }
+
+    inline void _Resume_coroutine(std::coroutine_handle<> _Handle)
+    {
+        auto _Slot = _Current_transfer_slot();
+        if (_Slot != nullptr && !_Slot->_M_handle)
+        {
+            _Slot->_M_handle = _Handle;
+            return;
+        }
+        _Handle.resume();
+    }
+
+    template<typename _Ty>
+    struct _Task_awaiter
+    {
+        task<_Ty> _M_task;
+
+        // A completed task resumes the coroutine right away, without going through the scheduler.
+        bool await_ready() const
+        {
+            return _M_task.is_done();
+        }
+
+        // The coroutine resumes on the thread that completes the task.
+        void await_suspend(std::coroutine_handle<> _Handle)
+        {
+            _M_task._Then([_Handle](task<_Ty>) { _Resume_coroutine(_Handle); }, nullptr, details::_ForceInline);
+        }
+
+        _Ty await_resume()
+        {
+            return _M_task.get();
+        }
+    };
+
+    /// <summary>
+    /// Completes the task of a coroutine once its locals are gone, frees the frame, and transfers to the
+    /// coroutine waiting on the task if the completion resumed one on this thread.
+    /// </summary>
+    struct _Task_final_awaiter
+    {
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        template<typename _Promise>
+        std::coroutine_handle<> await_suspend(std::coroutine_handle<_Promise> _Handle) noexcept
+        {
+            _Coroutine_transfer_slot _Slot;
+            auto& _Current = _Current_transfer_slot();
+            auto _Previous = _Current;
+            _Current = &_Slot;
+            _Handle.promise()._Complete();
+            _Current = _Previous;
+
+            // The awaiter lives in the frame, nothing of it may be used past this point.
+            _Handle.destroy();
+            if (_Slot._M_handle)
+                return _Slot._M_handle;
+            return std::noop_coroutine();
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+
+    template<typename _Ty>
+    struct _Task_promise_base
+    {
+        task_completion_event<_Ty> _M_completion;
+        std::exception_ptr _M_exception;
+
+        std::suspend_never initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        _Task_final_awaiter final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void unhandled_exception() noexcept
+        {
+            _M_exception = std::current_exception();
+        }
+    };
+
+    template<typename _Ty>
+    struct _Task_promise : _Task_promise_base<_Ty>
+    {
+        std::optional<_Ty> _M_result;
+
+        task<_Ty> get_return_object()
+        {
+            return task<_Ty>(this->_M_completion);
+        }
+
+        template<typename _Value>
+        void return_value(_Value&& _Result)
+        {
+            _M_result.emplace(std::forward<_Value>(_Result));
+        }
+
+        void _Complete()
+        {
+            if (this->_M_exception)
+                this->_M_completion.set_exception(this->_M_exception);
+            else
+                this->_M_completion.set(std::move(*_M_result));
+        }
+    };
+
+    template<>
+    struct _Task_promise<void> : _Task_promise_base<void>
+    {
+        task<void> get_return_object()
+        {
+            return task<void>(_M_completion);
+        }
+
+        void return_void()
+        {
+        }
+
+        void _Complete()
+        {
+            if (_M_exception)
+                _M_completion.set_exception(_M_exception);
+            else
+                _M_completion.set();
+        }
+    };
+
+    struct _Resume_on_awaiter
+    {
+        scheduler_ptr _M_scheduler;
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> _Handle)
+        {
+            auto _Resume = [](void* _Address) { std::coroutine_handle<>::from_address(_Address).resume(); };
+#if (defined(_MSC_VER) && (_MSC_VER >= 1800)) && !CPPREST_FORCE_PPLX
+            _M_scheduler->ScheduleTask(_Resume, _Handle.address());
+#else
+            _M_scheduler->schedule(_Resume, _Handle.address());
+#endif
+        }
+
+        void await_resume() const noexcept
+        {
+        }
+    };
+} // namespace details
+
+/// <summary>
+/// Waits for a task in a coroutine: <c>auto value = co_await some_task;</c>
+/// </summary>
+/// <remarks>
+/// A task already done does not suspend the coroutine. Otherwise the coroutine resumes on the thread that completes
+/// the task; <c>co_await resume_on(scheduler)</c> afterwards moves it elsewhere. Exceptions and cancellation of the
+/// task are thrown from the co_await.
+/// </remarks>
+template<typename _Ty>
+details::_Task_awaiter<_Ty> operator co_await(task<_Ty> _Task)
+{
+    return details::_Task_awaiter<_Ty> { std::move(_Task) };
+}
+
+/// <summary>
+/// Continues the coroutine on a thread of the given scheduler: <c>co_await pplx::resume_on(scheduler);</c>
+/// </summary>
+inline details::_Resume_on_awaiter resume_on(scheduler_ptr _Scheduler)
+{
+    return details::_Resume_on_awaiter { std::move(_Scheduler) };
+}
+
+} // namespace pplx
+
+/// <summary>
+/// Lets coroutines return pplx tasks. The coroutine runs on the calling thread up to its first suspension, and the
+/// task completes with the value of its co_return, or with the exception it let escape.
+/// </summary>
+template<typename _Ty, typename... _Args>
+struct std::coroutine_traits<pplx::task<_Ty>, _Args...>
+{
+    using promise_type = pplx::details::_Task_promise<_Ty>;
+};
+
+#endif // __cpp_impl_coroutine
+
+#endif // _PPLXAWAIT_H
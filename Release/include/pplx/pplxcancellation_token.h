@@ -22,8 +22,11 @@
 #error This file must not be included for Visual Studio 12 or later
 #endif
 
+#include <atomic>
 #include <cstdlib>
+#include <new>
 #include <string>
+#include <type_traits>
 #include "pplx/pplxinterface.h"
 #include "pplx/task_canceled.h"
 
@@ -151,7 +154,8 @@ namespace details
         _CancellationTokenRegistration(long _InitialRefs = 1) :
             _RefCounter(_InitialRefs),
             _M_state(_STATE_CALLED),
-            _M_pTokenState(NULL)
+            _M_pTokenState(NULL),
+            _M_next(NULL)
         {
         }
 
@@ -169,6 +173,11 @@ namespace details
 
         virtual void _Exec() = 0;
 
+        // Releases what the callback holds once it has been deregistered and will not be called
+        virtual void _Clear()
+        {
+        }
+
     private:
 
         friend class _CancellationTokenState;
@@ -197,6 +206,9 @@ namespace details
         atomic_long _M_state;
         extensibility::event_t *_M_pSyncBlock;
         _CancellationTokenState *_M_pTokenState;
+
+        // Next registration in the token's list
+        _CancellationTokenRegistration *_M_next;
     };
 
     template<typename _Function>
@@ -205,20 +217,38 @@ namespace details
     public:
 
         _CancellationTokenCallback(const _Function& _Func) :
-            _M_function(_Func)
+            _M_hasFunction(false)
         {
+            new (&_M_function) _Function(_Func);
+            _M_hasFunction = true;
+        }
+
+        ~_CancellationTokenCallback()
+        {
+            _CancellationTokenCallback::_Clear();
         }
 
     protected:
 
         virtual void _Exec()
         {
-            _M_function();
+            (*reinterpret_cast<_Function *>(&_M_function))();
+        }
+
+        // The captures go as soon as the callback is deregistered, not when the tombstone is unlinked
+        virtual void _Clear()
+        {
+            if (_M_hasFunction)
+            {
+                _M_hasFunction = false;
+                reinterpret_cast<_Function *>(&_M_function)->~_Function();
+            }
         }
 
     private:
 
-        _Function _M_function;
+        typename std::aligned_storage<sizeof(_Function), std::alignment_of<_Function>::value>::type _M_function;
+        bool _M_hasFunction;
     };
 
     class CancellationTokenRegistration_TaskProc : public _CancellationTokenRegistration
@@ -245,122 +275,14 @@ namespace details
     };
 
     // The base implementation of a cancellation token.
+    //
+    // Registrations are kept in a lock-free intrusive list, as a service may register callbacks for all of its
+    // requests on a single token. Registering pushes onto the head of the list. Deregistering frees the callback
+    // and marks the registration as a tombstone, which cancellation skips; the tombstones are unlinked once they make
+    // up half of the list, by one thread at a time. Cancellation closes the list and waits for such a purge to finish before
+    // it walks the registrations.
     class _CancellationTokenState : public _RefCounter
     {
-    protected:
-            class TokenRegistrationContainer
-        {
-        private:
-            typedef struct _Node {
-                _CancellationTokenRegistration* _M_token;
-                _Node *_M_next;
-            } Node;
-
-        public:
-            TokenRegistrationContainer() : _M_begin(nullptr), _M_last(nullptr)
-            {
-            }
-
-            ~TokenRegistrationContainer()
-            {
-#if defined(_MSC_VER)
-#pragma warning(push)
-#pragma warning(disable: 6001)
-#endif
-                auto node = _M_begin;
-                while (node != nullptr) 
-                {
-                    Node* tmp = node;
-                    node = node->_M_next;
-                    ::free(tmp);
-                }
-#if defined(_MSC_VER)
-#pragma warning(pop)
-#endif
-            }
-
-            void swap(TokenRegistrationContainer& list)
-            {
-                std::swap(list._M_begin, _M_begin);
-                std::swap(list._M_last, _M_last);
-            }
-
-            bool empty()
-            {
-                return _M_begin == nullptr;
-            }
-
-            template<typename T>
-            void for_each(T lambda)
-            {
-                Node* node = _M_begin;
-
-                while (node != nullptr) 
-                {
-                    lambda(node->_M_token);
-                    node = node->_M_next;
-                }
-            }
-
-            void push_back(_CancellationTokenRegistration* token)
-            {
-                Node* node = reinterpret_cast<Node*>(::malloc(sizeof(Node)));
-                if (node == nullptr)
-                {
-                    throw ::std::bad_alloc();
-                }
-
-                node->_M_token = token;
-                node->_M_next = nullptr;
-
-                if (_M_begin == nullptr) 
-                {
-                    _M_begin = node;
-                }
-                else
-                {
-                    _M_last->_M_next = node;
-                }
-
-                _M_last = node;
-            }
-
-            void remove(_CancellationTokenRegistration* token)
-            {
-                Node* node = _M_begin;
-                Node* prev = nullptr;
-
-                while (node != nullptr) 
-                {
-                    if (node->_M_token == token) {
-                        if (prev == nullptr)
-                        {
-                            _M_begin = node->_M_next;
-                        }
-                        else
-                        {
-                            prev->_M_next = node->_M_next;
-                        }
-
-                        if (node->_M_next == nullptr)
-                        {
-                            _M_last = prev;
-                        }
-
-                        ::free(node);
-                        break;
-                    }
-                    
-                    prev = node;
-                    node = node->_M_next;
-                }
-            }
-
-        private:
-            Node *_M_begin;
-            Node *_M_last;
-        };
-
     public:
 
         static _CancellationTokenState * _NewTokenState()
@@ -379,23 +301,29 @@ namespace details
         }
         
         _CancellationTokenState() :
-            _M_stateFlag(0)
+            _M_stateFlag(0),
+            _M_registrations(nullptr),
+            _M_registrationCount(0),
+            _M_tombstoneCount(0),
+            _M_purging(false)
         {
         }
 
         ~_CancellationTokenState()
         {
-            TokenRegistrationContainer rundownList;
+            auto pRegistration = _M_registrations.load();
+            if (pRegistration == _Closed())
             {
-                extensibility::scoped_critical_section_t _Lock(_M_listLock);
-                _M_registrations.swap(rundownList);
+                return;
             }
 
-            rundownList.for_each([](_CancellationTokenRegistration * pRegistration)
+            while (pRegistration != nullptr)
             {
+                auto pNext = pRegistration->_M_next;
                 pRegistration->_M_state = _CancellationTokenRegistration::_STATE_SYNCHRONIZE;
                 pRegistration->_Release();
-            });
+                pRegistration = pNext;
+            }
         }
 
         bool _IsCanceled() const
@@ -407,16 +335,28 @@ namespace details
         {
             if (atomic_compare_exchange(_M_stateFlag, 1l, 0l) == 0)
             {
-                TokenRegistrationContainer rundownList;
+                auto pRegistration = _M_registrations.exchange(_Closed());
+                while (_M_purging.load())
                 {
-                    extensibility::scoped_critical_section_t _Lock(_M_listLock);
-                    _M_registrations.swap(rundownList);
+                    ::pplx::details::platform::YieldExecution();
                 }
 
-                rundownList.for_each([](_CancellationTokenRegistration * pRegistration)
+                // Registrations are pushed on the head, call them back in the order they were made.
+                _CancellationTokenRegistration *pReversed = nullptr;
+                while (pRegistration != nullptr)
                 {
-                    pRegistration->_Invoke();
-                });
+                    auto pNext = pRegistration->_M_next;
+                    pRegistration->_M_next = pReversed;
+                    pReversed = pRegistration;
+                    pRegistration = pNext;
+                }
+
+                while (pReversed != nullptr)
+                {
+                    auto pNext = pReversed->_M_next;
+                    pReversed->_Invoke();
+                    pReversed = pNext;
+                }
 
                 _M_stateFlag = 2;
                 _M_cancelComplete.set();
@@ -436,116 +376,146 @@ namespace details
             _PRegistration->_Reference();
             _PRegistration->_M_pTokenState = this;
 
-            bool invoke = true;
-
-            if (!_IsCanceled())
+            auto pHead = _M_registrations.load();
+            do
             {
-                extensibility::scoped_critical_section_t _Lock(_M_listLock);
-
-                if (!_IsCanceled())
+                if (pHead == _Closed())
                 {
-                    invoke = false;
-                    _M_registrations.push_back(_PRegistration);
+                    _PRegistration->_Invoke();
+                    return;
                 }
-            }
+                _PRegistration->_M_next = pHead;
+            } while (!_M_registrations.compare_exchange_weak(pHead, _PRegistration));
 
-            if (invoke)
-            {
-                _PRegistration->_Invoke();
-            }
+            ++_M_registrationCount;
         }
 
         void _DeregisterCallback(_In_ _CancellationTokenRegistration *_PRegistration)
         {
-            bool synchronize = false;
-
-            {
-                extensibility::scoped_critical_section_t _Lock(_M_listLock);
-
-                //
-                // If a cancellation has occurred, the registration list is guaranteed to be empty if we've observed it under the auspices of the
-                // lock.  In this case, we must synchronize with the cancelling thread to guarantee that the cancellation is finished by the time
-                // we return from this method.
-                //
-                if (!_M_registrations.empty())
-                {
-                    _M_registrations.remove(_PRegistration);
-                    _PRegistration->_M_state = _CancellationTokenRegistration::_STATE_SYNCHRONIZE;
-                    _PRegistration->_Release();
-                }
-                else
-                {
-                    synchronize = true;
-                }
-            }
-
-            // 
-            // If the list is empty, we are in one of several situations:
+            //
+            // A registration still clear has not been called back and will not be: cancellation skips tombstones, so
+            // its callback is freed right away and the list drops its reference when it unlinks the registration.
+            // Otherwise we are in one of several situations:
             //
             // - The callback has already been made         --> do nothing
-            // - The callback is about to be made           --> flag it so it doesn't happen and return
             // - The callback is in progress elsewhere      --> synchronize with it
             // - The callback is in progress on this thread --> do nothing
             //
-            if (synchronize)
-            {
-                long result = atomic_compare_exchange(
-                    _PRegistration->_M_state, 
-                    _CancellationTokenRegistration::_STATE_DEFER_DELETE, 
-                    _CancellationTokenRegistration::_STATE_CLEAR
-                    );
+            long result = atomic_compare_exchange(
+                _PRegistration->_M_state, 
+                _CancellationTokenRegistration::_STATE_DEFER_DELETE, 
+                _CancellationTokenRegistration::_STATE_CLEAR
+                );
 
-                switch(result)
+            switch(result)
+            {
+                case _CancellationTokenRegistration::_STATE_CLEAR:
+                    _PRegistration->_Clear();
+                    _AddTombstone();
+                    break;
+                case _CancellationTokenRegistration::_STATE_CALLED:
+                    break;
+                case _CancellationTokenRegistration::_STATE_DEFER_DELETE:
+                case _CancellationTokenRegistration::_STATE_SYNCHRONIZE:
+                    _ASSERTE(false);
+                    break;
+                default:
                 {
-                    case _CancellationTokenRegistration::_STATE_CLEAR:
-                    case _CancellationTokenRegistration::_STATE_CALLED:
-                        break;
-                    case _CancellationTokenRegistration::_STATE_DEFER_DELETE:
-                    case _CancellationTokenRegistration::_STATE_SYNCHRONIZE:
-                        _ASSERTE(false);
-                        break;
-                    default:
+                    long tid = result;
+                    if (tid == ::pplx::details::platform::GetCurrentThreadId())
                     {
-                        long tid = result;
-                        if (tid == ::pplx::details::platform::GetCurrentThreadId())
-                        {
-                            //
-                            // It is entirely legal for a caller to Deregister during a callback instead of having to provide their own synchronization
-                            // mechanism between the two.  In this case, we do *NOT* need to explicitly synchronize with the callback as doing so would
-                            // deadlock.  If the call happens during, skip any extra synchronization.
-                            //
-                            break;
-                        }
-
-                        extensibility::event_t ev;
-                        _PRegistration->_M_pSyncBlock = &ev;
-
-                        long result_1 = atomic_exchange(_PRegistration->_M_state, _CancellationTokenRegistration::_STATE_SYNCHRONIZE);
-
-                        if (result_1 != _CancellationTokenRegistration::_STATE_CALLED)
-                        {
-                            _PRegistration->_M_pSyncBlock->wait(::pplx::extensibility::event_t::timeout_infinite);
-                        }
-
+                        //
+                        // It is entirely legal for a caller to Deregister during a callback instead of having to provide their own synchronization
+                        // mechanism between the two.  In this case, we do *NOT* need to explicitly synchronize with the callback as doing so would
+                        // deadlock.  If the call happens during, skip any extra synchronization.
+                        //
                         break;
                     }
+
+                    extensibility::event_t ev;
+                    _PRegistration->_M_pSyncBlock = &ev;
+
+                    long result_1 = atomic_exchange(_PRegistration->_M_state, _CancellationTokenRegistration::_STATE_SYNCHRONIZE);
+
+                    if (result_1 != _CancellationTokenRegistration::_STATE_CALLED)
+                    {
+                        _PRegistration->_M_pSyncBlock->wait(::pplx::extensibility::event_t::timeout_infinite);
+                    }
+
+                    break;
                 }
             }
         }
 
     private:
 
+        // Head of a list that cancellation has taken over.
+        static _CancellationTokenRegistration *_Closed()
+        {
+            return reinterpret_cast<_CancellationTokenRegistration *>(1);
+        }
+
+        void _AddTombstone()
+        {
+            const long tombstones = ++_M_tombstoneCount;
+            if (tombstones >= 16 && tombstones * 2 >= _M_registrationCount.load())
+            {
+                _PurgeTombstones();
+            }
+        }
+
+        // Unlinks the tombstones behind the current head. Only the purging thread changes the links of registrations
+        // already in the list, and registering threads only replace the head, so the purge needs no lock.
+        void _PurgeTombstones()
+        {
+            bool purging = false;
+            if (!_M_purging.compare_exchange_strong(purging, true))
+            {
+                return;
+            }
+
+            auto pPrevious = _M_registrations.load();
+            if (pPrevious != _Closed() && pPrevious != nullptr)
+            {
+                long purged = 0;
+                auto pRegistration = pPrevious->_M_next;
+                while (pRegistration != nullptr)
+                {
+                    auto pNext = pRegistration->_M_next;
+                    if (pRegistration->_M_state == _CancellationTokenRegistration::_STATE_DEFER_DELETE)
+                    {
+                        pPrevious->_M_next = pNext;
+                        pRegistration->_Release();
+                        ++purged;
+                    }
+                    else
+                    {
+                        pPrevious = pRegistration;
+                    }
+                    pRegistration = pNext;
+                }
+                _M_registrationCount -= purged;
+                _M_tombstoneCount -= purged;
+            }
+
+            _M_purging.store(false);
+        }
+
         // The flag for the token state (whether it is canceled or not)
         atomic_long _M_stateFlag;
 
         // Notification of completion of cancellation of this token.
         extensibility::event_t _M_cancelComplete; // Hmm.. where do we wait for it??
 
-        // Lock to protect the registrations list
-        extensibility::critical_section_t _M_listLock;
+        // The registrations, most recent first, or _Closed() once canceled
+        std::atomic<_CancellationTokenRegistration *> _M_registrations;
+
+        // Registrations in the list, and how many of them are tombstones
+        std::atomic<long> _M_registrationCount;
+        std::atomic<long> _M_tombstoneCount;
 
-        // The protected list of registrations
-        TokenRegistrationContainer _M_registrations;
+        // Set while a thread unlinks tombstones
+        std::atomic<bool> _M_purging;
     };
 
 } // namespace details
@@ -0,0 +1,601 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Bounded asynchronous channel between pplx tasks.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#pragma once
+
+#ifndef _PPLXCHANNEL_H
+#define _PPLXCHANNEL_H
+
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "pplx/pplxtasks.h"
+
+namespace pplx
+{
+
+namespace details
+{
+    template<typename _Type>
+    struct _Channel_push_waiter
+    {
+        std::optional<_Type> _M_value;
+        task_completion_event<void> _M_completed;
+        cancellation_token _M_token = cancellation_token::none();
+        cancellation_token_registration _M_registration;
+        typename std::list<std::shared_ptr<_Channel_push_waiter>>::iterator _M_position;
+        bool _M_queued = false;
+    };
+
+    template<typename _Type>
+    struct _Channel_pop_waiter
+    {
+        task_completion_event<std::optional<_Type>> _M_completed;
+        cancellation_token _M_token = cancellation_token::none();
+        cancellation_token_registration _M_registration;
+        typename std::list<std::shared_ptr<_Channel_pop_waiter>>::iterator _M_position;
+        bool _M_queued = false;
+    };
+
+    /// <summary>
+    /// The state shared by the copies of a channel.
+    /// </summary>
+    /// <remarks>
+    /// Values go through a bounded lock-free ring, where each cell carries a sequence number telling whether it can be
+    /// written or read at a given position. Pushes and pops that find room or a value there complete without a lock.
+    /// The others queue a waiter under the lock, and whoever next frees a cell or fills one moves values between the
+    /// waiters and the ring. A waiter count, checked after each fast-path operation, tells it whether to take the lock.
+    /// Waiters are completed once the lock is released, their continuations may use the channel again.
+    /// </remarks>
+    template<typename _Type>
+    class _Channel_impl : public std::enable_shared_from_this<_Channel_impl<_Type>>
+    {
+        typedef _Channel_push_waiter<_Type> _Push_waiter;
+        typedef _Channel_pop_waiter<_Type> _Pop_waiter;
+
+        // Waiters to complete once the lock is released.
+        struct _Completions
+        {
+            std::vector<std::pair<std::shared_ptr<_Pop_waiter>, std::optional<_Type>>> _M_popped;
+            std::vector<std::shared_ptr<_Push_waiter>> _M_pushed;
+        };
+
+        struct _Cell
+        {
+            std::atomic<size_t> _M_sequence;
+            std::optional<_Type> _M_value;
+        };
+
+    public:
+        explicit _Channel_impl(size_t _Capacity)
+            : _M_mask(_Round_capacity(_Capacity) - 1),
+            _M_cells(new _Cell[_M_mask + 1]),
+            _M_pushPosition(0),
+            _M_popPosition(0),
+            _M_pushState(0),
+            _M_waitingPushers(0),
+            _M_waitingPoppers(0),
+            _M_closed(false)
+        {
+            for (size_t _I = 0; _I <= _M_mask; ++_I)
+            {
+                _M_cells[_I]._M_sequence.store(_I, std::memory_order_relaxed);
+            }
+        }
+
+        size_t _Capacity() const
+        {
+            return _M_mask + 1;
+        }
+
+        task<void> _Push(_Type&& _Value, const cancellation_token& _Token)
+        {
+            // Values queued behind a full ring go first, so that a producer not waiting for its pushes keeps its order.
+            if (_M_waitingPushers.load(std::memory_order_relaxed) == 0)
+            {
+                // Counted in flight, so that close() waits for the value to be in the ring.
+                if (_M_pushState.fetch_add(2, std::memory_order_acquire) & 1)
+                {
+                    _M_pushState.fetch_sub(2, std::memory_order_release);
+                    return _Closed_push();
+                }
+
+                const bool _Pushed = _Try_enqueue(_Value);
+                _M_pushState.fetch_sub(2, std::memory_order_release);
+                if (_Pushed)
+                {
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    if (_M_waitingPoppers.load(std::memory_order_relaxed) != 0)
+                    {
+                        _Serve_and_complete();
+                    }
+                    return task_from_result();
+                }
+            }
+
+            return _Push_slow(std::move(_Value), _Token);
+        }
+
+        task<std::optional<_Type>> _Pop(const cancellation_token& _Token)
+        {
+            if (_M_waitingPoppers.load(std::memory_order_relaxed) == 0)
+            {
+                std::optional<_Type> _Value = _Try_dequeue();
+                if (_Value)
+                {
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    if (_M_waitingPushers.load(std::memory_order_relaxed) != 0)
+                    {
+                        _Serve_and_complete();
+                    }
+                    return task_from_result(std::move(_Value));
+                }
+            }
+
+            return _Pop_slow(_Token);
+        }
+
+        void _Close()
+        {
+            if (_M_pushState.fetch_or(1, std::memory_order_acq_rel) & 1)
+            {
+                return;
+            }
+
+            // A push that got past the check is a few instructions away from its cell.
+            while ((_M_pushState.load(std::memory_order_acquire) >> 1) != 0)
+            {
+                std::this_thread::yield();
+            }
+
+            _Completions _Done;
+            {
+                std::lock_guard<std::mutex> _Lock(_M_lock);
+                _M_closed = true;
+                _Serve(_Done);
+            }
+            _Complete(_Done);
+        }
+
+        bool _Is_closed() const
+        {
+            return (_M_pushState.load(std::memory_order_acquire) & 1) != 0;
+        }
+
+    private:
+        static size_t _Round_capacity(size_t _Capacity)
+        {
+            // The sequence numbers need two cells at least.
+            size_t _Rounded = 2;
+            while (_Rounded < _Capacity)
+            {
+                _Rounded <<= 1;
+            }
+            return _Rounded;
+        }
+
+        static task<void> _Closed_push()
+        {
+            return task_from_exception<void>(invalid_operation("push to a closed channel"));
+        }
+
+        // Moves from the value only if there is room for it.
+        bool _Try_enqueue(_Type& _Value)
+        {
+            size_t _Position = _M_pushPosition.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                _Cell& _Target = _M_cells[_Position & _M_mask];
+                const size_t _Sequence = _Target._M_sequence.load(std::memory_order_acquire);
+                const intptr_t _Diff = static_cast<intptr_t>(_Sequence) - static_cast<intptr_t>(_Position);
+                if (_Diff == 0)
+                {
+                    if (_M_pushPosition.compare_exchange_weak(_Position, _Position + 1, std::memory_order_relaxed))
+                    {
+                        _Target._M_value.emplace(std::move(_Value));
+                        _Target._M_sequence.store(_Position + 1, std::memory_order_release);
+                        return true;
+                    }
+                }
+                else if (_Diff < 0)
+                {
+                    return false;
+                }
+                else
+                {
+                    _Position = _M_pushPosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        std::optional<_Type> _Try_dequeue()
+        {
+            size_t _Position = _M_popPosition.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                _Cell& _Source = _M_cells[_Position & _M_mask];
+                const size_t _Sequence = _Source._M_sequence.load(std::memory_order_acquire);
+                const intptr_t _Diff = static_cast<intptr_t>(_Sequence) - static_cast<intptr_t>(_Position + 1);
+                if (_Diff == 0)
+                {
+                    if (_M_popPosition.compare_exchange_weak(_Position, _Position + 1, std::memory_order_relaxed))
+                    {
+                        std::optional<_Type> _Value(std::move(_Source._M_value));
+                        _Source._M_value.reset();
+                        _Source._M_sequence.store(_Position + _M_mask + 1, std::memory_order_release);
+                        return _Value;
+                    }
+                }
+                else if (_Diff < 0)
+                {
+                    return std::nullopt;
+                }
+                else
+                {
+                    _Position = _M_popPosition.load(std::memory_order_relaxed);
+                }
+            }
+        }
+
+        task<void> _Push_slow(_Type&& _Value, const cancellation_token& _Token)
+        {
+            auto _Waiter = std::make_shared<_Push_waiter>();
+            auto _Result = create_task(_Waiter->_M_completed);
+            if (_Token.is_canceled())
+            {
+                _Waiter->_M_completed._Cancel();
+                return _Result;
+            }
+
+            _Waiter->_M_value.emplace(std::move(_Value));
+            _Waiter->_M_token = _Token;
+
+            _Completions _Done;
+            bool _Queued;
+            {
+                std::lock_guard<std::mutex> _Lock(_M_lock);
+                if (_Is_closed())
+                {
+                    return _Closed_push();
+                }
+
+                _M_waitingPushers.fetch_add(1);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                _Waiter->_M_position = _M_pushers.insert(_M_pushers.end(), _Waiter);
+                _Waiter->_M_queued = true;
+                _Serve(_Done);
+                _Queued = _Waiter->_M_queued;
+            }
+            _Complete(_Done);
+
+            if (_Queued)
+            {
+                _Register(_Waiter);
+            }
+            return _Result;
+        }
+
+        task<std::optional<_Type>> _Pop_slow(const cancellation_token& _Token)
+        {
+            auto _Waiter = std::make_shared<_Pop_waiter>();
+            auto _Result = create_task(_Waiter->_M_completed);
+            if (_Token.is_canceled())
+            {
+                _Waiter->_M_completed._Cancel();
+                return _Result;
+            }
+
+            _Waiter->_M_token = _Token;
+
+            _Completions _Done;
+            bool _Queued;
+            {
+                std::lock_guard<std::mutex> _Lock(_M_lock);
+                _M_waitingPoppers.fetch_add(1);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                _Waiter->_M_position = _M_poppers.insert(_M_poppers.end(), _Waiter);
+                _Waiter->_M_queued = true;
+                _Serve(_Done);
+                _Queued = _Waiter->_M_queued;
+            }
+            _Complete(_Done);
+
+            if (_Queued)
+            {
+                _Register(_Waiter);
+            }
+            return _Result;
+        }
+
+        // Moves values from waiting pushers to the ring and from the ring to waiting poppers, for as long as either
+        // makes progress. Called with the lock held.
+        void _Serve(_Completions& _Done)
+        {
+            bool _Progress = true;
+            while (_Progress)
+            {
+                _Progress = false;
+                while (!_M_pushers.empty() && _Try_enqueue(*_M_pushers.front()->_M_value))
+                {
+                    _Done._M_pushed.push_back(_Dequeue_waiter(_M_pushers, _M_waitingPushers));
+                    _Progress = true;
+                }
+
+                while (!_M_poppers.empty())
+                {
+                    std::optional<_Type> _Value = _Try_dequeue();
+                    if (!_Value)
+                    {
+                        break;
+                    }
+                    _Done._M_popped.push_back(std::make_pair(_Dequeue_waiter(_M_poppers, _M_waitingPoppers), std::move(_Value)));
+                    _Progress = true;
+                }
+            }
+
+            // Once closed, a popper that finds nothing left gets nothing.
+            if (_M_closed && _M_pushers.empty())
+            {
+                while (!_M_poppers.empty())
+                {
+                    _Done._M_popped.push_back(std::make_pair(_Dequeue_waiter(_M_poppers, _M_waitingPoppers), std::optional<_Type>()));
+                }
+            }
+        }
+
+        template<typename _Waiter>
+        static std::shared_ptr<_Waiter> _Dequeue_waiter(std::list<std::shared_ptr<_Waiter>>& _Waiters, std::atomic<size_t>& _Count)
+        {
+            auto _Waiter_ptr = std::move(_Waiters.front());
+            _Waiters.pop_front();
+            _Waiter_ptr->_M_queued = false;
+            _Count.fetch_sub(1, std::memory_order_relaxed);
+            return _Waiter_ptr;
+        }
+
+        void _Serve_and_complete()
+        {
+            _Completions _Done;
+            {
+                std::lock_guard<std::mutex> _Lock(_M_lock);
+                _Serve(_Done);
+            }
+            _Complete(_Done);
+        }
+
+        void _Complete(_Completions& _Done)
+        {
+            for (auto& _Pushed : _Done._M_pushed)
+            {
+                _Deregister(*_Pushed);
+                _Pushed->_M_completed.set();
+            }
+
+            for (auto& _Popped : _Done._M_popped)
+            {
+                _Deregister(*_Popped.first);
+                _Popped.first->_M_completed.set(std::move(_Popped.second));
+            }
+        }
+
+        template<typename _Waiter>
+        static void _Deregister(_Waiter& _Target)
+        {
+            // Set under the lock, and only while queued: the waiter has been dequeued before getting here.
+            if (_Target._M_registration != cancellation_token_registration())
+            {
+                _Target._M_token.deregister_callback(_Target._M_registration);
+            }
+        }
+
+        // Lets the token withdraw a queued waiter. The callback only holds weak references, the registration held by
+        // the waiter would otherwise keep both alive.
+        template<typename _Waiter>
+        void _Register(const std::shared_ptr<_Waiter>& _Target)
+        {
+            if (!_Target->_M_token.is_cancelable())
+            {
+                return;
+            }
+
+            std::weak_ptr<_Channel_impl> _WeakImpl = this->shared_from_this();
+            std::weak_ptr<_Waiter> _WeakWaiter = _Target;
+            auto _Registration = _Target->_M_token.register_callback([_WeakImpl, _WeakWaiter]() {
+                auto _Impl = _WeakImpl.lock();
+                auto _Waiter_ptr = _WeakWaiter.lock();
+                if (_Impl && _Waiter_ptr)
+                {
+                    _Impl->_Withdraw(_Waiter_ptr);
+                }
+            });
+
+            {
+                std::lock_guard<std::mutex> _Lock(_M_lock);
+                if (_Target->_M_queued)
+                {
+                    _Target->_M_registration = std::move(_Registration);
+                    return;
+                }
+            }
+            _Target->_M_token.deregister_callback(_Registration);
+        }
+
+        void _Withdraw(const std::shared_ptr<_Push_waiter>& _Waiter)
+        {
+            {
+                std::lock_guard<std::mutex> _Lock(_M_lock);
+                if (!_Waiter->_M_queued)
+                {
+                    return;
+                }
+                _M_pushers.erase(_Waiter->_M_position);
+                _Waiter->_M_queued = false;
+                _M_waitingPushers.fetch_sub(1, std::memory_order_relaxed);
+            }
+            _Waiter->_M_completed._Cancel();
+
+            // Poppers left waiting for the last pusher of a closed channel are done.
+            _Serve_and_complete();
+        }
+
+        void _Withdraw(const std::shared_ptr<_Pop_waiter>& _Waiter)
+        {
+            {
+                std::lock_guard<std::mutex> _Lock(_M_lock);
+                if (!_Waiter->_M_queued)
+                {
+                    return;
+                }
+                _M_poppers.erase(_Waiter->_M_position);
+                _Waiter->_M_queued = false;
+                _M_waitingPoppers.fetch_sub(1, std::memory_order_relaxed);
+            }
+            _Waiter->_M_completed._Cancel();
+        }
+
+        const size_t _M_mask;
+        std::unique_ptr<_Cell[]> _M_cells;
+
+        // Each on its own cache line, producers and consumers do not contend with each other.
+        alignas(64) std::atomic<size_t> _M_pushPosition;
+        alignas(64) std::atomic<size_t> _M_popPosition;
+        // Bit 0 is set once closed, the rest counts the pushes in flight by two.
+        alignas(64) std::atomic<size_t> _M_pushState;
+        std::atomic<size_t> _M_waitingPushers;
+        std::atomic<size_t> _M_waitingPoppers;
+
+        std::mutex _M_lock;
+        std::list<std::shared_ptr<_Push_waiter>> _M_pushers;
+        std::list<std::shared_ptr<_Pop_waiter>> _M_poppers;
+        // Set under the lock once the pushes in flight have landed: poppers may then be told there is nothing left.
+        bool _M_closed;
+    };
+} // namespace details
+
+/// <summary>
+/// A bounded, multi-producer multi-consumer queue between tasks. A push waits while the channel is full and a pop
+/// while it is empty, without holding a thread, so that each stage of a pipeline slows down to the pace of the next.
+/// </summary>
+/// <remarks>
+/// <para>A channel behaves like a smart pointer: copies share the same queue, and should be passed by value.</para>
+/// <para>Pushes and pops that find room or a value complete right away, without taking a lock. Values are popped in
+/// the order they were pushed, and a producer that pushes without waiting for the previous push keeps its order.</para>
+/// <para>The capacity is rounded up to a power of two, and is at least two. Moving a value must not throw.</para>
+/// </remarks>
+template<typename _Type>
+class channel
+{
+public:
+    typedef _Type value_type;
+
+    /// <summary>
+    /// Creates a channel holding up to the given number of values.
+    /// </summary>
+    explicit channel(size_t _Capacity)
+        : _M_Impl(std::make_shared<details::_Channel_impl<_Type>>(_Capacity))
+    {
+    }
+
+    /// <summary>
+    /// Number of values the channel holds before pushes wait.
+    /// </summary>
+    size_t capacity() const
+    {
+        return _M_Impl->_Capacity();
+    }
+
+    /// <summary>
+    /// Adds a value to the channel.
+    /// </summary>
+    /// <returns>
+    /// A task that completes once the value is in the channel. It throws invalid_operation if the channel is closed,
+    /// and is canceled if the token is canceled before there is room for the value, which is then dropped.
+    /// </returns>
+    task<void> push(_Type _Value, cancellation_token _Token = cancellation_token::none()) const
+    {
+        return _M_Impl->_Push(std::move(_Value), _Token);
+    }
+
+    /// <summary>
+    /// Takes the oldest value from the channel.
+    /// </summary>
+    /// <returns>
+    /// A task that completes with the value, or with no value once the channel is closed and empty. It is canceled if
+    /// the token is canceled before a value comes.
+    /// </returns>
+    task<std::optional<_Type>> pop(cancellation_token _Token = cancellation_token::none()) const
+    {
+        return _M_Impl->_Pop(_Token);
+    }
+
+    /// <summary>
+    /// Stops accepting values. Values already pushed, including those waiting for room, can still be popped; pops
+    /// then complete with no value.
+    /// </summary>
+    void close() const
+    {
+        _M_Impl->_Close();
+    }
+
+    /// <summary>
+    /// Whether close() has been called.
+    /// </summary>
+    bool is_closed() const
+    {
+        return _M_Impl->_Is_closed();
+    }
+
+private:
+    std::shared_ptr<details::_Channel_impl<_Type>> _M_Impl;
+};
+
+/// <summary>
+/// Pushes each of the tasks, with its position in the range, to the channel in the order they complete, then closes
+/// the channel.
+/// </summary>
+/// <remarks>
+/// Completed tasks wait in the channel for as long as it is full, the consumer pops them at its own pace. Closing the
+/// channel early drops the tasks that complete afterwards.
+/// </remarks>
+/// <returns>A task that completes once the channel is closed.</returns>
+template<typename _Iterator>
+task<void> when_each(_Iterator _Begin, _Iterator _End, const channel<std::pair<typename std::iterator_traits<_Iterator>::value_type, size_t>>& _Results)
+{
+    typedef typename std::iterator_traits<_Iterator>::value_type _TaskType;
+    auto _Channel = _Results;
+    return when_each(_Begin, _End, [_Channel](const _TaskType& _Task, size_t _Index) {
+        _Channel.push(std::make_pair(_Task, _Index)).then([](task<void> _Pushed) {
+            try
+            {
+                _Pushed.wait();
+            }
+            catch (const invalid_operation&)
+            {
+                // Closed by the consumer, which wants no more.
+            }
+        });
+    }).then([_Channel](task<void> _Done) {
+        _Channel.close();
+        _Done.wait();
+    });
+}
+
+} // namespace pplx
+
+#endif // _PPLXCHANNEL_H
@@ -45,6 +45,20 @@ namespace pplx
 #endif
 namespace details
 {
+    /// <summary>
+    /// Implemented by schedulers that want to know when one of their threads blocks, so that other threads can
+    /// pick up the work it leaves behind.
+    /// </summary>
+    class blocking_observer
+    {
+    public:
+        virtual void blocking_begin() = 0;
+        virtual void blocking_end() = 0;
+
+    protected:
+        ~blocking_observer() {}
+    };
+
 namespace platform
 {
     /// <summary>
@@ -52,6 +66,16 @@ namespace platform
     /// </summary>
     _PPLXIMP long _pplx_cdecl GetCurrentThreadId();
 
+    /// <summary>
+    /// Sets the observer told when the calling thread blocks, nullptr for none. Schedulers set it on their threads.
+    /// </summary>
+    _PPLXIMP void _pplx_cdecl SetBlockingObserver(blocking_observer* observer);
+
+    /// <summary>
+    /// Returns the observer of the calling thread, nullptr if it has none
+    /// </summary>
+    _PPLXIMP blocking_observer* _pplx_cdecl GetBlockingObserver();
+
     /// <summary>
     /// Yields the execution of the current execution thread - typically when spin-waiting
     /// </summary>
@@ -66,6 +90,36 @@ namespace platform
     }
 }
 
+    /// <summary>
+    /// Reports the calling thread as blocked to its observer while the object lives
+    /// </summary>
+    class scoped_blocking_region
+    {
+    public:
+        scoped_blocking_region()
+            : _observer(platform::GetBlockingObserver())
+        {
+            if (_observer != nullptr)
+            {
+                _observer->blocking_begin();
+            }
+        }
+
+        ~scoped_blocking_region()
+        {
+            if (_observer != nullptr)
+            {
+                _observer->blocking_end();
+            }
+        }
+
+    private:
+        scoped_blocking_region(const scoped_blocking_region&);                    // no copy constructor
+        scoped_blocking_region const & operator=(const scoped_blocking_region&);  // no assignment operator
+
+        blocking_observer* _observer;
+    };
+
     /// <summary>
     /// Manual reset event
     /// </summary>
@@ -99,6 +153,17 @@ namespace platform
 
         unsigned int wait(unsigned int timeout)
         {
+            {
+                cpprest_synchronization::lock_guard<cpprest_synchronization::mutex> lock(_lock);
+                if (_signaled)
+                {
+                    return 0;
+                }
+            }
+
+            // The thread is about to block, which a pool thread waiting on other tasks of the same pool must report
+            // so that the pool can keep running them.
+            scoped_blocking_region blocking;
             cpprest_synchronization::unique_lock<cpprest_synchronization::mutex> lock(_lock);
             if (timeout == event_impl::timeout_infinite)
             {
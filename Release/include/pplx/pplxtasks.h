@@ -1415,7 +1415,7 @@ namespace details
     struct _Task_ptr
     {
         typedef std::shared_ptr<_Task_impl<_ReturnType>> _Type;
-        static _Type _Make(_CancellationTokenState * _Ct, scheduler_ptr _Scheduler_arg) { return std::make_shared<_Task_impl<_ReturnType>>(_Ct, _Scheduler_arg); }
+        static _Type _Make(_CancellationTokenState * _Ct, scheduler_ptr _Scheduler_arg) { return _Make_pooled_shared<_Task_impl<_ReturnType>>(_Ct, _Scheduler_arg); }
     };
 
     typedef _TaskCollection_t::_TaskProcHandle_t _UnrealizedChore_t;
@@ -2147,7 +2147,19 @@ namespace details
             {
                 case _Schedule:
                 {
-                    _PTaskHandle->_GetTaskImplBase()->_ScheduleContinuationTask(_PTaskHandle);
+                    // The antecedent is already done, so the continuation may as well run on this thread instead of
+                    // costing a trip through the scheduler, unless it asked for another scheduler or context. The
+                    // inlining depth bounds the stack when each such continuation adds another one. Only this path
+                    // is upgraded, cancellation and the other _DefaultAutoInline sites keep scheduling.
+                    auto _ContinuationImpl = _PTaskHandle->_GetTaskImplBase();
+                    if (_PTaskHandle->_M_inliningMode == details::_NoInline
+                        && !_PTaskHandle->_M_continuationContext._HasCapturedContext()
+                        && _ContinuationImpl->_GetScheduler().get() == _GetScheduler().get()
+                        && details::_Inline_depth::_Can_inline(details::_DefaultAutoInline))
+                    {
+                        _PTaskHandle->_M_inliningMode = details::_ForceInline;
+                    }
+                    _ContinuationImpl->_ScheduleContinuationTask(_PTaskHandle);
                     break;
                 }
                 case _Cancel:
@@ -2618,27 +2630,30 @@ namespace details
         bool                                _M_fIsCanceled;
     };
 
-    // Utility method for dealing with void functions
-    inline std::function<_Unit_type(void)> _MakeVoidToUnitFunc(const std::function<void(void)>& _Func)
+    // Utility method for dealing with void functions. The adapters refer to the task handle's functor rather than
+    // copying it into a std::function, which would allocate for any lambda capturing more than a couple of pointers.
+    template <typename _Function>
+    auto _MakeVoidToUnitFunc(_Function& _Func) -> decltype(auto)
     {
-        return [=]() -> _Unit_type { _Func(); return _Unit_type(); };
+        return [&_Func]() -> _Unit_type { _Func(); return _Unit_type(); };
     }
 
-    template <typename _Type>
-    std::function<_Type(_Unit_type)> _MakeUnitToTFunc(const std::function<_Type(void)>& _Func)
+    template <typename _Type, typename _Function>
+    auto _MakeUnitToTFunc(_Function& _Func) -> decltype(auto)
     {
-        return [=](_Unit_type) -> _Type { return _Func(); };
+        return [&_Func](_Unit_type) -> _Type { return _Func(); };
     }
 
-    template <typename _Type>
-    std::function<_Unit_type(_Type)> _MakeTToUnitFunc(const std::function<void(_Type)>& _Func)
+    template <typename _Type, typename _Function>
+    auto _MakeTToUnitFunc(_Function& _Func) -> decltype(auto)
     {
-        return [=](_Type t) -> _Unit_type { _Func(t); return _Unit_type(); };
+        return [&_Func](_Type t) -> _Unit_type { _Func(std::forward<_Type>(t)); return _Unit_type(); };
     }
 
-    inline std::function<_Unit_type(_Unit_type)> _MakeUnitToUnitFunc(const std::function<void(void)>& _Func)
+    template <typename _Function>
+    auto _MakeUnitToUnitFunc(_Function& _Func) -> decltype(auto)
     {
-        return [=](_Unit_type) -> _Unit_type { _Func(); return _Unit_type(); };
+        return [&_Func](_Unit_type) -> _Unit_type { _Func(); return _Unit_type(); };
     }
 } // namespace details
 
@@ -2668,7 +2683,7 @@ public:
     /// </summary>
     /**/
     task_completion_event() 
-        : _M_Impl(std::make_shared<details::_Task_completion_event_impl<_ResultType>>()) 
+        : _M_Impl(details::_Make_pooled_shared<details::_Task_completion_event_impl<_ResultType>>()) 
     {
     }
 
@@ -3093,7 +3108,7 @@ namespace details
             typename std::enable_if<!std::is_base_of<_NonCopyableFunctorWrapper<_Ty>,
                  typename std::decay<_Tx>::type>::value>::type>
         explicit _NonCopyableFunctorWrapper(_Tx&& f)
-          : _M_functor{std::make_shared<_Ty>(std::forward<_Tx>(f))}
+          : _M_functor{_Make_pooled_shared<_Ty>(std::forward<_Tx>(f))}
         {}
 
         template <class... _Args>
@@ -3132,7 +3147,8 @@ template<typename _InpType, typename _OutType>
 class _Continuation_func_transformer
 {
 public:
-    static auto _Perform(std::function<_OutType(_InpType)> _Func) -> decltype(_Func)
+    template<typename _Function>
+    static _Function& _Perform(_Function& _Func)
     {
         return _Func;
     }
@@ -3142,7 +3158,8 @@ template<typename _OutType>
 class _Continuation_func_transformer<void, _OutType>
 {
 public:
-    static auto _Perform(std::function<_OutType(void)> _Func) -> decltype(details::_MakeUnitToTFunc<_OutType>(_Func))
+    template<typename _Function>
+    static auto _Perform(_Function& _Func) -> decltype(details::_MakeUnitToTFunc<_OutType>(_Func))
     {
         return details::_MakeUnitToTFunc<_OutType>(_Func);
     }
@@ -3152,7 +3169,8 @@ template<typename _InType>
 class _Continuation_func_transformer<_InType, void>
 {
 public:
-    static auto _Perform(std::function<void(_InType)> _Func) -> decltype(details::_MakeTToUnitFunc<_InType>(_Func))
+    template<typename _Function>
+    static auto _Perform(_Function& _Func) -> decltype(details::_MakeTToUnitFunc<_InType>(_Func))
     {
         return details::_MakeTToUnitFunc<_InType>(_Func);
     }
@@ -3162,7 +3180,8 @@ template<>
 class _Continuation_func_transformer<void, void>
 {
 public:
-    static auto _Perform(std::function<void(void)> _Func) -> decltype(details::_MakeUnitToUnitFunc(_Func))
+    template<typename _Function>
+    static auto _Perform(_Function& _Func) -> decltype(details::_MakeUnitToUnitFunc(_Func))
     {
         return details::_MakeUnitToUnitFunc(_Func);
     }
@@ -3174,7 +3193,8 @@ template<typename _RetType>
 class _Init_func_transformer
 {
 public:
-    static auto _Perform(std::function<_RetType(void)> _Func) -> decltype(_Func)
+    template<typename _Function>
+    static _Function& _Perform(_Function& _Func)
     {
         return _Func;
     }
@@ -3184,7 +3204,8 @@ template<>
 class _Init_func_transformer<void>
 {
 public:
-    static auto _Perform(std::function<void(void)> _Func) -> decltype(details::_MakeVoidToUnitFunc(_Func))
+    template<typename _Function>
+    static auto _Perform(_Function& _Func) -> decltype(details::_MakeVoidToUnitFunc(_Func))
     {
         return details::_MakeVoidToUnitFunc(_Func);
     }
@@ -3730,7 +3751,8 @@ private:
     struct _InitialTaskHandle : 
         details::_PPLTaskHandle<_ReturnType, _InitialTaskHandle<_InternalReturnType, _Function, _TypeSelection>, details::_UnrealizedChore_t>
     {
-        _Function _M_function;
+        // Mutable: the handle runs once, and the functor may be a mutable lambda.
+        mutable _Function _M_function;
         _InitialTaskHandle(const typename details::_Task_ptr<_ReturnType>::_Type & _TaskImpl, const _Function & _func)
             : details::_PPLTaskHandle<_ReturnType, _InitialTaskHandle<_InternalReturnType, _Function, _TypeSelection>, details::_UnrealizedChore_t>::_PPLTaskHandle(_TaskImpl)
             , _M_function(_func)
@@ -3831,7 +3853,8 @@ private:
         typedef typename details::_NormalizeVoidToUnitType<_ContinuationReturnType>::_Type _NormalizedContinuationReturnType;
 
         typename details::_Task_ptr<_ReturnType>::_Type _M_ancestorTaskImpl;
-        typename details::_CopyableFunctor<typename std::decay<_Function>::type >::_Type _M_function;
+        // Mutable: the handle runs once, and the functor may be a mutable lambda.
+        mutable typename details::_CopyableFunctor<typename std::decay<_Function>::type >::_Type _M_function;
 
         template <class _ForwardedFunction>
         _ContinuationTaskHandle(const typename details::_Task_ptr<_ReturnType>::_Type & _AncestorImpl,
@@ -6262,69 +6285,115 @@ details::_AsyncTaskGeneratorThunk<_Function> ^create_async(const _Function& _Fun
 
 namespace details
 {
-    // Helper struct for when_all operators to know when tasks have completed
-    template<typename _Type>
-    struct _RunAllParam
+    // State shared by the continuations of a when_all: a single countdown of the tasks left, the tokens joined into
+    // the merged source, and the source to cancel on the first failure.
+    struct _RunAllParamBase
     {
-        _RunAllParam() : _M_completeCount(0), _M_numTasks(0)
+        _RunAllParamBase() : _M_completeCount(0), _M_numTasks(0), _M_fFailed(false), _M_cancelOnFailure(nullptr)
         {
         }
 
-        void _Resize(size_t _Len, bool _SkipVector = false)
+        ~_RunAllParamBase()
         {
-            _M_numTasks = _Len;
-            if (!_SkipVector)
+            // A long-lived token would otherwise keep a callback for every when_all it took part in.
+            for (auto _It = _M_joinedTokens.begin(); _It != _M_joinedTokens.end(); ++_It)
             {
-                _M_vector._Result.resize(_Len);
+                _It->first.deregister_callback(_It->second);
+            }
+
+            if (_CancellationTokenState::_IsValid(_M_cancelOnFailure))
+            {
+                _M_cancelOnFailure->_Release();
+            }
+        }
+
+        void _JoinToken(const cancellation_token_source& _MergedSrc, _CancellationTokenState *_PJoinedTokenState)
+        {
+            if (!_CancellationTokenState::_IsValid(_PJoinedTokenState))
+            {
+                return;
+            }
+
+            // Tasks gathered together mostly share one token, joining it once is enough.
+            if (!_M_joinedTokens.empty() && _M_joinedTokens.back().first._GetImplValue() == _PJoinedTokenState)
+            {
+                return;
+            }
+
+            cancellation_token _Token = cancellation_token::_FromImpl(_PJoinedTokenState);
+            auto _Registration = _Token.register_callback([_MergedSrc](){
+                _MergedSrc.cancel();
+            });
+            _M_joinedTokens.push_back(std::make_pair(_Token, _Registration));
+        }
+
+        void _SetCancelOnFailure(_CancellationTokenState *_PTokenState)
+        {
+            if (_CancellationTokenState::_IsValid(_PTokenState))
+            {
+                _PTokenState->_Reference();
+                _M_cancelOnFailure = _PTokenState;
+            }
+        }
+
+        void _Fail()
+        {
+            if (!_M_fFailed.exchange(true) && _M_cancelOnFailure != nullptr)
+            {
+                _M_cancelOnFailure->_Cancel();
             }
         }
 
         task_completion_event<_Unit_type>       _M_completed;
-        _ResultHolder<std::vector<_Type> >      _M_vector;
-        _ResultHolder<_Type>                    _M_mergeVal;
         atomic_size_t                           _M_completeCount;
         size_t                                  _M_numTasks;
+        // Once set, the results of the tasks still running are dropped rather than stored.
+        std::atomic<bool>                       _M_fFailed;
+        _CancellationTokenState *               _M_cancelOnFailure;
+        std::vector<std::pair<cancellation_token, cancellation_token_registration>> _M_joinedTokens;
     };
 
+    // Helper struct for when_all operators to know when tasks have completed
     template<typename _Type>
-    struct _RunAllParam<std::vector<_Type> >
+    struct _RunAllParam : _RunAllParamBase
     {
-        _RunAllParam() : _M_completeCount(0), _M_numTasks(0)
+        void _Resize(size_t _Len, bool _SkipVector = false)
         {
+            _M_numTasks = _Len;
+            if (!_SkipVector)
+            {
+                _M_vector._Result.resize(_Len);
+            }
         }
 
+        _ResultHolder<std::vector<_Type> >      _M_vector;
+        _ResultHolder<_Type>                    _M_mergeVal;
+    };
+
+    template<typename _Type>
+    struct _RunAllParam<std::vector<_Type> > : _RunAllParamBase
+    {
         void _Resize(size_t _Len, bool _SkipVector = false)
         {
             _M_numTasks = _Len;
-            
+
             if (!_SkipVector)
             {
                 _M_vector.resize(_Len);
             }
         }
 
-        task_completion_event<_Unit_type>       _M_completed;
         std::vector<_ResultHolder<std::vector<_Type> > >  _M_vector;
-        atomic_size_t                           _M_completeCount;
-        size_t                                  _M_numTasks;
     };
 
     // Helper struct specialization for void
     template<>
-    struct _RunAllParam<_Unit_type>
+    struct _RunAllParam<_Unit_type> : _RunAllParamBase
     {
-        _RunAllParam() : _M_completeCount(0), _M_numTasks(0)
-        {
-        }
-
         void _Resize(size_t _Len)
         {
             _M_numTasks = _Len;
         }
-
-        task_completion_event<_Unit_type> _M_completed;
-        atomic_size_t _M_completeCount;
-        size_t _M_numTasks;
     };
 
     inline void _JoinAllTokens_Add(const cancellation_token_source& _MergedSrc, _CancellationTokenState *_PJoinedTokenState)
@@ -6343,7 +6412,10 @@ namespace details
     {
         if (_Task._GetImpl()->_IsCompleted())
         {
-            _Func();
+            if (!_PParam->_M_fFailed)
+            {
+                _Func();
+            }
             if (atomic_increment(_PParam->_M_completeCount) == _PParam->_M_numTasks)
             {
                 // Inline execute its direct continuation, the _ReturnTask
@@ -6365,6 +6437,9 @@ namespace details
                 _PParam->_M_completed._Cancel();
             }
 
+            // The returned task is done already, stop the others early if asked to.
+            _PParam->_Fail();
+
             if (atomic_increment(_PParam->_M_completeCount) == _PParam->_M_numTasks)
             {
                 delete _PParam;
@@ -6375,11 +6450,12 @@ namespace details
     template<typename _ElementType, typename _Iterator>
     struct _WhenAllImpl
     {
-        static task<std::vector<_ElementType>> _Perform(const task_options& _TaskOptions, _Iterator _Begin, _Iterator _End)
+        static task<std::vector<_ElementType>> _Perform(const task_options& _TaskOptions, _Iterator _Begin, _Iterator _End, _CancellationTokenState *_PCancelOnFailure = nullptr)
         {
             _CancellationTokenState *_PTokenState = _TaskOptions.has_cancellation_token() ? _TaskOptions.get_cancellation_token()._GetImplValue() : nullptr;
 
             auto _PParam = new _RunAllParam<_ElementType>();
+            _PParam->_SetCancelOnFailure(_PCancelOnFailure);
             cancellation_token_source _MergedSource;
 
             // Step1: Create task completion event.
@@ -6388,13 +6464,14 @@ namespace details
             task<_Unit_type> _All_tasks_completed(_PParam->_M_completed, _Options);
             // The return task must be created before step 3 to enforce inline execution.
             auto _ReturnTask = _All_tasks_completed._Then([=](_Unit_type) -> std::vector<_ElementType> {
-                return _PParam->_M_vector.Get();
+                // Runs inline from the last completion, the slots are not used anymore.
+                return std::move(_PParam->_M_vector._Result);
             }, nullptr);
 
             // Step2: Combine and check tokens, and count elements in range.
             if (_PTokenState)
             {
-                _JoinAllTokens_Add(_MergedSource, _PTokenState);
+                _PParam->_JoinToken(_MergedSource, _PTokenState);
                 _PParam->_Resize(static_cast<size_t>(std::distance(_Begin, _End)));
             }
             else
@@ -6403,7 +6480,7 @@ namespace details
                 for (auto _PTask = _Begin; _PTask != _End; ++_PTask)
                 {
                     _TaskNum++;
-                    _JoinAllTokens_Add(_MergedSource, _PTask->_GetImpl()->_M_pTokenState);
+                    _PParam->_JoinToken(_MergedSource, _PTask->_GetImpl()->_M_pTokenState);
                 }
                 _PParam->_Resize(_TaskNum);
             }
@@ -6433,7 +6510,7 @@ namespace details
                         };
 
                         _WhenAllContinuationWrapper(_PParam, _Func, _ResultTask);
-                    }, _CancellationTokenState::_None()); 
+                    }, _CancellationTokenState::_None());
 
                     _Index++;
                 }
@@ -6446,11 +6523,12 @@ namespace details
     template<typename _ElementType, typename _Iterator>
     struct _WhenAllImpl<std::vector<_ElementType>, _Iterator>
     {
-        static task<std::vector<_ElementType>> _Perform(const task_options& _TaskOptions, _Iterator _Begin, _Iterator _End)
+        static task<std::vector<_ElementType>> _Perform(const task_options& _TaskOptions, _Iterator _Begin, _Iterator _End, _CancellationTokenState *_PCancelOnFailure = nullptr)
         {
             _CancellationTokenState *_PTokenState = _TaskOptions.has_cancellation_token() ? _TaskOptions.get_cancellation_token()._GetImplValue() : nullptr;
 
             auto _PParam = new _RunAllParam<std::vector<_ElementType>>();
+            _PParam->_SetCancelOnFailure(_PCancelOnFailure);
             cancellation_token_source _MergedSource;
 
             // Step1: Create task completion event.
@@ -6460,11 +6538,18 @@ namespace details
             // The return task must be created before step 3 to enforce inline execution.
             auto _ReturnTask = _All_tasks_completed._Then([=](_Unit_type) -> std::vector<_ElementType> {
                 _ASSERTE(_PParam->_M_completeCount ==  _PParam->_M_numTasks);
+                size_t _Size = 0;
+                for(size_t _I = 0; _I < _PParam->_M_numTasks; _I++)
+                {
+                    _Size += _PParam->_M_vector[_I]._Result.size();
+                }
+
                 std::vector<_ElementType> _Result;
+                _Result.reserve(_Size);
                 for(size_t _I = 0; _I < _PParam->_M_numTasks; _I++)
                 {
-                    const std::vector<_ElementType>& _Vec = _PParam->_M_vector[_I].Get();
-                    _Result.insert(_Result.end(), _Vec.begin(), _Vec.end());
+                    std::vector<_ElementType>& _Vec = _PParam->_M_vector[_I]._Result;
+                    _Result.insert(_Result.end(), std::make_move_iterator(_Vec.begin()), std::make_move_iterator(_Vec.end()));
                 }
                 return _Result;
             }, nullptr);
@@ -6472,7 +6557,7 @@ namespace details
             // Step2: Combine and check tokens, and count elements in range.
             if (_PTokenState)
             {
-                _JoinAllTokens_Add(_MergedSource, _PTokenState);
+                _PParam->_JoinToken(_MergedSource, _PTokenState);
                 _PParam->_Resize(static_cast<size_t>(std::distance(_Begin, _End)));
             }
             else
@@ -6481,7 +6566,7 @@ namespace details
                 for (auto _PTask = _Begin; _PTask != _End; ++_PTask)
                 {
                     _TaskNum++;
-                    _JoinAllTokens_Add(_MergedSource, _PTask->_GetImpl()->_M_pTokenState);
+                    _PParam->_JoinToken(_MergedSource, _PTask->_GetImpl()->_M_pTokenState);
                 }
                 _PParam->_Resize(_TaskNum);
             }
@@ -6524,11 +6609,12 @@ namespace details
     template<typename _Iterator>
     struct _WhenAllImpl<void, _Iterator>
     {
-        static task<void> _Perform(const task_options& _TaskOptions, _Iterator _Begin, _Iterator _End)
+        static task<void> _Perform(const task_options& _TaskOptions, _Iterator _Begin, _Iterator _End, _CancellationTokenState *_PCancelOnFailure = nullptr)
         {
             _CancellationTokenState *_PTokenState = _TaskOptions.has_cancellation_token() ? _TaskOptions.get_cancellation_token()._GetImplValue() : nullptr;
 
             auto _PParam = new _RunAllParam<_Unit_type>();
+            _PParam->_SetCancelOnFailure(_PCancelOnFailure);
             cancellation_token_source _MergedSource;
 
             // Step1: Create task completion event.
@@ -6542,7 +6628,7 @@ namespace details
             // Step2: Combine and check tokens, and count elements in range.
             if (_PTokenState)
             {
-                _JoinAllTokens_Add(_MergedSource, _PTokenState);
+                _PParam->_JoinToken(_MergedSource, _PTokenState);
                 _PParam->_Resize(static_cast<size_t>(std::distance(_Begin, _End)));
             }
             else
@@ -6551,7 +6637,7 @@ namespace details
                 for (auto _PTask = _Begin; _PTask != _End; ++_PTask)
                 {
                     _TaskNum++;
-                    _JoinAllTokens_Add(_MergedSource, _PTask->_GetImpl()->_M_pTokenState);
+                    _PParam->_JoinToken(_MergedSource, _PTask->_GetImpl()->_M_pTokenState);
                 }
                 _PParam->_Resize(_TaskNum);
             }
@@ -6594,11 +6680,11 @@ namespace details
         // The return task must be created before step 3 to enforce inline execution.
         auto _ReturnTask = _All_tasks_completed._Then([=](_Unit_type) -> std::vector<_ReturnType> {
             _ASSERTE(_PParam->_M_completeCount == 2);
-            auto _Result = _PParam->_M_vector.Get(); // copy by value
+            auto _Result = std::move(_PParam->_M_vector._Result);
             auto _mergeVal = _PParam->_M_mergeVal.Get();
 
             if (_OutputVectorFirst == true)
-            {                
+            {
                 _Result.push_back(_mergeVal);
             }
             else
@@ -6609,8 +6695,8 @@ namespace details
         }, nullptr);
 
         // Step2: Combine and check tokens.
-        _JoinAllTokens_Add(_MergedSource, _VectorTask._GetImpl()->_M_pTokenState);
-        _JoinAllTokens_Add(_MergedSource, _ValueTask._GetImpl()->_M_pTokenState);
+        _PParam->_JoinToken(_MergedSource, _VectorTask._GetImpl()->_M_pTokenState);
+        _PParam->_JoinToken(_MergedSource, _ValueTask._GetImpl()->_M_pTokenState);
 
         // Step3: Check states of previous tasks.
         _PParam->_Resize(2, true);
@@ -6640,6 +6726,128 @@ namespace details
 
         return _ReturnTask;
     }
+
+    // Hands the tasks of a when_each to the callback one at a time, in the order they complete. Whoever finds the
+    // callback idle delivers until the queue is empty, the others only queue their task.
+    template<typename _ElementType, typename _Function>
+    struct _RunEachParam
+    {
+        _RunEachParam(const _Function& _Func, size_t _NumTasks)
+            : _M_func(_Func), _M_numTasks(_NumTasks), _M_delivered(0), _M_fDelivering(false), _M_fStopped(false)
+        {
+        }
+
+        void _Deliver(const task<_ElementType>& _Task, size_t _Index)
+        {
+            {
+                ::pplx::extensibility::scoped_critical_section_t _LockHolder(_M_lock);
+                if (_M_fStopped)
+                {
+                    return;
+                }
+                _M_queue.push_back(std::make_pair(_Task, _Index));
+                if (_M_fDelivering)
+                {
+                    return;
+                }
+                _M_fDelivering = true;
+            }
+
+            std::vector<std::pair<task<_ElementType>, size_t>> _Batch;
+            for (;;)
+            {
+                {
+                    ::pplx::extensibility::scoped_critical_section_t _LockHolder(_M_lock);
+                    if (_M_queue.empty())
+                    {
+                        _M_fDelivering = false;
+                        return;
+                    }
+                    _Batch.swap(_M_queue);
+                }
+
+                for (auto _It = _Batch.begin(); _It != _Batch.end(); ++_It)
+                {
+                    if (_M_token.is_canceled())
+                    {
+                        _Stop();
+                        _M_completed._Cancel();
+                        return;
+                    }
+
+                    try
+                    {
+                        _M_func(_It->first, _It->second);
+                    }
+                    catch (...)
+                    {
+                        _Stop();
+                        _M_completed.set_exception(std::current_exception());
+                        return;
+                    }
+
+                    if (++_M_delivered == _M_numTasks)
+                    {
+                        _Stop();
+                        _M_completed.set();
+                        return;
+                    }
+                }
+                _Batch.clear();
+            }
+        }
+
+        void _SetRegistration(cancellation_token_registration&& _Registration)
+        {
+            // The callback runs right away if the token is already canceled, the registration is of no use then.
+            ::pplx::extensibility::scoped_critical_section_t _LockHolder(_M_lock);
+            if (!_M_fStopped)
+            {
+                _M_registration = std::move(_Registration);
+            }
+        }
+
+        void _Cancel()
+        {
+            // The registration holds the callback, which holds this object: it is released with the token's.
+            cancellation_token_registration _Registration;
+            {
+                ::pplx::extensibility::scoped_critical_section_t _LockHolder(_M_lock);
+                _M_fStopped = true;
+                _M_queue.clear();
+                _Registration = std::move(_M_registration);
+            }
+            _M_completed._Cancel();
+        }
+
+        void _Stop()
+        {
+            cancellation_token_registration _Registration;
+            {
+                ::pplx::extensibility::scoped_critical_section_t _LockHolder(_M_lock);
+                _M_fStopped = true;
+                _M_queue.clear();
+                _Registration = std::move(_M_registration);
+            }
+
+            if (_Registration != cancellation_token_registration())
+            {
+                _M_token.deregister_callback(_Registration);
+            }
+        }
+
+        task_completion_event<void>             _M_completed;
+        _Function                               _M_func;
+        cancellation_token                      _M_token = cancellation_token::none();
+        cancellation_token_registration         _M_registration;
+        ::pplx::extensibility::critical_section_t _M_lock;
+        std::vector<std::pair<task<_ElementType>, size_t>> _M_queue;
+        size_t                                  _M_numTasks;
+        // Only used by the thread delivering.
+        size_t                                  _M_delivered;
+        bool                                    _M_fDelivering;
+        bool                                    _M_fStopped;
+    };
 } // namespace details
 
 /// <summary>
@@ -6673,6 +6881,106 @@ auto when_all(_Iterator _Begin, _Iterator _End, const task_options& _TaskOptions
     return details::_WhenAllImpl<_ElementType, _Iterator>::_Perform(_TaskOptions, _Begin, _End);
 }
 
+/// <summary>
+///     Creates a task that will complete successfully when all of the tasks supplied as arguments complete successfully, and cancels
+///     the given source as soon as one of them fails.
+/// </summary>
+/// <typeparam name="_Iterator">
+///     The type of the input iterator.
+/// </typeparam>
+/// <param name="_Begin">
+///     The position of the first element in the range of elements to be combined into the resulting task.
+/// </param>
+/// <param name="_End">
+///     The position of the first element beyond the range of elements to be combined into the resulting task.
+/// </param>
+/// <param name="_CancelOnFailure">
+///     The source of the token the input tasks observe. It is canceled when the first of them is canceled or throws an exception.
+/// </param>
+/// <returns>
+///     A task that completes sucessfully when all of the input tasks have completed successfully, with the same result as the
+///     <c>when_all</c> overload without a source.
+/// </returns>
+/// <remarks>
+///     Without a source, the tasks still running when one fails keep running to completion, although their results are dropped.
+///     Canceling the source lets a scatter-gather over many requests stop the remaining ones right after the first failure.
+/// </remarks>
+/// <seealso cref="Task Parallelism (Concurrency Runtime)"/>
+/**/
+template <typename _Iterator>
+auto when_all(_Iterator _Begin, _Iterator _End, const cancellation_token_source& _CancelOnFailure, const task_options& _TaskOptions = task_options())
+    -> decltype (details::_WhenAllImpl<typename std::iterator_traits<_Iterator>::value_type::result_type, _Iterator>::_Perform(_TaskOptions, _Begin, _End))
+{
+    typedef typename std::iterator_traits<_Iterator>::value_type::result_type _ElementType;
+    return details::_WhenAllImpl<_ElementType, _Iterator>::_Perform(_TaskOptions, _Begin, _End, _CancelOnFailure._GetImpl());
+}
+
+/// <summary>
+///     Calls a function with each of the tasks supplied as arguments, in the order they complete, and creates a task that completes
+///     once the function has been called for all of them.
+/// </summary>
+/// <typeparam name="_Iterator">
+///     The type of the input iterator.
+/// </typeparam>
+/// <typeparam name="_Function">
+///     The type of the function, callable as <c>_Func(task&lt;T&gt;, size_t)</c>.
+/// </typeparam>
+/// <param name="_Begin">
+///     The position of the first element in the range of tasks.
+/// </param>
+/// <param name="_End">
+///     The position of the first element beyond the range of tasks.
+/// </param>
+/// <param name="_Func">
+///     The function called with each completed task and its position in the range. The task may be canceled or hold an exception,
+///     which <c>get()</c> rethrows.
+/// </param>
+/// <param name="_TaskOptions">
+///     The options of the returned task. If its token is canceled, no more calls are made and the task is canceled.
+/// </param>
+/// <returns>
+///     A task that completes once every task has been passed to the function. If the function throws, no more calls are made and the
+///     task completes with that exception.
+/// </returns>
+/// <remarks>
+///     Calls are never concurrent. Tasks completing while a call is running are queued and handed over by the thread already calling,
+///     so consumers get results as they arrive instead of waiting for the slowest task, without blocking a thread per task.
+/// </remarks>
+/**/
+template<typename _Iterator, typename _Function>
+task<void> when_each(_Iterator _Begin, _Iterator _End, const _Function& _Func, const task_options& _TaskOptions = task_options())
+{
+    typedef typename std::iterator_traits<_Iterator>::value_type::result_type _ElementType;
+    auto _PParam = std::make_shared<details::_RunEachParam<_ElementType, _Function>>(_Func, static_cast<size_t>(std::distance(_Begin, _End)));
+    task<void> _ReturnTask(_PParam->_M_completed, _TaskOptions);
+    if (_Begin == _End)
+    {
+        _PParam->_M_completed.set();
+        return _ReturnTask;
+    }
+
+    if (_TaskOptions.has_cancellation_token() && _TaskOptions.get_cancellation_token().is_cancelable())
+    {
+        // Registered before any task is handed over, so that delivering never races with it.
+        _PParam->_M_token = _TaskOptions.get_cancellation_token();
+        _PParam->_SetRegistration(_PParam->_M_token.register_callback([_PParam]() {
+            _PParam->_Cancel();
+        }));
+    }
+
+    size_t _Index = 0;
+    for (auto _PTask = _Begin; _PTask != _End; ++_PTask)
+    {
+        _PTask->_Then([_PParam, _Index](task<_ElementType> _ResultTask) {
+            _PParam->_Deliver(_ResultTask, _Index);
+        }, details::_CancellationTokenState::_None(), details::_DefaultAutoInline);
+
+        _Index++;
+    }
+
+    return _ReturnTask;
+}
+
 /// <summary>
 ///     Creates a task that will complete succesfully when both of the tasks supplied as arguments complete successfully.
 /// </summary>
@@ -7286,20 +7594,23 @@ _Ty operator||(const task<void> & _Lhs_arg, const task<void> & _Rhs_arg)
     return _ReturnTask;
 }
 
+// A task that is ready from the start needs no completion event: its impl is completed as soon as it is created.
 template<typename _Ty>
 task<_Ty> task_from_result(_Ty _Param, const task_options& _TaskOptions = task_options())
 {
-    task_completion_event<_Ty> _Tce;
-    _Tce.set(_Param);
-    return create_task(_Tce, _TaskOptions);
+    task<_Ty> _Task;
+    _Task._CreateImpl(_TaskOptions.get_cancellation_token()._GetImplValue(), _TaskOptions.get_scheduler());
+    _Task._GetImpl()->_FinalizeAndRunContinuations(std::move(_Param));
+    return _Task;
 }
 
 template<class _Ty = void>
 inline task<_Ty> task_from_result(const task_options& _TaskOptions = task_options())
 {
-    task_completion_event<_Ty> _Tce;
-    _Tce.set();
-    return create_task(_Tce, _TaskOptions);
+    task<_Ty> _Task;
+    _Task._CreateImpl(_TaskOptions.get_cancellation_token()._GetImplValue(), _TaskOptions.get_scheduler());
+    _Task._GetImpl()->_FinalizeAndRunContinuations(details::_Unit_type());
+    return _Task;
 }
 
 template<typename _TaskType, typename _ExType>
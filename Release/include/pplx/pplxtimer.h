@@ -0,0 +1,244 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Timers for pplx tasks: a shared timer wheel, pplx::delay and pplx::with_timeout.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#pragma once
+
+#ifndef _PPLXTIMER_H
+#define _PPLXTIMER_H
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include "cpprest/details/cpprest_compat.h"
+#include "pplx/pplxtasks.h"
+
+namespace pplx
+{
+
+/// <summary>
+/// Hierarchical timer wheel with a resolution of one millisecond. Starting and canceling a timer take constant time
+/// whatever the number of outstanding timers, so every request can have its own deadline.
+/// </summary>
+/// <remarks>
+/// One thread advances the wheel, and only while timers are pending. Callbacks run on that thread, outside of any
+/// lock, and must be short: they usually complete a task_completion_event, whose continuations go to the scheduler.
+/// </remarks>
+class timer_service
+{
+public:
+    typedef uint64_t timer_id;
+
+    /// <summary>
+    /// The timer service used by the library. It is never destroyed.
+    /// </summary>
+    _ASYNCRTIMP static timer_service& __cdecl shared_instance();
+
+    _ASYNCRTIMP timer_service();
+
+    /// <summary>
+    /// Stops the timer thread. Timers still pending are dropped without being called.
+    /// </summary>
+    _ASYNCRTIMP ~timer_service();
+
+    /// <summary>
+    /// Calls the callback once the delay has elapsed.
+    /// </summary>
+    /// <returns>The id to cancel the timer with, never 0.</returns>
+    _ASYNCRTIMP timer_id start(std::chrono::milliseconds delay, std::function<void()> callback);
+
+    /// <summary>
+    /// Calls the callback every period, the first time one period from now, until the timer is canceled.
+    /// </summary>
+    /// <remarks>Calls never overlap. A call running late delays the next ones rather than being repeated.</remarks>
+    _ASYNCRTIMP timer_id start_periodic(std::chrono::milliseconds period, std::function<void()> callback);
+
+    /// <summary>
+    /// Cancels a timer. Safe to call with the id of a timer that already fired, or from its own callback.
+    /// </summary>
+    /// <returns>True if the callback will not be called anymore, false if the timer already fired or is firing.</returns>
+    _ASYNCRTIMP bool cancel(timer_id id);
+
+    /// <summary>
+    /// Number of timers started and neither fired nor canceled.
+    /// </summary>
+    _ASYNCRTIMP size_t pending() const;
+
+private:
+    timer_service(const timer_service&);
+    timer_service& operator=(const timer_service&);
+
+    struct impl;
+    std::unique_ptr<impl> m_impl;
+};
+
+namespace details
+{
+    // Timers fire on whole milliseconds, a delay is rounded up so that it never fires early.
+    template<typename _Rep, typename _Period>
+    std::chrono::milliseconds _Timer_milliseconds(std::chrono::duration<_Rep, _Period> _Duration)
+    {
+        auto _Ms = std::chrono::duration_cast<std::chrono::milliseconds>(_Duration);
+        if (_Ms < _Duration)
+            ++_Ms;
+        return _Ms.count() < 0 ? std::chrono::milliseconds(0) : _Ms;
+    }
+
+    /// <summary>
+    /// The timer and the cancellation registration behind a delay or a timeout. Whichever completes the task first
+    /// releases both.
+    /// </summary>
+    class _Timer_cleanup
+    {
+    public:
+        _Timer_cleanup() : _M_done(false), _M_timer(0), _M_registered(false)
+        {
+        }
+
+        void _Set_timer(timer_service::timer_id _Timer)
+        {
+            std::unique_lock<std::mutex> _Lock(_M_lock);
+            if (_M_done)
+            {
+                _Lock.unlock();
+                timer_service::shared_instance().cancel(_Timer);
+                return;
+            }
+            _M_timer = _Timer;
+        }
+
+        template<typename _Function>
+        void _Register(const cancellation_token& _Token, const _Function& _Func)
+        {
+            if (!_Token.is_cancelable())
+                return;
+
+            // The callback runs right away if the token is already canceled.
+            auto _Registration = _Token.register_callback(_Func);
+            std::unique_lock<std::mutex> _Lock(_M_lock);
+            if (_M_done)
+            {
+                _Lock.unlock();
+                _Token.deregister_callback(_Registration);
+                return;
+            }
+            _M_token = _Token;
+            _M_registration = _Registration;
+            _M_registered = true;
+        }
+
+        void _Finish()
+        {
+            std::unique_lock<std::mutex> _Lock(_M_lock);
+            if (_M_done)
+                return;
+            _M_done = true;
+            const auto _Timer = _M_timer;
+            const bool _Registered = _M_registered;
+            // The registration holds the callback, which holds this object: both go once deregistered.
+            auto _Token = std::move(_M_token);
+            auto _Registration = std::move(_M_registration);
+            _Lock.unlock();
+
+            if (_Timer != 0)
+                timer_service::shared_instance().cancel(_Timer);
+            if (_Registered)
+                _Token.deregister_callback(_Registration);
+        }
+
+    private:
+        std::mutex _M_lock;
+        bool _M_done;
+        timer_service::timer_id _M_timer;
+        cancellation_token _M_token = cancellation_token::none();
+        cancellation_token_registration _M_registration;
+        bool _M_registered;
+    };
+
+    template<typename _ReturnType>
+    void _Transfer_result(const task<_ReturnType>& _Task, const task_completion_event<_ReturnType>& _Tce)
+    {
+        _Tce.set(_Task.get());
+    }
+
+    inline void _Transfer_result(const task<void>& _Task, const task_completion_event<void>& _Tce)
+    {
+        _Task.get();
+        _Tce.set();
+    }
+} // namespace details
+
+/// <summary>
+/// Returns a task that completes once the duration has elapsed, without holding a thread meanwhile.
+/// </summary>
+/// <remarks>If the token is canceled first, the task throws task_canceled.</remarks>
+template<typename _Rep, typename _Period>
+task<void> delay(std::chrono::duration<_Rep, _Period> _Duration, cancellation_token _Token = cancellation_token::none())
+{
+    task_completion_event<void> _Tce;
+    auto _Cleanup = std::make_shared<details::_Timer_cleanup>();
+    _Cleanup->_Set_timer(timer_service::shared_instance().start(details::_Timer_milliseconds(_Duration), [_Tce, _Cleanup]
+    {
+        _Cleanup->_Finish();
+        _Tce.set();
+    }));
+    _Cleanup->_Register(_Token, [_Tce, _Cleanup]
+    {
+        _Cleanup->_Finish();
+        _Tce.set_exception(task_canceled("delay canceled"));
+    });
+    return create_task(_Tce);
+}
+
+/// <summary>
+/// Returns a task that completes like the given one, unless it takes longer than the duration.
+/// </summary>
+/// <remarks>
+/// Past the duration the returned task throws std::system_error with std::errc::timed_out, and task_canceled if the
+/// token is canceled first. Either way the given task keeps running: cancel its own token to stop it.
+/// </remarks>
+template<typename _ReturnType, typename _Rep, typename _Period>
+task<_ReturnType> with_timeout(task<_ReturnType> _Task, std::chrono::duration<_Rep, _Period> _Duration, cancellation_token _Token = cancellation_token::none())
+{
+    task_completion_event<_ReturnType> _Tce;
+    auto _Cleanup = std::make_shared<details::_Timer_cleanup>();
+    _Cleanup->_Set_timer(timer_service::shared_instance().start(details::_Timer_milliseconds(_Duration), [_Tce, _Cleanup]
+    {
+        _Cleanup->_Finish();
+        _Tce.set_exception(std::system_error(std::make_error_code(std::errc::timed_out), "task timed out"));
+    }));
+    _Cleanup->_Register(_Token, [_Tce, _Cleanup]
+    {
+        _Cleanup->_Finish();
+        _Tce.set_exception(task_canceled("timeout canceled"));
+    });
+    _Task.then([_Tce, _Cleanup](task<_ReturnType> _Completed)
+    {
+        _Cleanup->_Finish();
+        try
+        {
+            details::_Transfer_result(_Completed, _Tce);
+        }
+        catch (...)
+        {
+            _Tce.set_exception(std::current_exception());
+        }
+    });
+    return create_task(_Tce);
+}
+
+} // namespace pplx
+
+#endif // _PPLXTIMER_H
@@ -1,7 +1,8 @@
 #pragma once
 #include <exception>
 #include <string>
-#include "..\..\include\cpprest\CppRestNativeExport.h"
+#include "cpprest/CppRestNativeExport.h"
+#include "cpprest/details/cpprest_compat.h"
 
 namespace pplx
 {
@@ -34,6 +35,6 @@ namespace pplx
 		/**/
 		task_canceled() throw();
 		~task_canceled() throw ();
-		const char* what() const override;
+		const char* what() const throw() override;
 	};
 }
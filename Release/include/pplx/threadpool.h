@@ -28,6 +28,10 @@
 #include "pplx/pplx.h"
 #endif
 
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
 #include "cpprest/details/cpprest_compat.h"
 
 namespace crossplat {
@@ -49,12 +53,78 @@ template<class T>
 using java_local_ref = std::unique_ptr<typename std::remove_pointer<T>::type, java_local_ref_deleter>;
 #endif
 
+/// <summary>
+/// Sizing and thread settings of a thread pool.
+/// </summary>
+/// <remarks>
+/// A pool starts min_threads threads, one per hardware thread by default. While posted handlers keep waiting it
+/// doubles its threads every 20 ms, up to max_threads, which covers bursts of handlers that block. Threads above
+/// min_threads exit once the pool has had a thread to spare for idle_timeout.
+/// </remarks>
+struct threadpool_options
+{
+    threadpool_options()
+        : min_threads((std::max)(static_cast<size_t>(std::thread::hardware_concurrency()), static_cast<size_t>(1)))
+        , max_threads((std::max)(static_cast<size_t>(std::thread::hardware_concurrency()) * 4, static_cast<size_t>(40)))
+        , stack_size(0)
+        , idle_timeout(std::chrono::seconds(30))
+        , thread_name("cpprest")
+    {
+    }
+
+    /// <summary>
+    /// Threads started with the pool and never retired, one per hardware thread by default and at least 1.
+    /// </summary>
+    size_t min_threads;
+
+    /// <summary>
+    /// Upper bound of the threads able to run handlers, 4 per hardware thread and at least 40 by default.
+    /// Threads blocked waiting on a pplx task do not count: the pool replaces them rather than deadlock.
+    /// </summary>
+    size_t max_threads;
+
+    /// <summary>
+    /// Stack size of the threads in bytes, 0 for the platform default.
+    /// </summary>
+    size_t stack_size;
+
+    std::chrono::milliseconds idle_timeout;
+
+    /// <summary>
+    /// Prefix of the thread names, followed by the thread number. Empty to leave the threads unnamed.
+    /// </summary>
+    std::string thread_name;
+
+    /// <summary>
+    /// CPUs the threads may run on, empty for all of them. Applied on Linux only.
+    /// </summary>
+    std::vector<unsigned> cpu_affinity;
+};
+
 class threadpool
 {
 public:
     static threadpool& shared_instance();
+
+    /// <summary>
+    /// Gives the shared pool a fixed number of threads. Must be called before its first use.
+    /// </summary>
+    /// <exception cref="std::runtime_error">The shared pool has already started.</exception>
+    _ASYNCRTIMP static void __cdecl initialize_with_threads(size_t num_threads);
+
+    /// <summary>
+    /// Sets the options of the shared pool. Must be called before its first use.
+    /// </summary>
+    /// <exception cref="std::runtime_error">The shared pool has already started.</exception>
+    _ASYNCRTIMP static void __cdecl initialize_with_options(const threadpool_options& options);
+
+    /// <summary>
+    /// Creates a pool of num_threads threads, all started right away.
+    /// </summary>
     _ASYNCRTIMP static std::unique_ptr<threadpool> __cdecl construct(size_t num_threads);
 
+    _ASYNCRTIMP static std::unique_ptr<threadpool> __cdecl construct(const threadpool_options& options);
+
     virtual ~threadpool() = default;
 
     template<typename T>
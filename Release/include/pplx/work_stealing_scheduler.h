@@ -0,0 +1,60 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Work-stealing scheduler for pplx tasks (non-Windows).
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#pragma once
+
+#include <memory>
+#include "pplx/pplx.h"
+
+namespace pplx
+{
+
+/// <summary>
+/// Scheduler with one worker thread per core, each owning a Chase-Lev deque. Tasks scheduled from a worker stay on it:
+/// the newest one waits in a LIFO slot and runs as soon as the current task returns, so continuation chains keep
+/// their data hot in one cache. Idle workers steal the oldest tasks of busy ones. Tasks scheduled from other threads
+/// go through a shared injection queue.
+/// </summary>
+/// <remarks>
+/// Install it before the first task is created:
+/// <c>pplx::set_ambient_scheduler(std::make_shared&lt;pplx::work_stealing_scheduler&gt;());</c>
+/// A task that blocks waiting for other tasks gets a spare thread for as long as it waits, so nested waits do not
+/// deadlock. Spare threads are kept for reuse and, unlike workers, own no deque.
+/// </remarks>
+class work_stealing_scheduler : public pplx::scheduler_interface
+{
+public:
+    /// <summary>
+    /// Starts the workers.
+    /// </summary>
+    /// <param name="worker_count">Number of worker threads, 0 for one per hardware thread.</param>
+    _PPLXIMP explicit work_stealing_scheduler(size_t worker_count = 0);
+
+    /// <summary>
+    /// Runs the tasks still queued, then stops the workers. Must not be called from a worker.
+    /// </summary>
+    _PPLXIMP ~work_stealing_scheduler();
+
+    _PPLXIMP virtual void schedule(TaskProc_t proc, _In_ void* param);
+
+    _PPLXIMP size_t worker_count() const;
+
+private:
+    work_stealing_scheduler(const work_stealing_scheduler&);
+    work_stealing_scheduler& operator=(const work_stealing_scheduler&);
+
+    struct impl;
+    std::unique_ptr<impl> m_impl;
+};
+
+} // namespace pplx
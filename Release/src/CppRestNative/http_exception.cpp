@@ -1,6 +1,6 @@
 #include "stdafx.h"
-#include "..\..\include\cpprest\http_exception.h"
-#include "..\..\include\cpprest\asyncrt_utils.h"
+#include "cpprest/http_exception.h"
+#include "cpprest/asyncrt_utils.h"
 
 /// <summary>
 /// Represents an HTTP error. This class holds an error message and an optional error code.
@@ -69,7 +69,7 @@ http_exception::http_exception(int errorCode, const std::error_category &cat) :
 /// Gets a string identifying the cause of the exception.
 /// </summary>
 /// <returns>A null terminated character string.</returns>
-const char* http_exception::what() const
+const char* http_exception::what() const throw()
 {
 	return m_msg.c_str();
 }
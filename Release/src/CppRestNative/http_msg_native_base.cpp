@@ -1,5 +1,5 @@
 #include "stdafx.h"
-#include "..\..\include\cpprest/details/http_msg_native_base.h"
+#include "cpprest/details/http_msg_native_base.h"
 
 std::shared_ptr<web::http::details::HttpCppCliBridge>& web::http::details::http_msg_native_base::_get_httpCppCliBridge()
 {
@@ -1,2 +1,2 @@
 #include "stdafx.h"
-#include "..\..\include\cpprest\details\http_request_base.h"
\ No newline at end of file
+#include "cpprest/details/http_request_base.h"
\ No newline at end of file
@@ -1,4 +1,4 @@
 #include "stdafx.h"
-#include "..\..\include\cpprest\istreambuf_type_erasure.h"
+#include "cpprest/istreambuf_type_erasure.h"
 
 Concurrency::streams::istreambuf_type_erasure::~istreambuf_type_erasure() {}
\ No newline at end of file
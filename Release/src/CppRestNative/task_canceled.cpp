@@ -1,5 +1,5 @@
 #include "stdafx.h"
-#include "..\..\include\pplx/task_canceled.h"
+#include "pplx/task_canceled.h"
 
 pplx::task_canceled::task_canceled(const char* _Message) throw(): _message(_Message)
 {
@@ -13,7 +13,7 @@ pplx::task_canceled::~task_canceled() throw()
 {
 }
 
-const char* pplx::task_canceled::what() const
+const char* pplx::task_canceled::what() const throw()
 {
 	return _message.c_str();
 }
@@ -104,6 +104,13 @@ namespace CppRestNetImpl
             var clientCertificateCollection = CertificateHelper.GetCachedCertificateCollection(settings?.ClientCertificates);
             if (!(clientCertificateCollection is null))
                 _request.ClientCertificates = clientCertificateCollection;
+            // ServicePoint is resolved per host and proxy, so it must be touched only after Proxy is set
+            if (!(settings?.ConnectionLimit is null))
+                _request.ServicePoint.ConnectionLimit = settings.ConnectionLimit.Value;
+            if (!(settings?.ConnectionIdleTimeout is null))
+                _request.ServicePoint.MaxIdleTime = (int) settings.ConnectionIdleTimeout.Value.TotalMilliseconds;
+            if (!(settings?.ConnectionLifetime is null))
+                _request.ServicePoint.ConnectionLeaseTimeout = (int) settings.ConnectionLifetime.Value.TotalMilliseconds;
             if (!(settings?.ConnectTimeout is null))
                 _request.Timeout = (int) settings.ConnectTimeout.Value.TotalMilliseconds;
             /*else
@@ -17,6 +17,9 @@ namespace CppRestNetImpl
         TimeSpan? ConnectTimeout { get; }
         ICollection<KeyValuePair<string, StoreLocation>> ClientCertificates { get; }
         System.Net.ICredentials Credentials { get; }
+        int? ConnectionLimit { get; }
+        TimeSpan? ConnectionIdleTimeout { get; }
+        TimeSpan? ConnectionLifetime { get; }
     }
 
     public class RequestSettings: IRequestSettings
@@ -29,6 +32,9 @@ namespace CppRestNetImpl
         public TimeSpan? ConnectTimeout { get; set; }
         public ICollection<KeyValuePair<string, StoreLocation>> ClientCertificates { get; } = new List<KeyValuePair<string, StoreLocation>>();
         public System.Net.ICredentials Credentials { get; set; }
+        public int? ConnectionLimit { get; set; }
+        public TimeSpan? ConnectionIdleTimeout { get; set; }
+        public TimeSpan? ConnectionLifetime { get; set; }
 
         public TimeSpan? AllTimeouts
         {
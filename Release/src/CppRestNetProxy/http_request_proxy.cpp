@@ -28,12 +28,38 @@ namespace web::http::details
 	std::shared_ptr<http::details::http_response_proxy> http_request_proxy::get_response_cli()
 	{
 		CPPREST_BEGIN_MANAGED_TRY
-		auto response = processRequest();
+		//HttpWebRequest does not expose DNS, connect, TLS or connection reuse, only the response arrival is known
+		http::http_timings timings;
+		timings.start = http::http_timings::clock::now();
+		std::shared_ptr<http::details::http_response_proxy> response;
+		try
+		{
+			response = processRequest();
+		}
+		catch (...)
+		{
+			timings.complete = http::http_timings::clock::now();
+			timings.failed = true;
+			publishTimings(timings, nullptr);
+			throw;
+		}
+		timings.first_byte = timings.complete = http::http_timings::clock::now();
+		publishTimings(timings, response.get());
 		_response = response;
 		return response;
 		CPPREST_END_MANAGED_TRY
 	}
 
+	void http_request_proxy::publishTimings(const http::http_timings& timings, http::details::http_response_proxy* response)
+	{
+		_set_timings(timings);
+		if (response)
+			response->_set_timings(timings);
+		const auto& observer = client_config().get_timings_observer();
+		if (observer)
+			observer(absolute_uri(), timings);
+	}
+
 	namespace
 	{
 		System::Uri^ GetUri(const uri& uri)
@@ -106,6 +132,19 @@ namespace web::http::details
 			settings->ProxyInfo = gcnew CppRest::ProxyInfo(GetProxyMode(nativeProxy), GetCredentials(nativeProxy.credentials()), GetProxyAddress(nativeProxy));
 			FillClientCerts(config.get_client_certificates(), settings->ClientCertificates);
 			settings->Credentials = GetNetworkCredentials(config.credentials());
+			if (config.max_connections_per_host() > 0)
+				settings->ConnectionLimit = static_cast<int>(config.max_connections_per_host());
+			//The default is left to ServicePoint.MaxIdleTime, only an explicit timeout overrides it
+			if (config.is_connection_idle_timeout_set())
+			{
+				const auto idleTimeout = config.connection_idle_timeout<std::chrono::milliseconds>().count();
+				settings->ConnectionIdleTimeout = idleTimeout > 0
+					? System::TimeSpan::FromMilliseconds(static_cast<double>(idleTimeout))
+					: System::Threading::Timeout::InfiniteTimeSpan;
+			}
+			const auto lifetime = config.connection_max_lifetime<std::chrono::milliseconds>().count();
+			if (lifetime > 0)
+				settings->ConnectionLifetime = System::TimeSpan::FromMilliseconds(static_cast<double>(lifetime));
 			return settings;
 		}
 	}
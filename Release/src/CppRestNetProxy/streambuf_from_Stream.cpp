@@ -1,8 +1,14 @@
 #include "stdafx.h"
 #include "..\..\include\cpprest\details\streambuf_from_Stream.h"
+#include <algorithm>
 
 namespace Concurrency::streams::details
 {
+	namespace
+	{
+		const size_t readChunkSize = 64 * 1024;
+	}
+
 	streambuf_from_Stream::streambuf_from_Stream(System::IO::Stream^ source, std::optional<int64_t> contentLength, std::shared_ptr<void> holder):
 		_source(source),
 		_contentLength(contentLength),
@@ -53,104 +59,51 @@ namespace Concurrency::streams::details
 		CPPREST_END_MANAGED_TRY
 	}
 
-	istreambuf_type_erasure::size_type streambuf_from_Stream::ReadWholeBuffer(array<System::Byte>^ buffer, size_type bufferOffset)
+	void streambuf_from_Stream::FillWindow(size_t size)
 	{
-		size_type oldReallyReaded = 0, reallyReaded = 0;
-		do
+		if (_readChunk.operator->() == nullptr)
+			_readChunk = gcnew array<System::Byte>(static_cast<int>(readChunkSize));
+		//The Stream only reads into managed arrays, each Read goes through the reusable chunk
+		_window.fill(size, [this](uint8_t* ptr, size_t count) -> size_t
 		{
-			oldReallyReaded = reallyReaded;
-			reallyReaded += _source->Read(buffer, reallyReaded+bufferOffset, buffer->Length-reallyReaded-bufferOffset);
-		} while (reallyReaded != oldReallyReaded);
-		return reallyReaded;
+			const auto readed = _source->Read(_readChunk, 0, static_cast<int>((std::min)(count, readChunkSize)));
+			if (readed <= 0)
+				return 0;
+			System::Runtime::InteropServices::Marshal::Copy(_readChunk, 0, System::IntPtr(ptr), readed);
+			return static_cast<size_t>(readed);
+		});
 	}
 
 	istreambuf_type_erasure::size_type streambuf_from_Stream::sgetn(void* ptr, size_type size)
 	{
 		CPPREST_BEGIN_MANAGED_TRY
-		//System::Diagnostics::Debug::WriteLine("sgetn");
 		if (size <= 0)
-		{
-			//System::Diagnostics::Debug::WriteLine("size <= 0");
 			return 0;
-		}
-		size_type realyReaded = 0;
-		if(_last_read_buffer.operator->() == nullptr)
-		{
-			//System::Diagnostics::Debug::WriteLine("_last_read_buffer == 0");
-			auto newBuffer = gcnew array<System::Byte>((size_t)size);
-			realyReaded = ReadWholeBuffer(newBuffer, 0);
-			System::Runtime::InteropServices::Marshal::Copy(newBuffer, 0, System::IntPtr(ptr), (size_t)size);
-			_last_read_buffer = newBuffer;
-		}
-		else if (_last_read_buffer->Length >= size)
-		{
-			//System::Diagnostics::Debug::WriteLine("_last_read_buffer->Length >= size");
-			System::Runtime::InteropServices::Marshal::Copy(_last_read_buffer, 0, System::IntPtr(ptr), (size_t)size);
-			realyReaded = size;
-		}
-		else if (_last_read_buffer->Length < size)
-		{
-			//System::Diagnostics::Debug::WriteLine("_last_read_buffer->Length < size");
-			auto newBuffer = gcnew array<System::Byte>(_last_read_buffer->Length + (size_t)size);
-			System::Array::Copy(_last_read_buffer, newBuffer, _last_read_buffer->Length);
-			realyReaded = ReadWholeBuffer(newBuffer, _last_read_buffer->Length);
-			_last_read_buffer = newBuffer;
-		}
-		return realyReaded;
+		FillWindow(static_cast<size_t>(size));
+		const auto available = (std::min)(static_cast<size_t>(size), _window.size());
+		_window.copy_to(ptr, available);
+		return static_cast<size_type>(available);
 		CPPREST_END_MANAGED_TRY
 	}
 
 	void streambuf_from_Stream::CursorMoveForward(size_type size)
 	{
-		CPPREST_BEGIN_MANAGED_TRY
-		//System::Diagnostics::Debug::WriteLine("CursorMoveForward");
 		if (size <= 0)
-		{
-			//System::Diagnostics::Debug::WriteLine("size <= 0");
 			return;
-		}
-		if (_last_read_buffer.operator->() == nullptr)
-		{
-			//System::Diagnostics::Debug::WriteLine("_last_read_buffer.operator->() == nullptr");
+		if (static_cast<size_t>(size) > _window.size())
 			throw std::logic_error(__FUNCSIG__);
-		}
 		if (_contentLength)
-		{
-			//System::Diagnostics::Debug::WriteLine("_contentLength");
 			_contentLength = std::make_optional(_contentLength.value() - size);
-		}
-		if (_last_read_buffer->Length == size)
-		{
-			//System::Diagnostics::Debug::WriteLine("_last_read_buffer->Length == size");
-			_last_read_buffer = nullptr;
-		}
-		else 
-			if (_last_read_buffer->Length > size)
-			{
-				//System::Diagnostics::Debug::WriteLine("_last_read_buffer->Length > size");
-				auto newBuffer = gcnew array<System::Byte>(_last_read_buffer->Length - (size_t)size);
-				System::Array::Copy(_last_read_buffer, (int)size, newBuffer, 0, (int)(_last_read_buffer->Length - (size_t)size));
-				_last_read_buffer = newBuffer;
-			}
-		CPPREST_END_MANAGED_TRY
+		_window.consume(static_cast<size_t>(size));
 	}
 
+	//Like any stream buffer, returns fewer bytes than asked for at the end of the source, and 0 past it.
+	//The readers loop until they get 0 (see _request_stream_writer_async), so they no longer need it to throw.
 	istreambuf_type_erasure::size_type streambuf_from_Stream::sbumpcn(void* ptr, size_type size)
 	{
 		CPPREST_BEGIN_MANAGED_TRY
-		//System::Diagnostics::Debug::WriteLine("sbumpcn");
-		if (size <= 0)
-		{
-			//System::Diagnostics::Debug::WriteLine("size <= 0");
-			return 0;
-		}
-		auto result = sgetn(ptr, size);
-		if (_last_read_buffer->Length < size)
-		{
-			//System::Diagnostics::Debug::WriteLine("_last_read_buffer->Length < size");
-			throw std::logic_error(__FUNCSIG__);
-		}
-		CursorMoveForward(size);
+		const auto result = sgetn(ptr, size);
+		CursorMoveForward(result);
 		return result;
 		CPPREST_END_MANAGED_TRY
 	}
@@ -158,12 +111,33 @@ namespace Concurrency::streams::details
 	istreambuf_type_erasure::size_type streambuf_from_Stream::snextcn(void* ptr, size_type size)
 	{
 		CPPREST_BEGIN_MANAGED_TRY
-		sgetn(ptr, size);
-		CursorMoveForward(size);
+		if (size <= 0)
+			return 0;
+		FillWindow(static_cast<size_t>(size));
+		CursorMoveForward((std::min)(size, static_cast<size_type>(_window.size())));
 		return sgetn(ptr, size);
 		CPPREST_END_MANAGED_TRY
 	}
 
+	bool streambuf_from_Stream::acquire(const void*& ptr, size_type& count)
+	{
+		CPPREST_BEGIN_MANAGED_TRY
+		FillWindow(1);
+		size_t contiguous = 0;
+		ptr = _window.contiguous(contiguous);
+		count = static_cast<size_type>(contiguous);
+		return true;
+		CPPREST_END_MANAGED_TRY
+	}
+
+	void streambuf_from_Stream::release(const void* ptr, size_type count)
+	{
+		CPPREST_BEGIN_MANAGED_TRY
+		(void)ptr;
+		CursorMoveForward(count);
+		CPPREST_END_MANAGED_TRY
+	}
+
 	istreambuf_type_erasure::pos_type streambuf_from_Stream::pubseekoff(pos_type pos,
 																		std::ios_base::seekdir cur,
 	                                                                    std::ios_base::openmode mode)
@@ -73,6 +73,18 @@ const uri & http_client::base_uri() const
     return _base_uri;
 }
 
+#if !defined(_WIN32)
+pplx::task<void> http_client::prewarm_connections(size_t count) const
+{
+    return details::prewarm_connections(_base_uri, _client_config, count);
+}
+
+connection_pool_stats http_client::pool_stats() const
+{
+    return details::get_connection_pool_stats(_base_uri, _client_config);
+}
+#endif
+
 // Macros to help build string at compile time and avoid overhead.
 #define STRINGIFY(x) _XPLATSTR(#x)
 #define TOSTRING(x) STRINGIFY(x)
@@ -0,0 +1,3191 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* HTTP Library: Client-side APIs.
+*
+* Native HTTP/1.1 transport built on Boost.Asio. On non-Windows platforms it replaces the .Net HttpWebRequest
+* bridge of CppRestNetProxy and implements http_request_proxy on top of non-blocking sockets.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "stdafx.h"
+
+#if !defined(_WIN32)
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <limits>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <boost/asio.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/algorithm/string.hpp>
+
+#include "pplx/pplxtimer.h"
+#include "pplx/threadpool.h"
+#include "cpprest/details/hpack.h"
+#include "cpprest/details/internal_http_helpers.h"
+#include "cpprest/details/http_request_proxy.h"
+#include "cpprest/details/http_response_proxy.h"
+#include "cpprest/metrics.h"
+
+using boost::asio::ip::tcp;
+
+namespace web { namespace http { namespace client { namespace details
+{
+
+using web::http::details::http_request_proxy;
+using web::http::details::http_response_proxy;
+namespace hpack = web::http::details::hpack;
+namespace compression = web::http::details::compression;
+
+namespace
+{
+    const std::string CRLF("\r\n");
+
+    // Ends a chunked request body, no trailers are sent.
+    const std::string last_chunk("0\r\n\r\n");
+
+    // Largest piece of a response body read from the socket at once.
+    const size_t body_read_size = 64 * 1024;
+
+    // Largest piece of a request body read from its stream at once, and so all an upload holds in memory.
+    const size_t body_write_size = 64 * 1024;
+
+    /// <summary>
+    /// Type-erased stream buffer over a byte vector. The http_request_proxy body writers only know
+    /// istreambuf_type_erasure, so request and response bodies are exchanged with them through this class.
+    /// </summary>
+    class streambuf_from_vector final : public concurrency::streams::istreambuf_type_erasure
+    {
+    public:
+        streambuf_from_vector() : m_position(0) {}
+
+        explicit streambuf_from_vector(std::vector<uint8_t> data) : m_data(std::move(data)), m_position(0) {}
+
+        std::vector<uint8_t>& data() { return m_data; }
+
+        bool can_seek() override { return true; }
+
+        size_type in_avail() override { return static_cast<size_type>(m_data.size() - m_position); }
+
+        int pubsync() override
+        {
+            return 0;
+        }
+
+        size_type sputn(const void* ptr, size_type size) override
+        {
+            if (size <= 0)
+                return 0;
+            auto first = static_cast<const uint8_t*>(ptr);
+            m_data.insert(m_data.end(), first, first + size);
+            return size;
+        }
+
+        size_type sgetn(void* ptr, size_type size) override
+        {
+            const auto count = (std::min)(size, in_avail());
+            if (count <= 0)
+                return 0;
+            std::memcpy(ptr, m_data.data() + m_position, static_cast<size_t>(count));
+            return count;
+        }
+
+        size_type sbumpcn(void* ptr, size_type size) override
+        {
+            const auto count = sgetn(ptr, size);
+            m_position += static_cast<size_t>(count);
+            return count;
+        }
+
+        size_type snextcn(void* ptr, size_type size) override
+        {
+            m_position += static_cast<size_t>((std::min)(size, in_avail()));
+            return sgetn(ptr, size);
+        }
+
+        pos_type pubseekoff(pos_type pos, std::ios_base::seekdir cur, std::ios_base::openmode mode) override
+        {
+            (void)mode;
+            pos_type base = 0;
+            if (cur == std::ios_base::cur)
+                base = static_cast<pos_type>(m_position);
+            else if (cur == std::ios_base::end)
+                base = static_cast<pos_type>(m_data.size());
+            const auto target = base + pos;
+            if (target < 0 || target > static_cast<pos_type>(m_data.size()))
+                return static_cast<pos_type>(-1);
+            m_position = static_cast<size_t>(target);
+            return target;
+        }
+
+        pos_type pubseekpos(pos_type pos, std::ios_base::openmode mode) override
+        {
+            return pubseekoff(pos, std::ios_base::beg, mode);
+        }
+
+        // The vector is handed out in place: readers consume it directly and writers fill its tail.
+        bool acquire(const void*& ptr, size_type& count) override
+        {
+            count = in_avail();
+            ptr = count > 0 ? m_data.data() + m_position : nullptr;
+            return true;
+        }
+
+        void release(const void*, size_type count) override
+        {
+            m_position += static_cast<size_t>((std::min)(count, in_avail()));
+        }
+
+        void* alloc(size_type count) override
+        {
+            if (count <= 0)
+                return nullptr;
+            m_alloc_base = m_data.size();
+            m_data.resize(m_alloc_base + static_cast<size_t>(count));
+            return m_data.data() + m_alloc_base;
+        }
+
+        void commit(size_type count) override
+        {
+            m_data.resize(m_alloc_base + static_cast<size_t>(count));
+        }
+
+    private:
+        std::vector<uint8_t> m_data;
+        size_t m_position;
+        size_t m_alloc_base = 0;
+    };
+
+    /// <summary>
+    /// Reads a request body from its stream one bounded window at a time, through the codec when the body is compressed.
+    /// Only the current window is held, so an upload takes the same memory whatever the size of its body.
+    /// </summary>
+    class request_body_source final : public std::enable_shared_from_this<request_body_source>
+    {
+    public:
+        request_body_source(concurrency::streams::streambuf<uint8_t> source, std::optional<int64_t> length,
+            std::optional<compression::compression_algorithm> algorithm, pplx::cancellation_token token)
+            : m_source(std::move(source)),
+            m_length(length),
+            m_remaining(length),
+            m_algorithm(algorithm),
+            m_token(std::move(token)),
+            m_origin(m_source.can_seek() ? m_source.getpos(std::ios_base::in) : static_cast<concurrency::streams::streambuf<uint8_t>::pos_type>(-1))
+        {
+            if (m_algorithm)
+                m_compressor = utility::details::make_unique<compression::stream_compressor>(*m_algorithm);
+        }
+
+        // Size of the body on the wire, unknown for compressed bodies and for streams that cannot seek.
+        std::optional<int64_t> wire_length() const { return m_algorithm ? std::nullopt : m_length; }
+
+        // True when the last window was handed out, next() would complete with an empty one.
+        bool complete() const { return m_finished || (!m_compressor && m_remaining && *m_remaining == 0); }
+
+        const uint8_t* data() const { return m_window.data(); }
+
+        /// <summary>
+        /// Completes with the size of the next window, zero once the body is complete. The window stays valid until the next call.
+        /// </summary>
+        pplx::task<size_t> next()
+        {
+            m_started = true;
+            if (m_finished)
+                return pplx::task_from_result<size_t>(0);
+            if (m_remaining && *m_remaining == 0)
+                return pplx::task_from_result(finish());
+
+            const auto count = m_remaining ? static_cast<size_t>((std::min)(*m_remaining, static_cast<int64_t>(body_write_size))) : body_write_size;
+            m_window.resize(body_write_size);
+            m_reading = true;
+            auto self = shared_from_this();
+            return m_source.getn(m_window.data(), count).then([self](pplx::task<size_t> read) -> pplx::task<size_t>
+            {
+                self->m_reading = false;
+                const auto size = read.get();
+                if (size == 0)
+                {
+                    if (self->m_remaining)
+                        throw http_exception(_XPLATSTR("Request body stream ended before the declared Content-Length"));
+                    return pplx::task_from_result(self->finish());
+                }
+                utility::metrics::library().http_request_body_bytes.add(static_cast<int64_t>(size));
+                if (self->m_remaining)
+                    *self->m_remaining -= static_cast<int64_t>(size);
+                if (!self->m_compressor)
+                    return pplx::task_from_result(size);
+
+                // The codec may hold everything back until it has a block, read on until it gives something out.
+                auto compressed = self->m_compressor->compress(self->m_window.data(), size, false);
+                if (self->m_compressor->has_error())
+                    throw http_exception(_XPLATSTR("Failed to compress request body"));
+                if (compressed.empty())
+                    return self->next();
+                self->m_window = std::move(compressed);
+                return pplx::task_from_result(self->m_window.size());
+            }, m_token);
+        }
+
+        /// <summary>
+        /// Goes back to where the body started so it can be sent again. Fails for streams that cannot seek once a window was read.
+        /// </summary>
+        bool rewind()
+        {
+            if (!m_started)
+                return true;
+            if (m_reading || m_origin == static_cast<concurrency::streams::streambuf<uint8_t>::pos_type>(-1)
+                || m_source.seekpos(m_origin, std::ios_base::in) != m_origin)
+            {
+                return false;
+            }
+            m_remaining = m_length;
+            m_finished = false;
+            m_started = false;
+            if (m_algorithm)
+                m_compressor = utility::details::make_unique<compression::stream_compressor>(*m_algorithm);
+            return true;
+        }
+
+    private:
+        size_t finish()
+        {
+            m_finished = true;
+            if (!m_compressor)
+                return 0;
+            m_window = m_compressor->compress(nullptr, 0, true);
+            if (m_compressor->has_error())
+                throw http_exception(_XPLATSTR("Failed to compress request body"));
+            return m_window.size();
+        }
+
+        concurrency::streams::streambuf<uint8_t> m_source;
+        const std::optional<int64_t> m_length;
+        std::optional<int64_t> m_remaining;
+        const std::optional<compression::compression_algorithm> m_algorithm;
+        std::unique_ptr<compression::stream_compressor> m_compressor;
+        pplx::cancellation_token m_token;
+        const concurrency::streams::streambuf<uint8_t>::pos_type m_origin;
+        std::vector<uint8_t> m_window;
+        bool m_started = false;
+        bool m_finished = false;
+        std::atomic<bool> m_reading { false };
+    };
+
+    utility::string_t basic_authorization(const web::credentials& cred)
+    {
+        const auto password = cred._internal_decrypt();
+        const auto userpass = utility::conversions::to_utf8string(cred.username() + _XPLATSTR(":") + *password);
+        return _XPLATSTR("Basic ") + utility::conversions::to_base64(std::vector<unsigned char>(userpass.begin(), userpass.end()));
+    }
+
+    int default_port(const uri& u)
+    {
+        if (!u.is_port_default())
+            return u.port();
+        return u.scheme() == _XPLATSTR("https") ? 443 : 80;
+    }
+}
+
+/// <summary>
+/// One TCP (optionally TLS) connection to a server or to a proxy.
+/// </summary>
+class asio_connection
+{
+public:
+    explicit asio_connection(boost::asio::io_service& service)
+        : m_socket(service),
+        m_created(std::chrono::steady_clock::now()),
+        m_keep_alive(true),
+        m_closed(false),
+        m_is_reused(false)
+    {
+    }
+
+    ~asio_connection()
+    {
+        close();
+    }
+
+    void upgrade_to_ssl(const http_client_config& config, const std::string& host, const std::vector<std::string>& alpn_protocols = std::vector<std::string>())
+    {
+        std::lock_guard<std::mutex> lock(m_socket_lock);
+        boost::asio::ssl::context ssl_context(boost::asio::ssl::context::sslv23);
+        ssl_context.set_default_verify_paths();
+        ssl_context.set_options(boost::asio::ssl::context::default_workarounds);
+        const auto& ssl_context_callback = config.get_ssl_context_callback();
+        if (ssl_context_callback)
+        {
+            ssl_context_callback(ssl_context);
+        }
+
+        m_ssl_stream = utility::details::make_unique<boost::asio::ssl::stream<tcp::socket&>>(m_socket, ssl_context);
+
+        // Check to set host name for Server Name Indication (SNI)
+        if (config.is_tlsext_sni_enabled())
+        {
+            SSL_set_tlsext_host_name(m_ssl_stream->native_handle(), const_cast<char*>(host.data()));
+        }
+
+        // Application protocols offered in the ClientHello, in preference order.
+        if (!alpn_protocols.empty())
+        {
+            std::vector<unsigned char> wire;
+            for (const auto& protocol : alpn_protocols)
+            {
+                wire.push_back(static_cast<unsigned char>(protocol.size()));
+                wire.insert(wire.end(), protocol.begin(), protocol.end());
+            }
+            SSL_set_alpn_protos(m_ssl_stream->native_handle(), wire.data(), static_cast<unsigned int>(wire.size()));
+        }
+
+        if (config.validate_certificates())
+        {
+            m_ssl_stream->set_verify_mode(boost::asio::ssl::verify_peer);
+            m_ssl_stream->set_verify_callback(boost::asio::ssl::rfc2818_verification(host));
+        }
+        else
+        {
+            m_ssl_stream->set_verify_mode(boost::asio::ssl::verify_none);
+        }
+    }
+
+    void close()
+    {
+        std::lock_guard<std::mutex> lock(m_socket_lock);
+
+        // Stop any outstanding operation; their handlers are invoked with operation_aborted.
+        m_keep_alive = false;
+        m_closed = true;
+
+        boost::system::error_code error;
+        m_socket.shutdown(tcp::socket::shutdown_both, error);
+        m_socket.close(error);
+    }
+
+    bool is_ssl() const { return m_ssl_stream ? true : false; }
+
+    /// <summary>
+    /// Protocol selected by the server through ALPN, empty if none was negotiated.
+    /// </summary>
+    std::string negotiated_protocol()
+    {
+        std::lock_guard<std::mutex> lock(m_socket_lock);
+        if (!m_ssl_stream)
+            return std::string();
+        const unsigned char* protocol = nullptr;
+        unsigned int length = 0;
+        SSL_get0_alpn_selected(m_ssl_stream->native_handle(), &protocol, &length);
+        return protocol ? std::string(reinterpret_cast<const char*>(protocol), length) : std::string();
+    }
+    bool keep_alive() const { return m_keep_alive; }
+    void set_keep_alive(bool keep_alive) { m_keep_alive = keep_alive; }
+
+    // True once the connection served a request and came back through the pool.
+    bool is_reused() const { return m_is_reused; }
+    void set_reused() { m_is_reused = true; }
+
+    std::chrono::steady_clock::time_point created() const { return m_created; }
+
+    template <typename Iterator, typename Handler>
+    void async_connect(const Iterator& begin, const Handler& handler)
+    {
+        std::lock_guard<std::mutex> lock(m_socket_lock);
+        if (m_closed)
+        {
+            boost::asio::post(m_socket.get_executor(), std::bind(handler, boost::asio::error::operation_aborted, Iterator()));
+            return;
+        }
+        boost::asio::async_connect(m_socket, begin, handler);
+    }
+
+    template <typename HandshakeHandler>
+    void async_handshake(const HandshakeHandler& handler)
+    {
+        std::lock_guard<std::mutex> lock(m_socket_lock);
+        m_ssl_stream->async_handshake(boost::asio::ssl::stream_base::client, handler);
+    }
+
+    template <typename ConstBufferSequence, typename Handler>
+    void async_write(const ConstBufferSequence& buffers, const Handler& handler)
+    {
+        std::lock_guard<std::mutex> lock(m_socket_lock);
+        if (m_ssl_stream)
+            boost::asio::async_write(*m_ssl_stream, buffers, handler);
+        else
+            boost::asio::async_write(m_socket, buffers, handler);
+    }
+
+    template <typename Handler>
+    void async_read_until(boost::asio::streambuf& buffer, const std::string& delim, const Handler& handler)
+    {
+        std::lock_guard<std::mutex> lock(m_socket_lock);
+        if (m_ssl_stream)
+            boost::asio::async_read_until(*m_ssl_stream, buffer, delim, handler);
+        else
+            boost::asio::async_read_until(m_socket, buffer, delim, handler);
+    }
+
+    template <typename CompletionCondition, typename Handler>
+    void async_read(boost::asio::streambuf& buffer, const CompletionCondition& condition, const Handler& handler)
+    {
+        std::lock_guard<std::mutex> lock(m_socket_lock);
+        if (m_ssl_stream)
+            boost::asio::async_read(*m_ssl_stream, buffer, condition, handler);
+        else
+            boost::asio::async_read(m_socket, buffer, condition, handler);
+    }
+
+private:
+    std::mutex m_socket_lock;
+    tcp::socket m_socket;
+    std::unique_ptr<boost::asio::ssl::stream<tcp::socket&>> m_ssl_stream;
+    const std::chrono::steady_clock::time_point m_created;
+    bool m_keep_alive;
+    bool m_closed;
+    bool m_is_reused;
+};
+
+/// <summary>
+/// Process wide pool of kept-alive connections, keyed by scheme, host, port and proxy.
+/// </summary>
+/// <remarks>
+/// Every connection handed out is counted as active until it is released. A released connection that
+/// may be kept alive goes to the first waiting request, or is parked as idle. Idle connections are
+/// reused most recently used first and swept once they pass the idle timeout or the maximum lifetime.
+/// </remarks>
+class asio_connection_pool
+{
+public:
+    /// <summary>
+    /// Receives an established connection, or nullptr when the caller got a slot to open a new one.
+    /// </summary>
+    typedef std::function<void(std::shared_ptr<asio_connection>)> acquire_handler;
+
+    static asio_connection_pool& shared_instance()
+    {
+        static asio_connection_pool instance(crossplat::threadpool::shared_instance().service());
+        return instance;
+    }
+
+    static std::string pool_key(const uri& base_uri, const http_client_config& config)
+    {
+        std::string key = utility::conversions::to_utf8string(base_uri.scheme()) + "://"
+            + utility::conversions::to_utf8string(base_uri.host()) + ":" + std::to_string(default_port(base_uri));
+        if (config.proxy().is_specified())
+        {
+            key += " via " + utility::conversions::to_utf8string(config.proxy().address().to_string());
+        }
+        return key;
+    }
+
+    void acquire(const std::string& key, const http_client_config& config, acquire_handler handler)
+    {
+        std::shared_ptr<asio_connection> connection;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            auto& host = m_hosts[key];
+            host.apply(config);
+            expire_idle(host, std::chrono::steady_clock::now());
+
+            if (!host.idle.empty())
+            {
+                connection = std::move(host.idle.back().connection);
+                host.idle.pop_back();
+                ++host.stats.connections_reused;
+            }
+            else if (host.max_connections != 0 && host.active >= host.max_connections)
+            {
+                host.waiters.push_back(std::move(handler));
+                return;
+            }
+            else
+            {
+                ++host.stats.connections_created;
+            }
+            ++host.active;
+        }
+        m_service.post(std::bind(std::move(handler), std::move(connection)));
+    }
+
+    /// <summary>
+    /// Grants up to count slots for new connections, leaving the idle ones and the host limit in place.
+    /// </summary>
+    size_t reserve(const std::string& key, const http_client_config& config, size_t count)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto entry = m_hosts.emplace(key, host_pool()).first;
+        auto& host = entry->second;
+        host.apply(config);
+        expire_idle(host, std::chrono::steady_clock::now());
+
+        size_t granted = count > host.idle.size() ? count - host.idle.size() : 0;
+        if (host.max_connections != 0)
+        {
+            const auto in_use = host.active + host.idle.size();
+            granted = (std::min)(granted, in_use < host.max_connections ? host.max_connections - in_use : 0);
+        }
+        host.active += granted;
+        host.stats.connections_created += granted;
+        forget_if_unused(entry);
+        return granted;
+    }
+
+    /// <summary>
+    /// Gives back a slot obtained from acquire or reserve. The connection is kept if the server allows it.
+    /// </summary>
+    void release(const std::string& key, std::shared_ptr<asio_connection> connection)
+    {
+        acquire_handler waiter;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            auto entry = m_hosts.find(key);
+            if (entry == m_hosts.end())
+            {
+                // Every slot holds its host entry, so this is not expected.
+                if (connection)
+                    connection->close();
+                return;
+            }
+            auto& host = entry->second;
+            const auto now = std::chrono::steady_clock::now();
+
+            if (connection && (!connection->keep_alive() || host.is_expired(*connection, now, now)))
+            {
+                connection->close();
+                connection.reset();
+            }
+
+            if (host.waiters.empty())
+            {
+                --host.active;
+                if (connection)
+                {
+                    connection->set_reused();
+                    host.idle.push_back(idle_connection { std::move(connection), now });
+                    schedule_sweep();
+                }
+                forget_if_unused(entry);
+                return;
+            }
+
+            // The slot moves to the waiting request, with the connection if it can be reused.
+            waiter = std::move(host.waiters.front());
+            host.waiters.pop_front();
+            if (connection)
+            {
+                connection->set_reused();
+                ++host.stats.connections_reused;
+            }
+            else
+            {
+                ++host.stats.connections_created;
+            }
+        }
+        m_service.post(std::bind(std::move(waiter), std::move(connection)));
+    }
+
+    connection_pool_stats stats(const std::string& key)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto host = m_hosts.find(key);
+        if (host == m_hosts.end())
+            return connection_pool_stats();
+        auto result = host->second.stats;
+        result.idle_connections = host->second.idle.size();
+        result.active_connections = host->second.active;
+        result.waiting_requests = host->second.waiters.size();
+        return result;
+    }
+
+private:
+    struct idle_connection
+    {
+        std::shared_ptr<asio_connection> connection;
+        std::chrono::steady_clock::time_point last_used;
+    };
+
+    struct host_pool
+    {
+        // Most recently used at the back.
+        std::vector<idle_connection> idle;
+        std::deque<acquire_handler> waiters;
+        size_t active = 0;
+        size_t max_connections = 0;
+        std::chrono::microseconds idle_timeout = std::chrono::microseconds::zero();
+        std::chrono::microseconds max_lifetime = std::chrono::microseconds::zero();
+        connection_pool_stats stats;
+
+        // The most recent client configuration for the host wins.
+        void apply(const http_client_config& config)
+        {
+            max_connections = config.max_connections_per_host();
+            idle_timeout = config.connection_idle_timeout<std::chrono::microseconds>();
+            max_lifetime = config.connection_max_lifetime<std::chrono::microseconds>();
+        }
+
+        bool is_expired(const asio_connection& connection, std::chrono::steady_clock::time_point last_used, std::chrono::steady_clock::time_point now) const
+        {
+            return (idle_timeout.count() > 0 && now - last_used >= idle_timeout)
+                || (max_lifetime.count() > 0 && now - connection.created() >= max_lifetime);
+        }
+    };
+
+    explicit asio_connection_pool(boost::asio::io_service& service)
+        : m_service(service),
+        m_sweep_timer(service),
+        m_sweep_scheduled(false)
+    {
+    }
+
+    typedef std::unordered_map<std::string, host_pool> host_map;
+
+    // Must be called with m_lock held. A host is dropped with its counters once nothing refers to it,
+    // so clients talking to many hosts do not keep an entry for each of them.
+    void forget_if_unused(host_map::iterator entry)
+    {
+        const auto& host = entry->second;
+        if (host.idle.empty() && host.active == 0 && host.waiters.empty())
+            m_hosts.erase(entry);
+    }
+
+    void expire_idle(host_pool& host, std::chrono::steady_clock::time_point now)
+    {
+        auto expired = std::remove_if(host.idle.begin(), host.idle.end(), [&](const idle_connection& idle)
+        {
+            return host.is_expired(*idle.connection, idle.last_used, now);
+        });
+        for (auto it = expired; it != host.idle.end(); ++it)
+        {
+            it->connection->close();
+            ++host.stats.connections_expired;
+        }
+        host.idle.erase(expired, host.idle.end());
+    }
+
+    // Must be called with m_lock held.
+    void schedule_sweep()
+    {
+        if (m_sweep_scheduled)
+            return;
+        m_sweep_scheduled = true;
+        m_sweep_timer.expires_from_now(boost::posix_time::seconds(1));
+        m_sweep_timer.async_wait([this](const boost::system::error_code& ec)
+        {
+            if (ec == boost::asio::error::operation_aborted)
+                return;
+            sweep();
+        });
+    }
+
+    void sweep()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        m_sweep_scheduled = false;
+        const auto now = std::chrono::steady_clock::now();
+        bool has_idle = false;
+        for (auto entry = m_hosts.begin(); entry != m_hosts.end();)
+        {
+            auto current = entry++;
+            expire_idle(current->second, now);
+            has_idle = has_idle || !current->second.idle.empty();
+            forget_if_unused(current);
+        }
+        if (has_idle)
+            schedule_sweep();
+    }
+
+    boost::asio::io_service& m_service;
+    std::mutex m_lock;
+    host_map m_hosts;
+    boost::asio::deadline_timer m_sweep_timer;
+    bool m_sweep_scheduled;
+};
+
+/// <summary>
+/// Brings a fresh connection up to the point where a request can be written: resolve, connect,
+/// CONNECT tunnel for https through a proxy, then the TLS handshake.
+/// </summary>
+class asio_connector final : public std::enable_shared_from_this<asio_connector>
+{
+public:
+    /// <summary>
+    /// Receives the failed step description with its error code, or an empty message on success.
+    /// </summary>
+    typedef std::function<void(const std::string&, const boost::system::error_code&)> connect_handler;
+
+    /// <param name="timings">Receives the DNS, connect and TLS phases, may be null. Must outlive the connect.</param>
+    asio_connector(std::shared_ptr<asio_connection> connection, const uri& target, const http_client_config& config, boost::asio::io_service& service,
+        std::vector<std::string> alpn_protocols = std::vector<std::string>(), http_timings* timings = nullptr)
+        : m_connection(std::move(connection)),
+        m_uri(target),
+        m_config(config),
+        m_resolver(service),
+        m_alpn_protocols(std::move(alpn_protocols)),
+        m_timings(timings)
+    {
+    }
+
+    void start(connect_handler handler)
+    {
+        m_handler = std::move(handler);
+        stamp(&http_timings::dns_start);
+
+        const uri& endpoint = uses_proxy() ? m_config.proxy().address() : m_uri;
+        tcp::resolver::query query(utility::conversions::to_utf8string(endpoint.host()), std::to_string(default_port(endpoint)));
+        auto self = shared_from_this();
+        m_resolver.async_resolve(query, [self](const boost::system::error_code& ec, tcp::resolver::iterator endpoints)
+        {
+            self->handle_resolve(ec, endpoints);
+        });
+    }
+
+private:
+    bool uses_proxy() const
+    {
+        return m_config.proxy().is_specified();
+    }
+
+    void stamp(http_timings::time_point http_timings::* phase)
+    {
+        if (m_timings)
+            m_timings->*phase = http_timings::clock::now();
+    }
+
+    void finish(const std::string& message, const boost::system::error_code& ec)
+    {
+        auto handler = std::move(m_handler);
+        handler(message, ec);
+    }
+
+    void handle_resolve(const boost::system::error_code& ec, tcp::resolver::iterator endpoints)
+    {
+        stamp(&http_timings::dns_end);
+        if (ec)
+        {
+            finish("Error resolving address", ec);
+            return;
+        }
+        stamp(&http_timings::connect_start);
+        auto self = shared_from_this();
+        m_connection->async_connect(endpoints, [self](const boost::system::error_code& ec, tcp::resolver::iterator)
+        {
+            self->handle_connect(ec);
+        });
+    }
+
+    void handle_connect(const boost::system::error_code& ec)
+    {
+        stamp(&http_timings::connect_end);
+        if (ec)
+        {
+            finish("Failed to connect to any resolved endpoint", ec);
+            return;
+        }
+
+        if (m_uri.scheme() != _XPLATSTR("https"))
+        {
+            finish(std::string(), ec);
+        }
+        else if (uses_proxy())
+        {
+            write_connect_request();
+        }
+        else
+        {
+            start_handshake();
+        }
+    }
+
+    void write_connect_request()
+    {
+        const auto authority = utility::conversions::to_utf8string(m_uri.host()) + ":" + std::to_string(default_port(m_uri));
+        std::ostream connect_stream(&m_connect_buf);
+        connect_stream.imbue(std::locale::classic());
+        connect_stream << "CONNECT " << authority << " HTTP/1.1" << CRLF;
+        connect_stream << "Host: " << authority << CRLF;
+        connect_stream << "Proxy-Connection: Keep-Alive" << CRLF;
+        if (m_config.proxy().credentials().is_set())
+        {
+            connect_stream << "Proxy-Authorization: " << utility::conversions::to_utf8string(basic_authorization(m_config.proxy().credentials())) << CRLF;
+        }
+        connect_stream << CRLF;
+
+        auto self = shared_from_this();
+        m_connection->async_write(m_connect_buf.data(), [self](const boost::system::error_code& ec, size_t)
+        {
+            if (ec)
+            {
+                self->finish("Failed to send connect request to proxy", ec);
+                return;
+            }
+            self->m_connection->async_read_until(self->m_connect_response_buf, CRLF + CRLF, [self](const boost::system::error_code& ec, size_t)
+            {
+                self->handle_connect_response(ec);
+            });
+        });
+    }
+
+    void handle_connect_response(const boost::system::error_code& ec)
+    {
+        if (ec)
+        {
+            finish("Failed to read connect response from proxy", ec);
+            return;
+        }
+
+        std::istream response_stream(&m_connect_response_buf);
+        std::string http_version;
+        status_code code = 0;
+        response_stream >> http_version >> code;
+        if (!response_stream || code != status_codes::OK)
+        {
+            finish("Expected a HTTP 200 response from the proxy, received " + std::to_string(code), boost::system::error_code());
+            return;
+        }
+        start_handshake();
+    }
+
+    void start_handshake()
+    {
+        stamp(&http_timings::tls_start);
+        m_connection->upgrade_to_ssl(m_config, utility::conversions::to_utf8string(m_uri.host()), m_alpn_protocols);
+        auto self = shared_from_this();
+        m_connection->async_handshake([self](const boost::system::error_code& ec)
+        {
+            self->stamp(&http_timings::tls_end);
+            if (ec)
+            {
+                self->finish("Error in SSL handshake", ec);
+                return;
+            }
+            self->finish(std::string(), ec);
+        });
+    }
+
+    std::shared_ptr<asio_connection> m_connection;
+    uri m_uri;
+    http_client_config m_config;
+    tcp::resolver m_resolver;
+    boost::asio::streambuf m_connect_buf;
+    boost::asio::streambuf m_connect_response_buf;
+    std::vector<std::string> m_alpn_protocols;
+    http_timings* m_timings;
+    connect_handler m_handler;
+};
+
+class asio_h2_session;
+
+/// <summary>
+/// State machine of a single request/response exchange. Every step is a completion handler posted on the
+/// shared io_service, the http_response task is completed from the last one.
+/// </summary>
+class asio_context final : public std::enable_shared_from_this<asio_context>
+{
+public:
+    asio_context(const std::shared_ptr<http_request_proxy>& request, boost::asio::io_service& service)
+        : m_request(request),
+        m_uri(request->absolute_uri()),
+        m_config(request->client_config()),
+        m_pool_key(asio_connection_pool::pool_key(m_uri, m_config)),
+        m_service(service),
+        m_content_length(0),
+        m_timedout(false),
+        m_aborted(false),
+        m_completed(false)
+    {
+    }
+
+    static pplx::task<std::shared_ptr<http_response_proxy>> start(const std::shared_ptr<http_request_proxy>& request)
+    {
+        auto& service = crossplat::threadpool::shared_instance().service();
+        auto ctx = std::make_shared<asio_context>(request, service);
+        request->_context = ctx;
+        ctx->m_response = request->make_empty_response();
+        ctx->m_timings.start = http_timings::clock::now();
+        ctx->m_decode_response = ctx->m_config.request_compressed_response()
+            && !request->headers().has(header_names::accept_encoding)
+            && !compression::supported_encodings().empty();
+        if (request->_has_explicit_response_stream())
+            ctx->m_body_stream = request->_request_impl_from_this()->_response_stream();
+
+        if (!request->has_request_body())
+        {
+            ctx->start_exchange();
+            return pplx::create_task(ctx->m_response_completion);
+        }
+
+        std::optional<int64_t> body_length;
+        utility::size64_t header_length = 0;
+        if (request->headers().match(header_names::content_length, header_length))
+            body_length = static_cast<int64_t>(header_length);
+        else
+            body_length = request->_request_stream_length();
+        if (body_length && *body_length < 0)
+            body_length.reset();
+
+        std::optional<compression::compression_algorithm> body_algorithm;
+        const auto& body_coding = ctx->m_config.request_body_compression();
+        if (!body_coding.empty() && !request->headers().has(header_names::content_encoding))
+        {
+            const auto algorithm = compression::stream_decompressor::to_compression_algorithm(body_coding);
+            if (!compression::stream_compressor::is_supported(algorithm))
+            {
+                ctx->report_error("Unsupported request body compression " + utility::conversions::to_utf8string(body_coding), boost::system::error_code());
+                return pplx::create_task(ctx->m_response_completion);
+            }
+            body_algorithm = algorithm;
+            ctx->m_request_content_encoding = utility::conversions::to_utf8string(body_coding);
+        }
+        else if (ctx->borrow_request_body(body_length))
+        {
+            ctx->start_exchange();
+            return pplx::create_task(ctx->m_response_completion);
+        }
+
+        // Everything else is read window by window while it is written, starting once the connection is ready.
+        auto request_impl = request->_request_impl_from_this();
+        ctx->m_body_source = std::make_shared<request_body_source>(request_impl->instream().streambuf(), body_length, body_algorithm,
+            request_impl->cancellation_token());
+        ctx->start_exchange();
+        return pplx::create_task(ctx->m_response_completion);
+    }
+
+    void abort()
+    {
+        m_aborted = true;
+        if (!cancel_exchange())
+        {
+            // Still collecting the body or waiting for the pool, nothing to interrupt.
+            report_error(std::string(), boost::system::error_code());
+        }
+    }
+
+private:
+    friend class asio_h2_session;
+
+    bool uses_proxy() const
+    {
+        return m_config.proxy().is_specified();
+    }
+
+    bool tunnels_through_proxy() const
+    {
+        return uses_proxy() && m_uri.scheme() == _XPLATSTR("https");
+    }
+
+    // HTTP/2 is used for https when enabled, and for plain http only with prior knowledge and no proxy.
+    bool uses_http2() const
+    {
+        const auto mode = m_config.http2();
+        if (mode == http2_mode::disabled)
+            return false;
+        if (m_uri.scheme() == _XPLATSTR("https"))
+            return true;
+        return mode == http2_mode::prior_knowledge && !uses_proxy();
+    }
+
+    // Defined after asio_h2_session.
+    void start_exchange();
+    void detach_h2_stream();
+
+    // In-memory bodies (container_buffer, rawptr_buffer) are written straight from their storage, without the pump.
+    bool borrow_request_body(const std::optional<int64_t>& length)
+    {
+        if (!length || *length < 0)
+            return false;
+        auto source = m_request->_request_impl_from_this()->instream().streambuf();
+        uint8_t* data = nullptr;
+        size_t available = 0;
+        if (!source || !source.acquire(data, available))
+            return false;
+        const auto size = static_cast<size_t>(*length);
+        if (available < size || (data == nullptr && size > 0))
+        {
+            source.release(data, 0);
+            return false;
+        }
+        m_borrowed_body = source;
+        m_request_data = data;
+        m_request_size = size;
+        utility::metrics::library().http_request_body_bytes.add(static_cast<int64_t>(size));
+        return true;
+    }
+
+    // The source is kept until the context goes, a cancelled HTTP/2 write may still reference it.
+    // A failed request consumes nothing, so a retry sends the body again from the caller's position.
+    void release_borrowed_body(bool sent)
+    {
+        if (!m_borrowed_body || m_borrowed_body_released.exchange(true))
+            return;
+        m_borrowed_body.release(const_cast<uint8_t*>(m_request_data), sent ? m_request_size : 0);
+    }
+
+    void start_request()
+    {
+        if (m_aborted)
+        {
+            report_exception(std::make_exception_ptr(pplx::task_canceled("http request aborted")));
+            return;
+        }
+
+        write_request_headers();
+        start_timer();
+        acquire_connection();
+    }
+
+    void acquire_connection()
+    {
+        auto self = shared_from_this();
+        asio_connection_pool::shared_instance().acquire(m_pool_key, m_config, [self](std::shared_ptr<asio_connection> connection)
+        {
+            self->handle_acquire(std::move(connection));
+        });
+    }
+
+    void handle_acquire(std::shared_ptr<asio_connection> connection)
+    {
+        const bool reused = connection ? true : false;
+        if (!connection)
+            connection = std::make_shared<asio_connection>(m_service);
+        {
+            std::lock_guard<std::mutex> lock(m_connection_lock);
+            m_connection = connection;
+        }
+
+        // Aborted or timed out while waiting for the pool, only give the slot back.
+        if (m_completed)
+        {
+            if (!reused)
+                connection->close();
+            release_connection();
+            return;
+        }
+        if (m_aborted || m_timedout)
+        {
+            report_error("Failed to acquire a connection", boost::system::error_code());
+            return;
+        }
+
+        m_timings.connection_reused = reused;
+        if (reused)
+        {
+            utility::metrics::library().http_pool_hits.add();
+            write_request();
+            return;
+        }
+        utility::metrics::library().http_pool_misses.add();
+
+        auto self = shared_from_this();
+        std::make_shared<asio_connector>(connection, m_uri, m_config, m_service, std::vector<std::string>(), &m_timings)
+            ->start([self](const std::string& message, const boost::system::error_code& ec)
+        {
+            if (!message.empty())
+            {
+                self->report_error(message, ec);
+                return;
+            }
+            self->write_request();
+        });
+    }
+
+    // A kept-alive connection may have been closed by the server while it sat in the pool.
+    bool retry_on_stale_connection(const boost::system::error_code& ec)
+    {
+        if (m_aborted || m_timedout || !m_connection->is_reused() || m_response_buf.size() != 0)
+            return false;
+        if (ec != boost::asio::error::eof
+            && ec != boost::asio::error::connection_reset
+            && ec != boost::asio::error::broken_pipe
+            && ec != boost::asio::ssl::error::stream_truncated)
+        {
+            return false;
+        }
+        // A streamed body can only be sent again from a stream that seeks back to where it started.
+        if (m_body_source && !m_body_source->rewind())
+            return false;
+        cancel_exchange();
+        release_connection();
+        acquire_connection();
+        return true;
+    }
+
+    void release_connection()
+    {
+        std::shared_ptr<asio_connection> connection;
+        {
+            std::lock_guard<std::mutex> lock(m_connection_lock);
+            connection = std::move(m_connection);
+        }
+        if (connection)
+            asio_connection_pool::shared_instance().release(m_pool_key, std::move(connection));
+    }
+
+    bool cancel_exchange()
+    {
+        std::lock_guard<std::mutex> lock(m_connection_lock);
+        if (!m_connection)
+            return false;
+        m_connection->close();
+        return true;
+    }
+
+    void write_request_headers()
+    {
+        std::ostream request_stream(&m_request_buf);
+        request_stream.imbue(std::locale::classic());
+
+        auto& request_headers = m_request->headers();
+        const auto host = utility::conversions::to_utf8string(m_uri.host());
+        const auto port = default_port(m_uri);
+
+        // Origin form for direct connections and CONNECT tunnels, absolute form for plain proxied requests.
+        std::string target;
+        if (uses_proxy() && !tunnels_through_proxy())
+        {
+            target = utility::conversions::to_utf8string(m_uri.scheme()) + "://" + host + ":" + std::to_string(port);
+        }
+        target += m_uri.path().empty() ? "/" : utility::conversions::to_utf8string(m_uri.path());
+        if (!m_uri.query().empty())
+        {
+            target += "?" + utility::conversions::to_utf8string(m_uri.query());
+        }
+
+        request_stream << utility::conversions::to_utf8string(m_request->method()) << " " << target << " HTTP/1.1" << CRLF;
+
+        if (!request_headers.has(header_names::host))
+        {
+            request_stream << "Host: " << host;
+            if (!m_uri.is_port_default())
+                request_stream << ":" << port;
+            request_stream << CRLF;
+        }
+
+        for (const auto& header : request_headers)
+        {
+            // Framing headers are produced by the transport.
+            if (utility::details::str_icmp(header.first, header_names::content_length)
+                || utility::details::str_icmp(header.first, header_names::transfer_encoding)
+                || utility::details::str_icmp(header.first, header_names::connection))
+            {
+                continue;
+            }
+            request_stream << utility::conversions::to_utf8string(header.first) << ": " << utility::conversions::to_utf8string(header.second) << CRLF;
+        }
+
+        if (m_config.credentials().is_set() && !request_headers.has(header_names::authorization))
+        {
+            request_stream << "Authorization: " << utility::conversions::to_utf8string(basic_authorization(m_config.credentials())) << CRLF;
+        }
+
+        if (uses_proxy() && !tunnels_through_proxy() && m_config.proxy().credentials().is_set())
+        {
+            request_stream << "Proxy-Authorization: " << utility::conversions::to_utf8string(basic_authorization(m_config.proxy().credentials())) << CRLF;
+        }
+
+        if (m_decode_response)
+        {
+            request_stream << "Accept-Encoding: " << utility::conversions::to_utf8string(compression::supported_encodings()) << CRLF;
+        }
+
+        if (!m_request_content_encoding.empty())
+        {
+            request_stream << "Content-Encoding: " << m_request_content_encoding << CRLF;
+        }
+
+        const auto method = m_request->method();
+        if (chunked_request())
+        {
+            request_stream << "Transfer-Encoding: chunked" << CRLF;
+        }
+        else if (request_length() != 0 || method == methods::POST || method == methods::PUT)
+        {
+            request_stream << "Content-Length: " << request_length() << CRLF;
+        }
+
+        request_stream << "Connection: Keep-Alive" << CRLF << CRLF;
+    }
+
+    void start_timer()
+    {
+        const auto timeout = m_config.timeout<std::chrono::microseconds>();
+        if (timeout.count() <= 0 || m_timer_started.exchange(true))
+            return;
+        // Deadlines live in the shared timer wheel, the exchange is torn down on the io_service like every other step.
+        std::weak_ptr<asio_context> weak_self = shared_from_this();
+        m_timer = pplx::timer_service::shared_instance().start(pplx::details::_Timer_milliseconds(timeout), [weak_self]
+        {
+            auto self = weak_self.lock();
+            if (!self)
+                return;
+            self->m_service.post([self]
+            {
+                if (self->m_completed)
+                    return;
+                self->m_timedout = true;
+                if (!self->cancel_exchange())
+                    self->report_error(std::string(), boost::system::error_code());
+            });
+        });
+    }
+
+    // Streamed bodies have no length up front when they are compressed or their stream cannot seek.
+    bool chunked_request() const
+    {
+        return m_body_source && !m_body_source->wire_length();
+    }
+
+    uint64_t request_length() const
+    {
+        return m_body_source ? static_cast<uint64_t>(m_body_source->wire_length().value_or(0)) : m_request_size;
+    }
+
+    void write_request()
+    {
+        m_timings.request_start = http_timings::clock::now();
+        if (m_body_source)
+        {
+            write_body(true);
+            return;
+        }
+
+        // Headers and an in-memory body leave in one gather write.
+        std::vector<boost::asio::const_buffer> buffers;
+        buffers.push_back(m_request_buf.data());
+        if (m_request_size != 0)
+            buffers.push_back(boost::asio::buffer(m_request_data, m_request_size));
+
+        auto self = shared_from_this();
+        m_connection->async_write(buffers, [self](const boost::system::error_code& ec, size_t)
+        {
+            self->handle_write(ec);
+        });
+    }
+
+    // Reads the next window of a streamed body and writes it, the headers go out together with the first one.
+    void write_body(bool with_headers)
+    {
+        auto self = shared_from_this();
+        m_body_source->next().then([self, with_headers](pplx::task<size_t> read)
+        {
+            size_t size = 0;
+            try
+            {
+                size = read.get();
+            }
+            catch (...)
+            {
+                self->report_exception(std::current_exception());
+                return;
+            }
+            self->write_window(size, with_headers);
+        });
+    }
+
+    void write_window(size_t size, bool with_headers)
+    {
+        std::vector<boost::asio::const_buffer> buffers;
+        if (with_headers)
+            buffers.push_back(m_request_buf.data());
+
+        const bool last = size == 0 || m_body_source->complete();
+        if (chunked_request() && size != 0)
+        {
+            const auto length = std::snprintf(m_chunk_header, sizeof(m_chunk_header), "%zx\r\n", size);
+            buffers.push_back(boost::asio::buffer(m_chunk_header, static_cast<size_t>(length)));
+        }
+        if (size != 0)
+            buffers.push_back(boost::asio::buffer(m_body_source->data(), size));
+        if (chunked_request() && size != 0)
+            buffers.push_back(boost::asio::buffer(CRLF));
+        if (chunked_request() && last)
+            buffers.push_back(boost::asio::buffer(last_chunk));
+
+        auto self = shared_from_this();
+        m_connection->async_write(buffers, [self, last](const boost::system::error_code& ec, size_t)
+        {
+            if (ec || last)
+            {
+                self->handle_write(ec);
+                return;
+            }
+            self->write_body(false);
+        });
+    }
+
+    void handle_write(const boost::system::error_code& ec)
+    {
+        if (ec)
+        {
+            if (!retry_on_stale_connection(ec))
+                report_error("Failed to write request", ec);
+            return;
+        }
+        m_timings.request_end = http_timings::clock::now();
+        read_headers();
+    }
+
+    void read_headers()
+    {
+        auto self = shared_from_this();
+        m_connection->async_read_until(m_response_buf, CRLF + CRLF, [self](const boost::system::error_code& ec, size_t)
+        {
+            self->handle_headers(ec);
+        });
+    }
+
+    void handle_headers(const boost::system::error_code& ec)
+    {
+        if (ec)
+        {
+            if (!retry_on_stale_connection(ec))
+                report_error("Failed to read HTTP status line and headers", ec);
+            return;
+        }
+
+        std::istream response_stream(&m_response_buf);
+        response_stream.imbue(std::locale::classic());
+        std::string http_version;
+        response_stream >> http_version;
+        status_code code = 0;
+        response_stream >> code;
+        std::string reason_phrase;
+        std::getline(response_stream, reason_phrase);
+        boost::algorithm::trim(reason_phrase);
+
+        if (!response_stream || http_version.substr(0, 5) != "HTTP/")
+        {
+            report_error("Invalid HTTP status line", boost::system::error_code());
+            return;
+        }
+
+        // Interim responses carry no body, wait for the final one.
+        const bool interim = code >= 100 && code < 200;
+
+        auto& response_headers = m_response->headers();
+        std::string header;
+        while (std::getline(response_stream, header) && header != "\r")
+        {
+            const auto colon = header.find_first_of(':');
+            if (colon == std::string::npos)
+                continue;
+            auto name = header.substr(0, colon);
+            auto value = header.substr(colon + 1);
+            boost::algorithm::trim(name);
+            boost::algorithm::trim(value);
+            if (interim)
+                continue;
+            if (boost::iequals(name, header_names::connection))
+            {
+                m_connection->set_keep_alive(!boost::iequals(value, "close"));
+            }
+            response_headers.add(utility::conversions::to_string_t(name), utility::conversions::to_string_t(value));
+        }
+
+        if (interim)
+        {
+            read_headers();
+            return;
+        }
+
+        m_timings.first_byte = http_timings::clock::now();
+        m_response->set_status_code(code);
+        m_response->set_reason_phrase(utility::conversions::to_string_t(reason_phrase));
+        select_response_decoder();
+
+        if (http_version == "HTTP/1.0")
+            m_connection->set_keep_alive(false);
+
+        // Responses to HEAD and some status codes never carry a body.
+        if (m_request->method() == methods::HEAD
+            || code == status_codes::NoContent
+            || code == status_codes::NotModified)
+        {
+            complete_response();
+            return;
+        }
+
+        utility::string_t transfer_encoding;
+        if (response_headers.match(header_names::transfer_encoding, transfer_encoding)
+            && boost::icontains(transfer_encoding, U("chunked")))
+        {
+            read_chunk_header();
+            return;
+        }
+
+        if (response_headers.match(header_names::content_length, m_content_length))
+        {
+            m_body_remaining = m_content_length;
+            read_content();
+            return;
+        }
+
+        // Neither Content-Length nor chunked: the body ends with the connection.
+        m_connection->set_keep_alive(false);
+        read_until_eof();
+    }
+
+    void read_content()
+    {
+        auto self = shared_from_this();
+        if (m_body_remaining == 0)
+        {
+            after_body_written([self] { self->complete_response(); });
+            return;
+        }
+
+        const auto buffered = m_response_buf.size();
+        if (buffered != 0)
+        {
+            const auto size = static_cast<size_t>((std::min)(m_body_remaining, static_cast<utility::size64_t>(buffered)));
+            take_body(size);
+            m_body_remaining -= size;
+            after_body_written([self] { self->read_content(); });
+            return;
+        }
+
+        m_connection->async_read(m_response_buf,
+            boost::asio::transfer_exactly(static_cast<size_t>((std::min)(m_body_remaining, static_cast<utility::size64_t>(body_read_size)))),
+            [self](const boost::system::error_code& ec, size_t)
+        {
+            if (ec)
+            {
+                self->report_error("Failed to read response body", ec);
+                return;
+            }
+            self->read_content();
+        });
+    }
+
+    void read_chunk_header()
+    {
+        auto self = shared_from_this();
+        m_connection->async_read_until(m_response_buf, CRLF, [self](const boost::system::error_code& ec, size_t)
+        {
+            self->handle_chunk_header(ec);
+        });
+    }
+
+    void handle_chunk_header(const boost::system::error_code& ec)
+    {
+        if (ec)
+        {
+            report_error("Failed to read chunked response part", ec);
+            return;
+        }
+
+        std::istream response_stream(&m_response_buf);
+        std::string line;
+        std::getline(response_stream, line);
+
+        // Chunk extensions after ';' are ignored.
+        std::istringstream octets(line.substr(0, line.find(';')));
+        size_t chunk_size = 0;
+        octets >> std::hex >> chunk_size;
+        if (octets.fail())
+        {
+            report_error("Invalid chunked response header", boost::system::error_code());
+            return;
+        }
+
+        if (chunk_size == 0)
+        {
+            read_trailers();
+            return;
+        }
+
+        m_body_remaining = chunk_size;
+        read_chunk();
+    }
+
+    // Hands the chunk on piece by piece as it arrives, then drops its CRLF.
+    void read_chunk()
+    {
+        auto self = shared_from_this();
+        const auto buffered = m_response_buf.size();
+        if (m_body_remaining != 0 && buffered != 0)
+        {
+            const auto size = static_cast<size_t>((std::min)(m_body_remaining, static_cast<utility::size64_t>(buffered)));
+            take_body(size);
+            m_body_remaining -= size;
+            after_body_written([self] { self->read_chunk(); });
+            return;
+        }
+
+        if (m_body_remaining == 0 && buffered >= CRLF.size())
+        {
+            m_response_buf.consume(CRLF.size());
+            read_chunk_header();
+            return;
+        }
+
+        const auto wanted = m_body_remaining != 0
+            ? static_cast<size_t>((std::min)(m_body_remaining + CRLF.size(), static_cast<utility::size64_t>(body_read_size)))
+            : CRLF.size() - buffered;
+        m_connection->async_read(m_response_buf, boost::asio::transfer_exactly(wanted),
+            [self](const boost::system::error_code& ec, size_t)
+        {
+            if (ec)
+            {
+                self->report_error("Failed to read chunked response part", ec);
+                return;
+            }
+            self->read_chunk();
+        });
+    }
+
+    void read_trailers()
+    {
+        auto self = shared_from_this();
+        m_connection->async_read_until(m_response_buf, CRLF, [self](const boost::system::error_code& ec, size_t)
+        {
+            if (ec)
+            {
+                self->report_error("Failed to read chunked response trailer", ec);
+                return;
+            }
+            std::istream response_stream(&self->m_response_buf);
+            std::string line;
+            std::getline(response_stream, line);
+            if (line == "\r" || line.empty())
+                self->complete_response();
+            else
+                self->read_trailers();
+        });
+    }
+
+    void read_until_eof()
+    {
+        auto self = shared_from_this();
+        m_connection->async_read(m_response_buf, boost::asio::transfer_at_least(1),
+            [self](const boost::system::error_code& ec, size_t)
+        {
+            self->take_body(self->m_response_buf.size());
+            if (ec == boost::asio::error::eof || ec == boost::asio::ssl::error::stream_truncated)
+            {
+                self->after_body_written([self] { self->complete_response(); });
+            }
+            else if (ec)
+            {
+                self->report_error("Failed to read response body", ec);
+            }
+            else
+            {
+                self->after_body_written([self] { self->read_until_eof(); });
+            }
+        });
+    }
+
+    void take_body(size_t size)
+    {
+        append_body(boost::asio::buffer_cast<const uint8_t*>(m_response_buf.data()), size);
+        m_response_buf.consume(size);
+    }
+
+    // Bodies in a coding we offered are decoded as they arrive, never held compressed in full.
+    void select_response_decoder()
+    {
+        utility::string_t coding;
+        if (!m_decode_response || !m_response->headers().match(header_names::content_encoding, coding))
+            return;
+        boost::algorithm::trim(coding);
+        boost::algorithm::to_lower(coding);
+        const auto algorithm = compression::stream_decompressor::to_compression_algorithm(coding);
+        if (compression::stream_decompressor::is_supported(algorithm))
+            m_response_decoder = utility::details::make_unique<compression::stream_decompressor>(algorithm);
+    }
+
+    /// <summary>
+    /// Passes a received piece of the body on. Without a caller supplied stream it is collected for the response,
+    /// otherwise it is written to that stream behind the pieces before it.
+    /// </summary>
+    /// <returns>The write of this piece, already completed when the body is collected.</returns>
+    pplx::task<void> append_body(const uint8_t* data, size_t size)
+    {
+        if (size == 0)
+            return m_body_written;
+        if (!m_body_stream)
+        {
+            if (m_response_decoder)
+            {
+                const auto decoded = m_response_decoder->decompress(data, size);
+                m_response_body.insert(m_response_body.end(), decoded.begin(), decoded.end());
+            }
+            else
+            {
+                m_response_body.insert(m_response_body.end(), data, data + size);
+            }
+            return m_body_written;
+        }
+
+        auto piece = std::make_shared<std::vector<uint8_t>>(m_response_decoder ? m_response_decoder->decompress(data, size) : std::vector<uint8_t>(data, data + size));
+        if (piece->empty())
+            return m_body_written;
+        m_body_stream_size += piece->size();
+        auto stream = m_body_stream;
+        m_body_written = m_body_written.then([stream, piece]() mutable
+        {
+            return stream.streambuf().putn_nocopy(piece->data(), piece->size()).then([piece](size_t written)
+            {
+                if (written != piece->size())
+                    throw http_exception(_XPLATSTR("Failed to write response body to the response stream"));
+                utility::metrics::library().http_response_body_bytes.add(static_cast<int64_t>(written));
+            });
+        });
+        return m_body_written;
+    }
+
+    // Runs next once everything received so far is in the caller's stream, so at most one read is held in memory.
+    template <typename Function>
+    void after_body_written(const Function& next)
+    {
+        if (!m_body_stream)
+        {
+            next();
+            return;
+        }
+        auto self = shared_from_this();
+        m_body_written.then([self, next](pplx::task<void> written)
+        {
+            try
+            {
+                written.get();
+            }
+            catch (...)
+            {
+                self->report_exception(std::current_exception());
+                return;
+            }
+            next();
+        });
+    }
+
+    void complete_response()
+    {
+        if (m_response_decoder && m_response_decoder->has_error())
+        {
+            report_error("Failed to decompress response body", boost::system::error_code());
+            return;
+        }
+        if (m_response_decoder && !m_response_decoder->is_complete())
+        {
+            report_error("Compressed response body is truncated", boost::system::error_code());
+            return;
+        }
+        if (m_completed.exchange(true))
+            return;
+
+        // The caller sees the decoded body, the headers describing the compressed one no longer apply.
+        if (m_response_decoder)
+        {
+            m_response->headers().remove(header_names::content_encoding);
+            m_response->headers().remove(header_names::content_length);
+        }
+
+        pplx::timer_service::shared_instance().cancel(m_timer);
+        release_borrowed_body(true);
+        publish_timings(false);
+
+        // The whole message has been read, so the connection can serve the next request to this host.
+        if (m_response_buf.size() != 0)
+            m_connection->set_keep_alive(false);
+        release_connection();
+
+        auto response = m_response;
+        if (m_body_stream)
+        {
+            // The body went to the user stream as it arrived, only the last writes may still be pending.
+            auto self = shared_from_this();
+            auto stream = m_body_stream;
+            const auto body_size = m_body_stream_size;
+            if (m_response_decoder)
+                response->headers().set_content_length(body_size);
+            m_body_written.then([stream]() mutable
+            {
+                return stream.flush();
+            }).then([response, body_size]
+            {
+                response->_set_content_ready(body_size);
+            }).then([self, response](pplx::task<void> written)
+            {
+                try
+                {
+                    written.get();
+                }
+                catch (...)
+                {
+                    self->m_response_completion.set_exception(std::current_exception());
+                    return;
+                }
+                self->m_response_completion.set(response);
+            });
+            return;
+        }
+
+        const auto body_size = m_response_body.size();
+        auto body = std::make_shared<streambuf_from_vector>(std::move(m_response_body));
+        if (body_size > 0)
+        {
+            utility::string_t content_type;
+            response->headers().match(header_names::content_type, content_type);
+            response->_set_response_body(body, body_size, utility::conversions::to_utf16string(content_type));
+        }
+        else
+        {
+            response->_set_content_ready(0);
+        }
+        m_response_completion.set(response);
+    }
+
+    void report_error(const std::string& message, const boost::system::error_code& ec)
+    {
+        if (m_aborted)
+        {
+            report_exception(std::make_exception_ptr(pplx::task_canceled("http request aborted")));
+            return;
+        }
+
+        int error_code = ec.value();
+        std::string what = message;
+        if (m_timedout)
+        {
+            error_code = std::make_error_code(std::errc::timed_out).value();
+            what = "Request timed out";
+        }
+        else if (ec)
+        {
+            what += ": " + ec.message();
+        }
+        report_exception(std::make_exception_ptr(http_exception(error_code, utility::conversions::to_string_t(what))));
+    }
+
+    void report_exception(std::exception_ptr exception)
+    {
+        if (m_completed.exchange(true))
+            return;
+
+        pplx::timer_service::shared_instance().cancel(m_timer);
+
+        // A connection in an unknown state never goes back to the pool, only its slot does.
+        cancel_exchange();
+        release_connection();
+        detach_h2_stream();
+        release_borrowed_body(false);
+        publish_timings(true);
+        m_response_completion.set_exception(exception);
+    }
+
+    // The record is copied into the messages and handed to the observer by reference, nothing is allocated.
+    void publish_timings(bool failed)
+    {
+        m_timings.complete = http_timings::clock::now();
+        m_timings.failed = failed;
+        m_request->_set_timings(m_timings);
+        if (!failed)
+            m_response->_set_timings(m_timings);
+        const auto& observer = m_config.get_timings_observer();
+        if (observer)
+            observer(m_uri, m_timings);
+    }
+
+    std::shared_ptr<http_request_proxy> m_request;
+    std::shared_ptr<http_response_proxy> m_response;
+    uri m_uri;
+    http_client_config m_config;
+    const std::string m_pool_key;
+    boost::asio::io_service& m_service;
+
+    std::mutex m_connection_lock;
+    std::shared_ptr<asio_connection> m_connection;
+    std::atomic<pplx::timer_service::timer_id> m_timer { 0 };
+
+    boost::asio::streambuf m_request_buf;
+    boost::asio::streambuf m_response_buf;
+    const uint8_t* m_request_data = nullptr;
+    size_t m_request_size = 0;
+    std::shared_ptr<request_body_source> m_body_source;
+    char m_chunk_header[20];
+    concurrency::streams::streambuf<uint8_t> m_borrowed_body;
+    std::atomic<bool> m_borrowed_body_released { false };
+    std::vector<uint8_t> m_response_body;
+    utility::size64_t m_content_length;
+    // Bytes of the current Content-Length body or chunk still to be read.
+    utility::size64_t m_body_remaining = 0;
+    concurrency::streams::ostream m_body_stream;
+    size_t m_body_stream_size = 0;
+    pplx::task<void> m_body_written = pplx::task_from_result();
+
+    bool m_decode_response = false;
+    std::string m_request_content_encoding;
+    std::unique_ptr<compression::stream_decompressor> m_response_decoder;
+
+    http_timings m_timings;
+
+    std::atomic<bool> m_timedout;
+    std::atomic<bool> m_aborted;
+    std::atomic<bool> m_completed;
+    std::atomic<bool> m_timer_started { false };
+    pplx::task_completion_event<std::shared_ptr<http_response_proxy>> m_response_completion;
+
+    std::weak_ptr<asio_h2_session> m_h2_session;
+};
+
+namespace
+{
+namespace h2
+{
+    // RFC 7540 section 6 frame types.
+    enum frame_type : uint8_t
+    {
+        frame_data = 0x0,
+        frame_headers = 0x1,
+        frame_priority = 0x2,
+        frame_rst_stream = 0x3,
+        frame_settings = 0x4,
+        frame_push_promise = 0x5,
+        frame_ping = 0x6,
+        frame_goaway = 0x7,
+        frame_window_update = 0x8,
+        frame_continuation = 0x9
+    };
+
+    const uint8_t flag_end_stream = 0x1;
+    const uint8_t flag_ack = 0x1;
+    const uint8_t flag_end_headers = 0x4;
+    const uint8_t flag_padded = 0x8;
+    const uint8_t flag_priority = 0x20;
+
+    // RFC 7540 section 6.5.2 settings.
+    const uint16_t settings_header_table_size = 0x1;
+    const uint16_t settings_enable_push = 0x2;
+    const uint16_t settings_max_concurrent_streams = 0x3;
+    const uint16_t settings_initial_window_size = 0x4;
+    const uint16_t settings_max_frame_size = 0x5;
+
+    // RFC 7540 section 7 error codes.
+    const uint32_t error_no_error = 0x0;
+    const uint32_t error_protocol = 0x1;
+    const uint32_t error_flow_control = 0x3;
+    const uint32_t error_frame_size = 0x6;
+    const uint32_t error_refused_stream = 0x7;
+    const uint32_t error_cancel = 0x8;
+    const uint32_t error_compression = 0x9;
+
+    const char connection_preface[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+    const size_t frame_header_size = 9;
+    const int64_t default_window_size = 65535;
+    const size_t default_max_frame_size = 16384;
+
+    // Receive windows announced to the server. Bodies are buffered, so the windows only bound what is in flight.
+    const int64_t local_stream_window = 1 << 20;
+    const int64_t local_connection_window = 16 << 20;
+
+    void append_frame_header(std::vector<uint8_t>& out, size_t length, uint8_t type, uint8_t flags, uint32_t stream_id)
+    {
+        out.push_back(static_cast<uint8_t>(length >> 16));
+        out.push_back(static_cast<uint8_t>(length >> 8));
+        out.push_back(static_cast<uint8_t>(length));
+        out.push_back(type);
+        out.push_back(flags);
+        out.push_back(static_cast<uint8_t>((stream_id >> 24) & 0x7f));
+        out.push_back(static_cast<uint8_t>(stream_id >> 16));
+        out.push_back(static_cast<uint8_t>(stream_id >> 8));
+        out.push_back(static_cast<uint8_t>(stream_id));
+    }
+
+    void append_uint32(std::vector<uint8_t>& out, uint32_t value)
+    {
+        out.push_back(static_cast<uint8_t>(value >> 24));
+        out.push_back(static_cast<uint8_t>(value >> 16));
+        out.push_back(static_cast<uint8_t>(value >> 8));
+        out.push_back(static_cast<uint8_t>(value));
+    }
+
+    uint32_t read_uint32(const uint8_t* data)
+    {
+        return (static_cast<uint32_t>(data[0]) << 24) | (static_cast<uint32_t>(data[1]) << 16)
+            | (static_cast<uint32_t>(data[2]) << 8) | static_cast<uint32_t>(data[3]);
+    }
+
+    void append_window_update(std::vector<uint8_t>& out, uint32_t stream_id, uint32_t increment)
+    {
+        append_frame_header(out, 4, frame_window_update, 0, stream_id);
+        append_uint32(out, increment & 0x7fffffff);
+    }
+
+    void append_rst_stream(std::vector<uint8_t>& out, uint32_t stream_id, uint32_t error_code)
+    {
+        append_frame_header(out, 4, frame_rst_stream, 0, stream_id);
+        append_uint32(out, error_code);
+    }
+
+    // Hop-by-hop headers have no meaning in HTTP/2 (RFC 7540 section 8.1.2.2).
+    bool is_connection_specific(const std::string& name)
+    {
+        return name == "connection" || name == "keep-alive" || name == "proxy-connection"
+            || name == "transfer-encoding" || name == "upgrade" || name == "host" || name == "te";
+    }
+}
+}
+
+/// <summary>
+/// One HTTP/2 connection multiplexing the exchanges of many asio_contexts to the same host.
+/// </summary>
+/// <remarks>
+/// The session owns the frame layer: a single outstanding read that parses every complete frame it has
+/// buffered, and a write queue whose frames are gathered into one socket write. asio_context callbacks
+/// are never invoked with m_lock held, since they can re-enter the session through cancel_stream.
+/// </remarks>
+class asio_h2_session final : public std::enable_shared_from_this<asio_h2_session>
+{
+public:
+    asio_h2_session(const std::string& key, const uri& base_uri, const http_client_config& config, boost::asio::io_service& service)
+        : m_key(key),
+        m_uri(base_uri),
+        m_config(config),
+        m_service(service),
+        m_idle_timer(service),
+        m_created(std::chrono::steady_clock::now()),
+        m_state(session_state::connecting),
+        m_next_stream_id(1),
+        m_connection_send_window(h2::default_window_size),
+        m_peer_initial_window(h2::default_window_size),
+        m_peer_max_frame_size(h2::default_max_frame_size),
+        m_peer_max_concurrent_streams((std::numeric_limits<uint32_t>::max)()),
+        m_continuation_stream(0),
+        m_writing(false)
+    {
+    }
+
+    /// <summary>
+    /// Routes an exchange to the session of its host, opening one if needed.
+    /// </summary>
+    static void submit(const std::shared_ptr<asio_context>& ctx)
+    {
+        auto& manager = sessions();
+        std::shared_ptr<asio_h2_session> session;
+        bool created = false;
+        {
+            std::lock_guard<std::mutex> lock(manager.lock);
+            if (manager.http11_hosts.count(ctx->m_pool_key) != 0)
+            {
+                // The server declined h2 through ALPN earlier.
+                session.reset();
+            }
+            else
+            {
+                auto it = manager.active.find(ctx->m_pool_key);
+                if (it != manager.active.end() && it->second->accepts_streams())
+                {
+                    session = it->second;
+                }
+                else
+                {
+                    session = std::make_shared<asio_h2_session>(ctx->m_pool_key, ctx->m_uri, ctx->m_config, ctx->m_service);
+                    manager.active[ctx->m_pool_key] = session;
+                    created = true;
+                }
+            }
+        }
+
+        if (!session)
+        {
+            ctx->start_request();
+            return;
+        }
+
+        auto& metrics = utility::metrics::library();
+        if (created)
+            metrics.http_pool_misses.add();
+        else
+            metrics.http_pool_hits.add();
+        session->enqueue(ctx);
+        if (created)
+            session->connect();
+    }
+
+    /// <summary>
+    /// Forgets the stream of an exchange that completed on its own (abort, timeout), resetting it on the wire.
+    /// </summary>
+    void cancel_stream(const asio_context* ctx)
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        auto pending = std::find_if(m_pending.begin(), m_pending.end(), [ctx](const std::shared_ptr<asio_context>& p) { return p.get() == ctx; });
+        if (pending != m_pending.end())
+        {
+            m_pending.erase(pending);
+            return;
+        }
+        for (auto it = m_streams.begin(); it != m_streams.end(); ++it)
+        {
+            if (it->second.ctx.get() != ctx)
+                continue;
+            std::vector<uint8_t> frame;
+            h2::append_rst_stream(frame, it->first, h2::error_cancel);
+            queue_frames(std::move(frame));
+            m_streams.erase(it);
+            schedule_idle_close();
+            return;
+        }
+    }
+
+private:
+    enum class session_state
+    {
+        connecting,
+        open,
+        // GOAWAY received or sent, or past its lifetime: no new streams.
+        draining,
+        closed
+    };
+
+    struct stream_state
+    {
+        std::shared_ptr<asio_context> ctx;
+        int64_t send_window = 0;
+        size_t body_offset = 0;
+        // Bytes of the current window of a streamed body, framed up to body_offset.
+        size_t window_size = 0;
+        bool window_pending = false;
+        bool end_stream_sent = false;
+        std::vector<uint8_t> header_block;
+        bool final_headers_received = false;
+    };
+
+    // Frames are owned by the queue, except DATA payloads which point into the in-memory request body of their exchange.
+    struct write_segment
+    {
+        std::vector<uint8_t> owned;
+        boost::asio::const_buffer borrowed;
+        std::shared_ptr<asio_context> owner;
+    };
+
+    struct session_manager
+    {
+        std::mutex lock;
+        std::unordered_map<std::string, std::shared_ptr<asio_h2_session>> active;
+        std::unordered_set<std::string> http11_hosts;
+    };
+
+    // Deferred calls into asio_contexts, run once m_lock is released.
+    typedef std::vector<std::function<void()>> completions;
+
+    static session_manager& sessions()
+    {
+        static session_manager manager;
+        return manager;
+    }
+
+    static void run(completions& actions)
+    {
+        for (auto& action : actions)
+            action();
+        actions.clear();
+    }
+
+    bool accepts_streams()
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (m_state == session_state::draining || m_state == session_state::closed)
+            return false;
+        const auto lifetime = m_config.connection_max_lifetime<std::chrono::microseconds>();
+        if (lifetime.count() > 0 && std::chrono::steady_clock::now() - m_created >= lifetime)
+        {
+            m_state = session_state::draining;
+            if (m_streams.empty() && m_pending.empty())
+            {
+                send_goaway(h2::error_no_error);
+                close_locked();
+            }
+            return false;
+        }
+        // Stream identifiers are not reused, an exhausted session is replaced.
+        return m_next_stream_id < 0x7fff0000;
+    }
+
+    void forget()
+    {
+        auto& manager = sessions();
+        std::lock_guard<std::mutex> lock(manager.lock);
+        auto it = manager.active.find(m_key);
+        if (it != manager.active.end() && it->second.get() == this)
+            manager.active.erase(it);
+    }
+
+    void enqueue(const std::shared_ptr<asio_context>& ctx)
+    {
+        {
+            std::lock_guard<std::mutex> lock(ctx->m_connection_lock);
+            ctx->m_h2_session = shared_from_this();
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_state != session_state::draining && m_state != session_state::closed)
+            {
+                m_idle_timer.cancel();
+                ctx->m_timings.connection_reused = m_state == session_state::open;
+                m_pending.push_back(ctx);
+                if (m_state == session_state::open)
+                {
+                    open_streams();
+                    pump_data();
+                }
+                return;
+            }
+        }
+        // Lost the race with the idle timeout or a GOAWAY.
+        forget();
+        resubmit(ctx);
+    }
+
+    void connect()
+    {
+        std::vector<std::string> alpn;
+        if (m_uri.scheme() == _XPLATSTR("https"))
+        {
+            alpn.push_back("h2");
+            if (m_config.http2() == http2_mode::negotiate)
+                alpn.push_back("http/1.1");
+        }
+
+        m_connection = std::make_shared<asio_connection>(m_service);
+        auto self = shared_from_this();
+        std::make_shared<asio_connector>(m_connection, m_uri, m_config, m_service, std::move(alpn), &m_connect_timings)
+            ->start([self](const std::string& message, const boost::system::error_code& ec)
+        {
+            self->handle_connect(message, ec);
+        });
+    }
+
+    void handle_connect(const std::string& message, const boost::system::error_code& ec)
+    {
+        if (!message.empty())
+        {
+            fail_session(message, ec);
+            return;
+        }
+
+        if (m_uri.scheme() == _XPLATSTR("https") && m_connection->negotiated_protocol() != "h2")
+        {
+            if (m_config.http2() == http2_mode::prior_knowledge)
+            {
+                fail_session("Server did not negotiate HTTP/2", boost::system::error_code());
+                return;
+            }
+            fall_back_to_http11();
+            return;
+        }
+
+        std::vector<uint8_t> preface(h2::connection_preface, h2::connection_preface + sizeof(h2::connection_preface) - 1);
+        h2::append_frame_header(preface, 18, h2::frame_settings, 0, 0);
+        preface.push_back(0);
+        preface.push_back(static_cast<uint8_t>(h2::settings_enable_push));
+        h2::append_uint32(preface, 0);
+        preface.push_back(0);
+        preface.push_back(static_cast<uint8_t>(h2::settings_initial_window_size));
+        h2::append_uint32(preface, static_cast<uint32_t>(h2::local_stream_window));
+        preface.push_back(0);
+        preface.push_back(static_cast<uint8_t>(h2::settings_max_frame_size));
+        h2::append_uint32(preface, static_cast<uint32_t>(h2::default_max_frame_size));
+        h2::append_window_update(preface, 0, static_cast<uint32_t>(h2::local_connection_window - h2::default_window_size));
+
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_state == session_state::connecting)
+                m_state = session_state::open;
+            // The exchanges that waited for the connection are charged with its setup.
+            for (auto& ctx : m_pending)
+            {
+                ctx->m_timings.dns_start = m_connect_timings.dns_start;
+                ctx->m_timings.dns_end = m_connect_timings.dns_end;
+                ctx->m_timings.connect_start = m_connect_timings.connect_start;
+                ctx->m_timings.connect_end = m_connect_timings.connect_end;
+                ctx->m_timings.tls_start = m_connect_timings.tls_start;
+                ctx->m_timings.tls_end = m_connect_timings.tls_end;
+            }
+            queue_frames(std::move(preface));
+            open_streams();
+            pump_data();
+        }
+        read_frames();
+    }
+
+    void fall_back_to_http11()
+    {
+        {
+            auto& manager = sessions();
+            std::lock_guard<std::mutex> lock(manager.lock);
+            manager.http11_hosts.insert(m_key);
+        }
+        forget();
+
+        std::deque<std::shared_ptr<asio_context>> pending;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_state = session_state::closed;
+            pending.swap(m_pending);
+        }
+        m_connection->close();
+        for (auto& ctx : pending)
+        {
+            {
+                std::lock_guard<std::mutex> lock(ctx->m_connection_lock);
+                ctx->m_h2_session.reset();
+            }
+            ctx->start_request();
+        }
+    }
+
+    // Must be called with m_lock held.
+    void open_streams()
+    {
+        while (!m_pending.empty() && m_state == session_state::open && m_streams.size() < m_peer_max_concurrent_streams)
+        {
+            auto ctx = m_pending.front();
+            m_pending.pop_front();
+
+            const auto stream_id = m_next_stream_id;
+            m_next_stream_id += 2;
+
+            stream_state stream;
+            stream.ctx = ctx;
+            stream.send_window = m_peer_initial_window;
+            const bool has_body = ctx->m_request_size != 0 || ctx->m_body_source;
+
+            hpack::header_list headers;
+            build_request_headers(*ctx, headers);
+            std::vector<uint8_t> block;
+            m_encoder.encode(headers, block);
+
+            // Weight goes with the HEADERS frame, all streams depend on the root.
+            std::vector<uint8_t> payload;
+            h2::append_uint32(payload, 0);
+            payload.push_back(ctx->m_request->_request_impl_from_this()->priority_weight());
+            const auto first_fragment = (std::min)(block.size(), m_peer_max_frame_size - payload.size());
+            payload.insert(payload.end(), block.begin(), block.begin() + first_fragment);
+
+            uint8_t flags = h2::flag_priority;
+            if (!has_body)
+                flags |= h2::flag_end_stream;
+            if (first_fragment == block.size())
+                flags |= h2::flag_end_headers;
+
+            std::vector<uint8_t> frames;
+            h2::append_frame_header(frames, payload.size(), h2::frame_headers, flags, stream_id);
+            frames.insert(frames.end(), payload.begin(), payload.end());
+            for (size_t offset = first_fragment; offset < block.size();)
+            {
+                const auto fragment = (std::min)(block.size() - offset, m_peer_max_frame_size);
+                const uint8_t continuation_flags = offset + fragment == block.size() ? h2::flag_end_headers : 0;
+                h2::append_frame_header(frames, fragment, h2::frame_continuation, continuation_flags, stream_id);
+                frames.insert(frames.end(), block.begin() + offset, block.begin() + offset + fragment);
+                offset += fragment;
+            }
+            queue_frames(std::move(frames));
+
+            // Times are taken when frames are queued for the socket.
+            ctx->m_timings.http2 = true;
+            ctx->m_timings.request_start = http_timings::clock::now();
+            if (!has_body)
+                ctx->m_timings.request_end = ctx->m_timings.request_start;
+            stream.end_stream_sent = !has_body;
+            m_streams.emplace(stream_id, std::move(stream));
+        }
+    }
+
+    void build_request_headers(asio_context& ctx, hpack::header_list& headers)
+    {
+        const auto& target = ctx.m_uri;
+        auto& request_headers = ctx.m_request->headers();
+
+        std::string authority = utility::conversions::to_utf8string(target.host());
+        if (!target.is_port_default())
+            authority += ":" + std::to_string(target.port());
+        utility::string_t host_header;
+        if (request_headers.match(header_names::host, host_header))
+            authority = utility::conversions::to_utf8string(host_header);
+
+        std::string path = target.path().empty() ? "/" : utility::conversions::to_utf8string(target.path());
+        if (!target.query().empty())
+            path += "?" + utility::conversions::to_utf8string(target.query());
+
+        headers.emplace_back(":method", utility::conversions::to_utf8string(ctx.m_request->method()));
+        headers.emplace_back(":scheme", utility::conversions::to_utf8string(target.scheme()));
+        headers.emplace_back(":authority", authority);
+        headers.emplace_back(":path", path);
+
+        for (const auto& header : request_headers)
+        {
+            auto name = utility::conversions::to_utf8string(header.first);
+            boost::algorithm::to_lower(name);
+            if (h2::is_connection_specific(name) || name == "content-length")
+                continue;
+            headers.emplace_back(std::move(name), utility::conversions::to_utf8string(header.second));
+        }
+
+        if (ctx.m_config.credentials().is_set() && !request_headers.has(header_names::authorization))
+        {
+            headers.emplace_back("authorization", utility::conversions::to_utf8string(basic_authorization(ctx.m_config.credentials())));
+        }
+
+        if (ctx.m_decode_response)
+        {
+            headers.emplace_back("accept-encoding", utility::conversions::to_utf8string(compression::supported_encodings()));
+        }
+
+        if (!ctx.m_request_content_encoding.empty())
+        {
+            headers.emplace_back("content-encoding", ctx.m_request_content_encoding);
+        }
+
+        // Streamed bodies of unknown length are delimited by END_STREAM alone.
+        const auto method = ctx.m_request->method();
+        if (!ctx.chunked_request() && (ctx.request_length() != 0 || method == methods::POST || method == methods::PUT))
+        {
+            headers.emplace_back("content-length", std::to_string(ctx.request_length()));
+        }
+    }
+
+    // Must be called with m_lock held. Heavier streams get their frame first in every round.
+    void pump_data()
+    {
+        if (m_state != session_state::open && m_state != session_state::draining)
+            return;
+
+        std::vector<std::pair<uint32_t, stream_state*>> sending;
+        for (auto& stream : m_streams)
+        {
+            if (!stream.second.end_stream_sent)
+                sending.emplace_back(stream.first, &stream.second);
+        }
+        std::stable_sort(sending.begin(), sending.end(), [](const std::pair<uint32_t, stream_state*>& a, const std::pair<uint32_t, stream_state*>& b)
+        {
+            return a.second->ctx->m_request->_request_impl_from_this()->priority_weight()
+                > b.second->ctx->m_request->_request_impl_from_this()->priority_weight();
+        });
+
+        // In-memory DATA payloads are not copied, the gather write takes them from the request bodies.
+        // Streamed ones are copied out of the current window, which is refilled once it is framed.
+        std::vector<write_segment> segments;
+        bool progress = true;
+        while (progress && m_connection_send_window > 0)
+        {
+            progress = false;
+            for (auto& entry : sending)
+            {
+                auto& stream = *entry.second;
+                if (stream.end_stream_sent || stream.window_pending)
+                    continue;
+                const auto& source = stream.ctx->m_body_source;
+                if (source && stream.body_offset == stream.window_size && !source->complete())
+                {
+                    read_window(entry.first, stream);
+                    continue;
+                }
+                const auto remaining = (source ? stream.window_size : stream.ctx->m_request_size) - stream.body_offset;
+                if (remaining != 0 && (stream.send_window <= 0 || m_connection_send_window <= 0))
+                    continue;
+
+                const auto window = (std::min)(stream.send_window, m_connection_send_window);
+                const auto chunk = static_cast<size_t>((std::min)(static_cast<int64_t>((std::min)(remaining, m_peer_max_frame_size)), window));
+                const bool last = chunk == remaining && (!source || source->complete());
+
+                write_segment header;
+                h2::append_frame_header(header.owned, chunk, h2::frame_data, last ? h2::flag_end_stream : 0, entry.first);
+                segments.push_back(std::move(header));
+                write_segment payload;
+                if (source)
+                {
+                    payload.owned.assign(source->data() + stream.body_offset, source->data() + stream.body_offset + chunk);
+                }
+                else
+                {
+                    payload.borrowed = boost::asio::buffer(stream.ctx->m_request_data + stream.body_offset, chunk);
+                    payload.owner = stream.ctx;
+                }
+                segments.push_back(std::move(payload));
+                stream.body_offset += chunk;
+                stream.send_window -= static_cast<int64_t>(chunk);
+                m_connection_send_window -= static_cast<int64_t>(chunk);
+                stream.end_stream_sent = last;
+                if (last)
+                    stream.ctx->m_timings.request_end = http_timings::clock::now();
+                progress = true;
+            }
+        }
+        if (!segments.empty())
+            queue_segments(std::move(segments));
+    }
+
+    // Must be called with m_lock held. The window is taken over on the io_service, never inline under the lock.
+    void read_window(uint32_t stream_id, stream_state& stream)
+    {
+        stream.window_pending = true;
+        auto self = shared_from_this();
+        auto ctx = stream.ctx;
+        ctx->m_body_source->next().then([self, ctx, stream_id](pplx::task<size_t> read)
+        {
+            self->m_service.post([self, ctx, stream_id, read]
+            {
+                size_t size = 0;
+                try
+                {
+                    size = read.get();
+                }
+                catch (...)
+                {
+                    ctx->report_exception(std::current_exception());
+                    return;
+                }
+                std::lock_guard<std::mutex> lock(self->m_lock);
+                auto it = self->m_streams.find(stream_id);
+                if (it == self->m_streams.end() || it->second.ctx != ctx)
+                    return;
+                it->second.window_pending = false;
+                it->second.window_size = size;
+                it->second.body_offset = 0;
+                self->pump_data();
+            });
+        });
+    }
+
+    // Must be called with m_lock held.
+    void queue_frames(std::vector<uint8_t> frames)
+    {
+        std::vector<write_segment> segments(1);
+        segments[0].owned = std::move(frames);
+        queue_segments(std::move(segments));
+    }
+
+    // Must be called with m_lock held.
+    void queue_segments(std::vector<write_segment> segments)
+    {
+        for (auto& segment : segments)
+            m_write_queue.push_back(std::move(segment));
+        if (!m_writing)
+            write_next();
+    }
+
+    // Must be called with m_lock held. Everything queued so far leaves in one gather write.
+    void write_next()
+    {
+        if (m_write_queue.empty() || m_state == session_state::connecting)
+            return;
+        m_writing = true;
+        m_write_in_flight.clear();
+        for (auto& segment : m_write_queue)
+            m_write_in_flight.push_back(std::move(segment));
+        m_write_queue.clear();
+
+        std::vector<boost::asio::const_buffer> buffers;
+        buffers.reserve(m_write_in_flight.size());
+        for (const auto& segment : m_write_in_flight)
+            buffers.push_back(segment.owner ? segment.borrowed : boost::asio::buffer(segment.owned));
+
+        auto self = shared_from_this();
+        m_connection->async_write(buffers, [self](const boost::system::error_code& ec, size_t)
+        {
+            if (ec)
+            {
+                self->fail_session("Failed to write HTTP/2 frames", ec);
+                return;
+            }
+            std::lock_guard<std::mutex> lock(self->m_lock);
+            self->m_writing = false;
+            self->m_write_in_flight.clear();
+            if (!self->m_write_queue.empty())
+                self->write_next();
+            else if (self->m_close_after_write)
+                self->m_connection->close();
+        });
+    }
+
+    void read_frames()
+    {
+        auto self = shared_from_this();
+        m_connection->async_read(m_read_buf, boost::asio::transfer_at_least(1), [self](const boost::system::error_code& ec, size_t)
+        {
+            if (ec)
+            {
+                self->fail_session("Failed to read HTTP/2 frames", ec);
+                return;
+            }
+            if (self->process_frames())
+                self->read_frames();
+        });
+    }
+
+    // Returns false once the session is done with the connection.
+    bool process_frames()
+    {
+        completions actions;
+        bool keep_reading = true;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            while (keep_reading && m_read_buf.size() >= h2::frame_header_size)
+            {
+                const auto header = boost::asio::buffer_cast<const uint8_t*>(m_read_buf.data());
+                const size_t length = (static_cast<size_t>(header[0]) << 16) | (static_cast<size_t>(header[1]) << 8) | header[2];
+                if (length > h2::default_max_frame_size)
+                {
+                    keep_reading = connection_error(h2::error_frame_size, "HTTP/2 frame exceeds SETTINGS_MAX_FRAME_SIZE", actions);
+                    break;
+                }
+                if (m_read_buf.size() < h2::frame_header_size + length)
+                    break;
+
+                const uint8_t type = header[3];
+                const uint8_t flags = header[4];
+                const uint32_t stream_id = h2::read_uint32(header + 5) & 0x7fffffff;
+                std::vector<uint8_t> payload(header + h2::frame_header_size, header + h2::frame_header_size + length);
+                m_read_buf.consume(h2::frame_header_size + length);
+
+                keep_reading = handle_frame(type, flags, stream_id, payload, actions);
+            }
+            if (!keep_reading || m_state == session_state::closed)
+                keep_reading = false;
+        }
+        run(actions);
+        return keep_reading;
+    }
+
+    // Must be called with m_lock held.
+    bool handle_frame(uint8_t type, uint8_t flags, uint32_t stream_id, std::vector<uint8_t>& payload, completions& actions)
+    {
+        if (m_continuation_stream != 0 && (type != h2::frame_continuation || stream_id != m_continuation_stream))
+            return connection_error(h2::error_protocol, "Expected HTTP/2 CONTINUATION frame", actions);
+
+        switch (type)
+        {
+        case h2::frame_data:
+            return handle_data(flags, stream_id, payload, actions);
+        case h2::frame_headers:
+            return handle_headers(flags, stream_id, payload, actions);
+        case h2::frame_continuation:
+            return handle_continuation(flags, stream_id, payload, actions);
+        case h2::frame_rst_stream:
+            if (payload.size() != 4)
+                return connection_error(h2::error_frame_size, "Invalid HTTP/2 RST_STREAM frame", actions);
+            reset_by_peer(stream_id, h2::read_uint32(payload.data()), actions);
+            return true;
+        case h2::frame_settings:
+            return handle_settings(flags, stream_id, payload, actions);
+        case h2::frame_push_promise:
+            // Push is disabled in our SETTINGS.
+            return connection_error(h2::error_protocol, "Unexpected HTTP/2 PUSH_PROMISE", actions);
+        case h2::frame_ping:
+            if (payload.size() != 8 || stream_id != 0)
+                return connection_error(h2::error_frame_size, "Invalid HTTP/2 PING frame", actions);
+            if ((flags & h2::flag_ack) == 0)
+            {
+                std::vector<uint8_t> frame;
+                h2::append_frame_header(frame, 8, h2::frame_ping, h2::flag_ack, 0);
+                frame.insert(frame.end(), payload.begin(), payload.end());
+                queue_frames(std::move(frame));
+            }
+            return true;
+        case h2::frame_goaway:
+            if (payload.size() < 8)
+                return connection_error(h2::error_frame_size, "Invalid HTTP/2 GOAWAY frame", actions);
+            handle_goaway(h2::read_uint32(payload.data()) & 0x7fffffff, h2::read_uint32(payload.data() + 4), actions);
+            return m_state != session_state::closed;
+        case h2::frame_window_update:
+            return handle_window_update(stream_id, payload, actions);
+        default:
+            // PRIORITY from the server and unknown frame types are ignored.
+            return true;
+        }
+    }
+
+    bool strip_padding(uint8_t flags, std::vector<uint8_t>& payload, size_t prefix)
+    {
+        size_t padding = 0;
+        size_t offset = 0;
+        if (flags & h2::flag_padded)
+        {
+            if (payload.empty())
+                return false;
+            padding = payload[0];
+            offset = 1;
+        }
+        if (offset + prefix + padding > payload.size())
+            return false;
+        payload.erase(payload.end() - padding, payload.end());
+        payload.erase(payload.begin(), payload.begin() + offset + prefix);
+        return true;
+    }
+
+    bool handle_data(uint8_t flags, uint32_t stream_id, std::vector<uint8_t>& payload, completions& actions)
+    {
+        if (stream_id == 0)
+            return connection_error(h2::error_protocol, "HTTP/2 DATA frame on stream 0", actions);
+
+        // Flow control counts the whole payload, padding included.
+        const auto consumed = static_cast<uint32_t>(payload.size());
+        std::vector<uint8_t> updates;
+        if (consumed > 0)
+            h2::append_window_update(updates, 0, consumed);
+
+        auto it = m_streams.find(stream_id);
+        if (it == m_streams.end())
+        {
+            // Data racing with our RST_STREAM; only the connection window needs to be given back.
+            if (!updates.empty())
+                queue_frames(std::move(updates));
+            return true;
+        }
+
+        if (!strip_padding(flags, payload, 0))
+            return connection_error(h2::error_protocol, "Invalid HTTP/2 DATA padding", actions);
+
+        auto written = it->second.ctx->append_body(payload.data(), payload.size());
+
+        if (flags & h2::flag_end_stream)
+        {
+            finish_stream(it, actions);
+        }
+        else if (consumed > 0 && it->second.ctx->m_body_stream)
+        {
+            // The stream window reopens once the data is in the user stream, so a slow stream holds back the server.
+            std::weak_ptr<asio_h2_session> weak_self = shared_from_this();
+            written.then([weak_self, stream_id, consumed](pplx::task<void> done)
+            {
+                try
+                {
+                    done.get();
+                }
+                catch (...)
+                {
+                    return;
+                }
+                auto self = weak_self.lock();
+                if (!self)
+                    return;
+                // The write may have completed inline, under m_lock, so the update is queued from the io_service.
+                self->m_service.post([self, stream_id, consumed]
+                {
+                    std::lock_guard<std::mutex> lock(self->m_lock);
+                    if (self->m_state == session_state::closed || self->m_streams.find(stream_id) == self->m_streams.end())
+                        return;
+                    std::vector<uint8_t> update;
+                    h2::append_window_update(update, stream_id, consumed);
+                    self->queue_frames(std::move(update));
+                });
+            });
+        }
+        else if (consumed > 0)
+        {
+            h2::append_window_update(updates, stream_id, consumed);
+        }
+        if (!updates.empty())
+            queue_frames(std::move(updates));
+        return true;
+    }
+
+    bool handle_headers(uint8_t flags, uint32_t stream_id, std::vector<uint8_t>& payload, completions& actions)
+    {
+        if (stream_id == 0)
+            return connection_error(h2::error_protocol, "HTTP/2 HEADERS frame on stream 0", actions);
+        if (!strip_padding(flags, payload, (flags & h2::flag_priority) ? 5 : 0))
+            return connection_error(h2::error_protocol, "Invalid HTTP/2 HEADERS padding", actions);
+
+        m_header_block.assign(payload.begin(), payload.end());
+        m_header_block_end_stream = (flags & h2::flag_end_stream) != 0;
+        if ((flags & h2::flag_end_headers) == 0)
+        {
+            m_continuation_stream = stream_id;
+            return true;
+        }
+        return complete_header_block(stream_id, actions);
+    }
+
+    bool handle_continuation(uint8_t flags, uint32_t stream_id, std::vector<uint8_t>& payload, completions& actions)
+    {
+        if (stream_id != m_continuation_stream)
+            return connection_error(h2::error_protocol, "Unexpected HTTP/2 CONTINUATION frame", actions);
+        m_header_block.insert(m_header_block.end(), payload.begin(), payload.end());
+        if ((flags & h2::flag_end_headers) == 0)
+            return true;
+        m_continuation_stream = 0;
+        return complete_header_block(stream_id, actions);
+    }
+
+    bool complete_header_block(uint32_t stream_id, completions& actions)
+    {
+        // Blocks of streams we already reset are still decoded, the HPACK state is shared by the connection.
+        hpack::header_list headers;
+        if (!m_decoder.decode(m_header_block.data(), m_header_block.size(), headers))
+            return connection_error(h2::error_compression, "Invalid HTTP/2 header block", actions);
+        m_header_block.clear();
+
+        auto it = m_streams.find(stream_id);
+        if (it == m_streams.end())
+            return true;
+
+        auto& stream = it->second;
+        if (!stream.final_headers_received)
+        {
+            status_code code = 0;
+            for (const auto& header : headers)
+            {
+                if (header.first == ":status")
+                    code = static_cast<status_code>(std::atoi(header.second.c_str()));
+            }
+
+            // Interim responses carry no body, wait for the final one.
+            if (code >= 100 && code < 200)
+                return true;
+
+            stream.ctx->m_timings.first_byte = http_timings::clock::now();
+            auto& response = *stream.ctx->m_response;
+            response.set_status_code(code);
+            response.set_reason_phrase(http::details::get_default_reason_phrase(code));
+            for (const auto& header : headers)
+            {
+                if (!header.first.empty() && header.first[0] != ':')
+                    response.headers().add(utility::conversions::to_string_t(header.first), utility::conversions::to_string_t(header.second));
+            }
+            stream.final_headers_received = true;
+            stream.ctx->select_response_decoder();
+        }
+        // A second block is the trailer section, which http_response has no place for.
+
+        if (m_header_block_end_stream)
+            finish_stream(it, actions);
+        return true;
+    }
+
+    bool handle_settings(uint8_t flags, uint32_t stream_id, const std::vector<uint8_t>& payload, completions& actions)
+    {
+        if (stream_id != 0)
+            return connection_error(h2::error_protocol, "HTTP/2 SETTINGS frame on a stream", actions);
+        if (flags & h2::flag_ack)
+            return true;
+        if (payload.size() % 6 != 0)
+            return connection_error(h2::error_frame_size, "Invalid HTTP/2 SETTINGS frame", actions);
+
+        for (size_t offset = 0; offset < payload.size(); offset += 6)
+        {
+            const uint16_t id = static_cast<uint16_t>((payload[offset] << 8) | payload[offset + 1]);
+            const uint32_t value = h2::read_uint32(payload.data() + offset + 2);
+            switch (id)
+            {
+            case h2::settings_header_table_size:
+                m_encoder.set_max_table_size(value);
+                break;
+            case h2::settings_max_concurrent_streams:
+                m_peer_max_concurrent_streams = value;
+                break;
+            case h2::settings_initial_window_size:
+            {
+                if (value > 0x7fffffff)
+                    return connection_error(h2::error_flow_control, "Invalid HTTP/2 initial window size", actions);
+                // The change applies to the windows of all open streams (RFC 7540 section 6.9.2).
+                const auto delta = static_cast<int64_t>(value) - m_peer_initial_window;
+                for (auto& stream : m_streams)
+                    stream.second.send_window += delta;
+                m_peer_initial_window = value;
+                break;
+            }
+            case h2::settings_max_frame_size:
+                if (value < h2::default_max_frame_size || value > 0xffffff)
+                    return connection_error(h2::error_protocol, "Invalid HTTP/2 max frame size", actions);
+                m_peer_max_frame_size = value;
+                break;
+            default:
+                break;
+            }
+        }
+
+        std::vector<uint8_t> ack;
+        h2::append_frame_header(ack, 0, h2::frame_settings, h2::flag_ack, 0);
+        queue_frames(std::move(ack));
+        open_streams();
+        pump_data();
+        return true;
+    }
+
+    bool handle_window_update(uint32_t stream_id, const std::vector<uint8_t>& payload, completions& actions)
+    {
+        if (payload.size() != 4)
+            return connection_error(h2::error_frame_size, "Invalid HTTP/2 WINDOW_UPDATE frame", actions);
+        const auto increment = static_cast<int64_t>(h2::read_uint32(payload.data()) & 0x7fffffff);
+        if (stream_id == 0)
+        {
+            m_connection_send_window += increment;
+            if (m_connection_send_window > 0x7fffffff)
+                return connection_error(h2::error_flow_control, "HTTP/2 connection window overflow", actions);
+        }
+        else
+        {
+            auto it = m_streams.find(stream_id);
+            if (it == m_streams.end())
+                return true;
+            it->second.send_window += increment;
+        }
+        pump_data();
+        return true;
+    }
+
+    void handle_goaway(uint32_t last_stream_id, uint32_t error_code, completions& actions)
+    {
+        m_state = session_state::draining;
+        actions.push_back([self = shared_from_this()] { self->forget(); });
+
+        // Streams above the last one were not processed and can be sent again on a new connection.
+        for (auto it = m_streams.begin(); it != m_streams.end();)
+        {
+            if (it->first <= last_stream_id)
+            {
+                ++it;
+                continue;
+            }
+            auto ctx = it->second.ctx;
+            it = m_streams.erase(it);
+            actions.push_back([ctx] { resubmit(ctx); });
+        }
+        for (auto& ctx : m_pending)
+            actions.push_back([ctx] { resubmit(ctx); });
+        m_pending.clear();
+
+        if (error_code != h2::error_no_error)
+        {
+            for (auto& stream : m_streams)
+            {
+                auto ctx = stream.second.ctx;
+                actions.push_back([ctx, error_code]
+                {
+                    ctx->report_error("HTTP/2 connection closed by server with error " + std::to_string(error_code), boost::system::error_code());
+                });
+            }
+            m_streams.clear();
+        }
+        if (m_streams.empty())
+            close_locked();
+    }
+
+    void reset_by_peer(uint32_t stream_id, uint32_t error_code, completions& actions)
+    {
+        auto it = m_streams.find(stream_id);
+        if (it == m_streams.end())
+            return;
+        auto ctx = it->second.ctx;
+        m_streams.erase(it);
+        if (error_code == h2::error_refused_stream)
+        {
+            // The server guarantees a refused stream was not processed.
+            actions.push_back([ctx] { resubmit(ctx); });
+        }
+        else
+        {
+            actions.push_back([ctx, error_code]
+            {
+                ctx->report_error("HTTP/2 stream reset by server with error " + std::to_string(error_code), boost::system::error_code());
+            });
+        }
+        after_stream_closed();
+    }
+
+    void finish_stream(std::map<uint32_t, stream_state>::iterator it, completions& actions)
+    {
+        auto ctx = it->second.ctx;
+        const bool request_unfinished = !it->second.end_stream_sent;
+        const auto stream_id = it->first;
+        m_streams.erase(it);
+        if (request_unfinished)
+        {
+            // The server answered before reading the whole body, stop sending it (RFC 7540 section 8.1).
+            std::vector<uint8_t> frame;
+            h2::append_rst_stream(frame, stream_id, h2::error_no_error);
+            queue_frames(std::move(frame));
+        }
+        actions.push_back([ctx] { ctx->complete_response(); });
+        after_stream_closed();
+    }
+
+    // Must be called with m_lock held.
+    void after_stream_closed()
+    {
+        open_streams();
+        if (m_state == session_state::draining && m_streams.empty())
+            close_locked();
+        else
+            schedule_idle_close();
+    }
+
+    // Must be called with m_lock held.
+    void schedule_idle_close()
+    {
+        const auto idle_timeout = m_config.connection_idle_timeout<std::chrono::microseconds>();
+        if (!m_streams.empty() || !m_pending.empty() || idle_timeout.count() <= 0 || m_state != session_state::open)
+            return;
+        m_idle_timer.expires_from_now(boost::posix_time::microseconds(idle_timeout.count()));
+        std::weak_ptr<asio_h2_session> weak_self = shared_from_this();
+        m_idle_timer.async_wait([weak_self](const boost::system::error_code& ec)
+        {
+            if (ec == boost::asio::error::operation_aborted)
+                return;
+            auto self = weak_self.lock();
+            if (!self)
+                return;
+            {
+                std::lock_guard<std::mutex> lock(self->m_lock);
+                if (!self->m_streams.empty() || !self->m_pending.empty() || self->m_state != session_state::open)
+                    return;
+                self->send_goaway(h2::error_no_error);
+                self->close_locked();
+            }
+            self->forget();
+        });
+    }
+
+    void send_goaway(uint32_t error_code)
+    {
+        std::vector<uint8_t> frame;
+        h2::append_frame_header(frame, 8, h2::frame_goaway, 0, 0);
+        h2::append_uint32(frame, 0);
+        h2::append_uint32(frame, error_code);
+        queue_frames(std::move(frame));
+    }
+
+    // Must be called with m_lock held. Queued frames (GOAWAY, RST_STREAM) are flushed before the socket goes.
+    void close_locked()
+    {
+        if (m_state == session_state::closed)
+            return;
+        m_state = session_state::closed;
+        m_idle_timer.cancel();
+        if (!m_writing && m_write_queue.empty())
+        {
+            m_connection->close();
+            return;
+        }
+        m_close_after_write = true;
+        if (!m_writing)
+            write_next();
+    }
+
+    bool connection_error(uint32_t error_code, const std::string& message, completions& actions)
+    {
+        actions.push_back([self = shared_from_this()] { self->forget(); });
+        send_goaway(error_code);
+        fail_streams_locked(message, boost::system::error_code(), actions);
+        m_state = session_state::draining;
+        close_locked();
+        return false;
+    }
+
+    // Must be called with m_lock held.
+    void fail_streams_locked(const std::string& message, const boost::system::error_code& ec, completions& actions)
+    {
+        for (auto& stream : m_streams)
+        {
+            auto ctx = stream.second.ctx;
+            actions.push_back([ctx, message, ec] { ctx->report_error(message, ec); });
+        }
+        m_streams.clear();
+
+        // Requests that never made it to the wire can be sent on a new connection.
+        for (auto& ctx : m_pending)
+        {
+            if (m_state == session_state::connecting)
+                actions.push_back([ctx, message, ec] { ctx->report_error(message, ec); });
+            else
+                actions.push_back([ctx] { resubmit(ctx); });
+        }
+        m_pending.clear();
+    }
+
+    void fail_session(const std::string& message, const boost::system::error_code& ec)
+    {
+        forget();
+        completions actions;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            if (m_state == session_state::closed && m_streams.empty() && m_pending.empty())
+            {
+                m_connection->close();
+                return;
+            }
+            fail_streams_locked(message, ec, actions);
+            m_state = session_state::closed;
+            m_idle_timer.cancel();
+        }
+        m_connection->close();
+        run(actions);
+    }
+
+    static void resubmit(const std::shared_ptr<asio_context>& ctx)
+    {
+        if (ctx->m_completed)
+            return;
+        if (ctx->m_body_source && !ctx->m_body_source->rewind())
+        {
+            ctx->report_error("Request body stream cannot be sent again on a new connection", boost::system::error_code());
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(ctx->m_connection_lock);
+            ctx->m_h2_session.reset();
+        }
+        submit(ctx);
+    }
+
+    const std::string m_key;
+    const uri m_uri;
+    const http_client_config m_config;
+    boost::asio::io_service& m_service;
+    std::shared_ptr<asio_connection> m_connection;
+    boost::asio::deadline_timer m_idle_timer;
+    const std::chrono::steady_clock::time_point m_created;
+    http_timings m_connect_timings;
+
+    std::mutex m_lock;
+    session_state m_state;
+    std::map<uint32_t, stream_state> m_streams;
+    std::deque<std::shared_ptr<asio_context>> m_pending;
+    uint32_t m_next_stream_id;
+
+    int64_t m_connection_send_window;
+    int64_t m_peer_initial_window;
+    size_t m_peer_max_frame_size;
+    size_t m_peer_max_concurrent_streams;
+
+    hpack::encoder m_encoder;
+    hpack::decoder m_decoder;
+    std::vector<uint8_t> m_header_block;
+    bool m_header_block_end_stream = false;
+    uint32_t m_continuation_stream;
+
+    boost::asio::streambuf m_read_buf;
+    std::deque<write_segment> m_write_queue;
+    std::vector<write_segment> m_write_in_flight;
+    bool m_writing;
+    bool m_close_after_write = false;
+};
+
+void asio_context::start_exchange()
+{
+    if (!uses_http2())
+    {
+        start_request();
+        return;
+    }
+    if (m_aborted)
+    {
+        report_exception(std::make_exception_ptr(pplx::task_canceled("http request aborted")));
+        return;
+    }
+    start_timer();
+    asio_h2_session::submit(shared_from_this());
+}
+
+void asio_context::detach_h2_stream()
+{
+    std::shared_ptr<asio_h2_session> session;
+    {
+        std::lock_guard<std::mutex> lock(m_connection_lock);
+        session = m_h2_session.lock();
+        m_h2_session.reset();
+    }
+    if (session)
+        session->cancel_stream(this);
+}
+
+pplx::task<void> prewarm_connections(const uri& base_uri, const http_client_config& client_config, size_t count)
+{
+    auto& pool = asio_connection_pool::shared_instance();
+    auto& service = crossplat::threadpool::shared_instance().service();
+    const auto key = asio_connection_pool::pool_key(base_uri, client_config);
+
+    std::vector<pplx::task<void>> connected;
+    const auto granted = pool.reserve(key, client_config, count);
+    for (size_t i = 0; i < granted; ++i)
+    {
+        pplx::task_completion_event<void> tce;
+        auto connection = std::make_shared<asio_connection>(service);
+        std::make_shared<asio_connector>(connection, base_uri, client_config, service)
+            ->start([key, connection, tce](const std::string& message, const boost::system::error_code& ec)
+        {
+            if (!message.empty())
+            {
+                connection->close();
+                asio_connection_pool::shared_instance().release(key, connection);
+                tce.set_exception(http_exception(ec.value(), utility::conversions::to_string_t(message)));
+                return;
+            }
+            asio_connection_pool::shared_instance().release(key, connection);
+            tce.set();
+        });
+        connected.push_back(pplx::create_task(tce));
+    }
+    return pplx::when_all(connected.begin(), connected.end());
+}
+
+connection_pool_stats get_connection_pool_stats(const uri& base_uri, const http_client_config& client_config)
+{
+    return asio_connection_pool::shared_instance().stats(asio_connection_pool::pool_key(base_uri, client_config));
+}
+
+}}}} // namespace web::http::client::details
+
+namespace web { namespace http { namespace details
+{
+
+http_request_proxy::http_request_proxy()
+{
+}
+
+http_request_proxy::~http_request_proxy()
+{
+}
+
+http_response_proxy::~http_response_proxy()
+{
+}
+
+pplx::task<std::shared_ptr<http_response_proxy>> http_request_proxy::get_response_async()
+{
+    auto response = client::details::asio_context::start(shared_from_this());
+    response.then([this_ = weak_from_this()](pplx::task<std::shared_ptr<http_response_proxy>> completed)
+    {
+        auto request = this_.lock();
+        if (!request)
+            return;
+        try
+        {
+            request->_response = completed.get();
+        }
+        catch (...)
+        {
+        }
+    });
+    return response;
+}
+
+std::shared_ptr<http_response_proxy> http_request_proxy::get_response_cli()
+{
+    return get_response_async().get();
+}
+
+void http_request_proxy::abort_request()
+{
+    if (auto context = _context.lock())
+    {
+        context->abort();
+    }
+}
+
+}}} // namespace web::http::details
+
+#endif
@@ -11,8 +11,9 @@
 * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 ****/
 #include "stdafx.h"
-#include "..\..\include\cpprest\details\internal_http_helpers.h"
-#include "cpprest\streambuf_type_erasure.h"
+#include "cpprest/details/internal_http_helpers.h"
+#include "cpprest/streambuf_type_erasure.h"
+#include "cpprest/metrics.h"
 
 namespace web { namespace http
 {
@@ -62,15 +63,17 @@ void details::_http_request::set_request_uri(const uri& relative)
 
 namespace
 {
-	int64_t getStreamSize(concurrency::streams::istream &inputStream_)
+	const size_t bodyBufferSize = 16 * 1024;
+	//Upload chunks double up to this size, so long bodies take few continuations
+	const size_t maxBodyBufferSize = 1024 * 1024;
+
+	//The body is read from the current position, so only what follows it counts
+	int64_t getStreamSize(concurrency::streams::istream &inputStream)
 	{
-		auto inputStream = concurrency::streams::async_istream<concurrency::streams::istream::traits::char_type>(inputStream_);
-		auto currentPosition = inputStream.tellg();
-		inputStream.seekg(0, std::ios::end);
-		auto streamSize = inputStream.tellg();
-		inputStream.seekg(currentPosition);
-		inputStream.clear();
-		return static_cast<int64_t>(streamSize);
+		auto currentPosition = inputStream.tell();
+		auto streamSize = inputStream.seek(0, std::ios::end);
+		inputStream.seek(currentPosition);
+		return static_cast<int64_t>(streamSize) - static_cast<int64_t>(currentPosition);
 	}
 }
 
@@ -86,108 +89,89 @@ std::optional<int64_t> details::_http_request::_request_stream_length()
 
 void details::_http_request::_request_stream_writer(
 	std::shared_ptr<Concurrency::streams::istreambuf_type_erasure> streambuf_te, std::optional<Concurrency::streams::istreambuf_type_erasure::size_type> contentSize)
+{
+	_request_stream_writer_async(std::move(streambuf_te), contentSize).get();
+}
+
+pplx::task<void> details::_http_request::_request_stream_writer_async(
+	std::shared_ptr<Concurrency::streams::istreambuf_type_erasure> streambuf_te, std::optional<Concurrency::streams::istreambuf_type_erasure::size_type> contentSize)
 {
 	typedef Concurrency::streams::istreambuf_type_erasure::size_type size_type;
 	if (!streambuf_te)
-		return;
+		return pplx::task_from_result();
 	auto requestBodySource = instream();
 	if (!requestBodySource)
-		return;
-	/*if (!contentSize)
-		throw new std::logic_error("Content-Length not setted before send request");*/
+		return pplx::task_from_result();
 	Concurrency::streams::streambuf<uint8_t> bodyDestination {
 		std::make_shared<Concurrency::streams::streambuf_type_erasure<uint8_t>>(streambuf_te, std::ios_base::out) };
-	auto flush = [&](pplx::task<size_t> writed)
+	auto flush = [bodyDestination](pplx::task<bool> writed) mutable
 	{
 		(void)writed.get();
-		return bodyDestination
-		       .sync()
-		       .then([writed](pplx::task<void> ignored)
-		       {
-			       ignored.get();
-			       return 0;
-		       });
+		return bodyDestination.sync();
 	};
-	if (contentSize)
-	{
-		const size_type bufferSize = 16 * 1024;
-		size_type readRemains = contentSize.value()-bufferSize;
-		auto reader = [&](pplx::task<size_t> readed)
-		{
-			auto reader_impl = [&](pplx::task<size_t> readed, auto self)
-			{
-				if (readed.get() <= 0)
-					return pplx::task_from_result<size_t>(0);
-				const auto nextBufferSize = static_cast<size_t>((std::min)(bufferSize, readRemains));
-				if (nextBufferSize <= 0 || readRemains <= 0)
-					return pplx::task_from_result<size_t>(0);
-				readRemains -= nextBufferSize;
-				return requestBodySource
-					.read(bodyDestination, nextBufferSize)
-					.then([self](pplx::task<size_t> readed) {return self(readed, self); }, m_cancellationToken);
-			};
-
-			return reader_impl(readed, reader_impl);
-		};
-		(void)requestBodySource
-			.read(bodyDestination, static_cast<size_t>(bufferSize))
-			.then(reader, m_cancellationToken)
-			.then(flush)
-			.get();
-	}
-	else
+	if (!contentSize)
 	{
 		//This branch should not be called
-		(void)requestBodySource
+		return requestBodySource
 			.read_to_end(bodyDestination)
-			.then(flush)
-			.get();
+			.then([](size_t readed) { return readed > 0; })
+			.then(flush);
 	}
+	//Each step is chained on the previous read, so no thread waits on the request body source
+	auto readRemains = std::make_shared<size_type>(contentSize.value());
+	auto chunkSize = std::make_shared<size_t>(bodyBufferSize);
+	auto cancellationToken = m_cancellationToken;
+	return Concurrency::details::_do_while([requestBodySource, bodyDestination, readRemains, chunkSize, cancellationToken]() mutable -> pplx::task<bool>
+	{
+		if (*readRemains <= 0)
+			return pplx::task_from_result(false);
+		const auto nextBufferSize = static_cast<size_t>((std::min)(static_cast<size_type>(*chunkSize), *readRemains));
+		return requestBodySource
+			.read(bodyDestination, nextBufferSize)
+			.then([readRemains, chunkSize, nextBufferSize](size_t readed)
+			{
+				*readRemains -= static_cast<size_type>(readed);
+				utility::metrics::library().http_request_body_bytes.add(static_cast<int64_t>(readed));
+				//A full chunk means the source keeps up, the next read asks for more
+				if (readed == nextBufferSize)
+					*chunkSize = (std::min)(*chunkSize * 2, maxBodyBufferSize);
+				return readed > 0;
+			}, cancellationToken);
+	}).then(flush);
 }
 
 void details::_http_request::_response_explicit_stream_writer(
 	std::shared_ptr<Concurrency::streams::istreambuf_type_erasure> streambuf_te)
 {
-	typedef Concurrency::streams::istreambuf_type_erasure::size_type size_type;
+	_response_explicit_stream_writer_async(std::move(streambuf_te)).get();
+}
+
+pplx::task<void> details::_http_request::_response_explicit_stream_writer_async(
+	std::shared_ptr<Concurrency::streams::istreambuf_type_erasure> streambuf_te)
+{
 	if (!streambuf_te)
-		throw std::invalid_argument(__FUNCSIG__ ": empty streambuf_te, but must at this point by internal logic");
+		throw std::invalid_argument(std::string(__FUNCSIG__) + ": empty streambuf_te, but must at this point by internal logic");
 	auto explicitResponseDestination = _response_stream();
 	if (!explicitResponseDestination)
-		throw std::logic_error(__FUNCSIG__ ": outstream is not setted, but must at this point by internal logic");
+		throw std::logic_error(std::string(__FUNCSIG__) + ": outstream is not setted, but must at this point by internal logic");
 	auto explicitResponseSource = Concurrency::streams::streambuf<uint8_t>(
 		std::make_shared<Concurrency::streams::streambuf_type_erasure<uint8_t>>(streambuf_te, std::ios_base::in));
 
-	const size_t bufferSize = 16 * 1024;
-
-	auto writer = [&](pplx::task<size_t> writed)
+	auto cancellationToken = m_cancellationToken;
+	return Concurrency::details::_do_while([explicitResponseDestination, explicitResponseSource, cancellationToken]() mutable -> pplx::task<bool>
 	{
-		auto writer_impl = [&](pplx::task<size_t> writed, auto self)
-		{
-			if (writed.get() <= 0)
-				return pplx::task_from_result<size_t>(0);
-			return explicitResponseDestination
-				.write(explicitResponseSource, bufferSize)
-				.then([self](pplx::task<size_t> writed) {return self(writed, self); }, m_cancellationToken);
-		};
-		
-		return writer_impl(writed, writer_impl);
-	};
-	auto flush = [&](pplx::task<size_t> writed)
+		return explicitResponseDestination
+			.write(explicitResponseSource, bodyBufferSize)
+			.then([](size_t writed)
+			{
+				utility::metrics::library().http_response_body_bytes.add(static_cast<int64_t>(writed));
+				return writed > 0;
+			}, cancellationToken);
+	}).then([explicitResponseDestination](pplx::task<bool> writed) mutable
 	{
 		(void)writed.get();
-		return explicitResponseDestination
-		       .flush()
-		       .then([&explicitResponseDestination, writed](pplx::task<void> ignored)
-		       {
-			       ignored.get();
-			       return 0;
-		       });
-	};
-	(void)explicitResponseDestination
-	      .write(explicitResponseSource, bufferSize)
-	      .then(writer, m_cancellationToken)
-	      .then(flush)
-	      .get();
+		return explicitResponseDestination.flush();
+	});
 }
 
 utility::string_t details::_http_request::to_string() const
@@ -212,20 +196,49 @@ pplx::task<http_response> details::_http_request::get_response()
 	if (m_response._GetImpl())
 		return m_response.then(_http_response_task_to_http_response);
 	register_request_aborter();
+	//Balanced in _set_timings, which every transport calls once the request has been sent
+#if defined(_WIN32)
+	//Not continuation based: HttpWebRequest sends, receives and pumps the bodies synchronously, so the whole exchange
+	//holds one thread of the Windows thread pool. pplx queues it as a long function there, which lets the pool add
+	//threads instead of hitting a fixed cap. Only the native transport below is free of blocking waits.
 	auto response = pplx::create_task([this_ = this->_request_impl_from_this()]
 	{
+		utility::metrics::library().http_requests_in_flight.add();
 		auto response_impl = std::static_pointer_cast<details::_http_response>(this_->get_response_cli());
 		auto result = http_response(response_impl);
 		return result;
 	}, pplx::task_options(m_cancellationToken));
+#else
+	utility::metrics::library().http_requests_in_flight.add();
+	auto response = get_response_async()
+		.then([](std::shared_ptr<http::details::http_response_proxy> response_proxy)
+	{
+		return http_response(std::static_pointer_cast<details::_http_response>(response_proxy));
+	}, m_cancellationToken);
+#endif
 	m_response = http_response_to__http_response(response);
 	return response;
 }
 
+void details::_http_request::_set_timings(const http::http_timings& timings)
+{
+	m_timings = timings;
+	auto& metrics = utility::metrics::library();
+	metrics.http_requests_in_flight.sub();
+	if (timings.failed)
+		metrics.http_requests_failed.add();
+	else
+		metrics.http_requests_completed.add();
+	metrics.http_request_duration.record(timings.total());
+}
+
 void details::_http_response::_set_response_body(
 	const std::shared_ptr<Concurrency::streams::istreambuf_type_erasure>& streambuf_te, utility::size64_t contentLength,
 	const utf16string& contentType)
 {
+	//Unknown lengths (the .Net bridge without Content-Length) are not counted
+	if (contentLength != (std::numeric_limits<utility::size64_t>::max)())
+		utility::metrics::library().http_response_body_bytes.add(static_cast<int64_t>(contentLength));
 	Concurrency::streams::streambuf<uint8_t> buf{
 		std::make_shared<Concurrency::streams::streambuf_type_erasure<uint8_t>>(streambuf_te, std::ios_base::in)
 	};
@@ -0,0 +1,546 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* HPACK header compression for HTTP/2 (RFC 7541).
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "stdafx.h"
+#include "cpprest/details/hpack.h"
+
+#include <algorithm>
+
+namespace web { namespace http { namespace details { namespace hpack {
+
+namespace
+{
+    struct static_entry
+    {
+        const char* name;
+        const char* value;
+    };
+
+    // RFC 7541 Appendix A, index 1 is the first entry.
+    const static_entry static_table[] =
+    {
+        { ":authority", "" },
+        { ":method", "GET" },
+        { ":method", "POST" },
+        { ":path", "/" },
+        { ":path", "/index.html" },
+        { ":scheme", "http" },
+        { ":scheme", "https" },
+        { ":status", "200" },
+        { ":status", "204" },
+        { ":status", "206" },
+        { ":status", "304" },
+        { ":status", "400" },
+        { ":status", "404" },
+        { ":status", "500" },
+        { "accept-charset", "" },
+        { "accept-encoding", "gzip, deflate" },
+        { "accept-language", "" },
+        { "accept-ranges", "" },
+        { "accept", "" },
+        { "access-control-allow-origin", "" },
+        { "age", "" },
+        { "allow", "" },
+        { "authorization", "" },
+        { "cache-control", "" },
+        { "content-disposition", "" },
+        { "content-encoding", "" },
+        { "content-language", "" },
+        { "content-length", "" },
+        { "content-location", "" },
+        { "content-range", "" },
+        { "content-type", "" },
+        { "cookie", "" },
+        { "date", "" },
+        { "etag", "" },
+        { "expect", "" },
+        { "expires", "" },
+        { "from", "" },
+        { "host", "" },
+        { "if-match", "" },
+        { "if-modified-since", "" },
+        { "if-none-match", "" },
+        { "if-range", "" },
+        { "if-unmodified-since", "" },
+        { "last-modified", "" },
+        { "link", "" },
+        { "location", "" },
+        { "max-forwards", "" },
+        { "proxy-authenticate", "" },
+        { "proxy-authorization", "" },
+        { "range", "" },
+        { "referer", "" },
+        { "refresh", "" },
+        { "retry-after", "" },
+        { "server", "" },
+        { "set-cookie", "" },
+        { "strict-transport-security", "" },
+        { "transfer-encoding", "" },
+        { "user-agent", "" },
+        { "vary", "" },
+        { "via", "" },
+        { "www-authenticate", "" },
+    };
+
+    const size_t static_table_size = sizeof(static_table) / sizeof(static_table[0]);
+
+    struct huffman_code
+    {
+        uint32_t code;
+        uint8_t bits;
+    };
+
+    // RFC 7541 Appendix B, indexed by symbol; 256 is EOS.
+    const huffman_code huffman_codes[257] =
+    {
+        { 0x1ff8, 13 }, { 0x7fffd8, 23 }, { 0xfffffe2, 28 }, { 0xfffffe3, 28 },
+        { 0xfffffe4, 28 }, { 0xfffffe5, 28 }, { 0xfffffe6, 28 }, { 0xfffffe7, 28 },
+        { 0xfffffe8, 28 }, { 0xffffea, 24 }, { 0x3ffffffc, 30 }, { 0xfffffe9, 28 },
+        { 0xfffffea, 28 }, { 0x3ffffffd, 30 }, { 0xfffffeb, 28 }, { 0xfffffec, 28 },
+        { 0xfffffed, 28 }, { 0xfffffee, 28 }, { 0xfffffef, 28 }, { 0xffffff0, 28 },
+        { 0xffffff1, 28 }, { 0xffffff2, 28 }, { 0x3ffffffe, 30 }, { 0xffffff3, 28 },
+        { 0xffffff4, 28 }, { 0xffffff5, 28 }, { 0xffffff6, 28 }, { 0xffffff7, 28 },
+        { 0xffffff8, 28 }, { 0xffffff9, 28 }, { 0xffffffa, 28 }, { 0xffffffb, 28 },
+        { 0x14, 6 }, { 0x3f8, 10 }, { 0x3f9, 10 }, { 0xffa, 12 },
+        { 0x1ff9, 13 }, { 0x15, 6 }, { 0xf8, 8 }, { 0x7fa, 11 },
+        { 0x3fa, 10 }, { 0x3fb, 10 }, { 0xf9, 8 }, { 0x7fb, 11 },
+        { 0xfa, 8 }, { 0x16, 6 }, { 0x17, 6 }, { 0x18, 6 },
+        { 0x0, 5 }, { 0x1, 5 }, { 0x2, 5 }, { 0x19, 6 },
+        { 0x1a, 6 }, { 0x1b, 6 }, { 0x1c, 6 }, { 0x1d, 6 },
+        { 0x1e, 6 }, { 0x1f, 6 }, { 0x5c, 7 }, { 0xfb, 8 },
+        { 0x7ffc, 15 }, { 0x20, 6 }, { 0xffb, 12 }, { 0x3fc, 10 },
+        { 0x1ffa, 13 }, { 0x21, 6 }, { 0x5d, 7 }, { 0x5e, 7 },
+        { 0x5f, 7 }, { 0x60, 7 }, { 0x61, 7 }, { 0x62, 7 },
+        { 0x63, 7 }, { 0x64, 7 }, { 0x65, 7 }, { 0x66, 7 },
+        { 0x67, 7 }, { 0x68, 7 }, { 0x69, 7 }, { 0x6a, 7 },
+        { 0x6b, 7 }, { 0x6c, 7 }, { 0x6d, 7 }, { 0x6e, 7 },
+        { 0x6f, 7 }, { 0x70, 7 }, { 0x71, 7 }, { 0x72, 7 },
+        { 0xfc, 8 }, { 0x73, 7 }, { 0xfd, 8 }, { 0x1ffb, 13 },
+        { 0x7fff0, 19 }, { 0x1ffc, 13 }, { 0x3ffc, 14 }, { 0x22, 6 },
+        { 0x7ffd, 15 }, { 0x3, 5 }, { 0x23, 6 }, { 0x4, 5 },
+        { 0x24, 6 }, { 0x5, 5 }, { 0x25, 6 }, { 0x26, 6 },
+        { 0x27, 6 }, { 0x6, 5 }, { 0x74, 7 }, { 0x75, 7 },
+        { 0x28, 6 }, { 0x29, 6 }, { 0x2a, 6 }, { 0x7, 5 },
+        { 0x2b, 6 }, { 0x76, 7 }, { 0x2c, 6 }, { 0x8, 5 },
+        { 0x9, 5 }, { 0x2d, 6 }, { 0x77, 7 }, { 0x78, 7 },
+        { 0x79, 7 }, { 0x7a, 7 }, { 0x7b, 7 }, { 0x7ffe, 15 },
+        { 0x7fc, 11 }, { 0x3ffd, 14 }, { 0x1ffd, 13 }, { 0xffffffc, 28 },
+        { 0xfffe6, 20 }, { 0x3fffd2, 22 }, { 0xfffe7, 20 }, { 0xfffe8, 20 },
+        { 0x3fffd3, 22 }, { 0x3fffd4, 22 }, { 0x3fffd5, 22 }, { 0x7fffd9, 23 },
+        { 0x3fffd6, 22 }, { 0x7fffda, 23 }, { 0x7fffdb, 23 }, { 0x7fffdc, 23 },
+        { 0x7fffdd, 23 }, { 0x7fffde, 23 }, { 0xffffeb, 24 }, { 0x7fffdf, 23 },
+        { 0xffffec, 24 }, { 0xffffed, 24 }, { 0x3fffd7, 22 }, { 0x7fffe0, 23 },
+        { 0xffffee, 24 }, { 0x7fffe1, 23 }, { 0x7fffe2, 23 }, { 0x7fffe3, 23 },
+        { 0x7fffe4, 23 }, { 0x1fffdc, 21 }, { 0x3fffd8, 22 }, { 0x7fffe5, 23 },
+        { 0x3fffd9, 22 }, { 0x7fffe6, 23 }, { 0x7fffe7, 23 }, { 0xffffef, 24 },
+        { 0x3fffda, 22 }, { 0x1fffdd, 21 }, { 0xfffe9, 20 }, { 0x3fffdb, 22 },
+        { 0x3fffdc, 22 }, { 0x7fffe8, 23 }, { 0x7fffe9, 23 }, { 0x1fffde, 21 },
+        { 0x7fffea, 23 }, { 0x3fffdd, 22 }, { 0x3fffde, 22 }, { 0xfffff0, 24 },
+        { 0x1fffdf, 21 }, { 0x3fffdf, 22 }, { 0x7fffeb, 23 }, { 0x7fffec, 23 },
+        { 0x1fffe0, 21 }, { 0x1fffe1, 21 }, { 0x3fffe0, 22 }, { 0x1fffe2, 21 },
+        { 0x7fffed, 23 }, { 0x3fffe1, 22 }, { 0x7fffee, 23 }, { 0x7fffef, 23 },
+        { 0xfffea, 20 }, { 0x3fffe2, 22 }, { 0x3fffe3, 22 }, { 0x3fffe4, 22 },
+        { 0x7ffff0, 23 }, { 0x3fffe5, 22 }, { 0x3fffe6, 22 }, { 0x7ffff1, 23 },
+        { 0x3ffffe0, 26 }, { 0x3ffffe1, 26 }, { 0xfffeb, 20 }, { 0x7fff1, 19 },
+        { 0x3fffe7, 22 }, { 0x7ffff2, 23 }, { 0x3fffe8, 22 }, { 0x1ffffec, 25 },
+        { 0x3ffffe2, 26 }, { 0x3ffffe3, 26 }, { 0x3ffffe4, 26 }, { 0x7ffffde, 27 },
+        { 0x7ffffdf, 27 }, { 0x3ffffe5, 26 }, { 0xfffff1, 24 }, { 0x1ffffed, 25 },
+        { 0x7fff2, 19 }, { 0x1fffe3, 21 }, { 0x3ffffe6, 26 }, { 0x7ffffe0, 27 },
+        { 0x7ffffe1, 27 }, { 0x3ffffe7, 26 }, { 0x7ffffe2, 27 }, { 0xfffff2, 24 },
+        { 0x1fffe4, 21 }, { 0x1fffe5, 21 }, { 0x3ffffe8, 26 }, { 0x3ffffe9, 26 },
+        { 0xffffffd, 28 }, { 0x7ffffe3, 27 }, { 0x7ffffe4, 27 }, { 0x7ffffe5, 27 },
+        { 0xfffec, 20 }, { 0xfffff3, 24 }, { 0xfffed, 20 }, { 0x1fffe6, 21 },
+        { 0x3fffe9, 22 }, { 0x1fffe7, 21 }, { 0x1fffe8, 21 }, { 0x7ffff3, 23 },
+        { 0x3fffea, 22 }, { 0x3fffeb, 22 }, { 0x1ffffee, 25 }, { 0x1ffffef, 25 },
+        { 0xfffff4, 24 }, { 0xfffff5, 24 }, { 0x3ffffea, 26 }, { 0x7ffff4, 23 },
+        { 0x3ffffeb, 26 }, { 0x7ffffe6, 27 }, { 0x3ffffec, 26 }, { 0x3ffffed, 26 },
+        { 0x7ffffe7, 27 }, { 0x7ffffe8, 27 }, { 0x7ffffe9, 27 }, { 0x7ffffea, 27 },
+        { 0x7ffffeb, 27 }, { 0xffffffe, 28 }, { 0x7ffffec, 27 }, { 0x7ffffed, 27 },
+        { 0x7ffffee, 27 }, { 0x7ffffef, 27 }, { 0x7fffff0, 27 }, { 0x3ffffee, 26 },
+        { 0x3fffffff, 30 },
+    };
+
+    /// <summary>
+    /// Canonical decoding table: the codes of one length are consecutive and ordered like their symbols.
+    /// </summary>
+    struct huffman_decode_table
+    {
+        static const uint8_t max_bits = 30;
+
+        uint32_t first_code[max_bits + 1];
+        uint16_t first_index[max_bits + 1];
+        uint16_t count[max_bits + 1];
+        uint16_t symbols[257];
+
+        huffman_decode_table()
+        {
+            std::fill(std::begin(count), std::end(count), static_cast<uint16_t>(0));
+            std::fill(std::begin(first_code), std::end(first_code), 0u);
+            for (const auto& code : huffman_codes)
+                ++count[code.bits];
+
+            uint16_t index = 0;
+            for (uint8_t bits = 1; bits <= max_bits; ++bits)
+            {
+                first_index[bits] = index;
+                index = static_cast<uint16_t>(index + count[bits]);
+            }
+
+            std::vector<uint16_t> ordered(257);
+            for (uint16_t symbol = 0; symbol < 257; ++symbol)
+                ordered[symbol] = symbol;
+            std::stable_sort(ordered.begin(), ordered.end(), [](uint16_t a, uint16_t b)
+            {
+                return huffman_codes[a].bits < huffman_codes[b].bits
+                    || (huffman_codes[a].bits == huffman_codes[b].bits && huffman_codes[a].code < huffman_codes[b].code);
+            });
+            std::copy(ordered.begin(), ordered.end(), symbols);
+            for (uint8_t bits = 1; bits <= max_bits; ++bits)
+            {
+                if (count[bits] != 0)
+                    first_code[bits] = huffman_codes[symbols[first_index[bits]]].code;
+            }
+        }
+    };
+
+    const huffman_decode_table& decode_table()
+    {
+        static const huffman_decode_table table;
+        return table;
+    }
+
+    bool lookup(const dynamic_table& table, size_t index, std::string& name, std::string& value)
+    {
+        if (index == 0)
+            return false;
+        if (index <= static_table_size)
+        {
+            name = static_table[index - 1].name;
+            value = static_table[index - 1].value;
+            return true;
+        }
+        index -= static_table_size + 1;
+        if (index >= table.count())
+            return false;
+        name = table.at(index).first;
+        value = table.at(index).second;
+        return true;
+    }
+
+    // Returns the index of a full match, or of a name only match through name_index; 0 when absent.
+    size_t find(const dynamic_table& table, const std::string& name, const std::string& value, size_t& name_index)
+    {
+        name_index = 0;
+        for (size_t i = 0; i < static_table_size; ++i)
+        {
+            if (name != static_table[i].name)
+                continue;
+            if (value == static_table[i].value)
+                return i + 1;
+            if (name_index == 0)
+                name_index = i + 1;
+        }
+        for (size_t i = 0; i < table.count(); ++i)
+        {
+            const auto& entry = table.at(i);
+            if (entry.first != name)
+                continue;
+            if (entry.second == value)
+                return static_table_size + 1 + i;
+            if (name_index == 0)
+                name_index = static_table_size + 1 + i;
+        }
+        return 0;
+    }
+
+    void encode_string(const std::string& value, std::vector<uint8_t>& out)
+    {
+        const auto huffman_size = huffman_encoded_size(value);
+        if (huffman_size < value.size())
+        {
+            encode_integer(huffman_size, 7, 0x80, out);
+            huffman_encode(value, out);
+        }
+        else
+        {
+            encode_integer(value.size(), 7, 0, out);
+            out.insert(out.end(), value.begin(), value.end());
+        }
+    }
+
+    bool decode_string(const uint8_t*& pos, const uint8_t* end, std::string& value)
+    {
+        if (pos == end)
+            return false;
+        const bool huffman = (*pos & 0x80) != 0;
+        uint64_t length = 0;
+        if (!decode_integer(pos, end, 7, length) || length > static_cast<uint64_t>(end - pos))
+            return false;
+        const auto size = static_cast<size_t>(length);
+        value.clear();
+        if (huffman)
+        {
+            if (!huffman_decode(pos, size, value))
+                return false;
+        }
+        else
+        {
+            value.assign(reinterpret_cast<const char*>(pos), size);
+        }
+        pos += size;
+        return true;
+    }
+
+    // Values that are unlikely to repeat only waste dynamic table space.
+    bool is_volatile(const std::string& name)
+    {
+        return name == ":path" || name == "content-length" || name == "date"
+            || name == "if-modified-since" || name == "if-none-match" || name == "etag";
+    }
+
+    // Credentials must not end up in a table an intermediary could probe (RFC 7541 section 7.1.3).
+    bool is_sensitive(const std::string& name)
+    {
+        return name == "authorization" || name == "proxy-authorization" || name == "cookie" || name == "set-cookie";
+    }
+}
+
+void dynamic_table::set_max_size(size_t max_size)
+{
+    m_max_size = max_size;
+    evict(0);
+}
+
+void dynamic_table::add(const std::string& name, const std::string& value)
+{
+    const auto size = entry_size(name, value);
+    if (size > m_max_size)
+    {
+        // An entry larger than the table empties it (RFC 7541 section 4.4).
+        m_entries.clear();
+        m_size = 0;
+        return;
+    }
+    evict(size);
+    m_entries.emplace_front(name, value);
+    m_size += size;
+}
+
+void dynamic_table::evict(size_t needed)
+{
+    while (!m_entries.empty() && m_size + needed > m_max_size)
+    {
+        m_size -= entry_size(m_entries.back().first, m_entries.back().second);
+        m_entries.pop_back();
+    }
+}
+
+void encode_integer(uint64_t value, uint8_t prefix_bits, uint8_t first_byte_flags, std::vector<uint8_t>& out)
+{
+    const uint64_t max_prefix = (1u << prefix_bits) - 1;
+    if (value < max_prefix)
+    {
+        out.push_back(static_cast<uint8_t>(first_byte_flags | value));
+        return;
+    }
+    out.push_back(static_cast<uint8_t>(first_byte_flags | max_prefix));
+    value -= max_prefix;
+    while (value >= 0x80)
+    {
+        out.push_back(static_cast<uint8_t>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<uint8_t>(value));
+}
+
+bool decode_integer(const uint8_t*& pos, const uint8_t* end, uint8_t prefix_bits, uint64_t& value)
+{
+    if (pos == end)
+        return false;
+    const uint64_t max_prefix = (1u << prefix_bits) - 1;
+    value = *pos++ & max_prefix;
+    if (value < max_prefix)
+        return true;
+    for (unsigned shift = 0; pos != end; shift += 7)
+    {
+        // Nothing in a header block needs more than 32 bits worth of integer.
+        if (shift > 28)
+            return false;
+        const auto byte = *pos++;
+        value += static_cast<uint64_t>(byte & 0x7f) << shift;
+        if ((byte & 0x80) == 0)
+            return true;
+    }
+    return false;
+}
+
+size_t huffman_encoded_size(const std::string& input)
+{
+    size_t bits = 0;
+    for (const auto ch : input)
+        bits += huffman_codes[static_cast<uint8_t>(ch)].bits;
+    return (bits + 7) / 8;
+}
+
+void huffman_encode(const std::string& input, std::vector<uint8_t>& out)
+{
+    uint64_t accumulator = 0;
+    unsigned pending = 0;
+    for (const auto ch : input)
+    {
+        const auto& code = huffman_codes[static_cast<uint8_t>(ch)];
+        accumulator = (accumulator << code.bits) | code.code;
+        pending += code.bits;
+        while (pending >= 8)
+        {
+            pending -= 8;
+            out.push_back(static_cast<uint8_t>(accumulator >> pending));
+        }
+    }
+    if (pending > 0)
+    {
+        // Pad with the most significant bits of EOS, which are all ones.
+        out.push_back(static_cast<uint8_t>((accumulator << (8 - pending)) | (0xff >> pending)));
+    }
+}
+
+bool huffman_decode(const uint8_t* data, size_t size, std::string& out)
+{
+    const auto& table = decode_table();
+    uint32_t code = 0;
+    uint8_t bits = 0;
+    for (size_t i = 0; i < size; ++i)
+    {
+        for (int bit = 7; bit >= 0; --bit)
+        {
+            code = (code << 1) | ((data[i] >> bit) & 1);
+            ++bits;
+            if (bits > huffman_decode_table::max_bits)
+                return false;
+            const auto offset = code - table.first_code[bits];
+            if (table.count[bits] == 0 || code < table.first_code[bits] || offset >= table.count[bits])
+                continue;
+            const auto symbol = table.symbols[table.first_index[bits] + offset];
+            if (symbol == 256)
+                return false;
+            out.push_back(static_cast<char>(symbol));
+            code = 0;
+            bits = 0;
+        }
+    }
+    // Padding is shorter than a byte and made of EOS bits only.
+    return bits < 8 && code == (1u << bits) - 1;
+}
+
+void encoder::set_max_table_size(size_t max_size)
+{
+    // The encoder is free to use less than the peer allows, the default bounds memory per connection.
+    const auto size = (std::min)(max_size, default_table_size);
+    if (size != m_table.max_size())
+    {
+        m_table.set_max_size(size);
+        m_pending_size_update = true;
+    }
+}
+
+void encoder::encode(const header_list& headers, std::vector<uint8_t>& out)
+{
+    if (m_pending_size_update)
+    {
+        encode_integer(m_table.max_size(), 5, 0x20, out);
+        m_pending_size_update = false;
+    }
+
+    for (const auto& header : headers)
+    {
+        size_t name_index = 0;
+        const auto index = find(m_table, header.first, header.second, name_index);
+        if (index != 0 && !is_sensitive(header.first))
+        {
+            encode_integer(index, 7, 0x80, out);
+            continue;
+        }
+
+        if (is_sensitive(header.first))
+        {
+            encode_integer(name_index, 4, 0x10, out);
+        }
+        else if (is_volatile(header.first))
+        {
+            encode_integer(name_index, 4, 0x00, out);
+        }
+        else
+        {
+            encode_integer(name_index, 6, 0x40, out);
+            m_table.add(header.first, header.second);
+        }
+        if (name_index == 0)
+            encode_string(header.first, out);
+        encode_string(header.second, out);
+    }
+}
+
+bool decoder::decode(const uint8_t* data, size_t size, header_list& out)
+{
+    const uint8_t* pos = data;
+    const uint8_t* end = data + size;
+    bool headers_seen = false;
+    while (pos != end)
+    {
+        const auto first = *pos;
+        uint64_t index = 0;
+        std::string name, value;
+
+        if (first & 0x80)
+        {
+            // Indexed header field.
+            if (!decode_integer(pos, end, 7, index) || !lookup(m_table, static_cast<size_t>(index), name, value))
+                return false;
+            out.emplace_back(std::move(name), std::move(value));
+            headers_seen = true;
+            continue;
+        }
+
+        if ((first & 0xe0) == 0x20)
+        {
+            // Dynamic table size update, only allowed at the start of a block.
+            if (headers_seen || !decode_integer(pos, end, 5, index) || index > m_settings_table_size)
+                return false;
+            m_table.set_max_size(static_cast<size_t>(index));
+            continue;
+        }
+
+        const bool incremental = (first & 0xc0) == 0x40;
+        if (!decode_integer(pos, end, incremental ? 6 : 4, index))
+            return false;
+        if (index != 0)
+        {
+            std::string ignored;
+            if (!lookup(m_table, static_cast<size_t>(index), name, ignored))
+                return false;
+        }
+        else if (!decode_string(pos, end, name))
+        {
+            return false;
+        }
+        if (!decode_string(pos, end, value))
+            return false;
+        if (incremental)
+            m_table.add(name, value);
+        out.emplace_back(std::move(name), std::move(value));
+        headers_seen = true;
+    }
+    return true;
+}
+
+}}}} // namespace web::http::details::hpack
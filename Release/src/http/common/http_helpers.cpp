@@ -12,7 +12,7 @@
 ****/
 
 #include "stdafx.h"
-#include "..\..\..\include\cpprest\details\http_helpers.h"
+#include "cpprest/details/http_helpers.h"
 
 // CPPREST_EXCLUDE_COMPRESSION is set if we're on a platform that supports compression but we want to explicitly disable it.
 // CPPREST_EXCLUDE_WEBSOCKETS is a flag that now essentially means "no external dependencies". TODO: Rename
@@ -28,15 +28,26 @@
 #if !defined(CPPREST_EXCLUDE_WEBSOCKETS) && !defined(CPPREST_EXCLUDE_COMPRESSION)
 #define CPPREST_HTTP_COMPRESSION
 #endif // !defined(CPPREST_EXCLUDE_WEBSOCKETS) && !defined(CPPREST_EXCLUDE_COMPRESSION)
+#elif !defined(_WIN32) && !defined(CPPREST_EXCLUDE_COMPRESSION)
+// The native asio transport links zlib.
+#define CPPREST_HTTP_COMPRESSION
+#endif
+
+// zstd is only linked by the native transport. CPPREST_EXCLUDE_ZSTD builds without it.
+#if defined(CPPREST_HTTP_COMPRESSION) && !defined(_WIN32) && !defined(CPPREST_EXCLUDE_ZSTD)
+#define CPPREST_HTTP_COMPRESSION_ZSTD
 #endif
 
 #if defined(CPPREST_HTTP_COMPRESSION)
 #include <zlib.h>
 #endif
+#if defined(CPPREST_HTTP_COMPRESSION_ZSTD)
+#include <zstd.h>
+#endif
 
-#include "..\..\..\include\cpprest\asyncrt_utils.h"
-#include "..\..\..\include\cpprest\details\internal_http_helpers.h"
-#include "..\..\..\include\cpprest\http_exception.h"
+#include "cpprest/asyncrt_utils.h"
+#include "cpprest/details/internal_http_helpers.h"
+#include "cpprest/http_exception.h"
 #include <atomic>
 
 using namespace web;
@@ -48,13 +59,13 @@ namespace web { namespace http
 
 #define _METHODS
 #define DAT(a,b) const method methods::a = b;
-#include "..\..\..\include\cpprest\details\http_constants.dat"
+#include "cpprest/details/http_constants.dat"
 #undef _METHODS
 #undef DAT
 
 #define _HEADER_NAMES
 #define DAT(a,b) const utility::string_t header_names::a = _XPLATSTR(b);
-#include "..\..\..\include\cpprest\details\http_constants.dat"
+#include "cpprest/details/http_constants.dat"
 #undef _HEADER_NAMES
 #undef DAT
 
@@ -62,13 +73,13 @@ namespace details {
 
 #define _MIME_TYPES
 #define DAT(a,b) const utility::string_t mime_types::a = _XPLATSTR(b);
-#include "..\..\..\include\cpprest\details\http_constants.dat"
+#include "cpprest/details/http_constants.dat"
 #undef _MIME_TYPES
 #undef DAT
 
 #define _CHARSET_TYPES
 #define DAT(a,b) const utility::string_t charset_types::a = _XPLATSTR(b);
-#include "..\..\..\include\cpprest\details\http_constants.dat"
+#include "cpprest/details/http_constants.dat"
 #undef _CHARSET_TYPES
 #undef DAT
 
@@ -82,7 +93,7 @@ namespace details
 static const http_status_to_phrase idToPhraseMap [] = {
 #define _PHRASES
 #define DAT(a,b,c) {status_codes::a, c},
-#include "..\..\..\include\cpprest\details\http_constants.dat"
+#include "cpprest/details/http_constants.dat"
 #undef _PHRASES
 #undef DAT
 };
@@ -96,7 +107,7 @@ utility::string_t get_default_reason_phrase(status_code code)
     static const http_status_to_phrase idToPhraseMap [] = {
 #define _PHRASES
 #define DAT(a,b,c) {status_codes::a, c},
-#include "..\..\..\include\cpprest\details\http_constants.dat"
+#include "cpprest/details/http_constants.dat"
 #undef _PHRASES
 #undef DAT
     };
@@ -179,7 +190,26 @@ namespace compression
 {
 #if defined(CPPREST_HTTP_COMPRESSION)
 
-    class compression_base_impl
+    // Output is produced in pieces of this size, the input is always consumed whole.
+    const size_t codec_buffer_size = 16 * 1024;
+
+    /// <summary>
+    /// Incremental codec behind stream_compressor and stream_decompressor.
+    /// </summary>
+    class compression_codec
+    {
+    public:
+        virtual ~compression_codec() {}
+
+        virtual data_buffer process(const uint8_t* input, size_t input_size, bool finish) = 0;
+
+        virtual bool has_error() const = 0;
+
+        // True once the end of the compressed stream was produced or consumed.
+        virtual bool is_complete() const = 0;
+    };
+
+    class compression_base_impl : public compression_codec
     {
     public:
         compression_base_impl(compression_algorithm alg) : m_alg(alg), m_zLibState(Z_OK)
@@ -187,21 +217,12 @@ namespace compression
             memset(&m_zLibStream, 0, sizeof(m_zLibStream));
         }
 
-        size_t read_output(size_t input_offset, size_t available_input, size_t total_out_before, uint8_t* temp_buffer, data_buffer& output)
-        {
-            input_offset += (available_input - stream().avail_in);
-            auto out_length = stream().total_out - total_out_before;
-            output.insert(output.end(), temp_buffer, temp_buffer + out_length);
-
-            return input_offset;
-        }
-
-        bool is_complete() const
+        bool is_complete() const override
         {
             return state() == Z_STREAM_END;
         }
 
-        bool has_error() const
+        bool has_error() const override
         {
             return !is_complete() && state() != Z_OK;
         }
@@ -213,7 +234,8 @@ namespace compression
 
         void set_state(int state)
         {
-            m_zLibState = state;
+            // Z_BUF_ERROR only means no progress was possible with the given buffers.
+            m_zLibState = state == Z_BUF_ERROR ? Z_OK : state;
         }
 
         compression_algorithm algorithm() const
@@ -238,24 +260,23 @@ namespace compression
         z_stream m_zLibStream;
     };
 
-    class stream_decompressor::stream_decompressor_impl : public compression_base_impl
+    class zlib_decompressor final : public compression_base_impl
     {
     public:
-        stream_decompressor_impl(compression_algorithm alg) : compression_base_impl(alg)
+        zlib_decompressor(compression_algorithm alg) : compression_base_impl(alg)
         {
             set_state(inflateInit2(&stream(), to_zlib_alg(alg)));
         }
 
-        ~stream_decompressor_impl()
+        ~zlib_decompressor()
         {
             inflateEnd(&stream());
         }
 
-        data_buffer decompress(const uint8_t* input, size_t input_size)
+        data_buffer process(const uint8_t* input, size_t input_size, bool) override
         {
             if (input == nullptr || input_size == 0)
             {
-                set_state(Z_BUF_ERROR);
                 return data_buffer();
             }
 
@@ -266,42 +287,38 @@ namespace compression
                 return data_buffer();
             }
 
-            const size_t BUFFER_SIZE = 1024;
-            unsigned char temp_buffer[BUFFER_SIZE];
+            uint8_t temp_buffer[codec_buffer_size];
 
             data_buffer output;
             output.reserve(input_size * 3);
 
-            size_t input_offset{ 0 };
+            stream().next_in = const_cast<uint8_t*>(input);
+            stream().avail_in = static_cast<uInt>(input_size);
 
-            while (state() == Z_OK && input_offset < input_size)
+            // A full output buffer may leave decoded data inside zlib even after all input is consumed.
+            do
             {
-                auto total_out_before = stream().total_out;
-
-                auto available_input = input_size - input_offset;
-                stream().next_in = const_cast<uint8_t*>(&input[input_offset]);
-                stream().avail_in = static_cast<int>(available_input);
                 stream().next_out = temp_buffer;
-                stream().avail_out = BUFFER_SIZE;
+                stream().avail_out = static_cast<uInt>(codec_buffer_size);
 
-                set_state(inflate(&stream(), Z_PARTIAL_FLUSH));
+                set_state(inflate(&stream(), Z_NO_FLUSH));
 
                 if (has_error())
                 {
                     return data_buffer();
                 }
 
-                input_offset = read_output(input_offset, available_input, total_out_before, temp_buffer, output);
-            }
+                output.insert(output.end(), temp_buffer, temp_buffer + (codec_buffer_size - stream().avail_out));
+            } while (state() == Z_OK && (stream().avail_in > 0 || stream().avail_out == 0));
 
             return output;
         }
     };
 
-    class stream_compressor::stream_compressor_impl : public compression_base_impl
+    class zlib_compressor final : public compression_base_impl
     {
     public:
-        stream_compressor_impl(compression_algorithm alg) : compression_base_impl(alg)
+        zlib_compressor(compression_algorithm alg) : compression_base_impl(alg)
         {
             const int level = Z_DEFAULT_COMPRESSION;
             if (alg == compression_algorithm::gzip)
@@ -314,68 +331,249 @@ namespace compression
             }
         }
 
-        web::http::details::compression::data_buffer compress(const uint8_t* input, size_t input_size, bool finish)
+        ~zlib_compressor()
         {
-            if (input == nullptr || input_size == 0)
-            {
-                set_state(Z_BUF_ERROR);
-                return data_buffer();
-            }
+            deflateEnd(&stream());
+        }
 
+        data_buffer process(const uint8_t* input, size_t input_size, bool finish) override
+        {
             if (state() != Z_OK)
             {
                 set_state(Z_STREAM_ERROR);
                 return data_buffer();
             }
 
-            data_buffer output;
-            output.reserve(input_size);
+            uint8_t temp_buffer[codec_buffer_size];
 
-            const size_t BUFFER_SIZE = 1024;
-            uint8_t temp_buffer[BUFFER_SIZE];
+            data_buffer output;
+            output.reserve(input_size / 2 + 64);
 
-            size_t input_offset{ 0 };
-            auto flush = Z_NO_FLUSH;
+            stream().next_in = const_cast<uint8_t*>(input);
+            stream().avail_in = static_cast<uInt>(input_size);
 
-            while (flush == Z_NO_FLUSH)
+            // Without finish the output is only what deflate could complete, the rest comes with later calls.
+            const int flush = finish ? Z_FINISH : Z_NO_FLUSH;
+            do
             {
-                auto total_out_before = stream().total_out;
-                auto available_input = input_size - input_offset;
+                stream().next_out = temp_buffer;
+                stream().avail_out = static_cast<uInt>(codec_buffer_size);
+
+                set_state(deflate(&stream(), flush));
 
-                if (available_input == 0)
+                if (has_error())
                 {
-                    flush = finish ? Z_FINISH : Z_PARTIAL_FLUSH;
+                    return data_buffer();
                 }
-                else
+
+                output.insert(output.end(), temp_buffer, temp_buffer + (codec_buffer_size - stream().avail_out));
+            } while (state() == Z_OK && (stream().avail_in > 0 || stream().avail_out == 0));
+
+            return output;
+        }
+    };
+
+#if defined(CPPREST_HTTP_COMPRESSION_ZSTD)
+    class zstd_decompressor final : public compression_codec
+    {
+    public:
+        zstd_decompressor() : m_stream(ZSTD_createDStream()), m_error(m_stream == nullptr), m_frame_complete(false)
+        {
+            if (m_stream != nullptr)
+            {
+                m_error = ZSTD_isError(ZSTD_initDStream(m_stream)) != 0;
+            }
+        }
+
+        ~zstd_decompressor()
+        {
+            ZSTD_freeDStream(m_stream);
+        }
+
+        data_buffer process(const uint8_t* input, size_t input_size, bool) override
+        {
+            if (m_error || input == nullptr || input_size == 0)
+            {
+                return data_buffer();
+            }
+
+            uint8_t temp_buffer[codec_buffer_size];
+
+            data_buffer output;
+            output.reserve(input_size * 3);
+
+            ZSTD_inBuffer in = { input, input_size, 0 };
+            ZSTD_outBuffer out;
+            do
+            {
+                out = { temp_buffer, codec_buffer_size, 0 };
+                const auto hint = ZSTD_decompressStream(m_stream, &out, &in);
+                if (ZSTD_isError(hint))
                 {
-                    stream().avail_in = static_cast<int>(available_input);
-                    stream().next_in = const_cast<uint8_t*>(&input[input_offset]);
+                    m_error = true;
+                    return data_buffer();
                 }
+                // Zero means a frame was fully decoded and flushed.
+                m_frame_complete = hint == 0;
+                output.insert(output.end(), temp_buffer, temp_buffer + out.pos);
+            } while (in.pos < in.size || out.pos == out.size);
 
-                do
-                {
-                    stream().next_out = temp_buffer;
-                    stream().avail_out = BUFFER_SIZE;
+            return output;
+        }
 
-                    set_state(deflate(&stream(), flush));
+        bool has_error() const override
+        {
+            return m_error;
+        }
 
-                    if (has_error())
-                    {
-                        return data_buffer();
-                    }
+        bool is_complete() const override
+        {
+            return m_frame_complete;
+        }
 
-                    input_offset = read_output(input_offset, available_input, total_out_before, temp_buffer, output);
+    private:
+        ZSTD_DStream* m_stream;
+        bool m_error;
+        bool m_frame_complete;
+    };
 
-                } while (stream().avail_out == 0);
+    class zstd_compressor final : public compression_codec
+    {
+    public:
+        zstd_compressor() : m_context(ZSTD_createCCtx()), m_error(m_context == nullptr), m_finished(false)
+        {
+        }
+
+        ~zstd_compressor()
+        {
+            ZSTD_freeCCtx(m_context);
+        }
+
+        data_buffer process(const uint8_t* input, size_t input_size, bool finish) override
+        {
+            if (m_error || m_finished)
+            {
+                m_error = true;
+                return data_buffer();
             }
 
+            uint8_t temp_buffer[codec_buffer_size];
+
+            data_buffer output;
+            output.reserve(input_size / 2 + 64);
+
+            ZSTD_inBuffer in = { input, input_size, 0 };
+            const auto directive = finish ? ZSTD_e_end : ZSTD_e_continue;
+            size_t remaining = 0;
+            ZSTD_outBuffer out;
+            do
+            {
+                out = { temp_buffer, codec_buffer_size, 0 };
+                remaining = ZSTD_compressStream2(m_context, &out, &in, directive);
+                if (ZSTD_isError(remaining))
+                {
+                    m_error = true;
+                    return data_buffer();
+                }
+                output.insert(output.end(), temp_buffer, temp_buffer + out.pos);
+            } while (in.pos < in.size || out.pos == out.size || (finish && remaining != 0));
+
+            m_finished = finish;
             return output;
         }
 
-        ~stream_compressor_impl()
+        bool has_error() const override
         {
-            deflateEnd(&stream());
+            return m_error;
+        }
+
+        bool is_complete() const override
+        {
+            return m_finished;
+        }
+
+    private:
+        ZSTD_CCtx* m_context;
+        bool m_error;
+        bool m_finished;
+    };
+#endif // defined(CPPREST_HTTP_COMPRESSION_ZSTD)
+
+    std::unique_ptr<compression_codec> make_decompression_codec(compression_algorithm alg)
+    {
+        switch (alg)
+        {
+        case compression_algorithm::gzip:
+        case compression_algorithm::deflate:
+            return std::unique_ptr<compression_codec>(new zlib_decompressor(alg));
+#if defined(CPPREST_HTTP_COMPRESSION_ZSTD)
+        case compression_algorithm::zstd:
+            return std::unique_ptr<compression_codec>(new zstd_decompressor());
+#endif
+        default:
+            return nullptr;
+        }
+    }
+
+    std::unique_ptr<compression_codec> make_compression_codec(compression_algorithm alg)
+    {
+        switch (alg)
+        {
+        case compression_algorithm::gzip:
+        case compression_algorithm::deflate:
+            return std::unique_ptr<compression_codec>(new zlib_compressor(alg));
+#if defined(CPPREST_HTTP_COMPRESSION_ZSTD)
+        case compression_algorithm::zstd:
+            return std::unique_ptr<compression_codec>(new zstd_compressor());
+#endif
+        default:
+            return nullptr;
+        }
+    }
+
+    class stream_decompressor::stream_decompressor_impl
+    {
+    public:
+        stream_decompressor_impl(compression_algorithm alg) : m_codec(make_decompression_codec(alg)), m_has_input(false) {}
+
+        data_buffer decompress(const uint8_t* input, size_t input_size)
+        {
+            m_has_input = m_has_input || input_size != 0;
+            return m_codec ? m_codec->process(input, input_size, false) : data_buffer();
+        }
+
+        bool has_error() const
+        {
+            return !m_codec || m_codec->has_error();
+        }
+
+        bool is_complete() const
+        {
+            return m_codec && (!m_has_input || m_codec->is_complete());
+        }
+
+    private:
+        std::unique_ptr<compression_codec> m_codec;
+        bool m_has_input;
+    };
+
+    class stream_compressor::stream_compressor_impl
+    {
+    public:
+        stream_compressor_impl(compression_algorithm alg) : m_codec(make_compression_codec(alg)) {}
+
+        data_buffer compress(const uint8_t* input, size_t input_size, bool finish)
+        {
+            return m_codec ? m_codec->process(input, input_size, finish) : data_buffer();
         }
+
+        bool has_error() const
+        {
+            return !m_codec || m_codec->has_error();
+        }
+
+    private:
+        std::unique_ptr<compression_codec> m_codec;
     };
 #else // Stub impl for when compression is not supported
 
@@ -386,6 +584,11 @@ namespace compression
         {
             return true;
         }
+
+        bool is_complete() const
+        {
+            return false;
+        }
     };
 
     class stream_compressor::stream_compressor_impl : public compression_base_impl
@@ -409,6 +612,35 @@ namespace compression
     };
 #endif
 
+    utility::string_t __cdecl supported_encodings()
+    {
+#if defined(CPPREST_HTTP_COMPRESSION_ZSTD)
+        return _XPLATSTR("zstd, gzip, deflate");
+#elif defined(CPPREST_HTTP_COMPRESSION)
+        return _XPLATSTR("gzip, deflate");
+#else
+        return utility::string_t();
+#endif
+    }
+
+    static bool is_algorithm_supported(compression_algorithm alg)
+    {
+        switch (alg)
+        {
+#if defined(CPPREST_HTTP_COMPRESSION)
+        case compression_algorithm::gzip:
+        case compression_algorithm::deflate:
+            return true;
+#endif
+#if defined(CPPREST_HTTP_COMPRESSION_ZSTD)
+        case compression_algorithm::zstd:
+            return true;
+#endif
+        default:
+            return false;
+        }
+    }
+
     bool __cdecl stream_decompressor::is_supported()
     {
 #if !defined(CPPREST_HTTP_COMPRESSION)
@@ -418,6 +650,11 @@ namespace compression
 #endif
     }
 
+    bool __cdecl stream_decompressor::is_supported(compression_algorithm alg)
+    {
+        return is_algorithm_supported(alg);
+    }
+
     stream_decompressor::stream_decompressor(compression_algorithm alg)
         : m_pimpl(std::make_shared<stream_decompressor::stream_decompressor_impl>(alg))
     {
@@ -443,6 +680,11 @@ namespace compression
         return m_pimpl->has_error();
     }
 
+    bool stream_decompressor::is_complete() const
+    {
+        return m_pimpl->is_complete();
+    }
+
     bool __cdecl stream_compressor::is_supported()
     {
 #if !defined(CPPREST_HTTP_COMPRESSION)
@@ -452,6 +694,11 @@ namespace compression
 #endif
     }
 
+    bool __cdecl stream_compressor::is_supported(compression_algorithm alg)
+    {
+        return is_algorithm_supported(alg);
+    }
+
     stream_compressor::stream_compressor(compression_algorithm alg)
         : m_pimpl(std::make_shared<stream_compressor::stream_compressor_impl>(alg))
     {
@@ -460,12 +707,12 @@ namespace compression
 
     compression::data_buffer stream_compressor::compress(const data_buffer& input, bool finish)
     {
-        if (input.empty())
+        if (input.empty() && !finish)
         {
             return compression::data_buffer();
         }
 
-        return m_pimpl->compress(&input[0], input.size(), finish);
+        return m_pimpl->compress(input.data(), input.size(), finish);
     }
 
     web::http::details::compression::data_buffer stream_compressor::compress(const uint8_t* input, size_t input_size, bool finish)
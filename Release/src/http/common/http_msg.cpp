@@ -11,8 +11,10 @@
 * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 ****/
 #include "stdafx.h"
-#include "..\..\include\cpprest\details\internal_http_helpers.h"
+#include "cpprest/details/internal_http_helpers.h"
+#if defined(_WIN32)
 #include <pplinterface.h>
+#endif
 
 #undef min
 #undef max
@@ -350,7 +352,7 @@ std::shared_ptr<details::_http_request> _http_request::_request_impl_from_this()
 void details::_http_request::register_request_aborter()
 {
 	if (m_cancellationToken.is_canceled())
-		throw task_canceled("_http_request task cancelled");
+		throw pplx::task_canceled("_http_request task cancelled");
 	if (!m_cancellationToken.is_cancelable())
 		return;
 	m_cancellationToken.register_callback([m_cancellationToken = m_cancellationToken, this_ = weak_from_this()]
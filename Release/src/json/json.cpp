@@ -36,119 +36,96 @@ utility::istream_t& web::json::operator >> (utility::istream_t &is, json::value
     return is;
 }
 
-web::json::value::value() :
-    m_value(utility::details::make_unique<web::json::details::_Null>())
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-    ,m_kind(value::Null)
-#endif
-    { }
+web::json::value::value() { }
 
-web::json::value::value(int32_t value) :
-    m_value(utility::details::make_unique<web::json::details::_Number>(value))
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-    ,m_kind(value::Number)
-#endif
-    { }
+web::json::value::value(int32_t value) : m_number(value) { }
 
-web::json::value::value(uint32_t value) :
-    m_value(utility::details::make_unique<web::json::details::_Number>(value))
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-    ,m_kind(value::Number)
-#endif
-    { }
+web::json::value::value(uint32_t value) : m_number(value) { }
 
-web::json::value::value(int64_t value) :
-    m_value(utility::details::make_unique<web::json::details::_Number>(value))
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-    ,m_kind(value::Number)
-#endif
-    { }
+web::json::value::value(int64_t value) : m_number(value) { }
 
-web::json::value::value(uint64_t value) :
-    m_value(utility::details::make_unique<web::json::details::_Number>(value))
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-    ,m_kind(value::Number)
-#endif
-    { }
+web::json::value::value(uint64_t value) : m_number(value) { }
 
-web::json::value::value(double value) :
-    m_value(utility::details::make_unique<web::json::details::_Number>(value))
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-    ,m_kind(value::Number)
-#endif
-    { }
+web::json::value::value(double value) : m_number(value) { }
 
-web::json::value::value(bool value) :
-    m_value(utility::details::make_unique<web::json::details::_Boolean>(value))
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-    ,m_kind(value::Boolean)
-#endif
-    { }
+web::json::value::value(bool value)
+{
+    m_number.m_bool = value;
+    m_number.m_type = json::number::boolean_type;
+}
 
 web::json::value::value(utility::string_t value) :
-    m_value(utility::details::make_unique<web::json::details::_String>(std::move(value)))
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-    ,m_kind(value::String)
-#endif
+    web::json::value(new web::json::details::_String(std::move(value)))
     { }
 
 web::json::value::value(utility::string_t value, bool has_escape_chars) :
-m_value(utility::details::make_unique<web::json::details::_String>(std::move(value), has_escape_chars))
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-, m_kind(value::String)
-#endif
-{ }
+    web::json::value(new web::json::details::_String(std::move(value), has_escape_chars))
+    { }
 
 web::json::value::value(const utility::char_t* value) :
-    m_value(utility::details::make_unique<web::json::details::_String>(value))
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-    ,m_kind(value::String)
-#endif
+    web::json::value(new web::json::details::_String(value))
     { }
 
 web::json::value::value(const utility::char_t* value, bool has_escape_chars) :
-m_value(utility::details::make_unique<web::json::details::_String>(utility::string_t(value), has_escape_chars))
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-, m_kind(value::String)
-#endif
-{ }
+    web::json::value(new web::json::details::_String(utility::string_t(value), has_escape_chars))
+    { }
 
 web::json::value::value(const value &other) :
-    m_value(other.m_value->_copy_value())
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-    ,m_kind(other.m_kind)
-#endif
-    { }
+    m_number(other.m_number)
+{
+    switch (m_number.m_type)
+    {
+    case json::number::string_type:
+        m_number.m_string = new details::_String(*other.m_number.m_string);
+        break;
+    case json::number::object_type:
+        m_number.m_object = new details::_Object(*other.m_number.m_object);
+        break;
+    case json::number::array_type:
+        m_number.m_array = new details::_Array(*other.m_number.m_array);
+        break;
+    default:
+        break;
+    }
+}
 
 web::json::value &web::json::value::operator=(const value &other)
 {
     if(this != &other)
     {
-        m_value = std::unique_ptr<details::_Value>(other.m_value->_copy_value());
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-        m_kind = other.m_kind;
-#endif
+        *this = value(other);
     }
     return *this;
 }
 
 web::json::value::value(value &&other) CPPREST_NOEXCEPT :
-    m_value(std::move(other.m_value))
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-    ,m_kind(other.m_kind)
-#endif
-{}
+    m_number(other.m_number)
+{
+    other.m_number = json::number();
+}
 
 web::json::value &web::json::value::operator=(web::json::value &&other) CPPREST_NOEXCEPT
 {
-    if(this != &other)
+    std::swap(m_number, other.m_number);
+    return *this;
+}
+
+void web::json::value::release()
+{
+    switch (m_number.m_type)
     {
-        m_value.swap(other.m_value);
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-        m_kind = other.m_kind;
-#endif
+    case json::number::string_type:
+        delete m_number.m_string;
+        break;
+    case json::number::object_type:
+        delete m_number.m_object;
+        break;
+    case json::number::array_type:
+        delete m_number.m_array;
+        break;
+    default:
+        break;
     }
-    return *this;
 }
 
 web::json::value web::json::value::null()
@@ -188,124 +165,96 @@ web::json::value web::json::value::boolean(bool value)
 
 web::json::value web::json::value::string(utility::string_t value)
 {
-    std::unique_ptr<details::_Value> ptr = utility::details::make_unique<details::_String>(std::move(value));
-    return web::json::value(std::move(ptr)
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-            ,value::String
-#endif
-            );
+    return web::json::value(new details::_String(std::move(value)));
 }
 
 web::json::value web::json::value::string(utility::string_t value, bool has_escape_chars)
 {
-    std::unique_ptr<details::_Value> ptr = utility::details::make_unique<details::_String>(std::move(value), has_escape_chars);
-    return web::json::value(std::move(ptr)
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-            ,value::String
-#endif
-            );
+    return web::json::value(new details::_String(std::move(value), has_escape_chars));
 }
 
 #ifdef _WIN32
 web::json::value web::json::value::string(const std::string &value)
 {
-    std::unique_ptr<details::_Value> ptr = utility::details::make_unique<details::_String>(utility::conversions::to_utf16string(value));
-    return web::json::value(std::move(ptr)
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-            ,value::String
-#endif
-            );
+    return web::json::value(new details::_String(utility::conversions::to_utf16string(value)));
 }
 #endif
 
 web::json::value web::json::value::object(bool keep_order)
 {
-    std::unique_ptr<details::_Value> ptr = utility::details::make_unique<details::_Object>(keep_order);
-    return web::json::value(std::move(ptr)
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-            ,value::Object
-#endif
-            );
+    return web::json::value(new details::_Object(keep_order));
 }
 
 web::json::value web::json::value::object(std::vector<std::pair<::utility::string_t, value>> fields, bool keep_order)
 {
-    std::unique_ptr<details::_Value> ptr = utility::details::make_unique<details::_Object>(std::move(fields), keep_order);
-    return web::json::value(std::move(ptr)
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-            ,value::Object
-#endif
-            );
+    return web::json::value(new details::_Object(std::move(fields), keep_order));
 }
 
 web::json::value web::json::value::array()
 {
-    std::unique_ptr<details::_Value> ptr = utility::details::make_unique<details::_Array>();
-    return web::json::value(std::move(ptr)
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-            ,value::Array
-#endif
-            );
+    return web::json::value(new details::_Array());
 }
 
 web::json::value web::json::value::array(size_t size)
 {
-    std::unique_ptr<details::_Value> ptr = utility::details::make_unique<details::_Array>(size);
-    return web::json::value(std::move(ptr)
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-            ,value::Array
-#endif
-            );
+    return web::json::value(new details::_Array(size));
 }
 
 web::json::value web::json::value::array(std::vector<value> elements)
 {
-    std::unique_ptr<details::_Value> ptr = utility::details::make_unique<details::_Array>(std::move(elements));
-    return web::json::value(std::move(ptr)
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-            ,value::Array
-#endif
-            );
+    return web::json::value(new details::_Array(std::move(elements)));
 }
 
 const web::json::number& web::json::value::as_number() const
 {
-    return m_value->as_number();
+    if (!is_number())
+        throw json_exception(_XPLATSTR("not a number"));
+    return m_number;
 }
 
 double web::json::value::as_double() const
 {
-    return m_value->as_double();
+    return as_number().to_double();
 }
 
 int web::json::value::as_integer() const
 {
-    return m_value->as_integer();
+    return as_number().to_int32();
 }
 
 bool web::json::value::as_bool() const
 {
-    return m_value->as_bool();
+    if (!is_boolean())
+        throw json_exception(_XPLATSTR("not a boolean"));
+    return m_number.m_bool;
 }
 
 json::array& web::json::value::as_array()
 {
-    return m_value->as_array();
+    if (!is_array())
+        throw json_exception(_XPLATSTR("not an array"));
+    return m_number.m_array->m_array;
 }
 
 const json::array& web::json::value::as_array() const
 {
-    return m_value->as_array();
+    if (!is_array())
+        throw json_exception(_XPLATSTR("not an array"));
+    return m_number.m_array->m_array;
 }
 
 json::object& web::json::value::as_object()
 {
-    return m_value->as_object();
+    if (!is_object())
+        throw json_exception(_XPLATSTR("not an object"));
+    return m_number.m_object->m_object;
 }
 
 const json::object& web::json::value::as_object() const
 {
-    return m_value->as_object();
+    if (!is_object())
+        throw json_exception(_XPLATSTR("not an object"));
+    return m_number.m_object->m_object;
 }
 
 bool web::json::number::is_int32() const
@@ -355,34 +304,14 @@ bool web::json::details::_String::has_escape_chars(const _String &str)
     });
 }
 
-web::json::value::value_type json::value::type() const { return m_value->type(); }
-
 bool json::value::is_integer() const
 {
-    if(!is_number())
-    {
-        return false;
-    }
-    return m_value->is_integer();
+    return is_number() && m_number.is_integral();
 }
 
 bool json::value::is_double() const
 {
-    if(!is_number())
-    {
-        return false;
-    }
-    return m_value->is_double();
-}
-
-json::value& web::json::details::_Object::index(const utility::string_t &key)
-{
-    return m_object[key];
-}
-
-bool web::json::details::_Object::has_field(const utility::string_t &key) const
-{
-    return m_object.find(key) != m_object.end();
+    return is_number() && !m_number.is_integral();
 }
 
 bool web::json::value::has_number_field(const utility::string_t &key) const
@@ -422,35 +351,31 @@ bool web::json::value::has_object_field(const utility::string_t &key) const
 
 utility::string_t json::value::to_string() const
 {
-#ifndef _WIN32
-    utility::details::scoped_c_thread_locale locale;
-#endif
-    return m_value->to_string();
+    return serialize();
 }
 
 bool json::value::operator==(const json::value &other) const
 {
-    if (this->m_value.get() == other.m_value.get())
+    if (this == &other)
         return true;
     if (this->type() != other.type())
         return false;
 
-    switch(this->type())
+    switch(m_number.m_type)
     {
-    case Null:
+    case json::number::null_type:
         return true;
-    case Number:
-        return this->as_number() == other.as_number();
-    case Boolean:
-        return this->as_bool() == other.as_bool();
-    case String:
-        return this->as_string() == other.as_string();
-    case Object:
-        return static_cast<const json::details::_Object*>(this->m_value.get())->is_equal(static_cast<const json::details::_Object*>(other.m_value.get()));
-    case Array:
-        return static_cast<const json::details::_Array*>(this->m_value.get())->is_equal(static_cast<const json::details::_Array*>(other.m_value.get()));
+    case json::number::boolean_type:
+        return m_number.m_bool == other.m_number.m_bool;
+    case json::number::string_type:
+        return m_number.m_string->as_string() == other.m_number.m_string->as_string();
+    case json::number::object_type:
+        return m_number.m_object->is_equal(other.m_number.m_object);
+    case json::number::array_type:
+        return m_number.m_array->is_equal(other.m_number.m_array);
+    default:
+        return m_number == other.m_number;
     }
-    __assume(0);
 }
 
 void web::json::value::erase(size_t index)
@@ -488,24 +413,18 @@ web::json::value& web::json::value::operator [] (const utility::string_t &key)
 {
     if ( this->is_null() )
     {
-        m_value.reset(new web::json::details::_Object(details::g_keep_json_object_unsorted));
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-        m_kind = value::Object;
-#endif
+        *this = value(new web::json::details::_Object(details::g_keep_json_object_unsorted));
     }
-    return m_value->index(key);
+    return this->as_object()[key];
 }
 
 web::json::value& web::json::value::operator[](size_t index)
 {
     if ( this->is_null() )
     {
-        m_value.reset(new web::json::details::_Array());
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-        m_kind = value::Array;
-#endif
+        *this = value(new web::json::details::_Array());
     }
-    return m_value->index(index);
+    return this->as_array()[index];
 }
 
 // Remove once VS 2013 is no longer supported.
@@ -0,0 +1,435 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* HTTP Library: read-only JSON documents allocated from an arena
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "stdafx.h"
+#include <cstddef>
+#include <limits>
+#include "cpprest/json_document.h"
+
+#undef min
+#undef max
+
+using namespace web;
+using namespace web::json;
+
+namespace
+{
+    const size_t min_block_size = 4096;
+
+    // Keeps the blocks aligned for any node type after the link to the next block.
+    const size_t block_header_size = (sizeof(void*) + alignof(std::max_align_t) - 1) & ~(alignof(std::max_align_t) - 1);
+
+    uint32_t checked_size(size_t size)
+    {
+        if (size > static_cast<size_t>(std::numeric_limits<uint32_t>::max()))
+        {
+            throw json_exception(_XPLATSTR("JSON value too large for a document"));
+        }
+        return static_cast<uint32_t>(size);
+    }
+}
+
+namespace web { namespace json { namespace details
+{
+
+_Document_arena::_Document_arena(size_t initial_size)
+    : m_blocks(nullptr), m_cursor(nullptr), m_end(nullptr), m_next_size(std::max(initial_size, min_block_size)), m_reserved(0)
+{
+}
+
+_Document_arena::~_Document_arena()
+{
+    while (m_blocks != nullptr)
+    {
+        _Block* next = m_blocks->m_next;
+        ::operator delete(m_blocks);
+        m_blocks = next;
+    }
+}
+
+void* _Document_arena::allocate(size_t size, size_t alignment)
+{
+    uintptr_t start = (reinterpret_cast<uintptr_t>(m_cursor) + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    if (m_cursor == nullptr || start > reinterpret_cast<uintptr_t>(m_end) || size > static_cast<size_t>(reinterpret_cast<uintptr_t>(m_end) - start))
+    {
+        // Each block is as large as all the previous ones together, so a document needs few of them.
+        const size_t block_size = std::max(m_next_size, block_header_size + size + alignment);
+        _Block* block = static_cast<_Block*>(::operator new(block_size));
+        block->m_next = m_blocks;
+        m_blocks = block;
+        m_reserved += block_size;
+        m_next_size = m_reserved;
+
+        m_cursor = reinterpret_cast<char*>(block) + block_header_size;
+        m_end = reinterpret_cast<char*>(block) + block_size;
+        start = (reinterpret_cast<uintptr_t>(m_cursor) + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    }
+
+    m_cursor = reinterpret_cast<char*>(start + size);
+    return reinterpret_cast<void*>(start);
+}
+
+// Turns the reader events into document nodes. The children of the containers still open wait
+// on a scratch stack and are copied next to each other into the arena when their container ends.
+class _Document_builder : public json_handler
+{
+public:
+    explicit _Document_builder(size_t initial_size)
+        : m_arena(std::make_shared<_Document_arena>(initial_size)), m_name(nullptr), m_name_size(0)
+    {
+    }
+
+    virtual bool start_object() { return open(); }
+
+    virtual bool key(const utility::string_t &name)
+    {
+        m_name = copy_string(name, m_name_size);
+        return true;
+    }
+
+    virtual bool end_object()
+    {
+        _Document_node node = close(json::value::Object);
+        _Document_field* fields = m_arena->allocate_array<_Document_field>(node.m_size);
+        std::copy(m_stack.end() - node.m_size, m_stack.end(), fields);
+        node.m_fields = fields;
+        return pop_and_push(node);
+    }
+
+    virtual bool start_array() { return open(); }
+
+    virtual bool end_array()
+    {
+        _Document_node node = close(json::value::Array);
+        _Document_node* elements = m_arena->allocate_array<_Document_node>(node.m_size);
+        auto source = m_stack.end() - node.m_size;
+        for (uint32_t i = 0; i < node.m_size; ++i, ++source)
+        {
+            elements[i] = source->m_value;
+        }
+        node.m_elements = elements;
+        return pop_and_push(node);
+    }
+
+    virtual bool string_value(const utility::string_t &value)
+    {
+        _Document_node node = make_node(json::value::String);
+        node.m_string = copy_string(value, node.m_size);
+        return push(node);
+    }
+
+    virtual bool number_value(int64_t value)
+    {
+        _Document_node node = make_node(json::value::Number);
+        node.m_intval = value;
+        node.m_number_type = value < 0 ? _Document_node::signed_type : _Document_node::unsigned_type;
+        return push(node);
+    }
+
+    virtual bool number_value(uint64_t value)
+    {
+        _Document_node node = make_node(json::value::Number);
+        node.m_uintval = value;
+        node.m_number_type = _Document_node::unsigned_type;
+        return push(node);
+    }
+
+    virtual bool number_value(double value)
+    {
+        _Document_node node = make_node(json::value::Number);
+        node.m_double = value;
+        node.m_number_type = _Document_node::double_type;
+        return push(node);
+    }
+
+    virtual bool boolean_value(bool value)
+    {
+        _Document_node node = make_node(json::value::Boolean);
+        node.m_bool = value;
+        return push(node);
+    }
+
+    virtual bool null_value()
+    {
+        return push(make_node(json::value::Null));
+    }
+
+    document finish()
+    {
+        _ASSERTE(m_stack.size() == 1 && m_frames.empty());
+        _Document_node* root = m_arena->allocate_array<_Document_node>(1);
+        *root = m_stack.back().m_value;
+
+        document result;
+        result.m_arena = std::move(m_arena);
+        result.m_root = root;
+        return result;
+    }
+
+private:
+    struct _Frame
+    {
+        size_t m_start;
+        const utility::char_t* m_name;
+        uint32_t m_name_size;
+    };
+
+    static _Document_node make_node(json::value::value_type type)
+    {
+        _Document_node node;
+        node.m_uintval = 0;
+        node.m_size = 0;
+        node.m_type = static_cast<uint8_t>(type);
+        node.m_number_type = _Document_node::unsigned_type;
+        return node;
+    }
+
+    const utility::char_t* copy_string(const utility::string_t &str, uint32_t &size)
+    {
+        size = checked_size(str.size());
+        if (size == 0)
+        {
+            return nullptr;
+        }
+
+        utility::char_t* copy = m_arena->allocate_array<utility::char_t>(size);
+        std::char_traits<utility::char_t>::copy(copy, str.data(), size);
+        return copy;
+    }
+
+    bool push(const _Document_node &node)
+    {
+        _Document_field field;
+        field.m_name = m_name;
+        field.m_name_size = m_name_size;
+        field.m_value = node;
+        m_stack.push_back(field);
+        m_name = nullptr;
+        m_name_size = 0;
+        return true;
+    }
+
+    bool open()
+    {
+        _Frame frame;
+        frame.m_start = m_stack.size();
+        frame.m_name = m_name;
+        frame.m_name_size = m_name_size;
+        m_frames.push_back(frame);
+        m_name = nullptr;
+        m_name_size = 0;
+        return true;
+    }
+
+    _Document_node close(json::value::value_type type)
+    {
+        _Document_node node = make_node(type);
+        node.m_size = checked_size(m_stack.size() - m_frames.back().m_start);
+        return node;
+    }
+
+    bool pop_and_push(const _Document_node &node)
+    {
+        m_stack.resize(m_frames.back().m_start);
+        m_name = m_frames.back().m_name;
+        m_name_size = m_frames.back().m_name_size;
+        m_frames.pop_back();
+        return push(node);
+    }
+
+    std::shared_ptr<_Document_arena> m_arena;
+    std::vector<_Document_field> m_stack;
+    std::vector<_Frame> m_frames;
+    const utility::char_t* m_name;
+    uint32_t m_name_size;
+};
+
+}}}
+
+json::number document_value::as_number() const
+{
+    if (!is_number())
+    {
+        throw json_exception(_XPLATSTR("not a number"));
+    }
+
+    switch (m_node->m_number_type)
+    {
+    case details::_Document_node::signed_type:
+        return json::number(m_node->m_intval);
+    case details::_Document_node::unsigned_type:
+        return json::number(m_node->m_uintval);
+    case details::_Document_node::double_type:
+    default:
+        return json::number(m_node->m_double);
+    }
+}
+
+bool document_value::as_bool() const
+{
+    if (!is_boolean())
+    {
+        throw json_exception(_XPLATSTR("not a boolean"));
+    }
+    return m_node->m_bool;
+}
+
+document_value::string_view_t document_value::as_string() const
+{
+    if (!is_string())
+    {
+        throw json_exception(_XPLATSTR("not a string"));
+    }
+    return string_view_t(m_node->m_string, m_node->m_size);
+}
+
+document_value document_value::at(size_t index) const
+{
+    if (!is_array())
+    {
+        throw json_exception(_XPLATSTR("not an array"));
+    }
+    if (index >= m_node->m_size)
+    {
+        throw json_exception(_XPLATSTR("index out of bounds"));
+    }
+    return document_value(m_node->m_elements + index);
+}
+
+const web::json::details::_Document_field* document_value::find_field(string_view_t key) const
+{
+    if (!is_object())
+    {
+        return nullptr;
+    }
+
+    const details::_Document_field* const end = m_node->m_fields + m_node->m_size;
+    for (const details::_Document_field* field = m_node->m_fields; field != end; ++field)
+    {
+        if (string_view_t(field->m_name, field->m_name_size) == key)
+        {
+            return field;
+        }
+    }
+    return nullptr;
+}
+
+document_value document_value::at(string_view_t key) const
+{
+    if (!is_object())
+    {
+        throw json_exception(_XPLATSTR("not an object"));
+    }
+
+    const details::_Document_field* field = find_field(key);
+    if (field == nullptr)
+    {
+        throw json_exception(_XPLATSTR("Key not found"));
+    }
+    return document_value(&field->m_value);
+}
+
+bool document_value::has_field(string_view_t key) const
+{
+    return find_field(key) != nullptr;
+}
+
+document_value::string_view_t document_value::field_name(size_t index) const
+{
+    if (!is_object())
+    {
+        throw json_exception(_XPLATSTR("not an object"));
+    }
+    if (index >= m_node->m_size)
+    {
+        throw json_exception(_XPLATSTR("index out of bounds"));
+    }
+    return string_view_t(m_node->m_fields[index].m_name, m_node->m_fields[index].m_name_size);
+}
+
+document_value document_value::field_value(size_t index) const
+{
+    if (!is_object())
+    {
+        throw json_exception(_XPLATSTR("not an object"));
+    }
+    if (index >= m_node->m_size)
+    {
+        throw json_exception(_XPLATSTR("index out of bounds"));
+    }
+    return document_value(&m_node->m_fields[index].m_value);
+}
+
+json::value document_value::to_value() const
+{
+    switch (type())
+    {
+    case json::value::Boolean:
+        return json::value::boolean(m_node->m_bool);
+    case json::value::Number:
+        switch (m_node->m_number_type)
+        {
+        case details::_Document_node::signed_type:
+            return json::value::number(m_node->m_intval);
+        case details::_Document_node::unsigned_type:
+            return json::value::number(m_node->m_uintval);
+        case details::_Document_node::double_type:
+        default:
+            return json::value::number(m_node->m_double);
+        }
+    case json::value::String:
+        return json::value::string(utility::string_t(m_node->m_string, m_node->m_size));
+    case json::value::Array:
+        {
+            std::vector<json::value> elements;
+            elements.reserve(m_node->m_size);
+            for (uint32_t i = 0; i < m_node->m_size; ++i)
+            {
+                elements.push_back(document_value(m_node->m_elements + i).to_value());
+            }
+            return json::value::array(std::move(elements));
+        }
+    case json::value::Object:
+        {
+            std::vector<std::pair<utility::string_t, json::value>> fields;
+            fields.reserve(m_node->m_size);
+            for (uint32_t i = 0; i < m_node->m_size; ++i)
+            {
+                const details::_Document_field& field = m_node->m_fields[i];
+                fields.emplace_back(utility::string_t(field.m_name, field.m_name_size), document_value(&field.m_value).to_value());
+            }
+            return json::value::object(std::move(fields), details::g_keep_json_object_unsorted);
+        }
+    case json::value::Null:
+    default:
+        return json::value::null();
+    }
+}
+
+document document::parse(const utility::string_t &value)
+{
+    // Names and strings never outgrow the input, the nodes mostly fit in as much again.
+    details::_Document_builder builder(value.size() * sizeof(utility::char_t) * 2);
+    json_reader::read(value, builder);
+    return builder.finish();
+}
+
+pplx::task<document> document::parse(concurrency::streams::istream stream)
+{
+    const size_t initial_size = json_reader::default_chunk_size;
+    auto builder = std::make_shared<details::_Document_builder>(initial_size);
+    return json_reader::read(stream, *builder).then([builder](bool)
+    {
+        return builder->finish();
+    });
+}
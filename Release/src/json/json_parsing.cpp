@@ -13,8 +13,16 @@
 
 #include "stdafx.h"
 #include <cstdlib>
+#include "cpprest/metrics.h"
+#include "cpprest/json_reader.h"
+
+#if !defined(CPPREST_EXCLUDE_JSON_SIMD) && (defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__))
+#include <emmintrin.h>
+#define CPPREST_JSON_SSE2
+#endif
 
 #if defined(_MSC_VER)
+#include <intrin.h>
 #pragma warning(disable : 4127) // allow expressions like while(true) pass
 #endif
 using namespace web;
@@ -126,13 +134,7 @@ public:
         utility::details::scoped_c_thread_locale locale;
 #endif
 
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-        auto _value = _ParseValue(first);
-        auto type = _value->type();
-        return web::json::value(std::move(_value), type);
-#else
-        return web::json::value(_ParseValue(first));
-#endif
+        return _ParseValue(first);
     }
 
 protected:
@@ -142,6 +144,7 @@ protected:
 
     virtual bool CompleteComment(Token &token);
     virtual bool CompleteStringLiteral(Token &token);
+    virtual int_type EatWhitespace();
     bool handle_unescape_char(Token &token);
 
 private:
@@ -151,14 +154,12 @@ private:
     bool CompleteKeywordTrue(Token &token);
     bool CompleteKeywordFalse(Token &token);
     bool CompleteKeywordNull(Token &token);
-    std::unique_ptr<web::json::details::_Value> _ParseValue(typename JSON_Parser<CharType>::Token &first);
-    std::unique_ptr<web::json::details::_Value> _ParseObject(typename JSON_Parser<CharType>::Token &tkn);
-    std::unique_ptr<web::json::details::_Value> _ParseArray(typename JSON_Parser<CharType>::Token &tkn);
+    web::json::value _ParseValue(typename JSON_Parser<CharType>::Token &first);
+    web::json::value _ParseObject(typename JSON_Parser<CharType>::Token &tkn);
+    web::json::value _ParseArray(typename JSON_Parser<CharType>::Token &tkn);
 
     JSON_Parser& operator=(const JSON_Parser&);
 
-    int_type EatWhitespace();
-
     void CreateToken(typename JSON_Parser<CharType>::Token& tk, typename Token::Kind kind, Location &start)
     {
         tk.kind = kind;
@@ -215,6 +216,92 @@ private:
     typename std::basic_streambuf<CharType, std::char_traits<CharType>>* m_streambuf;
 };
 
+// Index of the lowest set bit of a non-zero mask.
+inline unsigned long LowestBit(unsigned int mask)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward(&index, mask);
+    return index;
+#else
+    return static_cast<unsigned long>(__builtin_ctz(mask));
+#endif
+}
+
+// Finds the first character in [first, last) that ends a plain run of a string literal:
+// a quote, a backslash, a control character or one that reads as the end of the input
+// (a 0xFF byte or a 0xFFFF code unit). Returns last if there is none.
+template <typename CharType>
+const CharType* FindStringDelimiter(const CharType* first, const CharType* last)
+{
+    for (; first != last; ++first)
+    {
+        const auto ch = static_cast<typename std::make_unsigned<CharType>::type>(*first);
+        if (ch == '"' || ch == '\\' || ch < 0x20 || static_cast<typename std::char_traits<CharType>::int_type>(*first) == eof<CharType>())
+            break;
+    }
+    return first;
+}
+
+#ifdef CPPREST_JSON_SSE2
+// The same scan, 16 bytes at a time. Bytes of multi-byte UTF-8 sequences are never delimiters.
+template <>
+inline const char* FindStringDelimiter(const char* first, const char* last)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1F);
+    const __m128i ones = _mm_set1_epi8(-1);
+    for (; last - first >= 16; first += 16)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        // A byte is a control character when subtracting 0x1F with unsigned saturation leaves zero.
+        const __m128i found = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(chunk, quote), _mm_cmpeq_epi8(chunk, backslash)),
+            _mm_or_si128(_mm_cmpeq_epi8(_mm_subs_epu8(chunk, control), _mm_setzero_si128()), _mm_cmpeq_epi8(chunk, ones)));
+        const int mask = _mm_movemask_epi8(found);
+        if (mask != 0)
+            return first + LowestBit(static_cast<unsigned int>(mask));
+    }
+    for (; first != last; ++first)
+    {
+        const unsigned char ch = static_cast<unsigned char>(*first);
+        if (ch == '"' || ch == '\\' || ch < 0x20 || ch == 0xFF)
+            break;
+    }
+    return first;
+}
+
+#ifdef _UTF16_STRINGS
+// The same scan over UTF-16 code units, 8 at a time.
+template <>
+inline const utf16char* FindStringDelimiter(const utf16char* first, const utf16char* last)
+{
+    const __m128i quote = _mm_set1_epi16('"');
+    const __m128i backslash = _mm_set1_epi16('\\');
+    const __m128i control = _mm_set1_epi16(0x1F);
+    const __m128i ones = _mm_set1_epi16(-1);
+    for (; last - first >= 8; first += 8)
+    {
+        const __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(first));
+        const __m128i found = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi16(chunk, quote), _mm_cmpeq_epi16(chunk, backslash)),
+            _mm_or_si128(_mm_cmpeq_epi16(_mm_subs_epu16(chunk, control), _mm_setzero_si128()), _mm_cmpeq_epi16(chunk, ones)));
+        // Two mask bits per code unit.
+        const int mask = _mm_movemask_epi8(found);
+        if (mask != 0)
+            return first + LowestBit(static_cast<unsigned int>(mask)) / 2;
+    }
+    for (; first != last; ++first)
+    {
+        if (*first == '"' || *first == '\\' || *first < 0x20 || *first == 0xFFFF)
+            break;
+    }
+    return first;
+}
+#endif
+#endif
+
 template <typename CharType>
 class JSON_StringParser : public JSON_Parser<CharType>
 {
@@ -233,6 +320,7 @@ protected:
 
     virtual bool CompleteComment(typename JSON_Parser<CharType>::Token &token);
     virtual bool CompleteStringLiteral(typename JSON_Parser<CharType>::Token &token);
+    virtual typename JSON_Parser<CharType>::int_type EatWhitespace();
 
 private:
     bool finish_parsing_string_with_unescape_char(typename JSON_Parser<CharType>::Token &token);
@@ -312,6 +400,35 @@ typename JSON_Parser<CharType>::int_type JSON_Parser<CharType>::EatWhitespace()
    return ch;
 }
 
+template <typename CharType>
+typename JSON_Parser<CharType>::int_type JSON_StringParser<CharType>::EatWhitespace()
+{
+    // Same as the generic version, without a virtual call per character.
+    while (m_position != m_endpos)
+    {
+        const CharType ch = *m_position;
+        if (ch == ' ' || ch == '\t' || ch == '\r')
+        {
+            this->m_currentColumn += 1;
+        }
+        else if (ch == '\n')
+        {
+            this->m_currentLine += 1;
+            this->m_currentColumn = 0;
+        }
+        else if (!iswspace(static_cast<wint_t>(ch)))
+        {
+            return JSON_StringParser<CharType>::NextCharacter();
+        }
+        else
+        {
+            this->m_currentColumn += 1;
+        }
+        ++m_position;
+    }
+    return eof<CharType>();
+}
+
 template <typename CharType>
 bool JSON_Parser<CharType>::CompleteKeywordTrue(Token &token)
 {
@@ -813,47 +930,34 @@ template <typename CharType>
 bool JSON_StringParser<CharType>::CompleteStringLiteral(typename JSON_Parser<CharType>::Token &token)
 {
     // This function is specialized for the string parser, since we can be slightly more
-    // efficient in copying data from the input to the token: do a memcpy() rather than
-    // one character at a time.
+    // efficient in copying data from the input to the token: find the end of each run of
+    // plain characters with a vectorized scan and append the run at once.
 
-    auto start = m_position;
     token.has_unescape_symbol = false;
 
-    auto ch = JSON_StringParser<CharType>::NextCharacter();
-
-    while (ch != '"')
+    while (true)
     {
-        if (ch == eof<CharType>())
-            return false;
+        const CharType* start = m_position;
+        m_position = FindStringDelimiter(start, m_endpos);
 
-        if (ch == '\\')
-        {
-            const size_t numChars = m_position - start - 1;
-            const size_t prevSize = token.string_val.size();
-            token.string_val.resize(prevSize + numChars);
-            memcpy(const_cast<CharType *>(token.string_val.c_str() + prevSize), start, numChars * sizeof(CharType));
+        // Runs never contain a newline, since control characters end them.
+        const size_t numChars = m_position - start;
+        this->m_currentColumn += numChars;
+        token.string_val.append(start, numChars);
 
-            if (!JSON_StringParser<CharType>::handle_unescape_char(token))
-            {
-                return false;
-            }
+        const auto ch = JSON_StringParser<CharType>::NextCharacter();
+        if (ch == '"')
+            break;
 
-            // Reset start position and continue.
-            start = m_position;
-        }
-        else if (ch >= CharType(0x0) && ch < CharType(0x20))
+        if (ch != '\\')
+            return false; // The end of the input or a control character.
+
+        if (!JSON_StringParser<CharType>::handle_unescape_char(token))
         {
             return false;
         }
-
-        ch = JSON_StringParser<CharType>::NextCharacter();
     }
 
-    const size_t numChars = m_position - start - 1;
-    const size_t prevSize = token.string_val.size();
-    token.string_val.resize(prevSize + numChars);
-    memcpy(const_cast<CharType *>(token.string_val.c_str() + prevSize), start, numChars * sizeof(CharType));
-
     token.kind = JSON_Parser<CharType>::Token::TKN_StringLiteral;
 
     return true;
@@ -961,10 +1065,11 @@ try_again:
 }
 
 template <typename CharType>
-std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseObject(typename JSON_Parser<CharType>::Token &tkn)
+web::json::value JSON_Parser<CharType>::_ParseObject(typename JSON_Parser<CharType>::Token &tkn)
 {
-    auto obj = utility::details::make_unique<web::json::details::_Object>(g_keep_json_object_unsorted);
-    auto& elems = obj->m_object.m_elements;
+    auto obj = web::json::value::object(g_keep_json_object_unsorted);
+    auto& fields = obj.as_object();
+    auto& elems = fields.m_elements;
 
     GetNextToken(tkn);
     if (tkn.m_error) goto error;
@@ -994,13 +1099,7 @@ std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseObject(
             if (tkn.m_error) goto error;
 
             // State 3: Looking for an expression.
-#ifdef ENABLE_JSON_VALUE_VISUALIZER
-            auto fieldValue = _ParseValue(tkn);
-            auto type = fieldValue->type();
-            elems.emplace_back(utility::conversions::to_string_t(std::move(fieldName)), json::value(std::move(fieldValue), type));
-#else
-            elems.emplace_back(utility::conversions::to_string_t(std::move(fieldName)), json::value(_ParseValue(tkn)));
-#endif
+            elems.emplace_back(utility::conversions::to_string_t(std::move(fieldName)), _ParseValue(tkn));
             if (tkn.m_error) goto error;
 
             // State 4: Looking for a comma or a closing brace
@@ -1020,64 +1119,66 @@ std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseObject(
 
 done:
     GetNextToken(tkn);
-    if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+    if (tkn.m_error) return web::json::value();
 
     if (!g_keep_json_object_unsorted) {
         ::std::sort(elems.begin(), elems.end(), json::object::compare_pairs);
     }
+    fields.reindex();
 
-    return std::move(obj);
+    return obj;
 
 error:
     if (!tkn.m_error)
     {
         SetErrorCode(tkn, json_error::malformed_object_literal);
     }
-    return utility::details::make_unique<web::json::details::_Null>();
+    return web::json::value();
 }
 
 template <typename CharType>
-std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseArray(typename JSON_Parser<CharType>::Token &tkn)
+web::json::value JSON_Parser<CharType>::_ParseArray(typename JSON_Parser<CharType>::Token &tkn)
 {
     GetNextToken(tkn);
-    if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+    if (tkn.m_error) return web::json::value();
 
-    auto result = utility::details::make_unique<web::json::details::_Array>();
+    auto result = web::json::value::array();
+    auto& elems = result.as_array().m_elements;
 
     if (tkn.kind != JSON_Parser<CharType>::Token::TKN_CloseBracket)
     {
         while (true)
         {
             // State 1: Looking for an expression.
-            result->m_array.m_elements.emplace_back(ParseValue(tkn));
-            if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+            elems.emplace_back(_ParseValue(tkn));
+            if (tkn.m_error) return web::json::value();
 
             // State 4: Looking for a comma or a closing bracket
             switch (tkn.kind)
             {
             case JSON_Parser<CharType>::Token::TKN_Comma:
                 GetNextToken(tkn);
-                if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+                if (tkn.m_error) return web::json::value();
                 break;
             case JSON_Parser<CharType>::Token::TKN_CloseBracket:
                 GetNextToken(tkn);
-                if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
-                return std::move(result);
+                if (tkn.m_error) return web::json::value();
+                return result;
             default:
                 SetErrorCode(tkn, json_error::malformed_array_literal);
-                return utility::details::make_unique<web::json::details::_Null>();
+                return web::json::value();
             }
         }
     }
 
     GetNextToken(tkn);
-    if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
+    if (tkn.m_error) return web::json::value();
 
-    return std::move(result);
+    return result;
 }
 
 template <typename CharType>
-std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseValue(typename JSON_Parser<CharType>::Token &tkn)
+web::json::value JSON_Parser<CharType>::_ParseValue(typename JSON_Parser<CharType>::Token &tkn)
 {
     switch (tkn.kind)
     {
@@ -1091,55 +1192,360 @@ std::unique_ptr<web::json::details::_Value> JSON_Parser<CharType>::_ParseValue(t
             }
         case JSON_Parser<CharType>::Token::TKN_StringLiteral:
             {
-                auto value = utility::details::make_unique<web::json::details::_String>(std::move(tkn.string_val), tkn.has_unescape_symbol);
+                web::json::value value(new web::json::details::_String(std::move(tkn.string_val), tkn.has_unescape_symbol));
                 GetNextToken(tkn);
-                if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
-                return std::move(value);
+                if (tkn.m_error) return web::json::value();
+                return value;
             }
         case JSON_Parser<CharType>::Token::TKN_IntegerLiteral:
             {
-                std::unique_ptr<web::json::details::_Number> value;
-                if (tkn.signed_number)
-                    value = utility::details::make_unique<web::json::details::_Number>(tkn.int64_val);
-                else
-                    value = utility::details::make_unique<web::json::details::_Number>(tkn.uint64_val);
-
+                web::json::value value = tkn.signed_number ? web::json::value(tkn.int64_val) : web::json::value(tkn.uint64_val);
                 GetNextToken(tkn);
-                if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
-                return std::move(value);
+                if (tkn.m_error) return web::json::value();
+                return value;
             }
         case JSON_Parser<CharType>::Token::TKN_NumberLiteral:
             {
-                auto value = utility::details::make_unique<web::json::details::_Number>(tkn.double_val);
+                web::json::value value(tkn.double_val);
                 GetNextToken(tkn);
-                if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
-                return std::move(value);
+                if (tkn.m_error) return web::json::value();
+                return value;
             }
         case JSON_Parser<CharType>::Token::TKN_BooleanLiteral:
             {
-                auto value = utility::details::make_unique<web::json::details::_Boolean>(tkn.boolean_val);
+                web::json::value value(tkn.boolean_val);
                 GetNextToken(tkn);
-                if (tkn.m_error) return utility::details::make_unique<web::json::details::_Null>();
-                return std::move(value);
+                if (tkn.m_error) return web::json::value();
+                return value;
             }
         case JSON_Parser<CharType>::Token::TKN_NullLiteral:
             {
                 GetNextToken(tkn);
                 // Returning a null value whether or not an error occurred.
-                return utility::details::make_unique<web::json::details::_Null>();
+                return web::json::value();
             }
         default:
             {
                 SetErrorCode(tkn, json_error::malformed_token);
-                return utility::details::make_unique<web::json::details::_Null>();
+                return web::json::value();
             }
     }
 }
 
+//
+// Event based reading
+//
+
+inline const utility::string_t& AsStringT(const utility::string_t& str, utility::string_t&)
+{
+    return str;
+}
+
+#ifdef _UTF16_STRINGS
+inline const utility::string_t& AsStringT(const std::string& str, utility::string_t& scratch)
+{
+    scratch = utility::conversions::to_string_t(str);
+    return scratch;
+}
+#endif
+
+// Checks the token sequence against the JSON grammar and turns it into handler events.
+// Only the kinds of the open containers are kept, so no recursion and no DOM is needed.
+template <typename CharType>
+class JSON_SaxDispatcher
+{
+public:
+    typedef typename JSON_Parser<CharType>::Token Token;
+
+    JSON_SaxDispatcher(json_handler& handler)
+        : m_handler(handler), m_state(ExpectValue)
+    { }
+
+    // Returns false when the handler stops the reading or the token is not valid here;
+    // in the latter case the token carries the error.
+    bool Accept(Token& tkn)
+    {
+        switch (m_state)
+        {
+        case ExpectKeyOrClose:
+            if (tkn.kind == Token::TKN_CloseBrace)
+                return Close();
+            // fall through
+        case ExpectKey:
+            if (tkn.kind != Token::TKN_StringLiteral)
+                return Fail(tkn, json_error::malformed_object_literal);
+            m_state = ExpectColon;
+            return m_handler.key(AsStringT(tkn.string_val, m_scratch));
+
+        case ExpectColon:
+            if (tkn.kind != Token::TKN_Colon)
+                return Fail(tkn, json_error::malformed_object_literal);
+            m_state = ExpectValue;
+            return true;
+
+        case ExpectValueOrClose:
+            if (tkn.kind == Token::TKN_CloseBracket)
+                return Close();
+            // fall through
+        case ExpectValue:
+            return Value(tkn);
+
+        case ExpectCommaOrClose:
+            if (tkn.kind == Token::TKN_Comma)
+            {
+                m_state = m_containers.back() == Token::TKN_OpenBrace ? ExpectKey : ExpectValue;
+                return true;
+            }
+            if (m_containers.back() == Token::TKN_OpenBrace)
+            {
+                return tkn.kind == Token::TKN_CloseBrace ? Close() : Fail(tkn, json_error::malformed_object_literal);
+            }
+            return tkn.kind == Token::TKN_CloseBracket ? Close() : Fail(tkn, json_error::malformed_array_literal);
+
+        case ExpectEnd:
+        default:
+            if (tkn.kind != Token::TKN_EOF)
+                return Fail(tkn, json_error::left_over_character_in_stream);
+            return true;
+        }
+    }
+
+private:
+    enum State
+    {
+        ExpectValue,
+        ExpectValueOrClose,
+        ExpectKey,
+        ExpectKeyOrClose,
+        ExpectColon,
+        ExpectCommaOrClose,
+        ExpectEnd
+    };
+
+    bool Value(Token& tkn)
+    {
+        switch (tkn.kind)
+        {
+        case Token::TKN_OpenBrace:
+            m_containers.push_back(tkn.kind);
+            m_state = ExpectKeyOrClose;
+            return m_handler.start_object();
+        case Token::TKN_OpenBracket:
+            m_containers.push_back(tkn.kind);
+            m_state = ExpectValueOrClose;
+            return m_handler.start_array();
+        case Token::TKN_StringLiteral:
+            ValueDone();
+            return m_handler.string_value(AsStringT(tkn.string_val, m_scratch));
+        case Token::TKN_IntegerLiteral:
+            ValueDone();
+            return tkn.signed_number ? m_handler.number_value(tkn.int64_val) : m_handler.number_value(tkn.uint64_val);
+        case Token::TKN_NumberLiteral:
+            ValueDone();
+            return m_handler.number_value(tkn.double_val);
+        case Token::TKN_BooleanLiteral:
+            ValueDone();
+            return m_handler.boolean_value(tkn.boolean_val);
+        case Token::TKN_NullLiteral:
+            ValueDone();
+            return m_handler.null_value();
+        default:
+            return Fail(tkn, json_error::malformed_token);
+        }
+    }
+
+    bool Close()
+    {
+        const bool object = m_containers.back() == Token::TKN_OpenBrace;
+        m_containers.pop_back();
+        ValueDone();
+        return object ? m_handler.end_object() : m_handler.end_array();
+    }
+
+    void ValueDone()
+    {
+        m_state = m_containers.empty() ? ExpectEnd : ExpectCommaOrClose;
+    }
+
+    bool Fail(Token& tkn, json_error error)
+    {
+        if (!tkn.m_error)
+        {
+            SetErrorCode(tkn, error);
+        }
+        return false;
+    }
+
+    JSON_SaxDispatcher& operator=(const JSON_SaxDispatcher&);
+
+    json_handler& m_handler;
+    State m_state;
+    std::vector<typename Token::Kind> m_containers;
+    utility::string_t m_scratch;
+};
+
+// Tokenizes input that arrives in pieces. A token cut by the end of the buffered input is
+// rolled back and read again once more input was appended, so the buffer only has to hold
+// the unread input and the token being read.
+template <typename CharType>
+class JSON_ChunkParser : public JSON_Parser<CharType>
+{
+public:
+    JSON_ChunkParser()
+        : m_position(0), m_final(false), m_starved(false)
+    {
+    }
+
+    // Number of characters buffered but not tokenized yet.
+    size_t Pending() const
+    {
+        return m_buffer.size() - m_position;
+    }
+
+    // Makes room for up to count more characters, dropping the ones already tokenized.
+    CharType* Prepare(size_t count)
+    {
+        m_buffer.erase(0, m_position);
+        m_position = 0;
+        const size_t size = m_buffer.size();
+        m_buffer.resize(size + count);
+        return &m_buffer[size];
+    }
+
+    // Keeps count of the characters made room for by Prepare; zero marks the end of the input.
+    void Commit(size_t count, size_t prepared)
+    {
+        m_buffer.resize(m_buffer.size() - prepared + count);
+        if (count == 0)
+        {
+            m_final = true;
+        }
+    }
+
+    // Returns false when the buffered input ends inside the next token.
+    bool TryGetNextToken(typename JSON_Parser<CharType>::Token& tkn)
+    {
+        // Whitespace is consumed up front so that long runs of it never stay buffered.
+        while (m_position != m_buffer.size() && iswspace(static_cast<wint_t>(std::char_traits<CharType>::to_int_type(m_buffer[m_position]))))
+        {
+            NextCharacter();
+        }
+
+        const size_t position = m_position;
+        const size_t line = this->m_currentLine;
+        const size_t column = this->m_currentColumn;
+        const size_t depth = this->m_currentParsingDepth;
+
+        m_starved = false;
+        this->GetNextToken(tkn);
+        if (!m_starved)
+            return true;
+
+        m_position = position;
+        this->m_currentLine = line;
+        this->m_currentColumn = column;
+        this->m_currentParsingDepth = depth;
+        tkn.m_error.clear();
+        return false;
+    }
+
+protected:
+
+    virtual typename JSON_Parser<CharType>::int_type NextCharacter()
+    {
+        if (m_position == m_buffer.size())
+        {
+            m_starved = !m_final;
+            return eof<CharType>();
+        }
+
+        const CharType ch = m_buffer[m_position++];
+
+        if (ch == '\n')
+        {
+            this->m_currentLine += 1;
+            this->m_currentColumn = 0;
+        }
+        else
+        {
+            this->m_currentColumn += 1;
+        }
+
+        return std::char_traits<CharType>::to_int_type(ch);
+    }
+
+    virtual typename JSON_Parser<CharType>::int_type PeekCharacter()
+    {
+        if (m_position == m_buffer.size())
+        {
+            m_starved = !m_final;
+            return eof<CharType>();
+        }
+
+        return std::char_traits<CharType>::to_int_type(m_buffer[m_position]);
+    }
+
+private:
+    std::basic_string<CharType> m_buffer;
+    size_t m_position;
+    bool m_final;
+    bool m_starved;
+};
+
 }}}
 
+namespace
+{
+    // Feeds the json.* metrics when a parse ends, successfully or not.
+    template <typename CharType>
+    class parse_metrics_scope
+    {
+    public:
+        typedef typename std::basic_streambuf<CharType>::pos_type pos_type;
+        typedef typename std::basic_streambuf<CharType>::off_type off_type;
+
+        explicit parse_metrics_scope(size_t length)
+            : m_length(length), m_streambuf(nullptr), m_start(off_type(-1)), m_started(std::chrono::steady_clock::now())
+        {
+        }
+
+        // Streams are measured from their read position, when they can report it.
+        explicit parse_metrics_scope(std::basic_streambuf<CharType>* streambuf)
+            : m_length(0), m_streambuf(streambuf), m_start(streambuf->pubseekoff(0, std::ios_base::cur, std::ios_base::in)), m_started(std::chrono::steady_clock::now())
+        {
+        }
+
+        // Adds input read after the scope started.
+        void consumed(size_t length)
+        {
+            m_length += length;
+        }
+
+        ~parse_metrics_scope()
+        {
+            auto& metrics = utility::metrics::library();
+            metrics.json_parse_duration.record(std::chrono::steady_clock::now() - m_started);
+            if (m_streambuf != nullptr && m_start != pos_type(off_type(-1)))
+            {
+                const auto end = m_streambuf->pubseekoff(0, std::ios_base::cur, std::ios_base::in);
+                if (end != pos_type(off_type(-1)))
+                    m_length = static_cast<size_t>(end - m_start);
+            }
+            metrics.json_documents_parsed.add();
+            metrics.json_bytes_parsed.add(static_cast<int64_t>(m_length * sizeof(CharType)));
+        }
+
+    private:
+        size_t m_length;
+        std::basic_streambuf<CharType>* m_streambuf;
+        pos_type m_start;
+        std::chrono::steady_clock::time_point m_started;
+    };
+}
+
 static web::json::value _parse_stream(utility::istream_t &stream)
 {
+    parse_metrics_scope<utility::char_t> metrics(stream.rdbuf());
     web::json::details::JSON_StreamParser<utility::char_t> parser(stream);
     web::json::details::JSON_Parser<utility::char_t>::Token tkn;
 
@@ -1163,6 +1569,7 @@ static web::json::value _parse_stream(utility::istream_t &stream)
 
 static web::json::value _parse_stream(utility::istream_t &stream, std::error_code& error)
 {
+    parse_metrics_scope<utility::char_t> metrics(stream.rdbuf());
     web::json::details::JSON_StreamParser<utility::char_t> parser(stream);
     web::json::details::JSON_Parser<utility::char_t>::Token tkn;
 
@@ -1186,6 +1593,7 @@ static web::json::value _parse_stream(utility::istream_t &stream, std::error_cod
 #ifdef _WIN32
 static web::json::value _parse_narrow_stream(std::istream &stream)
 {
+    parse_metrics_scope<char> metrics(stream.rdbuf());
     web::json::details::JSON_StreamParser<char> parser(stream);
     web::json::details::JSON_StreamParser<char>::Token tkn;
 
@@ -1209,6 +1617,7 @@ static web::json::value _parse_narrow_stream(std::istream &stream)
 
 static web::json::value _parse_narrow_stream(std::istream &stream, std::error_code& error)
 {
+    parse_metrics_scope<char> metrics(stream.rdbuf());
     web::json::details::JSON_StreamParser<char> parser(stream);
     web::json::details::JSON_StreamParser<char>::Token tkn;
 
@@ -1233,6 +1642,7 @@ static web::json::value _parse_narrow_stream(std::istream &stream, std::error_co
 
 web::json::value web::json::value::parse(const utility::string_t& str)
 {
+    parse_metrics_scope<utility::char_t> metrics(str.size());
     web::json::details::JSON_StringParser<utility::char_t> parser(str);
     web::json::details::JSON_Parser<utility::char_t>::Token tkn;
 
@@ -1256,6 +1666,7 @@ web::json::value web::json::value::parse(const utility::string_t& str)
 
 web::json::value web::json::value::parse(const utility::string_t& str, std::error_code& error)
 {
+    parse_metrics_scope<utility::char_t> metrics(str.size());
     web::json::details::JSON_StringParser<utility::char_t> parser(str);
     web::json::details::JSON_Parser<utility::char_t>::Token tkn;
 
@@ -1298,3 +1709,111 @@ web::json::value web::json::value::parse(std::istream& stream, std::error_code&
     return _parse_narrow_stream(stream, error);
 }
 #endif
+
+namespace
+{
+    // Tokenizes what the parser holds and dispatches it, until the input runs out or the reading ends.
+    // Returns true while more input is needed.
+    template <typename CharType>
+    bool _read_tokens(web::json::details::JSON_ChunkParser<CharType>& parser,
+                      web::json::details::JSON_SaxDispatcher<CharType>& dispatcher,
+                      typename web::json::details::JSON_Parser<CharType>::Token& tkn,
+                      bool& completed)
+    {
+#ifndef _WIN32
+        utility::details::scoped_c_thread_locale locale;
+#endif
+        while (parser.TryGetNextToken(tkn))
+        {
+            if (tkn.m_error)
+            {
+                web::json::details::CreateException(tkn, utility::conversions::to_string_t(tkn.m_error.message()));
+            }
+            if (!dispatcher.Accept(tkn))
+            {
+                if (tkn.m_error)
+                {
+                    web::json::details::CreateException(tkn, utility::conversions::to_string_t(tkn.m_error.message()));
+                }
+                return false;
+            }
+            if (tkn.kind == web::json::details::JSON_Parser<CharType>::Token::TKN_EOF)
+            {
+                completed = true;
+                return false;
+            }
+        }
+        return true;
+    }
+
+    struct _stream_read_state
+    {
+        _stream_read_state(web::json::json_handler& handler)
+            : metrics(size_t(0)), dispatcher(handler), completed(false)
+        {
+        }
+
+        parse_metrics_scope<char> metrics;
+        web::json::details::JSON_ChunkParser<char> parser;
+        web::json::details::JSON_SaxDispatcher<char> dispatcher;
+        web::json::details::JSON_Parser<char>::Token tkn;
+        bool completed;
+    };
+}
+
+pplx::task<bool> web::json::json_reader::read(concurrency::streams::istream stream, json_handler& handler, size_t chunk_size)
+{
+    if (chunk_size == 0)
+        throw std::invalid_argument("chunk_size must be greater than zero");
+
+    auto state = std::make_shared<_stream_read_state>(handler);
+    auto buffer = stream.streambuf();
+    return Concurrency::details::_do_while([state, buffer, chunk_size]() mutable -> pplx::task<bool>
+    {
+        // A token longer than a chunk is read again from its start after every chunk,
+        // so the request grows with it to keep that rereading linear.
+        const size_t count = (std::max)(chunk_size, state->parser.Pending());
+        auto target = reinterpret_cast<uint8_t*>(state->parser.Prepare(count));
+        return buffer.getn(target, count).then([state, count](size_t read)
+        {
+            state->parser.Commit(read, count);
+            state->metrics.consumed(read);
+            return _read_tokens(state->parser, state->dispatcher, state->tkn, state->completed);
+        });
+    }).then([state](bool)
+    {
+        return state->completed;
+    });
+}
+
+bool web::json::json_reader::read(const utility::string_t& value, json_handler& handler)
+{
+    parse_metrics_scope<utility::char_t> metrics(value.size());
+    web::json::details::JSON_StringParser<utility::char_t> parser(value);
+    web::json::details::JSON_SaxDispatcher<utility::char_t> dispatcher(handler);
+    web::json::details::JSON_Parser<utility::char_t>::Token tkn;
+
+#ifndef _WIN32
+    utility::details::scoped_c_thread_locale locale;
+#endif
+    while (true)
+    {
+        parser.GetNextToken(tkn);
+        if (tkn.m_error)
+        {
+            web::json::details::CreateException(tkn, utility::conversions::to_string_t(tkn.m_error.message()));
+        }
+        if (!dispatcher.Accept(tkn))
+        {
+            if (tkn.m_error)
+            {
+                web::json::details::CreateException(tkn, utility::conversions::to_string_t(tkn.m_error.message()));
+            }
+            return false;
+        }
+        if (tkn.kind == web::json::details::JSON_Parser<utility::char_t>::Token::TKN_EOF)
+        {
+            return true;
+        }
+    }
+}
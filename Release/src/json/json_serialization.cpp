@@ -33,13 +33,10 @@ void web::json::value::serialize(std::ostream& stream) const
 {
     // This has better performance than writing directly to stream.
     std::string str;
-    m_value->serialize_impl(str);
+    str.reserve(get_reserve_size());
+    format(str);
     stream << str;
 }
-void web::json::value::format(std::basic_string<wchar_t> &string) const
-{
-    m_value->format(string);
-}
 #endif
 
 void web::json::value::serialize(utility::ostream_t &stream) const
@@ -50,14 +47,73 @@ void web::json::value::serialize(utility::ostream_t &stream) const
 
     // This has better performance than writing directly to stream.
     utility::string_t str;
-    m_value->serialize_impl(str);
+    str.reserve(get_reserve_size());
+    format(str);
     stream << str;
 }
 
+size_t web::json::value::get_reserve_size() const
+{
+    switch (m_number.m_type)
+    {
+    case json::number::string_type: return m_number.m_string->get_reserve_size();
+    case json::number::object_type: return m_number.m_object->get_reserve_size();
+    case json::number::array_type: return m_number.m_array->get_reserve_size();
+    default: return 0;
+    }
+}
+
 void web::json::value::format(std::basic_string<char>& string) const
 {
-    m_value->format(string);
+    switch (m_number.m_type)
+    {
+    case json::number::null_type:
+        string.append("null");
+        break;
+    case json::number::boolean_type:
+        string.append(m_number.m_bool ? "true" : "false");
+        break;
+    case json::number::string_type:
+        m_number.m_string->format(string);
+        break;
+    case json::number::object_type:
+        m_number.m_object->format(string);
+        break;
+    case json::number::array_type:
+        m_number.m_array->format(string);
+        break;
+    default:
+        m_number.format(string);
+        break;
+    }
+}
+
+#ifdef _WIN32
+void web::json::value::format(std::basic_string<wchar_t> &string) const
+{
+    switch (m_number.m_type)
+    {
+    case json::number::null_type:
+        string.append(L"null");
+        break;
+    case json::number::boolean_type:
+        string.append(m_number.m_bool ? L"true" : L"false");
+        break;
+    case json::number::string_type:
+        m_number.m_string->format(string);
+        break;
+    case json::number::object_type:
+        m_number.m_object->format(string);
+        break;
+    case json::number::array_type:
+        m_number.m_array->format(string);
+        break;
+    default:
+        m_number.format(string);
+        break;
+    }
 }
+#endif
 
 template<typename CharType>
 void web::json::details::append_escape_string(std::basic_string<CharType>& str, const std::basic_string<CharType>& escaped)
@@ -147,9 +203,9 @@ void web::json::details::_String::format(std::basic_string<char>& str) const
     str.push_back('"');
 }
 
-void web::json::details::_Number::format(std::basic_string<char>& stream) const
+void web::json::number::format(std::basic_string<char>& stream) const
 {
-    if(m_number.m_type != number::type::double_type)
+    if(m_type != number::type::double_type)
     {
         // #digits + 1 to avoid loss + 1 for the sign + 1 for null terminator.
         const size_t tempSize = std::numeric_limits<uint64_t>::digits10 + 3;
@@ -157,18 +213,18 @@ void web::json::details::_Number::format(std::basic_string<char>& stream) const
 
 #ifdef _WIN32
         // This can be improved performance-wise if we implement our own routine
-        if (m_number.m_type == number::type::signed_type)
-            _i64toa_s(m_number.m_intval, tempBuffer, tempSize, 10);
+        if (m_type == number::type::signed_type)
+            _i64toa_s(m_intval, tempBuffer, tempSize, 10);
         else
-            _ui64toa_s(m_number.m_uintval, tempBuffer, tempSize, 10);
+            _ui64toa_s(m_uintval, tempBuffer, tempSize, 10);
 
         const auto numChars = strnlen_s(tempBuffer, tempSize);
 #else
         int numChars;
-        if (m_number.m_type == number::type::signed_type)
-            numChars = snprintf(tempBuffer, tempSize, "%" PRId64, m_number.m_intval);
+        if (m_type == number::type::signed_type)
+            numChars = snprintf(tempBuffer, tempSize, "%" PRId64, m_intval);
         else
-            numChars = snprintf(tempBuffer, tempSize, "%" PRIu64, m_number.m_uintval);
+            numChars = snprintf(tempBuffer, tempSize, "%" PRIu64, m_uintval);
 #endif
         stream.append(tempBuffer, numChars);
     }
@@ -184,9 +240,9 @@ void web::json::details::_Number::format(std::basic_string<char>& stream) const
             "%.*g",
             utility::details::scoped_c_thread_locale::c_locale(),
             std::numeric_limits<double>::digits10 + 2,
-            m_number.m_value);
+            m_value);
 #else
-        const auto numChars = snprintf(tempBuffer, tempSize, "%.*g", std::numeric_limits<double>::digits10 + 2, m_number.m_value);
+        const auto numChars = snprintf(tempBuffer, tempSize, "%.*g", std::numeric_limits<double>::digits10 + 2, m_value);
 #endif
         stream.append(tempBuffer, numChars);
     }
@@ -210,18 +266,18 @@ void web::json::details::_String::format(std::basic_string<wchar_t>& str) const
     str.push_back(L'"');
 }
 
-void web::json::details::_Number::format(std::basic_string<wchar_t>& stream) const
+void web::json::number::format(std::basic_string<wchar_t>& stream) const
 {
-    if(m_number.m_type != number::type::double_type)
+    if(m_type != number::type::double_type)
     {
         // #digits + 1 to avoid loss + 1 for the sign + 1 for null terminator.
         const size_t tempSize = std::numeric_limits<uint64_t>::digits10 + 3;
         wchar_t tempBuffer[tempSize];
 
-        if (m_number.m_type == number::type::signed_type)
-            _i64tow_s(m_number.m_intval, tempBuffer, tempSize, 10);
+        if (m_type == number::type::signed_type)
+            _i64tow_s(m_intval, tempBuffer, tempSize, 10);
         else
-            _ui64tow_s(m_number.m_uintval, tempBuffer, tempSize, 10);
+            _ui64tow_s(m_uintval, tempBuffer, tempSize, 10);
 
         stream.append(tempBuffer, wcsnlen_s(tempBuffer, tempSize));
     }
@@ -236,21 +292,18 @@ void web::json::details::_Number::format(std::basic_string<wchar_t>& stream) con
             L"%.*g",
             utility::details::scoped_c_thread_locale::c_locale(),
             std::numeric_limits<double>::digits10 + 2,
-            m_number.m_value);
+            m_value);
         stream.append(tempBuffer, numChars);
     }
 }
 
 #endif
 
-const utility::string_t & web::json::details::_String::as_string() const
-{
-    return m_string;
-}
-
 const utility::string_t & web::json::value::as_string() const
 {
-    return m_value->as_string();
+    if (!is_string())
+        throw json_exception(_XPLATSTR("not a string"));
+    return m_number.m_string->as_string();
 }
 
 utility::string_t json::value::serialize() const
@@ -258,5 +311,8 @@ utility::string_t json::value::serialize() const
 #ifndef _WIN32
     utility::details::scoped_c_thread_locale locale;
 #endif
-    return m_value->to_string();
+    utility::string_t str;
+    str.reserve(get_reserve_size());
+    format(str);
+    return str;
 }
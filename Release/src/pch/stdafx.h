@@ -94,7 +94,7 @@
 #include "pplx/pplxtasks.h"
 #include "cpprest/version.h"
 
-#include "cpprest\http_exception.h"
+#include "cpprest/http_exception.h"
 
 // streams
 #include "cpprest/streams.h"
@@ -17,6 +17,9 @@
 
 #include "pplx/pplx.h"
 
+#include <mutex>
+#include <vector>
+
 // Disable false alarm code analyze warning
 #if defined(_MSC_VER)
 #pragma warning (disable : 26165 26110)
@@ -63,6 +66,179 @@ namespace details
     };
 
     typedef ::pplx::scoped_lock<_Spin_lock> _Scoped_spin_lock;
+
+namespace
+{
+    // Block sizes are rounded up to a multiple of 16, which keeps every block aligned for any fundamental type.
+    const size_t _Pool_granularity = 16;
+    const size_t _Pool_max_block = 512;
+    const size_t _Pool_classes = _Pool_max_block / _Pool_granularity;
+    // Blocks move between a thread and the central pool, and are carved out of slabs, this many at a time.
+    const size_t _Pool_batch = 32;
+
+    struct _Pool_block
+    {
+        _Pool_block* _M_next;
+    };
+
+    struct _Pool_chain
+    {
+        _Pool_block* _M_head;
+        size_t _M_count;
+    };
+
+    // Blocks freed by threads that have cached more than they use. Never destroyed: tasks may be released during
+    // static destruction, after the thread caches are gone.
+    struct _Central_pool
+    {
+        std::mutex _M_lock;
+        std::vector<_Pool_chain> _M_chains[_Pool_classes];
+    };
+
+    _Central_pool& _Get_central_pool()
+    {
+        static _Central_pool* _Pool = new _Central_pool();
+        return *_Pool;
+    }
+
+    _Pool_chain _Take_chain(size_t _Class)
+    {
+        auto& _Central = _Get_central_pool();
+        {
+            std::lock_guard<std::mutex> _Lock(_Central._M_lock);
+            auto& _Chains = _Central._M_chains[_Class];
+            if (!_Chains.empty())
+            {
+                auto _Chain = _Chains.back();
+                _Chains.pop_back();
+                return _Chain;
+            }
+        }
+
+        const size_t _Block_size = (_Class + 1) * _Pool_granularity;
+        auto _Slab = static_cast<char*>(::operator new(_Block_size * _Pool_batch));
+        _Pool_block* _Head = nullptr;
+        for (size_t _I = _Pool_batch; _I-- > 0;)
+        {
+            auto _Block = reinterpret_cast<_Pool_block*>(_Slab + _I * _Block_size);
+            _Block->_M_next = _Head;
+            _Head = _Block;
+        }
+        return _Pool_chain { _Head, _Pool_batch };
+    }
+
+    void _Give_chain(size_t _Class, _Pool_chain _Chain)
+    {
+        auto& _Central = _Get_central_pool();
+        std::lock_guard<std::mutex> _Lock(_Central._M_lock);
+        _Central._M_chains[_Class].push_back(_Chain);
+    }
+
+    // Trivially destructible, so that it stays usable while other thread_local objects are destroyed.
+    struct _Thread_cache
+    {
+        enum _State { _New = 0, _Alive, _Dead };
+
+        _State _M_state;
+        _Pool_chain _M_free[_Pool_classes];
+    };
+
+    thread_local _Thread_cache _T_cache;
+
+    void _Flush_thread_cache()
+    {
+        for (size_t _Class = 0; _Class < _Pool_classes; ++_Class)
+        {
+            if (_T_cache._M_free[_Class]._M_count != 0)
+                _Give_chain(_Class, _T_cache._M_free[_Class]);
+            _T_cache._M_free[_Class] = _Pool_chain { nullptr, 0 };
+        }
+    }
+
+    struct _Thread_cache_guard
+    {
+        ~_Thread_cache_guard()
+        {
+            _Flush_thread_cache();
+            _T_cache._M_state = _Thread_cache::_Dead;
+        }
+    };
+
+    thread_local _Thread_cache_guard _T_cache_guard;
+
+    // Returns false once the thread is exiting, blocks then go straight to the central pool.
+    bool _Use_thread_cache()
+    {
+        if (_T_cache._M_state == _Thread_cache::_New)
+        {
+            // Touching the guard registers its destructor for this thread.
+            (void)&_T_cache_guard;
+            _T_cache._M_state = _Thread_cache::_Alive;
+        }
+        return _T_cache._M_state == _Thread_cache::_Alive;
+    }
+} // namespace
+
+    _PPLXIMP void* _pplx_cdecl _Allocate_pooled(size_t _Size)
+    {
+        if (_Size == 0 || _Size > _Pool_max_block)
+            return ::operator new(_Size);
+
+        const size_t _Class = (_Size - 1) / _Pool_granularity;
+        if (!_Use_thread_cache())
+        {
+            auto _Chain = _Take_chain(_Class);
+            auto _Block = _Chain._M_head;
+            if (_Chain._M_count > 1)
+                _Give_chain(_Class, _Pool_chain { _Block->_M_next, _Chain._M_count - 1 });
+            return _Block;
+        }
+
+        auto& _Free = _T_cache._M_free[_Class];
+        if (_Free._M_count == 0)
+            _Free = _Take_chain(_Class);
+        auto _Block = _Free._M_head;
+        _Free._M_head = _Block->_M_next;
+        --_Free._M_count;
+        return _Block;
+    }
+
+    _PPLXIMP void _pplx_cdecl _Free_pooled(void* _Ptr, size_t _Size)
+    {
+        if (_Ptr == nullptr)
+            return;
+        if (_Size == 0 || _Size > _Pool_max_block)
+        {
+            ::operator delete(_Ptr);
+            return;
+        }
+
+        const size_t _Class = (_Size - 1) / _Pool_granularity;
+        auto _Block = static_cast<_Pool_block*>(_Ptr);
+        if (!_Use_thread_cache())
+        {
+            _Block->_M_next = nullptr;
+            _Give_chain(_Class, _Pool_chain { _Block, 1 });
+            return;
+        }
+
+        // Continuations often complete on another thread than the one that created them. A thread that keeps
+        // freeing more than it allocates hands the surplus back in batches.
+        auto& _Free = _T_cache._M_free[_Class];
+        _Block->_M_next = _Free._M_head;
+        _Free._M_head = _Block;
+        if (++_Free._M_count == 2 * _Pool_batch)
+        {
+            auto _Last = _Free._M_head;
+            for (size_t _I = 1; _I < _Pool_batch; ++_I)
+                _Last = _Last->_M_next;
+            _Pool_chain _Surplus { _Free._M_head, _Pool_batch };
+            _Free._M_head = _Last->_M_next;
+            _Free._M_count -= _Pool_batch;
+            _Last->_M_next = nullptr;
+            _Give_chain(_Class, _Surplus);
+        }
+    }
 } // namespace details
 
 static struct _pplx_g_sched_t
@@ -39,6 +39,21 @@ namespace details {
             sleep(0);
         }
 
+        namespace
+        {
+            thread_local blocking_observer* current_blocking_observer = nullptr;
+        }
+
+        _PPLXIMP void SetBlockingObserver(blocking_observer* observer)
+        {
+            current_blocking_observer = observer;
+        }
+
+        _PPLXIMP blocking_observer* GetBlockingObserver()
+        {
+            return current_blocking_observer;
+        }
+
     } // namespace platform
 
     void apple_scheduler::schedule( TaskProc_t proc, void* param)
@@ -14,6 +14,7 @@
 #include "stdafx.h"
 #include "pplx/pplx.h"
 #include "pplx/threadpool.h"
+#include "cpprest/metrics.h"
 #include "sys/syscall.h"
 
 #ifdef _WIN32
@@ -36,11 +37,35 @@ namespace details {
         {
             std::this_thread::yield();
         }
+
+        namespace
+        {
+            thread_local blocking_observer* current_blocking_observer = nullptr;
+        }
+
+        _PPLXIMP void SetBlockingObserver(blocking_observer* observer)
+        {
+            current_blocking_observer = observer;
+        }
+
+        _PPLXIMP blocking_observer* GetBlockingObserver()
+        {
+            return current_blocking_observer;
+        }
     }
 
     _PPLXIMP void linux_scheduler::schedule(TaskProc_t proc, void* param)
     {
-        crossplat::threadpool::shared_instance().service().post(boost::bind(proc, param));
+        auto& metrics = utility::metrics::library();
+        metrics.pplx_queue_depth.add();
+        crossplat::threadpool::shared_instance().service().post([proc, param, &metrics]
+        {
+            metrics.pplx_queue_depth.sub();
+            const auto started = std::chrono::steady_clock::now();
+            proc(param);
+            metrics.pplx_task_execution.record(std::chrono::steady_clock::now() - started);
+            metrics.pplx_tasks_executed.add();
+        });
     }
 
 } // namespace details
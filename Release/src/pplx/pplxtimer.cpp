@@ -0,0 +1,393 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Timer wheel behind pplx::delay and pplx::with_timeout.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "stdafx.h"
+#include <climits>
+#include <condition_variable>
+#include <thread>
+#include <vector>
+#include "pplx/pplxtimer.h"
+#include "cpprest/metrics.h"
+
+namespace pplx
+{
+
+namespace details
+{
+    // Four levels of 256 slots cover 2^32 ticks of one millisecond, about 49 days. Longer timers wait in the last
+    // level and are put back until they are due.
+    const unsigned wheel_bits = 8;
+    const size_t wheel_slots = size_t(1) << wheel_bits;
+    const size_t wheel_levels = 4;
+    const uint64_t wheel_span = uint64_t(1) << (wheel_bits * wheel_levels);
+
+    // Timers live in chunks that are never freed, so that a node stays where it is while its id is around.
+    const size_t nodes_per_chunk = 4096;
+
+    enum class timer_state : uint8_t
+    {
+        free,
+        pending,
+        firing,
+        canceled_while_firing
+    };
+
+    struct timer_node
+    {
+        timer_node* prev;
+        timer_node* next;
+        uint64_t expiry;
+        uint64_t period;
+        std::function<void()> callback;
+        uint32_t index;
+        uint32_t generation;
+        timer_state state;
+        uint8_t level;
+        uint8_t slot;
+    };
+} // namespace details
+
+using namespace details;
+
+struct timer_service::impl
+{
+    impl()
+        : m_origin(std::chrono::steady_clock::now()),
+        m_now(0),
+        m_pending(0),
+        m_wake(0),
+        m_free(nullptr),
+        m_stopping(false)
+    {
+        for (auto& level : m_wheel)
+        {
+            for (auto& slot : level)
+                slot = nullptr;
+        }
+    }
+
+    ~impl()
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_stopping = true;
+        }
+        m_changed.notify_all();
+        if (m_thread.joinable())
+            m_thread.join();
+        utility::metrics::library().pplx_timers_pending.sub(static_cast<int64_t>(m_pending));
+    }
+
+    timer_id start(uint64_t delay, uint64_t period, std::function<void()>&& callback)
+    {
+        std::unique_lock<std::mutex> lock(m_lock);
+        // An empty wheel is not advanced, it jumps to the current tick instead. Otherwise the timer counts from the
+        // clock rather than from the wheel, which lags while callbacks run.
+        const auto now = elapsed_ticks();
+        if (m_pending == 0)
+            m_now = (std::max)(m_now, now);
+
+        auto node = allocate();
+        node->callback = std::move(callback);
+        node->period = period;
+        // The current tick may be nearly over, a timer always waits for one more so that it never fires early.
+        node->expiry = (std::max)(m_now, now) + delay + 1;
+        node->state = timer_state::pending;
+        insert(node);
+        ++m_pending;
+        const timer_id id = (uint64_t(node->generation) << 32) | (uint64_t(node->index) + 1);
+
+        if (!m_thread.joinable())
+            m_thread = std::thread(&impl::run, this);
+        else if (node->expiry < m_wake)
+            m_changed.notify_one();
+        lock.unlock();
+
+        utility::metrics::library().pplx_timers_pending.add();
+        return id;
+    }
+
+    bool cancel(timer_id id)
+    {
+        std::function<void()> callback;
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            auto node = find(id);
+            if (node == nullptr)
+                return false;
+            if (node->state == timer_state::firing)
+            {
+                // A periodic timer is only stopped once its callback returns, a one-shot one has fired for good.
+                if (node->period == 0)
+                    return false;
+                node->state = timer_state::canceled_while_firing;
+                return true;
+            }
+            if (node->state != timer_state::pending)
+                return false;
+            unlink(node);
+            callback = release(node);
+            --m_pending;
+        }
+        utility::metrics::library().pplx_timers_pending.sub();
+        return true;
+    }
+
+    size_t pending() const
+    {
+        std::lock_guard<std::mutex> lock(m_lock);
+        return m_pending;
+    }
+
+private:
+    timer_node* allocate()
+    {
+        if (m_free == nullptr)
+        {
+            std::unique_ptr<timer_node[]> chunk(new timer_node[nodes_per_chunk]);
+            const auto base = static_cast<uint32_t>(m_chunks.size() * nodes_per_chunk);
+            for (size_t i = nodes_per_chunk; i-- > 0;)
+            {
+                auto& node = chunk[i];
+                node.index = base + static_cast<uint32_t>(i);
+                node.generation = 1;
+                node.state = timer_state::free;
+                node.next = m_free;
+                m_free = &node;
+            }
+            m_chunks.push_back(std::move(chunk));
+        }
+        auto node = m_free;
+        m_free = node->next;
+        return node;
+    }
+
+    // Returns the callback, so that what it captured is destroyed once the lock is released.
+    std::function<void()> release(timer_node* node)
+    {
+        auto callback = std::move(node->callback);
+        node->callback = nullptr;
+        node->state = timer_state::free;
+        ++node->generation;
+        node->next = m_free;
+        m_free = node;
+        return callback;
+    }
+
+    timer_node* find(timer_id id)
+    {
+        const auto index = static_cast<uint32_t>(id & 0xffffffff);
+        if (index == 0 || index > m_chunks.size() * nodes_per_chunk)
+            return nullptr;
+        auto node = &m_chunks[(index - 1) / nodes_per_chunk][(index - 1) % nodes_per_chunk];
+        return node->generation == static_cast<uint32_t>(id >> 32) ? node : nullptr;
+    }
+
+    // A timer goes to the lowest level whose slots are long enough to reach its expiry. Its slot there is given by
+    // the bits of the expiry for that level, it moves down a level each time the level above turns to that slot.
+    void insert(timer_node* node)
+    {
+        const auto delta = node->expiry - m_now;
+        const auto target = delta < wheel_span ? node->expiry : m_now + wheel_span - 1;
+        size_t level = 0;
+        while (level + 1 < wheel_levels && (target - m_now) >= (uint64_t(1) << (wheel_bits * (level + 1))))
+            ++level;
+        const auto slot = static_cast<size_t>((target >> (wheel_bits * level)) & (wheel_slots - 1));
+
+        auto& head = m_wheel[level][slot];
+        node->level = static_cast<uint8_t>(level);
+        node->slot = static_cast<uint8_t>(slot);
+        node->prev = nullptr;
+        node->next = head;
+        if (head != nullptr)
+            head->prev = node;
+        head = node;
+    }
+
+    void unlink(timer_node* node)
+    {
+        if (node->prev != nullptr)
+            node->prev->next = node->next;
+        else
+            m_wheel[node->level][node->slot] = node->next;
+        if (node->next != nullptr)
+            node->next->prev = node->prev;
+    }
+
+    // Moves one tick forward, adding the timers due to the list of those to fire.
+    void advance(std::vector<timer_node*>& due)
+    {
+        ++m_now;
+        for (size_t level = 1; level < wheel_levels; ++level)
+        {
+            if ((m_now & ((uint64_t(1) << (wheel_bits * level)) - 1)) != 0)
+                break;
+            const auto slot = static_cast<size_t>((m_now >> (wheel_bits * level)) & (wheel_slots - 1));
+            auto node = m_wheel[level][slot];
+            m_wheel[level][slot] = nullptr;
+            while (node != nullptr)
+            {
+                auto next = node->next;
+                insert(node);
+                node = next;
+            }
+        }
+
+        auto& head = m_wheel[0][m_now & (wheel_slots - 1)];
+        for (auto node = head; node != nullptr; node = node->next)
+        {
+            node->state = timer_state::firing;
+            due.push_back(node);
+        }
+        head = nullptr;
+    }
+
+    uint64_t elapsed_ticks() const
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_origin).count());
+    }
+
+    // The next tick that can fire a timer or move timers down: the next occupied slot of the first level, or the
+    // turn of that level.
+    uint64_t next_event() const
+    {
+        const auto turn = (m_now | (wheel_slots - 1)) + 1;
+        for (auto tick = m_now + 1; tick < turn; ++tick)
+        {
+            if (m_wheel[0][tick & (wheel_slots - 1)] != nullptr)
+                return tick;
+        }
+        return turn;
+    }
+
+    void run()
+    {
+        std::vector<timer_node*> due;
+        std::vector<std::function<void()>> released;
+        std::unique_lock<std::mutex> lock(m_lock);
+        while (!m_stopping)
+        {
+            if (m_pending == 0)
+            {
+                m_wake = UINT64_MAX;
+                m_changed.wait(lock);
+                continue;
+            }
+
+            const auto now = elapsed_ticks();
+            if (m_now >= now)
+            {
+                // Timers started meanwhile wake the thread if they are due before that.
+                m_wake = next_event();
+                m_changed.wait_until(lock, m_origin + std::chrono::milliseconds(m_wake));
+                continue;
+            }
+            m_wake = 0;
+
+            while (m_now < now && due.size() < m_pending)
+                advance(due);
+            if (due.empty())
+                continue;
+
+            // Callbacks run without the lock, so that they may start and cancel timers.
+            lock.unlock();
+            for (auto node : due)
+            {
+                try
+                {
+                    node->callback();
+                }
+                catch (...)
+                {
+                    // A timer has no one to report to, its callback is expected to complete a task instead.
+                }
+            }
+            lock.lock();
+
+            size_t finished = 0;
+            for (auto node : due)
+            {
+                if (node->period != 0 && node->state == timer_state::firing)
+                {
+                    node->state = timer_state::pending;
+                    node->expiry = (std::max)(node->expiry + node->period, m_now + 1);
+                    insert(node);
+                    continue;
+                }
+                released.push_back(release(node));
+                ++finished;
+            }
+            m_pending -= finished;
+            utility::metrics::library().pplx_timers_fired.add(static_cast<int64_t>(due.size()));
+            utility::metrics::library().pplx_timers_pending.sub(static_cast<int64_t>(finished));
+            due.clear();
+
+            lock.unlock();
+            released.clear();
+            lock.lock();
+        }
+    }
+
+    const std::chrono::steady_clock::time_point m_origin;
+
+    mutable std::mutex m_lock;
+    std::condition_variable m_changed;
+    // Ticks since m_origin the wheel has been advanced to.
+    uint64_t m_now;
+    size_t m_pending;
+    // Tick the thread sleeps until, 0 while it is awake.
+    uint64_t m_wake;
+    timer_node* m_wheel[wheel_levels][wheel_slots];
+    std::vector<std::unique_ptr<timer_node[]>> m_chunks;
+    timer_node* m_free;
+    bool m_stopping;
+    std::thread m_thread;
+};
+
+timer_service& __cdecl timer_service::shared_instance()
+{
+    // Timers may still be started and canceled by static destructors, the service is never destroyed.
+    static timer_service* instance = new timer_service();
+    return *instance;
+}
+
+timer_service::timer_service() : m_impl(new impl())
+{
+}
+
+timer_service::~timer_service()
+{
+}
+
+timer_service::timer_id timer_service::start(std::chrono::milliseconds delay, std::function<void()> callback)
+{
+    return m_impl->start(static_cast<uint64_t>((std::max)(delay.count(), static_cast<std::chrono::milliseconds::rep>(0))), 0, std::move(callback));
+}
+
+timer_service::timer_id timer_service::start_periodic(std::chrono::milliseconds period, std::function<void()> callback)
+{
+    const auto ticks = static_cast<uint64_t>((std::max)(period.count(), static_cast<std::chrono::milliseconds::rep>(1)));
+    return m_impl->start(ticks, ticks, std::move(callback));
+}
+
+bool timer_service::cancel(timer_id id)
+{
+    return m_impl->cancel(id);
+}
+
+size_t timer_service::pending() const
+{
+    return m_impl->pending();
+}
+
+} // namespace pplx
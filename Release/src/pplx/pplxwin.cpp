@@ -16,6 +16,7 @@
 #if !defined(_WIN32) || _MSC_VER < 1800 || CPPREST_FORCE_PPLX
 
 #include "pplx/pplxwin.h"
+#include "cpprest/metrics.h"
 
 // Disable false alarm code analysis warning
 #pragma warning (disable : 26165 26110)
@@ -247,9 +248,14 @@ namespace details
         static void CALLBACK DefaultWorkCallback(PTP_CALLBACK_INSTANCE, PVOID pContext, PTP_WORK)
         {
             auto schedulerParam = (_Scheduler_Param *)(pContext);
+            auto& metrics = utility::metrics::library();
+            metrics.pplx_queue_depth.sub();
+            const auto started = std::chrono::steady_clock::now();
 
             schedulerParam->m_proc(schedulerParam->m_param);
 
+            metrics.pplx_task_execution.record(std::chrono::steady_clock::now() - started);
+            metrics.pplx_tasks_executed.add();
             delete schedulerParam;
         }
     };
@@ -265,6 +271,8 @@ namespace details
             throw utility::details::create_system_error(GetLastError());
         }
 
+        utility::metrics::library().pplx_queue_depth.add();
+
         SubmitThreadpoolWork(work);
         CloseThreadpoolWork(work);
     }
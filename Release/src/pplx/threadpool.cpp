@@ -8,6 +8,7 @@
 
 #if !defined(CPPREST_EXCLUDE_WEBSOCKETS) || !defined(_WIN32)
 #include "pplx/threadpool.h"
+#include "cpprest/metrics.h"
 
 #if !defined(_WIN32)
 #define CPPREST_PTHREADS
@@ -19,6 +20,11 @@
 #include <thread>
 #endif
 
+#include <algorithm>
+#include <climits>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
 #include <vector>
 
 #if defined(__ANDROID__)
@@ -29,42 +35,122 @@
 namespace
 {
 
+// How often the pool checks that posted handlers get a thread.
+const std::chrono::milliseconds probe_interval(20);
+
 struct threadpool_impl final : crossplat::threadpool
+#if !defined(_WIN32)
+    , pplx::details::blocking_observer
+#endif
 {
-    threadpool_impl(size_t n)
-        : crossplat::threadpool(n)
+    threadpool_impl(const crossplat::threadpool_options& options)
+        : crossplat::threadpool(options.max_threads)
+        , m_options(options)
         , m_work(m_service)
+        , m_threads(0)
+        , m_retiring(0)
+        , m_blocked(0)
+        , m_named(0)
+        , m_probe_pending(false)
+        , m_stopping(false)
     {
-        for (size_t i = 0; i < n; i++)
+        m_options.min_threads = (std::max)(m_options.min_threads, static_cast<size_t>(1));
+        m_options.max_threads = (std::max)(m_options.max_threads, m_options.min_threads);
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        for (size_t i = 0; i < m_options.min_threads; i++)
             add_thread();
+        if (m_options.max_threads > m_options.min_threads)
+            start_monitor();
     }
 
     ~threadpool_impl()
     {
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            m_stopping = true;
+        }
+        m_changed.notify_all();
+        if (m_monitor.joinable())
+            m_monitor.join();
+
         m_service.stop();
-        for (auto iter = m_threads.begin(); iter != m_threads.end(); ++iter)
+        std::unique_lock<std::mutex> lock(m_lock);
+        m_changed.wait(lock, [this] { return m_threads == 0; });
+    }
+
+    // A pool thread blocked in a pplx wait may be waiting for handlers queued behind it. If it was the last thread
+    // able to run them, a thread is added right away, otherwise the monitor adds threads once handlers starve.
+    // Either way max_threads bounds only the threads that are not blocked.
+    void blocking_begin()
+    {
+        auto& metrics = utility::metrics::library();
+        metrics.pplx_blocking_waits.add();
+        metrics.pplx_threads_blocked.add();
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        ++m_blocked;
+        if (!m_stopping && running() == 0)
         {
-#if defined(CPPREST_PTHREADS)
-            pthread_t t = *iter;
-            void* res;
-            pthread_join(t, &res);
-#else
-            iter->join();
-#endif
+            add_thread();
+            metrics.pplx_compensating_threads_started.add();
+            // Fixed size pools have no monitor until then, it retires the extra thread once the wait is over.
+            start_monitor();
         }
     }
 
+    void blocking_end()
+    {
+        utility::metrics::library().pplx_threads_blocked.sub();
+        std::lock_guard<std::mutex> lock(m_lock);
+        --m_blocked;
+    }
+
 private:
+    // Threads neither blocked nor about to retire. Must be called with m_lock held.
+    size_t running() const
+    {
+        return m_threads - (std::min)(m_threads, m_retiring + m_blocked);
+    }
+
+    // Must be called with m_lock held.
+    void start_monitor()
+    {
+        if (!m_monitor.joinable())
+            m_monitor = std::thread(&threadpool_impl::monitor, this);
+    }
+
+    // Must be called with m_lock held. Threads are detached, the pool waits for m_threads to drop to 0 instead.
     void add_thread()
     {
 #ifdef CPPREST_PTHREADS
+        pthread_attr_t attr;
+        pthread_attr_init(&attr);
+        pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+        if (m_options.stack_size != 0)
+            pthread_attr_setstacksize(&attr, (std::max)(m_options.stack_size, static_cast<size_t>(PTHREAD_STACK_MIN)));
+#if defined(__linux__) && !defined(__ANDROID__)
+        if (!m_options.cpu_affinity.empty())
+        {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            for (auto cpu : m_options.cpu_affinity)
+            {
+                if (cpu < CPU_SETSIZE)
+                    CPU_SET(cpu, &cpus);
+            }
+            pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+        }
+#endif
         pthread_t t;
-        auto result = pthread_create(&t, nullptr, &thread_start, this);
-        if (result == 0)
-            m_threads.push_back(t);
+        auto result = pthread_create(&t, &attr, &thread_start, this);
+        pthread_attr_destroy(&attr);
+        if (result != 0)
+            return;
 #else
-        m_threads.push_back(std::thread(&thread_start, this));
+        std::thread(&thread_start, this).detach();
 #endif
+        ++m_threads;
     }
 
 #if defined(__ANDROID__)
@@ -82,33 +168,135 @@ private:
         pthread_cleanup_push(detach_from_java, nullptr);
 #endif
         threadpool_impl* _this = reinterpret_cast<threadpool_impl*>(arg);
-        _this->m_service.run();
+        _this->run();
 #if defined(__ANDROID__)
         pthread_cleanup_pop(true);
 #endif
         return arg;
     }
 
-#if defined(CPPREST_PTHREADS)
-    std::vector<pthread_t> m_threads;
-#else
-    std::vector<std::thread> m_threads;
+    void set_thread_name()
+    {
+        // Linux limits thread names to 15 characters.
+        auto name = m_options.thread_name + "-" + std::to_string(++m_named);
+        if (name.size() > 15)
+            name.erase(0, name.size() - 15);
+#if defined(__APPLE__)
+        pthread_setname_np(name.c_str());
+#elif defined(__linux__)
+        pthread_setname_np(pthread_self(), name.c_str());
+#endif
+    }
+
+    void run()
+    {
+        if (!m_options.thread_name.empty())
+            set_thread_name();
+#if !defined(_WIN32)
+        pplx::details::platform::SetBlockingObserver(this);
 #endif
+
+        // Handlers run one at a time so that a retire request posted by the monitor ends only the thread running it.
+        boost::system::error_code ec;
+        while (m_service.run_one(ec) != 0 && s_retiring_from != this)
+        {
+        }
+
+        std::lock_guard<std::mutex> lock(m_lock);
+        if (s_retiring_from == this)
+            --m_retiring;
+        --m_threads;
+        m_changed.notify_all();
+    }
+
+    // Every probe_interval posts an empty handler. A probe still waiting at the next check means the threads are
+    // all busy, or blocked, and the pool doubles its running threads. The io_service does not expose its queue
+    // length, so the growth follows how long the backlog lasts, up to max_threads. If no probe waited for a whole
+    // idle_timeout, a thread had nothing to do during all that time and one is retired.
+    void monitor()
+    {
+        const auto idle_probes = (std::max)(static_cast<long long>(m_options.idle_timeout / probe_interval), 1LL);
+        long long quiet = 0;
+
+        std::unique_lock<std::mutex> lock(m_lock);
+        while (!m_changed.wait_for(lock, probe_interval, [this] { return m_stopping; }))
+        {
+            if (!m_probe_pending.exchange(true))
+            {
+                if (++quiet >= idle_probes && running() > m_options.min_threads)
+                {
+                    quiet = 0;
+                    ++m_retiring;
+                    m_service.post([this] { s_retiring_from = this; });
+                }
+                m_service.post([this] { m_probe_pending = false; });
+                continue;
+            }
+
+            quiet = 0;
+            const auto active = running();
+            auto wanted = (std::max)(active, static_cast<size_t>(1));
+            wanted = (std::min)(wanted, m_options.max_threads - (std::min)(m_options.max_threads, active));
+            if (m_blocked != 0)
+                utility::metrics::library().pplx_compensating_threads_started.add(static_cast<int64_t>(wanted));
+            for (size_t i = 0; i < wanted; i++)
+                add_thread();
+        }
+    }
+
+    static thread_local const threadpool_impl* s_retiring_from;
+
+    crossplat::threadpool_options m_options;
     boost::asio::io_service::work m_work;
+
+    std::mutex m_lock;
+    std::condition_variable m_changed;
+    size_t m_threads;
+    size_t m_retiring;
+    size_t m_blocked;
+    std::atomic<size_t> m_named;
+    std::atomic<bool> m_probe_pending;
+    bool m_stopping;
+    std::thread m_monitor;
 };
+
+thread_local const threadpool_impl* threadpool_impl::s_retiring_from = nullptr;
+
 }
 
 namespace crossplat
 {
-	namespace {
-		std::once_flag threadpool_once_init;
-		std::unique_ptr<threadpool_impl> threadpool_holder;
+namespace
+{
+    std::mutex threadpool_init_lock;
+    threadpool_options threadpool_init_options;
+    std::once_flag threadpool_once_init;
+    std::unique_ptr<threadpool_impl> threadpool_holder;
 
-		void fillthread_pool()
-		{
-			threadpool_holder = new threadpool_impl(40);
-		}
-	}
+    void fillthread_pool()
+    {
+        std::lock_guard<std::mutex> lock(threadpool_init_lock);
+        threadpool_holder.reset(new threadpool_impl(threadpool_init_options));
+    }
+}
+
+void threadpool::initialize_with_threads(size_t num_threads)
+{
+    threadpool_options options;
+    options.min_threads = num_threads;
+    options.max_threads = num_threads;
+    initialize_with_options(options);
+}
+
+void threadpool::initialize_with_options(const threadpool_options& options)
+{
+    std::lock_guard<std::mutex> lock(threadpool_init_lock);
+    if (threadpool_holder)
+    {
+        throw std::runtime_error("the cpprestsdk threadpool has already been initialized");
+    }
+    threadpool_init_options = options;
+}
 
 #if defined(__ANDROID__)
 // This pointer will be 0-initialized by default (at load time).
@@ -139,8 +327,8 @@ JNIEnv* get_jvm_env()
 threadpool& threadpool::shared_instance()
 {
     abort_if_no_jvm();
-	std::call_once(threadpool_once_init, fillthread_pool);
-    return *(threadpool_holder->get());
+    std::call_once(threadpool_once_init, fillthread_pool);
+    return *threadpool_holder;
 }
 
 #else
@@ -148,8 +336,8 @@ threadpool& threadpool::shared_instance()
 // initialize the static shared threadpool
 threadpool& threadpool::shared_instance()
 {
-	std::call_once(threadpool_once_init, fillthread_pool);
-	return *(threadpool_holder->get());
+    std::call_once(threadpool_once_init, fillthread_pool);
+    return *threadpool_holder;
 }
 
 #endif
@@ -164,6 +352,14 @@ void cpprest_init(JavaVM* vm) {
 
 std::unique_ptr<crossplat::threadpool> crossplat::threadpool::construct(size_t num_threads)
 {
-    return std::unique_ptr<crossplat::threadpool>(new threadpool_impl(num_threads));
+    threadpool_options options;
+    options.min_threads = num_threads;
+    options.max_threads = num_threads;
+    return construct(options);
+}
+
+std::unique_ptr<crossplat::threadpool> crossplat::threadpool::construct(const threadpool_options& options)
+{
+    return std::unique_ptr<crossplat::threadpool>(new threadpool_impl(options));
 }
 #endif
\ No newline at end of file
@@ -0,0 +1,551 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Work-stealing scheduler for pplx tasks (non-Windows).
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "stdafx.h"
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include "pplx/work_stealing_scheduler.h"
+#include "cpprest/metrics.h"
+
+#ifdef _WIN32
+#error "ERROR: This file should only be included in non-windows Build"
+#endif
+
+namespace pplx
+{
+
+namespace details
+{
+    struct task_item
+    {
+        TaskProc_t proc;
+        void* param;
+    };
+
+    /// <summary>
+    /// Chase-Lev deque, in the formulation for weak memory models of Le, Pop, Cohen and Zappa Nardelli (PPoPP 2013).
+    /// The owner pushes and takes at the bottom, thieves take the oldest entry at the top.
+    /// </summary>
+    /// <remarks>
+    /// An entry is two independent atomics. A thief can read an entry while the owner overwrites it only after the
+    /// top moved past it, and then the thief loses the CAS on top and drops what it read.
+    /// </remarks>
+    class task_deque
+    {
+    public:
+        task_deque() : m_top(0), m_bottom(0)
+        {
+            m_rings.emplace_back(new ring(initial_capacity));
+            m_ring.store(m_rings.back().get(), std::memory_order_relaxed);
+        }
+
+        // Owner only.
+        void push(const task_item& item)
+        {
+            const auto bottom = m_bottom.load(std::memory_order_relaxed);
+            const auto top = m_top.load(std::memory_order_acquire);
+            auto entries = m_ring.load(std::memory_order_relaxed);
+            if (bottom - top > static_cast<int64_t>(entries->mask))
+                entries = grow(entries, top, bottom);
+            entries->put(bottom, item);
+            std::atomic_thread_fence(std::memory_order_release);
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+        }
+
+        // Owner only, newest entry first.
+        bool take(task_item& item)
+        {
+            const auto bottom = m_bottom.load(std::memory_order_relaxed) - 1;
+            auto entries = m_ring.load(std::memory_order_relaxed);
+            m_bottom.store(bottom, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto top = m_top.load(std::memory_order_relaxed);
+            if (top > bottom)
+            {
+                m_bottom.store(bottom + 1, std::memory_order_relaxed);
+                return false;
+            }
+            item = entries->get(bottom);
+            if (top != bottom)
+                return true;
+
+            // Last entry, the thieves may be after it too.
+            const bool won = m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            m_bottom.store(bottom + 1, std::memory_order_relaxed);
+            return won;
+        }
+
+        // Any thread, oldest entry first. Fails spuriously when another thief wins the same entry.
+        bool steal(task_item& item)
+        {
+            auto top = m_top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const auto bottom = m_bottom.load(std::memory_order_acquire);
+            if (top >= bottom)
+                return false;
+            item = m_ring.load(std::memory_order_acquire)->get(top);
+            return m_top.compare_exchange_strong(top, top + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        }
+
+        bool empty() const
+        {
+            return m_bottom.load(std::memory_order_seq_cst) <= m_top.load(std::memory_order_seq_cst);
+        }
+
+    private:
+        static const size_t initial_capacity = 256;
+
+        struct ring
+        {
+            struct entry
+            {
+                std::atomic<TaskProc_t> proc;
+                std::atomic<void*> param;
+            };
+
+            explicit ring(size_t capacity) : mask(capacity - 1), entries(new entry[capacity]) {}
+
+            void put(int64_t index, const task_item& item)
+            {
+                auto& slot = entries[static_cast<size_t>(index) & mask];
+                slot.proc.store(item.proc, std::memory_order_relaxed);
+                slot.param.store(item.param, std::memory_order_relaxed);
+            }
+
+            task_item get(int64_t index) const
+            {
+                const auto& slot = entries[static_cast<size_t>(index) & mask];
+                return task_item { slot.proc.load(std::memory_order_relaxed), slot.param.load(std::memory_order_relaxed) };
+            }
+
+            const size_t mask;
+            std::unique_ptr<entry[]> entries;
+        };
+
+        // Thieves may still read the old ring, so replaced rings are kept until the deque goes.
+        ring* grow(ring* current, int64_t top, int64_t bottom)
+        {
+            m_rings.emplace_back(new ring((current->mask + 1) * 2));
+            auto bigger = m_rings.back().get();
+            for (auto index = top; index < bottom; ++index)
+                bigger->put(index, current->get(index));
+            m_ring.store(bigger, std::memory_order_release);
+            return bigger;
+        }
+
+        std::atomic<int64_t> m_top;
+        std::atomic<int64_t> m_bottom;
+        std::atomic<ring*> m_ring;
+        std::vector<std::unique_ptr<ring>> m_rings;
+    };
+
+    /// <summary>
+    /// Holds the task most recently scheduled by a worker. Other workers can take it, so a worker that blocks
+    /// right after scheduling does not strand it.
+    /// </summary>
+    class lifo_slot
+    {
+    public:
+        lifo_slot() : m_state(empty_state) {}
+
+        // Owner only. Returns true with the previous task in displaced, if there was one.
+        bool replace(const task_item& item, task_item& displaced)
+        {
+            const bool had_task = take(displaced);
+            // A thief may still be copying the previous task out.
+            while (m_state.load(std::memory_order_acquire) == busy_state)
+                std::this_thread::yield();
+            m_proc.store(item.proc, std::memory_order_relaxed);
+            m_param.store(item.param, std::memory_order_relaxed);
+            m_state.store(full_state, std::memory_order_seq_cst);
+            return had_task;
+        }
+
+        bool take(task_item& item)
+        {
+            int expected = full_state;
+            if (!m_state.compare_exchange_strong(expected, busy_state, std::memory_order_acquire, std::memory_order_relaxed))
+                return false;
+            item.proc = m_proc.load(std::memory_order_relaxed);
+            item.param = m_param.load(std::memory_order_relaxed);
+            m_state.store(empty_state, std::memory_order_release);
+            return true;
+        }
+
+        bool full() const { return m_state.load(std::memory_order_seq_cst) == full_state; }
+
+    private:
+        enum { empty_state, full_state, busy_state };
+
+        std::atomic<int> m_state;
+        std::atomic<TaskProc_t> m_proc;
+        std::atomic<void*> m_param;
+    };
+
+    // Identifies the scheduler and the worker running on the current thread.
+    static thread_local const void* current_scheduler = nullptr;
+    static thread_local size_t current_worker = 0;
+
+    // current_worker of the spare threads, which own no deque.
+    const size_t no_worker = static_cast<size_t>(-1);
+
+    // Consecutive tasks a worker takes from its LIFO slot before it looks at its deque.
+    const unsigned max_lifo_streak = 16;
+    // A worker looks at the injection queue first once every this many tasks.
+    const unsigned injection_check_interval = 61;
+    // Rounds over the other workers before a thief goes to sleep. LIFO slots are only stolen from the second round.
+    const unsigned steal_rounds = 3;
+} // namespace details
+
+using namespace details;
+
+struct work_stealing_scheduler::impl : blocking_observer
+{
+    struct alignas(64) worker
+    {
+        task_deque deque;
+        lifo_slot lifo;
+        std::thread thread;
+    };
+
+    explicit impl(size_t count) : injection_size(0), sleeping(0), searching(0), stopping(false),
+        spares_wanted(0), spares_active(0), spares_idle(0), spare_grants(0)
+    {
+        for (size_t i = 0; i < count; ++i)
+            workers.emplace_back(new worker());
+        for (size_t i = 0; i < count; ++i)
+            workers[i]->thread = std::thread([this, i] { run_worker(i); });
+    }
+
+    ~impl()
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_lock);
+            stopping.store(true);
+        }
+        wakeup.notify_all();
+        {
+            // An idle spare checks stopping under spare_lock, taking it here means it sees it or gets the notification.
+            std::lock_guard<std::mutex> lock(spare_lock);
+        }
+        spare_granted.notify_all();
+        for (auto& worker : workers)
+            worker->thread.join();
+
+        std::vector<std::thread> spares;
+        {
+            std::lock_guard<std::mutex> lock(spare_lock);
+            spares.swap(spare_threads);
+        }
+        for (auto& spare : spares)
+            spare.join();
+    }
+
+    void schedule(const task_item& item)
+    {
+        utility::metrics::library().pplx_queue_depth.add();
+        if (current_scheduler == this && current_worker != no_worker)
+        {
+            auto& self = *workers[current_worker];
+            task_item displaced;
+            if (self.lifo.replace(item, displaced))
+                self.deque.push(displaced);
+        }
+        else
+        {
+            std::lock_guard<std::mutex> lock(injection_lock);
+            injection.push_back(item);
+            injection_size.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        wake_if_idle();
+    }
+
+    // A thread blocking in a pplx wait may be waiting for tasks queued behind it. A worker hands its LIFO task over
+    // to the others, and a spare thread runs tasks for as long as the wait lasts, so the waits cannot deadlock.
+    void blocking_begin()
+    {
+        auto& metrics = utility::metrics::library();
+        metrics.pplx_blocking_waits.add();
+        metrics.pplx_threads_blocked.add();
+        if (current_worker != no_worker)
+        {
+            task_item item;
+            auto& self = *workers[current_worker];
+            if (self.lifo.take(item))
+                self.deque.push(item);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(spare_lock);
+            ++spares_wanted;
+            if (spares_active < spares_wanted && !stopping.load())
+            {
+                ++spares_active;
+                metrics.pplx_compensating_threads_started.add();
+                if (spares_idle != 0)
+                {
+                    --spares_idle;
+                    ++spare_grants;
+                    spare_granted.notify_one();
+                }
+                else
+                {
+                    spare_threads.emplace_back([this] { run_spare(); });
+                }
+            }
+        }
+        wake_if_idle();
+    }
+
+    void blocking_end()
+    {
+        utility::metrics::library().pplx_threads_blocked.sub();
+        bool surplus = false;
+        {
+            std::lock_guard<std::mutex> lock(spare_lock);
+            --spares_wanted;
+            surplus = spares_active > spares_wanted;
+        }
+        // A spare parked while waiting for work retires once it wakes up.
+        if (surplus)
+        {
+            std::lock_guard<std::mutex> lock(sleep_lock);
+            wakeup.notify_all();
+        }
+    }
+
+    void wake_if_idle()
+    {
+        // Pairs with the fence in park: either the sleeper sees the task, or this sees the sleeper.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (searching.load(std::memory_order_relaxed) == 0 && sleeping.load(std::memory_order_relaxed) != 0)
+        {
+            std::lock_guard<std::mutex> lock(sleep_lock);
+            wakeup.notify_one();
+        }
+    }
+
+    void run_worker(size_t index)
+    {
+        current_scheduler = this;
+        current_worker = index;
+        platform::SetBlockingObserver(this);
+        auto& self = *workers[index];
+        uint32_t random = static_cast<uint32_t>(index) * 2654435761u + 1;
+        unsigned lifo_streak = 0;
+        unsigned ticks = 0;
+        for (;;)
+        {
+            task_item item;
+            if (next_local(self, item, lifo_streak, ticks) || search(index, item, random))
+            {
+                run(item);
+                continue;
+            }
+            if (!park())
+                return;
+        }
+    }
+
+    // Spares steal like idle workers, and go back to the idle list once no wait needs them any more.
+    void run_spare()
+    {
+        current_scheduler = this;
+        current_worker = no_worker;
+        platform::SetBlockingObserver(this);
+        uint32_t random = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(&random)) | 1u;
+        for (;;)
+        {
+            for (;;)
+            {
+                if (retire_spare())
+                    break;
+                task_item item;
+                if (search(no_worker, item, random))
+                {
+                    run(item);
+                    continue;
+                }
+                if (!park())
+                    return;
+            }
+
+            std::unique_lock<std::mutex> lock(spare_lock);
+            spare_granted.wait(lock, [this] { return spare_grants != 0 || stopping.load(); });
+            if (spare_grants == 0)
+                return;
+            --spare_grants;
+        }
+    }
+
+    bool retire_spare()
+    {
+        std::lock_guard<std::mutex> lock(spare_lock);
+        if (spares_active <= spares_wanted)
+            return false;
+        --spares_active;
+        ++spares_idle;
+        return true;
+    }
+
+    bool next_local(worker& self, task_item& item, unsigned& lifo_streak, unsigned& ticks)
+    {
+        if (++ticks % injection_check_interval == 0 && pop_injection(item))
+            return true;
+        if (lifo_streak < max_lifo_streak && self.lifo.take(item))
+        {
+            ++lifo_streak;
+            return true;
+        }
+        lifo_streak = 0;
+        return self.deque.take(item) || self.lifo.take(item) || pop_injection(item);
+    }
+
+    // On failure the worker is left counted as searching, park takes it off.
+    bool search(size_t index, task_item& item, uint32_t& random)
+    {
+        searching.fetch_add(1, std::memory_order_seq_cst);
+        const auto count = workers.size();
+        for (unsigned round = 0; round < steal_rounds; ++round)
+        {
+            // xorshift32, only spreads the thieves over the victims.
+            random ^= random << 13;
+            random ^= random >> 17;
+            random ^= random << 5;
+            const auto start = random % count;
+            for (size_t i = 0; i < count; ++i)
+            {
+                const auto victim = (start + i) % count;
+                if (victim != index && workers[victim]->deque.steal(item))
+                    return found_while_searching();
+            }
+            if (pop_injection(item))
+                return found_while_searching();
+            // The owner normally runs its LIFO task right away, only take those it left waiting.
+            for (size_t i = 0; round > 0 && i < count; ++i)
+            {
+                const auto victim = (start + i) % count;
+                if (victim != index && workers[victim]->lifo.take(item))
+                    return found_while_searching();
+            }
+            std::this_thread::yield();
+        }
+        return false;
+    }
+
+    bool found_while_searching()
+    {
+        searching.fetch_sub(1, std::memory_order_seq_cst);
+        return true;
+    }
+
+    // Returns false once the scheduler stops and no work is left.
+    bool park()
+    {
+        std::unique_lock<std::mutex> lock(sleep_lock);
+        sleeping.fetch_add(1, std::memory_order_seq_cst);
+        searching.fetch_sub(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        bool keep_running = true;
+        if (!has_work())
+        {
+            if (stopping.load())
+                keep_running = false;
+            else
+                wakeup.wait(lock);
+        }
+        sleeping.fetch_sub(1, std::memory_order_seq_cst);
+        return keep_running;
+    }
+
+    bool has_work() const
+    {
+        if (injection_size.load(std::memory_order_seq_cst) != 0)
+            return true;
+        for (const auto& worker : workers)
+        {
+            if (!worker->deque.empty() || worker->lifo.full())
+                return true;
+        }
+        return false;
+    }
+
+    bool pop_injection(task_item& item)
+    {
+        if (injection_size.load(std::memory_order_relaxed) == 0)
+            return false;
+        std::lock_guard<std::mutex> lock(injection_lock);
+        if (injection.empty())
+            return false;
+        item = injection.front();
+        injection.pop_front();
+        injection_size.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    static void run(const task_item& item)
+    {
+        auto& metrics = utility::metrics::library();
+        metrics.pplx_queue_depth.sub();
+        const auto started = std::chrono::steady_clock::now();
+        item.proc(item.param);
+        metrics.pplx_task_execution.record(std::chrono::steady_clock::now() - started);
+        metrics.pplx_tasks_executed.add();
+    }
+
+    std::vector<std::unique_ptr<worker>> workers;
+
+    std::mutex injection_lock;
+    std::deque<task_item> injection;
+    std::atomic<size_t> injection_size;
+
+    std::mutex sleep_lock;
+    std::condition_variable wakeup;
+    std::atomic<size_t> sleeping;
+    std::atomic<size_t> searching;
+    std::atomic<bool> stopping;
+
+    // Spare threads: one is active for each blocked thread, the others wait in the idle list to be reused.
+    std::mutex spare_lock;
+    std::condition_variable spare_granted;
+    std::vector<std::thread> spare_threads;
+    size_t spares_wanted;
+    size_t spares_active;
+    size_t spares_idle;
+    size_t spare_grants;
+};
+
+work_stealing_scheduler::work_stealing_scheduler(size_t worker_count)
+{
+    if (worker_count == 0)
+        worker_count = (std::max)(std::thread::hardware_concurrency(), 1u);
+    m_impl.reset(new impl(worker_count));
+}
+
+work_stealing_scheduler::~work_stealing_scheduler()
+{
+}
+
+void work_stealing_scheduler::schedule(TaskProc_t proc, void* param)
+{
+    m_impl->schedule(task_item { proc, param });
+}
+
+size_t work_stealing_scheduler::worker_count() const
+{
+    return m_impl->workers.size();
+}
+
+} // namespace pplx
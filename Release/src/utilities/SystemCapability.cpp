@@ -1,6 +1,6 @@
 #include "stdafx.h"
 #include "Windows.h"
-#include "..\..\include\cpprest\details\SystemCapability.h"
+#include "cpprest/details/SystemCapability.h"
 
 
 namespace cpprestsdk
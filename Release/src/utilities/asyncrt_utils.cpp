@@ -12,10 +12,12 @@
 ****/
 
 #include "stdafx.h"
-#include "..\..\include\cpprest\asyncrt_utils.h"
+#include "cpprest/asyncrt_utils.h"
+#ifdef _WIN32
 struct IUnknown;
 #include <urlmon.h>
 #include <winhttp.h>
+#endif
 
 #ifndef _WIN32
 #if defined(__clang__)
@@ -1127,7 +1129,21 @@ std::wstring conversions::convert_string_t_to_wstring(string_t src)
 #ifdef _UTF16_STRINGS
 	return /*convert_utf16_to_utf16*/(std::move(src));
 #else
-	return convert_utf8_to_utf16(std::move(src));
+	// wchar_t holds whole code points outside Windows, so surrogate pairs are combined
+	const utf16string utf16 = utf8_to_utf16(src);
+	std::wstring result;
+	result.reserve(utf16.size());
+	for (size_t i = 0; i < utf16.size(); ++i)
+	{
+		uint32_t ch = utf16[i];
+		if (ch >= H_SURROGATE_START && ch <= H_SURROGATE_END && i + 1 < utf16.size()
+			&& utf16[i + 1] >= L_SURROGATE_START && utf16[i + 1] <= L_SURROGATE_END)
+		{
+			ch = ((ch - H_SURROGATE_START) << 10) + (utf16[++i] - L_SURROGATE_START) + SURROGATE_PAIR_START;
+		}
+		result.push_back(static_cast<wchar_t>(ch));
+	}
+	return result;
 #endif
 }
 
@@ -9,7 +9,7 @@
 * =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
 ****/
 #include "stdafx.h"
-#include "..\..\include\cpprest\asyncrt_utils.h"
+#include "cpprest/asyncrt_utils.h"
 
 //using namespace web;
 using namespace utility;
@@ -0,0 +1,177 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Library-wide counters and latency histograms.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "stdafx.h"
+#include "cpprest/metrics.h"
+#include "cpprest/json.h"
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+namespace utility { namespace metrics {
+
+namespace
+{
+    unsigned highest_bit(uint64_t value)
+    {
+#if defined(_MSC_VER)
+        unsigned long index;
+        _BitScanReverse64(&index, value);
+        return static_cast<unsigned>(index);
+#else
+        return 63 - static_cast<unsigned>(__builtin_clzll(value));
+#endif
+    }
+
+    uint64_t percentile(const uint64_t* buckets, uint64_t count, double fraction)
+    {
+        // Rank of the value, 1 based, rounded up so that p99 of 10 values is the largest one.
+        auto rank = static_cast<uint64_t>(fraction * static_cast<double>(count));
+        if (static_cast<double>(rank) < fraction * static_cast<double>(count))
+            ++rank;
+        if (rank == 0)
+            rank = 1;
+        uint64_t seen = 0;
+        for (size_t i = 0; i < histogram::bucket_count; ++i)
+        {
+            seen += buckets[i];
+            if (seen >= rank)
+                return histogram::bucket_upper_bound(i);
+        }
+        return 0;
+    }
+
+    const struct
+    {
+        const utility::char_t* name;
+        counter library_metrics::* member;
+    } counters[] =
+    {
+        { _XPLATSTR("http.requests_in_flight"), &library_metrics::http_requests_in_flight },
+        { _XPLATSTR("http.requests_completed"), &library_metrics::http_requests_completed },
+        { _XPLATSTR("http.requests_failed"), &library_metrics::http_requests_failed },
+        { _XPLATSTR("http.request_body_bytes"), &library_metrics::http_request_body_bytes },
+        { _XPLATSTR("http.response_body_bytes"), &library_metrics::http_response_body_bytes },
+        { _XPLATSTR("http.pool_hits"), &library_metrics::http_pool_hits },
+        { _XPLATSTR("http.pool_misses"), &library_metrics::http_pool_misses },
+        { _XPLATSTR("pplx.queue_depth"), &library_metrics::pplx_queue_depth },
+        { _XPLATSTR("pplx.tasks_executed"), &library_metrics::pplx_tasks_executed },
+        { _XPLATSTR("pplx.blocking_waits"), &library_metrics::pplx_blocking_waits },
+        { _XPLATSTR("pplx.threads_blocked"), &library_metrics::pplx_threads_blocked },
+        { _XPLATSTR("pplx.compensating_threads_started"), &library_metrics::pplx_compensating_threads_started },
+        { _XPLATSTR("pplx.timers_pending"), &library_metrics::pplx_timers_pending },
+        { _XPLATSTR("pplx.timers_fired"), &library_metrics::pplx_timers_fired },
+        { _XPLATSTR("streams.producer_consumer_buffered_bytes"), &library_metrics::streams_buffered_bytes },
+        { _XPLATSTR("json.documents_parsed"), &library_metrics::json_documents_parsed },
+        { _XPLATSTR("json.bytes_parsed"), &library_metrics::json_bytes_parsed },
+    };
+
+    const struct
+    {
+        const utility::char_t* name;
+        histogram library_metrics::* member;
+    } histograms[] =
+    {
+        { _XPLATSTR("http.request_duration_us"), &library_metrics::http_request_duration },
+        { _XPLATSTR("pplx.task_execution_us"), &library_metrics::pplx_task_execution },
+        { _XPLATSTR("json.parse_duration_us"), &library_metrics::json_parse_duration },
+    };
+}
+
+size_t histogram::bucket_index(uint64_t value)
+{
+    if (value < sub_bucket_count)
+        return static_cast<size_t>(value);
+    const auto exponent = highest_bit(value) - sub_bucket_bits;
+    return (exponent + 1) * sub_bucket_count + static_cast<size_t>((value >> exponent) & (sub_bucket_count - 1));
+}
+
+uint64_t histogram::bucket_upper_bound(size_t index)
+{
+    if (index < sub_bucket_count)
+        return index;
+    const auto exponent = index / sub_bucket_count - 1;
+    const auto lower = static_cast<uint64_t>(sub_bucket_count + index % sub_bucket_count) << exponent;
+    return lower + ((uint64_t(1) << exponent) - 1);
+}
+
+void histogram::record(uint64_t value)
+{
+    auto& shard = m_shards[details::current_shard()];
+    shard.buckets[bucket_index(value)].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+histogram_summary histogram::summary() const
+{
+    histogram_summary result;
+    uint64_t buckets[bucket_count] = {};
+    for (const auto& shard : m_shards)
+    {
+        for (size_t i = 0; i < bucket_count; ++i)
+            buckets[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        result.sum += shard.sum.load(std::memory_order_relaxed);
+    }
+    for (size_t i = 0; i < bucket_count; ++i)
+    {
+        if (buckets[i] == 0)
+            continue;
+        result.count += buckets[i];
+        result.max = bucket_upper_bound(i);
+    }
+    if (result.count == 0)
+        return result;
+    result.p50 = percentile(buckets, result.count, 0.5);
+    result.p90 = percentile(buckets, result.count, 0.9);
+    result.p99 = percentile(buckets, result.count, 0.99);
+    result.p999 = percentile(buckets, result.count, 0.999);
+    return result;
+}
+
+library_metrics& library()
+{
+    static library_metrics metrics;
+    return metrics;
+}
+
+web::json::value snapshot()
+{
+    auto& metrics = library();
+
+    auto counter_values = web::json::value::object();
+    for (const auto& entry : counters)
+        counter_values[entry.name] = web::json::value::number((metrics.*entry.member).value());
+
+    auto histogram_values = web::json::value::object();
+    for (const auto& entry : histograms)
+    {
+        const auto summary = (metrics.*entry.member).summary();
+        auto value = web::json::value::object();
+        value[_XPLATSTR("count")] = web::json::value::number(summary.count);
+        value[_XPLATSTR("sum")] = web::json::value::number(summary.sum);
+        value[_XPLATSTR("max")] = web::json::value::number(summary.max);
+        value[_XPLATSTR("p50")] = web::json::value::number(summary.p50);
+        value[_XPLATSTR("p90")] = web::json::value::number(summary.p90);
+        value[_XPLATSTR("p99")] = web::json::value::number(summary.p99);
+        value[_XPLATSTR("p999")] = web::json::value::number(summary.p999);
+        histogram_values[entry.name] = std::move(value);
+    }
+
+    auto result = web::json::value::object();
+    result[_XPLATSTR("counters")] = std::move(counter_values);
+    result[_XPLATSTR("histograms")] = std::move(histogram_values);
+    return result;
+}
+
+}} // namespace utility::metrics
@@ -0,0 +1,137 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Benchmarks for building, copying, destroying, parsing and serializing json::value trees.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "benchmark_harness.h"
+
+#include <chrono>
+#include <iostream>
+#include <memory>
+
+#include "cpprest/json.h"
+
+using namespace web;
+
+namespace
+{
+    const size_t record_count = 200 * 1000;
+    const int rounds = 5;
+
+    // An array of small records, the shape most service payloads have.
+    json::value make_records(size_t count)
+    {
+        auto records = json::value::array(count);
+        for (size_t i = 0; i < count; ++i)
+        {
+            auto record = json::value::object();
+            record[_XPLATSTR("id")] = json::value::number(static_cast<int64_t>(i));
+            record[_XPLATSTR("name")] = json::value::string(_XPLATSTR("item"));
+            record[_XPLATSTR("active")] = json::value::boolean(i % 2 == 0);
+            record[_XPLATSTR("score")] = json::value::number(i * 0.5);
+            record[_XPLATSTR("parent")] = json::value::null();
+            records[i] = std::move(record);
+        }
+        return records;
+    }
+
+    // Records made of string literals of the given length, one in eight with an escape in the middle.
+    utility::string_t make_string_records(size_t count, size_t length)
+    {
+        const utility::string_t plain(length, _XPLATSTR('a'));
+        auto escaped = plain;
+        escaped.replace(length / 2, 1, _XPLATSTR("\\n"));
+
+        utility::string_t text = _XPLATSTR("[");
+        for (size_t i = 0; i < count; ++i)
+        {
+            text += i == 0 ? _XPLATSTR("{\"key\":\"") : _XPLATSTR(",\n  {\"key\":\"");
+            text += i % 8 == 0 ? escaped : plain;
+            text += _XPLATSTR("\",\"other\":\"");
+            text += plain;
+            text += _XPLATSTR("\"}");
+        }
+        return text + _XPLATSTR("]");
+    }
+}
+
+BENCHMARK(json_value_size)
+{
+    std::cout << "  sizeof(json::value)  " << sizeof(json::value) << " bytes" << std::endl;
+    std::cout << "  sizeof(json::number) " << sizeof(json::number) << " bytes" << std::endl;
+}
+
+BENCHMARK(json_value_build_copy_destroy)
+{
+    const double values = static_cast<double>(record_count) * 6;
+    tests::report("build " + std::to_string(record_count) + " records", tests::best_seconds(rounds, []
+    {
+        make_records(record_count);
+    }), values, "values");
+
+    const auto records = make_records(record_count);
+    tests::report("deep copy", tests::best_seconds(rounds, [&records]
+    {
+        json::value copy = records;
+        (void)copy;
+    }), values, "values");
+
+    // Only the destructor is timed, the copy is made before the clock starts.
+    double best = 0;
+    for (int i = 0; i < rounds; ++i)
+    {
+        auto copy = std::make_unique<json::value>(records);
+        const auto start = std::chrono::steady_clock::now();
+        copy.reset();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = i == 0 ? elapsed.count() : (std::min)(best, elapsed.count());
+    }
+    tests::report("destroy", best, values, "values");
+}
+
+BENCHMARK(json_value_parse_serialize)
+{
+    const auto text = make_records(record_count).serialize();
+    const double bytes = static_cast<double>(text.size() * sizeof(utility::char_t));
+
+    tests::report("parse " + std::to_string(text.size() / 1024) + " KB", tests::best_seconds(rounds, [&text]
+    {
+        json::value::parse(text);
+    }), bytes, "bytes");
+
+    const auto parsed = json::value::parse(text);
+    tests::report("serialize", tests::best_seconds(rounds, [&parsed]
+    {
+        parsed.serialize();
+    }), bytes, "bytes");
+}
+
+BENCHMARK(json_string_literal_parse)
+{
+    // Build with CPPREST_EXCLUDE_JSON_SIMD to compare against the scalar scan.
+#if defined(CPPREST_EXCLUDE_JSON_SIMD)
+    const std::string scan = "scalar";
+#else
+    const std::string scan = "SSE2 where available";
+#endif
+    std::cout << "  string literal scan: " << scan << std::endl;
+
+    const size_t total_length = 32 * 1024 * 1024;
+    for (size_t length : { 8, 32, 128, 1024 })
+    {
+        const auto text = make_string_records(total_length / (2 * length), length);
+        const double bytes = static_cast<double>(text.size() * sizeof(utility::char_t));
+        tests::report(std::to_string(length) + " character literals", tests::best_seconds(rounds, [&text]
+        {
+            json::value::parse(text);
+        }), bytes, "bytes");
+    }
+}
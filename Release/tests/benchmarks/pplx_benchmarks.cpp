@@ -0,0 +1,247 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Benchmarks for the pooled task allocations, against operator new, for creating and running tasks, for
+* registering on cancellation tokens, and for the work-stealing scheduler against the asio pool.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "benchmark_harness.h"
+
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "pplx/pplxtasks.h"
+#include "pplx/work_stealing_scheduler.h"
+
+namespace
+{
+    const size_t allocation_count = 1000 * 1000;
+    const size_t batch = 256;
+    const int rounds = 5;
+
+    struct pooled
+    {
+        static void* allocate(size_t size) { return pplx::details::_Allocate_pooled(size); }
+        static void free(void* ptr, size_t size) { pplx::details::_Free_pooled(ptr, size); }
+    };
+
+    struct global_new
+    {
+        static void* allocate(size_t size) { return ::operator new(size); }
+        static void free(void* ptr, size_t) { ::operator delete(ptr); }
+    };
+
+    // Allocates and frees in batches on one thread, the way a chain of continuations does.
+    template<typename Allocator>
+    void same_thread(size_t size)
+    {
+        std::vector<void*> blocks(batch);
+        for (size_t done = 0; done < allocation_count; done += batch)
+        {
+            for (auto& b : blocks)
+                b = Allocator::allocate(size);
+            for (auto b : blocks)
+                Allocator::free(b, size);
+        }
+    }
+
+    // Allocates on this thread and frees on another, the way continuations completed by an I/O thread do.
+    template<typename Allocator>
+    void cross_thread(size_t size)
+    {
+        std::vector<std::vector<void*>> batches(allocation_count / batch, std::vector<void*>(batch));
+        for (auto& blocks : batches)
+            for (auto& b : blocks)
+                b = Allocator::allocate(size);
+        std::thread([&batches, size]
+        {
+            for (auto& blocks : batches)
+                for (auto b : blocks)
+                    Allocator::free(b, size);
+        }).join();
+    }
+
+    // Fork/join without blocking: each task joins its children with a continuation.
+    pplx::task<size_t> fork_join(const pplx::task_options& options, size_t depth)
+    {
+        if (depth == 0)
+            return pplx::task_from_result<size_t>(1);
+        auto left = pplx::create_task([options, depth] { return fork_join(options, depth - 1); }, options);
+        auto right = pplx::create_task([options, depth] { return fork_join(options, depth - 1); }, options);
+        return (left && right).then([](std::vector<size_t> sums) { return sums[0] + sums[1]; });
+    }
+
+    // Fork/join where each task blocks until its children are done.
+    size_t blocking_fork_join(const pplx::task_options& options, size_t depth)
+    {
+        if (depth == 0)
+            return 1;
+        auto left = pplx::create_task([options, depth] { return blocking_fork_join(options, depth - 1); }, options);
+        auto right = pplx::create_task([options, depth] { return blocking_fork_join(options, depth - 1); }, options);
+        return left.get() + right.get();
+    }
+
+    void scheduler_cases(const std::string& label, const pplx::task_options& options)
+    {
+        const size_t task_count = 100 * 1000;
+        const size_t chain_length = 100 * 1000;
+        const size_t fork_depth = 15;
+        const size_t blocking_depth = 10;
+
+        tests::report(label + ", independent tasks", tests::best_seconds(rounds, [&options, task_count]
+        {
+            std::vector<pplx::task<void>> tasks;
+            tasks.reserve(task_count);
+            for (size_t i = 0; i < task_count; ++i)
+                tasks.push_back(pplx::create_task([] {}, options));
+            pplx::when_all(tasks.begin(), tasks.end()).wait();
+        }), static_cast<double>(task_count), "tasks");
+
+        tests::report(label + ", continuation chain", tests::best_seconds(rounds, [&options, chain_length]
+        {
+            auto task = pplx::create_task([] { return 0; }, options);
+            for (size_t i = 0; i < chain_length; ++i)
+                task = task.then([](int value) { return value + 1; });
+            task.wait();
+        }), static_cast<double>(chain_length), "tasks");
+
+        tests::report(label + ", fork/join", tests::best_seconds(rounds, [&options, fork_depth]
+        {
+            pplx::create_task([options, fork_depth] { return fork_join(options, fork_depth); }, options).wait();
+        }), static_cast<double>((static_cast<size_t>(2) << fork_depth) - 1), "tasks");
+
+        tests::report(label + ", blocking fork/join", tests::best_seconds(rounds, [&options, blocking_depth]
+        {
+            pplx::create_task([options, blocking_depth] { return blocking_fork_join(options, blocking_depth); }, options).wait();
+        }), static_cast<double>((static_cast<size_t>(2) << blocking_depth) - 1), "tasks");
+    }
+}
+
+BENCHMARK(pooled_allocation)
+{
+    for (size_t size : { 64, 128, 256 })
+    {
+        const auto label = std::to_string(size) + " bytes";
+        tests::report("same thread, pooled, " + label, tests::best_seconds(rounds, [size] { same_thread<pooled>(size); }),
+            static_cast<double>(allocation_count), "allocs");
+        tests::report("same thread, operator new, " + label, tests::best_seconds(rounds, [size] { same_thread<global_new>(size); }),
+            static_cast<double>(allocation_count), "allocs");
+        tests::report("cross thread, pooled, " + label, tests::best_seconds(rounds, [size] { cross_thread<pooled>(size); }),
+            static_cast<double>(allocation_count), "allocs");
+        tests::report("cross thread, operator new, " + label, tests::best_seconds(rounds, [size] { cross_thread<global_new>(size); }),
+            static_cast<double>(allocation_count), "allocs");
+    }
+}
+
+BENCHMARK(task_creation)
+{
+    const size_t task_count = 100 * 1000;
+
+    // A completed task and one continuation: two impls, one handle and the functor, all pooled.
+    tests::report("task_from_result().then()", tests::best_seconds(rounds, [task_count]
+    {
+        std::vector<pplx::task<int>> tasks;
+        tasks.reserve(task_count);
+        for (size_t i = 0; i < task_count; ++i)
+            tasks.push_back(pplx::task_from_result(static_cast<int>(i)).then([](int value) { return value + 1; }));
+        pplx::when_all(tasks.begin(), tasks.end()).wait();
+    }), static_cast<double>(task_count), "tasks");
+
+    tests::report("task_completion_event, set on another thread", tests::best_seconds(rounds, [task_count]
+    {
+        std::vector<pplx::task_completion_event<int>> events(task_count);
+        std::vector<pplx::task<int>> tasks;
+        tasks.reserve(task_count);
+        for (auto& tce : events)
+            tasks.push_back(pplx::create_task(tce).then([](int value) { return value + 1; }));
+        std::thread([&events]
+        {
+            for (auto& tce : events)
+                tce.set(1);
+        }).join();
+        pplx::when_all(tasks.begin(), tasks.end()).wait();
+    }), static_cast<double>(task_count), "tasks");
+}
+
+BENCHMARK(cancellation_registration)
+{
+    const size_t registration_count = 200 * 1000;
+
+    // The pattern of a request: register on the caller's token, deregister once the response is in.
+    tests::report("register + deregister, one thread", tests::best_seconds(rounds, [registration_count]
+    {
+        pplx::cancellation_token_source source;
+        auto token = source.get_token();
+        for (size_t i = 0; i < registration_count; ++i)
+            token.deregister_callback(token.register_callback([] {}));
+    }), static_cast<double>(registration_count), "registrations");
+
+    // Many requests outstanding on one token, deregistered in the order they complete.
+    tests::report("register all, then deregister all", tests::best_seconds(rounds, [registration_count]
+    {
+        pplx::cancellation_token_source source;
+        auto token = source.get_token();
+        std::vector<pplx::cancellation_token_registration> registrations;
+        registrations.reserve(registration_count);
+        for (size_t i = 0; i < registration_count; ++i)
+            registrations.push_back(token.register_callback([] {}));
+        for (const auto& registration : registrations)
+            token.deregister_callback(registration);
+    }), static_cast<double>(registration_count), "registrations");
+
+    const size_t threads = 4;
+    tests::report("register + deregister, " + std::to_string(threads) + " threads on one token", tests::best_seconds(rounds, [registration_count, threads]
+    {
+        pplx::cancellation_token_source source;
+        auto token = source.get_token();
+        std::vector<std::thread> workers;
+        for (size_t t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([token, registration_count, threads]
+            {
+                for (size_t i = 0; i < registration_count / threads; ++i)
+                    token.deregister_callback(token.register_callback([] {}));
+            });
+        }
+        for (auto& worker : workers)
+            worker.join();
+    }), static_cast<double>(registration_count), "registrations");
+
+    tests::report("cancel with every callback registered", tests::best_seconds(rounds, [registration_count]
+    {
+        pplx::cancellation_token_source source;
+        auto token = source.get_token();
+        for (size_t i = 0; i < registration_count; ++i)
+            token.register_callback([] {});
+        source.cancel();
+    }), static_cast<double>(registration_count), "registrations");
+
+    tests::report("register on a canceled token", tests::best_seconds(rounds, [registration_count]
+    {
+        pplx::cancellation_token_source source;
+        source.cancel();
+        auto token = source.get_token();
+        for (size_t i = 0; i < registration_count; ++i)
+            token.register_callback([] {});
+    }), static_cast<double>(registration_count), "registrations");
+}
+
+BENCHMARK(scheduler)
+{
+    // The ambient scheduler is left alone, both run side by side through task_options.
+    scheduler_cases("asio pool", pplx::task_options(pplx::get_ambient_scheduler()));
+
+    auto work_stealing = std::make_shared<pplx::work_stealing_scheduler>();
+    scheduler_cases("work stealing", pplx::task_options(work_stealing));
+    // Its destructor joins the workers, so it must not run on one when they free the last task impls.
+    while (work_stealing.use_count() > 1)
+        std::this_thread::yield();
+}
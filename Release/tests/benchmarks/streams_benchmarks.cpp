@@ -0,0 +1,111 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Benchmarks for the read-ahead window behind streambuf_from_Stream, against the buffer it replaced, which was
+* allocated for each read and filled by as many source reads as it took.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "benchmark_harness.h"
+
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "cpprest/details/read_window.h"
+
+using Concurrency::streams::details::read_window;
+
+namespace
+{
+    const size_t source_size = 64 * 1024 * 1024;
+    const size_t read_chunk_size = 64 * 1024;
+    const int rounds = 5;
+
+    // Stands in for the .Net Stream: hands out at most one read chunk per call, like FillWindow asks for.
+    class memory_source
+    {
+    public:
+        explicit memory_source(const std::vector<uint8_t>& data) : m_data(data), m_offset(0) {}
+
+        size_t operator()(uint8_t* ptr, size_t count)
+        {
+            const auto stored = (std::min)({ count, read_chunk_size, m_data.size() - m_offset });
+            std::memcpy(ptr, m_data.data() + m_offset, stored);
+            m_offset += stored;
+            return stored;
+        }
+
+    private:
+        const std::vector<uint8_t>& m_data;
+        size_t m_offset;
+    };
+
+    // sbumpcn on the window: fill, copy out, consume.
+    size_t read_through_window(const std::vector<uint8_t>& data, size_t read_size)
+    {
+        memory_source source(data);
+        read_window window;
+        std::vector<uint8_t> out(read_size);
+        size_t total = 0;
+        for (;;)
+        {
+            window.fill(read_size, source);
+            const auto available = (std::min)(read_size, window.size());
+            if (available == 0)
+                return total;
+            window.copy_to(out.data(), available);
+            window.consume(available);
+            total += available;
+        }
+    }
+
+    // sbumpcn before the window: a fresh buffer of the asked size, read whole, copied out and dropped.
+    size_t read_through_buffer_per_read(const std::vector<uint8_t>& data, size_t read_size)
+    {
+        memory_source source(data);
+        std::vector<uint8_t> out(read_size);
+        size_t total = 0;
+        for (;;)
+        {
+            std::vector<uint8_t> buffer(read_size);
+            size_t available = 0;
+            while (available < read_size)
+            {
+                const auto stored = source(buffer.data() + available, read_size - available);
+                if (stored == 0)
+                    break;
+                available += stored;
+            }
+            if (available == 0)
+                return total;
+            std::memcpy(out.data(), buffer.data(), available);
+            total += available;
+        }
+    }
+}
+
+BENCHMARK(read_window_throughput)
+{
+    const std::vector<uint8_t> data(source_size, 0x5a);
+
+    for (size_t read_size : { static_cast<size_t>(1), static_cast<size_t>(4 * 1024), static_cast<size_t>(1024 * 1024) })
+    {
+        // Byte-sized reads of the whole source take too long to repeat, so those read a part of it
+        const auto size = read_size == 1 ? source_size / 16 : source_size;
+        const std::vector<uint8_t> source(data.begin(), data.begin() + size);
+        const auto label = std::to_string(read_size) + " byte reads";
+
+        tests::report("read window, " + label, tests::best_seconds(rounds, [&source, read_size] { read_through_window(source, read_size); }),
+            static_cast<double>(size) / (1024 * 1024), "MB");
+        tests::report("buffer per read, " + label, tests::best_seconds(rounds, [&source, read_size] { read_through_buffer_per_read(source, read_size); }),
+            static_cast<double>(size) / (1024 * 1024), "MB");
+    }
+}
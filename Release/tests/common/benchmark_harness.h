@@ -0,0 +1,72 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Minimal benchmark registry, the counterpart of test_harness.h. Each executable defines its cases with BENCHMARK
+* and runs them from benchmark_main.cpp. Benchmarks are not registered with ctest, run them by hand on a quiet machine.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <limits>
+#include <string>
+#include <vector>
+
+namespace tests
+{
+    struct benchmark_case
+    {
+        const char* name;
+        std::function<void()> body;
+    };
+
+    inline std::vector<benchmark_case>& registered_benchmarks()
+    {
+        static std::vector<benchmark_case> benchmarks;
+        return benchmarks;
+    }
+
+    struct benchmark_registrar
+    {
+        benchmark_registrar(const char* name, std::function<void()> body)
+        {
+            registered_benchmarks().push_back(benchmark_case{name, std::move(body)});
+        }
+    };
+
+    // Runs body once to warm up, then rounds more times, and returns the fastest run in seconds.
+    template<typename Body>
+    double best_seconds(int rounds, Body&& body)
+    {
+        body();
+        double best = (std::numeric_limits<double>::max)();
+        for (int i = 0; i < rounds; ++i)
+        {
+            const auto start = std::chrono::steady_clock::now();
+            body();
+            const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+            best = (std::min)(best, elapsed.count());
+        }
+        return best;
+    }
+
+    // Prints one line: what was measured, the time of a run, and units per second when units is not zero.
+    void report(const std::string& name, double seconds, double units = 0, const char* unit = "");
+
+    // Runs every registered benchmark, or only the ones named on the command line.
+    int run_benchmarks(int argc, char** argv);
+}
+
+#define BENCHMARK(name) \
+    static void name(); \
+    static ::tests::benchmark_registrar name##_registrar(#name, &name); \
+    static void name()
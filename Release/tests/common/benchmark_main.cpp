@@ -0,0 +1,63 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Entry point of the benchmark executables.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "benchmark_harness.h"
+
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+void tests::report(const std::string& name, double seconds, double units, const char* unit)
+{
+    char line[256];
+    if (units > 0)
+        std::snprintf(line, sizeof(line), "  %-48s %10.3f ms %14.1f %s/s", name.c_str(), seconds * 1e3, units / seconds, unit);
+    else
+        std::snprintf(line, sizeof(line), "  %-48s %10.3f ms", name.c_str(), seconds * 1e3);
+    std::cout << line << std::endl;
+}
+
+int tests::run_benchmarks(int argc, char** argv)
+{
+    int failures = 0;
+    for (const auto& benchmark : registered_benchmarks())
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc && !selected; ++i)
+        {
+            selected = std::strcmp(argv[i], benchmark.name) == 0;
+        }
+        if (!selected)
+        {
+            continue;
+        }
+
+        std::cout << benchmark.name << std::endl;
+        try
+        {
+            benchmark.body();
+        }
+        catch (const std::exception& e)
+        {
+            ++failures;
+            std::cout << "  failed: " << e.what() << std::endl;
+        }
+    }
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    return tests::run_benchmarks(argc, argv) == 0 ? 0 : 1;
+}
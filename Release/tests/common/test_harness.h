@@ -0,0 +1,92 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Minimal test registry for the non-Windows test executables. Each executable defines its cases with TEST and
+* runs them from test_main.cpp; ctest runs every executable.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#pragma once
+
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace tests
+{
+    struct test_case
+    {
+        const char* name;
+        std::function<void()> body;
+    };
+
+    inline std::vector<test_case>& registered_tests()
+    {
+        static std::vector<test_case> tests;
+        return tests;
+    }
+
+    struct test_registrar
+    {
+        test_registrar(const char* name, std::function<void()> body)
+        {
+            registered_tests().push_back(test_case{name, std::move(body)});
+        }
+    };
+
+    class test_failure : public std::runtime_error
+    {
+    public:
+        explicit test_failure(const std::string& message) : std::runtime_error(message) {}
+    };
+
+    inline void fail(const char* file, int line, const std::string& message)
+    {
+        std::ostringstream out;
+        out << file << ":" << line << ": " << message;
+        throw test_failure(out.str());
+    }
+
+    // Runs every registered case, or only the ones named on the command line. Returns the number of failures.
+    int run_tests(int argc, char** argv);
+}
+
+#define TEST(name) \
+    static void name(); \
+    static ::tests::test_registrar name##_registrar(#name, &name); \
+    static void name()
+
+#define VERIFY_IS_TRUE(expression) \
+    do { if (!(expression)) ::tests::fail(__FILE__, __LINE__, "VERIFY_IS_TRUE(" #expression ")"); } while (false)
+
+#define VERIFY_IS_FALSE(expression) \
+    do { if (expression) ::tests::fail(__FILE__, __LINE__, "VERIFY_IS_FALSE(" #expression ")"); } while (false)
+
+#define VERIFY_ARE_EQUAL(expected, actual) \
+    do \
+    { \
+        const auto& expected_ = (expected); \
+        const auto& actual_ = (actual); \
+        if (!(expected_ == actual_)) \
+        { \
+            std::ostringstream message_; \
+            message_ << "VERIFY_ARE_EQUAL(" #expected ", " #actual "): expected " << expected_ << ", got " << actual_; \
+            ::tests::fail(__FILE__, __LINE__, message_.str()); \
+        } \
+    } while (false)
+
+#define VERIFY_THROWS(expression, exception) \
+    do \
+    { \
+        bool thrown_ = false; \
+        try { expression; } catch (const exception&) { thrown_ = true; } \
+        if (!thrown_) ::tests::fail(__FILE__, __LINE__, "VERIFY_THROWS(" #expression ", " #exception ")"); \
+    } while (false)
@@ -0,0 +1,64 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Entry point of the test executables.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "test_harness.h"
+
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <iostream>
+
+int tests::run_tests(int argc, char** argv)
+{
+    int failures = 0;
+    int run = 0;
+    for (const auto& test : registered_tests())
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc && !selected; ++i)
+        {
+            selected = std::strcmp(argv[i], test.name) == 0;
+        }
+        if (!selected)
+        {
+            continue;
+        }
+
+        ++run;
+        const auto start = std::chrono::steady_clock::now();
+        try
+        {
+            test.body();
+            const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start);
+            std::cout << "[ OK ] " << test.name << " (" << elapsed.count() << " ms)" << std::endl;
+        }
+        catch (const std::exception& e)
+        {
+            ++failures;
+            std::cout << "[FAIL] " << test.name << ": " << e.what() << std::endl;
+        }
+        catch (...)
+        {
+            ++failures;
+            std::cout << "[FAIL] " << test.name << ": unknown exception" << std::endl;
+        }
+    }
+
+    std::cout << run - failures << " of " << run << " tests passed" << std::endl;
+    return failures;
+}
+
+int main(int argc, char** argv)
+{
+    return tests::run_tests(argc, argv) == 0 ? 0 : 1;
+}
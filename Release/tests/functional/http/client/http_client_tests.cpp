@@ -0,0 +1,184 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Tests for the native Boost.Asio transport against a server on the loopback interface.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "test_harness.h"
+#include "loopback_server.h"
+
+#include "cpprest/http_client.h"
+#include "cpprest/producerconsumerstream.h"
+
+using namespace web::http;
+using namespace web::http::client;
+using namespace tests::functional::http::client;
+
+namespace
+{
+    // Several upload windows worth of bytes that do not repeat within a window.
+    std::string make_upload(size_t size)
+    {
+        std::string body(size, '\0');
+        for (size_t i = 0; i < size; ++i)
+        {
+            body[i] = static_cast<char>((i * 7 + i / 251) & 0xff);
+        }
+        return body;
+    }
+
+    // Written in small blocks, so the client cannot borrow the body in place and has to stream it.
+    concurrency::streams::istream make_stream(const std::string& body)
+    {
+        concurrency::streams::producer_consumer_buffer<uint8_t> buffer;
+        for (size_t offset = 0; offset < body.size(); offset += 4096)
+        {
+            const auto size = (std::min)(body.size() - offset, static_cast<size_t>(4096));
+            buffer.putn_nocopy(reinterpret_cast<const uint8_t*>(body.data()) + offset, size).wait();
+        }
+        buffer.close(std::ios_base::out).wait();
+        return buffer.create_istream();
+    }
+}
+
+TEST(get_returns_body)
+{
+    loopback_server server([](const recorded_request&)
+    {
+        test_response response;
+        response.body = "hello";
+        response.headers["Content-Type"] = "text/plain";
+        return response;
+    });
+
+    http_client client(server.uri());
+    http_response response = client.request(methods::GET, "path?x=1").get();
+
+    VERIFY_ARE_EQUAL(status_codes::OK, response.status_code());
+    VERIFY_ARE_EQUAL(std::string("hello"), response.extract_string().get());
+
+    const auto requests = server.requests();
+    VERIFY_ARE_EQUAL(1u, requests.size());
+    VERIFY_ARE_EQUAL(std::string("GET"), requests[0].method);
+    VERIFY_ARE_EQUAL(std::string("/path?x=1"), requests[0].path);
+    VERIFY_IS_TRUE(requests[0].body.empty());
+}
+
+TEST(post_sends_body)
+{
+    loopback_server server;
+
+    http_client client(server.uri());
+    http_response response = client.request(methods::POST, "upload", std::string("request payload"), "text/plain").get();
+
+    VERIFY_ARE_EQUAL(status_codes::OK, response.status_code());
+    VERIFY_ARE_EQUAL(std::string("request payload"), response.extract_string(true).get());
+
+    const auto requests = server.requests();
+    VERIFY_ARE_EQUAL(1u, requests.size());
+    VERIFY_ARE_EQUAL(std::string("POST"), requests[0].method);
+    VERIFY_ARE_EQUAL(std::string("/upload"), requests[0].path);
+    VERIFY_ARE_EQUAL(std::string("request payload"), requests[0].body);
+    VERIFY_ARE_EQUAL(std::string("15"), requests[0].headers.at("content-length"));
+}
+
+TEST(keep_alive_reuses_connection)
+{
+    loopback_server server;
+
+    http_client client(server.uri());
+    for (int i = 0; i < 3; ++i)
+    {
+        const std::string body = "request " + std::to_string(i);
+        http_response response = client.request(methods::PUT, "", body, "text/plain").get();
+        VERIFY_ARE_EQUAL(body, response.extract_string(true).get());
+    }
+
+    VERIFY_ARE_EQUAL(1u, server.connections());
+    for (const auto& request : server.requests())
+    {
+        VERIFY_ARE_EQUAL(1u, request.connection);
+    }
+
+    const auto stats = client.pool_stats();
+    VERIFY_ARE_EQUAL(1u, stats.connections_created);
+    VERIFY_ARE_EQUAL(2u, stats.connections_reused);
+}
+
+TEST(stream_without_length_is_sent_chunked)
+{
+    loopback_server server([](const recorded_request&) { return test_response(); });
+    const auto body = make_upload(1024 * 1024 + 17);
+
+    http_client client(server.uri());
+    http_response response = client.request(methods::POST, "upload", make_stream(body)).get();
+    VERIFY_ARE_EQUAL(status_codes::OK, response.status_code());
+
+    // The body leaves in bounded windows, one chunk each, instead of being collected first.
+    const auto requests = server.requests();
+    VERIFY_ARE_EQUAL(1u, requests.size());
+    VERIFY_IS_TRUE(requests[0].chunked);
+    VERIFY_IS_TRUE(requests[0].headers.find("content-length") == requests[0].headers.end());
+    VERIFY_IS_TRUE(requests[0].chunks >= body.size() / (64 * 1024));
+    VERIFY_IS_TRUE(requests[0].body == body);
+}
+
+TEST(stream_with_length_is_sent_with_content_length)
+{
+    loopback_server server([](const recorded_request&) { return test_response(); });
+    const auto body = make_upload(300 * 1024);
+
+    http_client client(server.uri());
+    http_response response = client.request(methods::PUT, "upload", make_stream(body), body.size()).get();
+    VERIFY_ARE_EQUAL(status_codes::OK, response.status_code());
+
+    const auto requests = server.requests();
+    VERIFY_ARE_EQUAL(1u, requests.size());
+    VERIFY_IS_FALSE(requests[0].chunked);
+    VERIFY_ARE_EQUAL(std::to_string(body.size()), requests[0].headers.at("content-length"));
+    VERIFY_IS_TRUE(requests[0].body == body);
+}
+
+TEST(stream_shorter_than_content_length_fails)
+{
+    loopback_server server;
+    const auto body = make_upload(1000);
+
+    http_client client(server.uri());
+    VERIFY_THROWS(client.request(methods::PUT, "upload", make_stream(body), body.size() + 1).get(), http_exception);
+}
+
+TEST(compressed_body_is_sent_chunked)
+{
+    namespace compression = web::http::details::compression;
+    if (!compression::stream_compressor::is_supported(compression::compression_algorithm::gzip))
+    {
+        return;
+    }
+
+    loopback_server server([](const recorded_request&) { return test_response(); });
+    const auto body = make_upload(512 * 1024);
+
+    http_client_config config;
+    config.set_request_body_compression(_XPLATSTR("gzip"));
+    http_client client(server.uri(), config);
+    http_response response = client.request(methods::POST, "upload", make_stream(body)).get();
+    VERIFY_ARE_EQUAL(status_codes::OK, response.status_code());
+
+    const auto requests = server.requests();
+    VERIFY_ARE_EQUAL(1u, requests.size());
+    VERIFY_IS_TRUE(requests[0].chunked);
+    VERIFY_ARE_EQUAL(std::string("gzip"), requests[0].headers.at("content-encoding"));
+
+    compression::stream_decompressor decompressor(compression::compression_algorithm::gzip);
+    const auto& sent = requests[0].body;
+    const auto inflated = decompressor.decompress(reinterpret_cast<const uint8_t*>(sent.data()), sent.size());
+    VERIFY_IS_TRUE(std::string(inflated.begin(), inflated.end()) == body);
+}
@@ -0,0 +1,314 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* HTTP/1.1 server on the loopback interface for the http_client tests. It records every request and the connection
+* it arrived on, so the tests can check bodies, framing and connection reuse.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#pragma once
+
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <boost/asio.hpp>
+
+namespace tests { namespace functional { namespace http { namespace client
+{
+    struct recorded_request
+    {
+        std::string method;
+        std::string path;
+        // Header names in lower case
+        std::map<std::string, std::string> headers;
+        std::string body;
+        bool chunked = false;
+        // Number of chunks a chunked body arrived in
+        size_t chunks = 0;
+        // Counts from 1 in the order the server accepted the connections
+        size_t connection = 0;
+    };
+
+    struct test_response
+    {
+        int status = 200;
+        std::string body;
+        std::map<std::string, std::string> headers;
+    };
+
+    class loopback_server
+    {
+    public:
+        typedef std::function<test_response(const recorded_request&)> handler_t;
+
+        // Answers 200 with the request body echoed back, unless a handler is given.
+        explicit loopback_server(handler_t handler = handler_t())
+            : m_acceptor(m_service), m_handler(std::move(handler)), m_connections(0)
+        {
+            using boost::asio::ip::tcp;
+            tcp::endpoint endpoint(boost::asio::ip::address_v4::loopback(), 0);
+            m_acceptor.open(endpoint.protocol());
+            m_acceptor.bind(endpoint);
+            m_acceptor.listen();
+            accept();
+            m_thread = std::thread([this]() { m_service.run(); });
+        }
+
+        ~loopback_server()
+        {
+            boost::asio::post(m_service, [this]()
+            {
+                boost::system::error_code ignored;
+                m_acceptor.close(ignored);
+                for (auto& weak : m_sessions)
+                {
+                    if (auto session = weak.lock())
+                    {
+                        session->socket.close(ignored);
+                    }
+                }
+            });
+            // Closing the acceptor and the sockets cancels every pending operation, which ends run()
+            m_thread.join();
+        }
+
+        std::string uri() const
+        {
+            return "http://127.0.0.1:" + std::to_string(m_acceptor.local_endpoint().port()) + "/";
+        }
+
+        std::vector<recorded_request> requests() const
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            return m_requests;
+        }
+
+        size_t connections() const
+        {
+            std::lock_guard<std::mutex> lock(m_lock);
+            return m_connections;
+        }
+
+    private:
+        struct session
+        {
+            explicit session(boost::asio::io_context& service) : socket(service) {}
+
+            boost::asio::ip::tcp::socket socket;
+            boost::asio::streambuf buffer;
+            recorded_request request;
+            std::string response;
+        };
+
+        void accept()
+        {
+            auto next = std::make_shared<session>(m_service);
+            m_acceptor.async_accept(next->socket, [this, next](const boost::system::error_code& ec)
+            {
+                if (ec)
+                {
+                    return;
+                }
+                {
+                    std::lock_guard<std::mutex> lock(m_lock);
+                    next->request.connection = ++m_connections;
+                }
+                m_sessions.push_back(next);
+                read_headers(next);
+                accept();
+            });
+        }
+
+        static std::string lower(std::string value)
+        {
+            std::transform(value.begin(), value.end(), value.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+            return value;
+        }
+
+        static std::string take_line(std::istream& in)
+        {
+            std::string line;
+            std::getline(in, line);
+            if (!line.empty() && line.back() == '\r')
+            {
+                line.pop_back();
+            }
+            return line;
+        }
+
+        void read_headers(const std::shared_ptr<session>& s)
+        {
+            boost::asio::async_read_until(s->socket, s->buffer, "\r\n\r\n", [this, s](const boost::system::error_code& ec, size_t)
+            {
+                if (ec)
+                {
+                    return;
+                }
+
+                const size_t connection = s->request.connection;
+                s->request = recorded_request();
+                s->request.connection = connection;
+
+                std::istream in(&s->buffer);
+                std::string line = take_line(in);
+                const auto first = line.find(' ');
+                const auto second = line.find(' ', first + 1);
+                s->request.method = line.substr(0, first);
+                s->request.path = line.substr(first + 1, second - first - 1);
+                while (!(line = take_line(in)).empty())
+                {
+                    const auto colon = line.find(':');
+                    auto value = line.substr(colon + 1);
+                    value.erase(0, value.find_first_not_of(' '));
+                    s->request.headers[lower(line.substr(0, colon))] = value;
+                }
+
+                const auto& headers = s->request.headers;
+                const auto encoding = headers.find("transfer-encoding");
+                const auto length = headers.find("content-length");
+                if (encoding != headers.end() && lower(encoding->second) == "chunked")
+                {
+                    s->request.chunked = true;
+                    read_chunk_size(s);
+                }
+                else
+                {
+                    read_body(s, length == headers.end() ? 0 : static_cast<size_t>(std::strtoull(length->second.c_str(), nullptr, 10)));
+                }
+            });
+        }
+
+        void read_body(const std::shared_ptr<session>& s, size_t size)
+        {
+            const size_t buffered = std::min(size, s->buffer.size());
+            boost::asio::async_read(s->socket, s->buffer, boost::asio::transfer_exactly(size - buffered),
+                [this, s, size](const boost::system::error_code& ec, size_t)
+            {
+                if (ec)
+                {
+                    return;
+                }
+                s->request.body.append(boost::asio::buffers_begin(s->buffer.data()), boost::asio::buffers_begin(s->buffer.data()) + size);
+                s->buffer.consume(size);
+                respond(s);
+            });
+        }
+
+        void read_chunk_size(const std::shared_ptr<session>& s)
+        {
+            boost::asio::async_read_until(s->socket, s->buffer, "\r\n", [this, s](const boost::system::error_code& ec, size_t)
+            {
+                if (ec)
+                {
+                    return;
+                }
+                std::istream in(&s->buffer);
+                const size_t size = static_cast<size_t>(std::strtoull(take_line(in).c_str(), nullptr, 16));
+                if (size == 0)
+                {
+                    // No trailers are sent by the client, only the final CRLF
+                    boost::asio::async_read_until(s->socket, s->buffer, "\r\n", [this, s](const boost::system::error_code& ec, size_t)
+                    {
+                        if (!ec)
+                        {
+                            std::istream in(&s->buffer);
+                            take_line(in);
+                            respond(s);
+                        }
+                    });
+                    return;
+                }
+                read_chunk_data(s, size);
+            });
+        }
+
+        void read_chunk_data(const std::shared_ptr<session>& s, size_t size)
+        {
+            const size_t framed = size + 2;
+            const size_t buffered = std::min(framed, s->buffer.size());
+            boost::asio::async_read(s->socket, s->buffer, boost::asio::transfer_exactly(framed - buffered),
+                [this, s, size](const boost::system::error_code& ec, size_t)
+            {
+                if (ec)
+                {
+                    return;
+                }
+                s->request.body.append(boost::asio::buffers_begin(s->buffer.data()), boost::asio::buffers_begin(s->buffer.data()) + size);
+                s->buffer.consume(size + 2);
+                ++s->request.chunks;
+                read_chunk_size(s);
+            });
+        }
+
+        void respond(const std::shared_ptr<session>& s)
+        {
+            test_response response;
+            if (m_handler)
+            {
+                response = m_handler(s->request);
+            }
+            else
+            {
+                response.body = s->request.body;
+            }
+
+            {
+                std::lock_guard<std::mutex> lock(m_lock);
+                m_requests.push_back(s->request);
+            }
+
+            const auto connection = s->request.headers.find("connection");
+            const bool close = connection != s->request.headers.end() && lower(connection->second) == "close";
+
+            s->response = "HTTP/1.1 " + std::to_string(response.status) + " Test\r\n";
+            for (const auto& header : response.headers)
+            {
+                s->response += header.first + ": " + header.second + "\r\n";
+            }
+            s->response += "Content-Length: " + std::to_string(response.body.size()) + "\r\n";
+            if (close)
+            {
+                s->response += "Connection: close\r\n";
+            }
+            s->response += "\r\n" + response.body;
+
+            boost::asio::async_write(s->socket, boost::asio::buffer(s->response), [this, s, close](const boost::system::error_code& ec, size_t)
+            {
+                if (ec)
+                {
+                    return;
+                }
+                if (close)
+                {
+                    boost::system::error_code ignored;
+                    s->socket.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored);
+                    return;
+                }
+                read_headers(s);
+            });
+        }
+
+        boost::asio::io_context m_service;
+        boost::asio::ip::tcp::acceptor m_acceptor;
+        handler_t m_handler;
+        std::vector<std::weak_ptr<session>> m_sessions;
+        std::thread m_thread;
+
+        mutable std::mutex m_lock;
+        std::vector<recorded_request> m_requests;
+        size_t m_connections;
+    };
+}}}}
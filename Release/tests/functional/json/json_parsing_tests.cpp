@@ -0,0 +1,153 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Tests for the string literal scan of the JSON string parser, with every kind of delimiter at every position of
+* the blocks it scans at once (16 bytes, or 8 UTF-16 code units) and of the tail after them.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "test_harness.h"
+
+#include <string>
+
+#include "cpprest/json.h"
+
+using namespace web;
+
+namespace
+{
+    // Two whole blocks and a tail.
+    const size_t literal_length = 40;
+
+    utility::string_t quoted(const utility::string_t& body)
+    {
+        return _XPLATSTR("\"") + body + _XPLATSTR("\"");
+    }
+
+    // literal_length plain characters with insert in place of the one at position.
+    utility::string_t with_at(size_t position, const utility::string_t& insert)
+    {
+        utility::string_t body(literal_length, _XPLATSTR('x'));
+        return body.replace(position, 1, insert);
+    }
+
+    // The column the parser reports for the token after a string literal of the given text.
+    size_t column_after(const utility::string_t& text)
+    {
+        try
+        {
+            json::value::parse(_XPLATSTR("[") + text + _XPLATSTR(", ?]"));
+        }
+        catch (const json::json_exception& e)
+        {
+            const std::string what = e.what();
+            const auto column = what.find("Column ");
+            VERIFY_IS_TRUE(column != std::string::npos);
+            return static_cast<size_t>(std::stoul(what.substr(column + 7)));
+        }
+        VERIFY_IS_TRUE(!"the parse did not fail");
+        return 0;
+    }
+}
+
+TEST(closing_quote_at_every_position)
+{
+    for (size_t length = 0; length <= literal_length; ++length)
+    {
+        const utility::string_t body(length, _XPLATSTR('x'));
+        VERIFY_IS_TRUE(json::value::parse(quoted(body)).as_string() == body);
+    }
+}
+
+TEST(escapes_at_every_position)
+{
+    const struct
+    {
+        const utility::char_t* escaped;
+        const utility::char_t* unescaped;
+    } escapes[] =
+    {
+        { _XPLATSTR("\\\""), _XPLATSTR("\"") },
+        { _XPLATSTR("\\\\"), _XPLATSTR("\\") },
+        { _XPLATSTR("\\/"), _XPLATSTR("/") },
+        { _XPLATSTR("\\n"), _XPLATSTR("\n") },
+        { _XPLATSTR("\\t"), _XPLATSTR("\t") },
+        { _XPLATSTR("\\u0041"), _XPLATSTR("A") },
+    };
+
+    for (const auto& escape : escapes)
+    {
+        for (size_t position = 0; position < literal_length; ++position)
+        {
+            const auto parsed = json::value::parse(quoted(with_at(position, escape.escaped))).as_string();
+            VERIFY_IS_TRUE(parsed == with_at(position, escape.unescaped));
+        }
+    }
+}
+
+TEST(consecutive_escapes_across_the_block_boundary)
+{
+    for (size_t position = 0; position + 4 <= literal_length; ++position)
+    {
+        const auto parsed = json::value::parse(quoted(with_at(position, _XPLATSTR("\\\\\\\"\\n\\\\")))).as_string();
+        VERIFY_IS_TRUE(parsed == with_at(position, _XPLATSTR("\\\"\n\\")));
+    }
+}
+
+TEST(control_characters_at_every_position_fail)
+{
+    for (const utility::char_t control : { utility::char_t(0x01), utility::char_t('\n'), utility::char_t(0x1F) })
+    {
+        for (size_t position = 0; position < literal_length; ++position)
+        {
+            VERIFY_THROWS(json::value::parse(quoted(with_at(position, utility::string_t(1, control)))), json::json_exception);
+        }
+    }
+}
+
+TEST(end_of_input_marker_at_every_position_fails)
+{
+    // 0xFF, or 0xFFFF in UTF-16, reads as the end of the input, so the literal is unterminated.
+    const utility::string_t marker(1, static_cast<utility::char_t>(-1));
+    for (size_t position = 0; position < literal_length; ++position)
+    {
+        VERIFY_THROWS(json::value::parse(quoted(with_at(position, marker))), json::json_exception);
+    }
+}
+
+TEST(non_ascii_at_every_position)
+{
+#ifdef _UTF16_STRINGS
+    const utility::string_t letter = L"\u00e9";
+#else
+    const utility::string_t letter = "\xc3\xa9";
+#endif
+    // DEL and the bytes of multi-byte UTF-8 sequences are plain characters.
+    for (const auto& insert : { letter, utility::string_t(1, static_cast<utility::char_t>(0x7F)) })
+    {
+        for (size_t position = 0; position < literal_length; ++position)
+        {
+            VERIFY_IS_TRUE(json::value::parse(quoted(with_at(position, insert))).as_string() == with_at(position, insert));
+        }
+    }
+}
+
+TEST(columns_count_every_character_of_a_literal)
+{
+    // Plain runs are counted at once and escapes one character at a time, both one column per source character.
+    const auto empty = column_after(quoted(utility::string_t()));
+    for (size_t length = 0; length <= literal_length; ++length)
+    {
+        VERIFY_ARE_EQUAL(empty + length, column_after(quoted(utility::string_t(length, _XPLATSTR('x')))));
+    }
+    for (size_t position = 0; position < literal_length; ++position)
+    {
+        VERIFY_ARE_EQUAL(empty + literal_length + 1, column_after(quoted(with_at(position, _XPLATSTR("\\n")))));
+    }
+}
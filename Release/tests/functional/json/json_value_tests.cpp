@@ -0,0 +1,108 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Tests for the json::value representation and its accessors.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "test_harness.h"
+
+#include "cpprest/json.h"
+
+// The deprecated get() overloads are tested on purpose.
+#if defined(__GNUC__)
+#pragma GCC diagnostic ignored "-Wdeprecated-declarations"
+#endif
+
+using namespace web;
+
+TEST(value_fits_in_16_bytes)
+{
+    if (sizeof(void*) == 8)
+    {
+        VERIFY_ARE_EQUAL(16u, sizeof(json::value));
+    }
+}
+
+TEST(get_field_throws)
+{
+    auto object = json::value::object();
+    object[_XPLATSTR("present")] = json::value::number(1);
+
+    VERIFY_THROWS(object.get(_XPLATSTR("present")), json::json_exception);
+    VERIFY_THROWS(object.get(_XPLATSTR("missing")), json::json_exception);
+    VERIFY_THROWS(json::value::number(1).get(_XPLATSTR("present")), json::json_exception);
+}
+
+TEST(get_element_throws)
+{
+    auto array = json::value::array(2);
+
+    VERIFY_THROWS(array.get(0), json::json_exception);
+    VERIFY_THROWS(array.get(5), json::json_exception);
+    VERIFY_THROWS(json::value::string(_XPLATSTR("text")).get(0), json::json_exception);
+}
+
+TEST(at_throws_for_missing_entries)
+{
+    auto object = json::value::object();
+    object[_XPLATSTR("present")] = json::value::boolean(true);
+    VERIFY_IS_TRUE(object.at(_XPLATSTR("present")).as_bool());
+    VERIFY_THROWS(object.at(_XPLATSTR("missing")), json::json_exception);
+
+    auto array = json::value::array(1);
+    VERIFY_IS_TRUE(array.at(0).is_null());
+    VERIFY_THROWS(array.at(1), json::json_exception);
+}
+
+TEST(inline_kinds_keep_their_values)
+{
+    VERIFY_IS_TRUE(json::value().is_null());
+    VERIFY_IS_TRUE(json::value::boolean(true).as_bool());
+    VERIFY_ARE_EQUAL(-42, json::value::number(-42).as_integer());
+    VERIFY_ARE_EQUAL(static_cast<uint64_t>(1) << 63, json::value::number(static_cast<uint64_t>(1) << 63).as_number().to_uint64());
+    VERIFY_ARE_EQUAL(2.5, json::value::number(2.5).as_double());
+}
+
+TEST(copies_are_deep)
+{
+    auto original = json::value::object();
+    original[_XPLATSTR("name")] = json::value::string(_XPLATSTR("short"));
+    original[_XPLATSTR("list")] = json::value::array(1);
+
+    auto copy = original;
+    copy[_XPLATSTR("name")] = json::value::string(_XPLATSTR("changed"));
+    copy[_XPLATSTR("list")][0] = json::value::number(7);
+
+    VERIFY_ARE_EQUAL(utility::string_t(_XPLATSTR("short")), original.at(_XPLATSTR("name")).as_string());
+    VERIFY_IS_TRUE(original.at(_XPLATSTR("list")).at(0).is_null());
+    VERIFY_ARE_EQUAL(7, copy.at(_XPLATSTR("list")).at(0).as_integer());
+}
+
+TEST(move_construction_leaves_null)
+{
+    auto source = json::value::string(_XPLATSTR("moved"));
+    json::value target(std::move(source));
+    VERIFY_ARE_EQUAL(utility::string_t(_XPLATSTR("moved")), target.as_string());
+    VERIFY_IS_TRUE(source.is_null());
+
+    // Move assignment swaps, as it always has.
+    source = json::value::array(3);
+    target = std::move(source);
+    VERIFY_ARE_EQUAL(3u, target.size());
+    VERIFY_ARE_EQUAL(utility::string_t(_XPLATSTR("moved")), source.as_string());
+}
+
+TEST(round_trip_through_text)
+{
+    const utility::string_t text = _XPLATSTR("{\"a\":[1,2.5,true,null,\"s\",{\"c\":\"d\"}]}");
+    const auto parsed = json::value::parse(text);
+    VERIFY_ARE_EQUAL(text, parsed.serialize());
+    VERIFY_IS_TRUE(parsed == json::value::parse(parsed.serialize()));
+}
@@ -0,0 +1,270 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Tests for the lock-free registration list of cancellation tokens: concurrent register, deregister and cancel,
+* the tombstone purge, and registering on a token that is already canceled.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "test_harness.h"
+
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "pplx/pplxtasks.h"
+
+namespace
+{
+    // Counts its destruction, which happens once both the test and the token list have let go of it.
+    class counted_registration : public pplx::details::_CancellationTokenRegistration
+    {
+    public:
+        explicit counted_registration(std::atomic<int>& destroyed) : m_destroyed(destroyed) {}
+
+        ~counted_registration()
+        {
+            ++m_destroyed;
+        }
+
+    protected:
+        void _Exec() override {}
+
+    private:
+        std::atomic<int>& m_destroyed;
+    };
+
+    struct registration_record
+    {
+        pplx::cancellation_token_registration registration;
+        std::atomic<int> calls { 0 };
+        std::atomic<bool> deregistered { false };
+        std::atomic<bool> called_after_deregister { false };
+    };
+}
+
+TEST(register_after_cancel_calls_back_immediately)
+{
+    pplx::cancellation_token_source source;
+    source.cancel();
+
+    const auto thread = std::this_thread::get_id();
+    bool called = false;
+    bool same_thread = false;
+    source.get_token().register_callback([&] { called = true; same_thread = std::this_thread::get_id() == thread; });
+    VERIFY_IS_TRUE(called);
+    VERIFY_IS_TRUE(same_thread);
+}
+
+TEST(callbacks_run_once_in_registration_order)
+{
+    pplx::cancellation_token_source source;
+    std::vector<int> order;
+    for (int i = 0; i < 50; ++i)
+    {
+        source.get_token().register_callback([&order, i] { order.push_back(i); });
+    }
+    source.cancel();
+    source.cancel();
+
+    VERIFY_ARE_EQUAL(50u, order.size());
+    for (int i = 0; i < 50; ++i)
+    {
+        VERIFY_ARE_EQUAL(i, order[i]);
+    }
+}
+
+TEST(deregister_frees_the_callback_before_the_purge)
+{
+    pplx::cancellation_token_source source;
+    auto token = source.get_token();
+    auto capture = std::make_shared<int>(0);
+
+    auto registration = token.register_callback([capture] {});
+    VERIFY_ARE_EQUAL(2, capture.use_count());
+    token.deregister_callback(registration);
+    VERIFY_ARE_EQUAL(1, capture.use_count());
+}
+
+TEST(tombstones_are_purged_at_sixteen_and_half_the_list)
+{
+    pplx::cancellation_token_source source;
+    auto state = source.get_token()._GetImpl();
+    std::atomic<int> destroyed(0);
+
+    // The list keeps a reference to each registration until it unlinks it.
+    std::vector<counted_registration*> registrations;
+    for (int i = 0; i < 20; ++i)
+    {
+        registrations.push_back(new counted_registration(destroyed));
+        state->_RegisterCallback(registrations.back());
+    }
+
+    // Fifteen tombstones: below the threshold, nothing is unlinked.
+    for (int i = 0; i < 15; ++i)
+    {
+        state->_DeregisterCallback(registrations[i]);
+        registrations[i]->_Release();
+    }
+    VERIFY_ARE_EQUAL(0, destroyed.load());
+
+    // The sixteenth is also at least half of the twenty, all of them go at once.
+    state->_DeregisterCallback(registrations[15]);
+    registrations[15]->_Release();
+    VERIFY_ARE_EQUAL(16, destroyed.load());
+
+    // The rest are still called back.
+    source.cancel();
+    for (int i = 16; i < 20; ++i)
+    {
+        registrations[i]->_Release();
+    }
+    VERIFY_ARE_EQUAL(20, destroyed.load());
+}
+
+TEST(tombstones_below_half_the_list_stay)
+{
+    pplx::cancellation_token_source source;
+    auto state = source.get_token()._GetImpl();
+    std::atomic<int> destroyed(0);
+
+    std::vector<counted_registration*> registrations;
+    for (int i = 0; i < 40; ++i)
+    {
+        registrations.push_back(new counted_registration(destroyed));
+        state->_RegisterCallback(registrations.back());
+    }
+    for (int i = 0; i < 19; ++i)
+    {
+        state->_DeregisterCallback(registrations[i]);
+        registrations[i]->_Release();
+    }
+    VERIFY_ARE_EQUAL(0, destroyed.load());
+
+    state->_DeregisterCallback(registrations[19]);
+    registrations[19]->_Release();
+    VERIFY_ARE_EQUAL(20, destroyed.load());
+
+    for (int i = 20; i < 40; ++i)
+    {
+        registrations[i]->_Release();
+    }
+    source.cancel();
+    VERIFY_ARE_EQUAL(40, destroyed.load());
+}
+
+TEST(deregister_waits_for_a_running_callback)
+{
+    pplx::cancellation_token_source source;
+    auto token = source.get_token();
+    std::atomic<bool> started(false);
+    std::atomic<bool> finished(false);
+
+    auto registration = token.register_callback([&]
+    {
+        started = true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        finished = true;
+    });
+
+    std::thread canceler([&source] { source.cancel(); });
+    while (!started)
+    {
+        std::this_thread::yield();
+    }
+    token.deregister_callback(registration);
+    VERIFY_IS_TRUE(finished.load());
+    canceler.join();
+}
+
+TEST(deregister_from_inside_the_callback)
+{
+    pplx::cancellation_token_source source;
+    auto token = source.get_token();
+    pplx::cancellation_token_registration registration;
+    bool called = false;
+    registration = token.register_callback([&]
+    {
+        // Must not wait for itself.
+        token.deregister_callback(registration);
+        called = true;
+    });
+    source.cancel();
+    VERIFY_IS_TRUE(called);
+}
+
+TEST(concurrent_register_deregister_and_cancel)
+{
+    // Threads register and deregister on one token while another cancels it. A callback never runs after its
+    // deregistration returned, and every callback still registered at cancellation runs exactly once.
+    const int threads = 4;
+    const int per_thread = 5000;
+
+    for (int attempt = 0; attempt < 5; ++attempt)
+    {
+        pplx::cancellation_token_source source;
+        auto token = source.get_token();
+        std::vector<std::unique_ptr<registration_record>> records;
+        for (int i = 0; i < threads * per_thread; ++i)
+        {
+            records.push_back(std::unique_ptr<registration_record>(new registration_record()));
+        }
+
+        std::atomic<int> running(0);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t)
+        {
+            workers.emplace_back([&, t]
+            {
+                ++running;
+                for (int i = t * per_thread; i < (t + 1) * per_thread; ++i)
+                {
+                    auto record = records[i].get();
+                    record->registration = token.register_callback([record]
+                    {
+                        if (record->deregistered)
+                        {
+                            record->called_after_deregister = true;
+                        }
+                        ++record->calls;
+                    });
+                    // Every other one is dropped again, which keeps the purge busy.
+                    if (i % 2 == 0)
+                    {
+                        token.deregister_callback(record->registration);
+                        record->deregistered = true;
+                    }
+                }
+            });
+        }
+
+        while (running < threads)
+        {
+            std::this_thread::yield();
+        }
+        std::this_thread::sleep_for(std::chrono::microseconds(200 * attempt));
+        source.cancel();
+        for (auto& worker : workers)
+        {
+            worker.join();
+        }
+
+        for (const auto& record : records)
+        {
+            VERIFY_IS_FALSE(record->called_after_deregister.load());
+            VERIFY_IS_TRUE(record->calls <= 1);
+            if (!record->deregistered)
+            {
+                VERIFY_ARE_EQUAL(1, record->calls.load());
+            }
+        }
+    }
+}
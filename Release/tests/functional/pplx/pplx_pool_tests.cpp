@@ -0,0 +1,249 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Stress tests for the pooled allocation of task impls, continuation handles and completion events, with blocks
+* allocated on one thread and freed on another.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "test_harness.h"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "pplx/pplxtasks.h"
+
+namespace
+{
+    const size_t thread_count = 4;
+
+    // Sizes on both sides of the pool classes, and one past the largest pooled block.
+    const size_t block_sizes[] = { 1, 16, 24, 64, 100, 256, 512, 513, 4096 };
+
+    struct block
+    {
+        unsigned char* data;
+        size_t size;
+        unsigned char fill;
+    };
+
+    void fill(block& b)
+    {
+        std::memset(b.data, b.fill, b.size);
+    }
+
+    bool intact(const block& b)
+    {
+        for (size_t i = 0; i < b.size; ++i)
+        {
+            if (b.data[i] != b.fill)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    struct alignas(64) overaligned
+    {
+        unsigned char bytes[64];
+    };
+}
+
+TEST(blocks_freed_on_other_threads_are_not_shared)
+{
+    // Every thread allocates a batch, hands it to its neighbour, and frees the batch it was handed.
+    const size_t rounds = 200;
+    const size_t batch = 64;
+    std::vector<std::vector<block>> mailboxes(thread_count);
+    std::vector<std::mutex> locks(thread_count);
+    std::atomic<bool> corrupted(false);
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; ++t)
+    {
+        threads.emplace_back([&, t]
+        {
+            for (size_t round = 0; round < rounds; ++round)
+            {
+                std::vector<block> mine;
+                for (size_t i = 0; i < batch; ++i)
+                {
+                    const size_t size = block_sizes[(i + round) % (sizeof(block_sizes) / sizeof(block_sizes[0]))];
+                    block b { static_cast<unsigned char*>(pplx::details::_Allocate_pooled(size)), size, static_cast<unsigned char>(t * 31 + i) };
+                    fill(b);
+                    mine.push_back(b);
+                }
+                {
+                    std::lock_guard<std::mutex> lock(locks[(t + 1) % thread_count]);
+                    auto& box = mailboxes[(t + 1) % thread_count];
+                    box.insert(box.end(), mine.begin(), mine.end());
+                }
+
+                std::vector<block> handed;
+                {
+                    std::lock_guard<std::mutex> lock(locks[t]);
+                    handed.swap(mailboxes[t]);
+                }
+                for (const auto& b : handed)
+                {
+                    if (!intact(b))
+                    {
+                        corrupted = true;
+                    }
+                    pplx::details::_Free_pooled(b.data, b.size);
+                }
+            }
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    for (auto& box : mailboxes)
+    {
+        for (const auto& b : box)
+        {
+            if (!intact(b))
+            {
+                corrupted = true;
+            }
+            pplx::details::_Free_pooled(b.data, b.size);
+        }
+    }
+    VERIFY_IS_FALSE(corrupted.load());
+}
+
+TEST(live_blocks_are_distinct)
+{
+    // More blocks than a thread caches, so chains move between the threads and the central pool.
+    std::vector<void*> blocks;
+    for (size_t i = 0; i < 20000; ++i)
+    {
+        blocks.push_back(pplx::details::_Allocate_pooled(48));
+    }
+    std::thread([&blocks]
+    {
+        for (size_t i = 0; i < blocks.size(); i += 2)
+        {
+            pplx::details::_Free_pooled(blocks[i], 48);
+            blocks[i] = pplx::details::_Allocate_pooled(48);
+        }
+    }).join();
+
+    std::set<void*> distinct(blocks.begin(), blocks.end());
+    VERIFY_ARE_EQUAL(blocks.size(), distinct.size());
+    for (auto b : blocks)
+    {
+        pplx::details::_Free_pooled(b, 48);
+    }
+}
+
+TEST(blocks_outlive_the_thread_that_allocated_them)
+{
+    // The allocating threads exit first, their caches go back to the central pool.
+    std::vector<block> blocks(thread_count * 1000);
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; ++t)
+    {
+        threads.emplace_back([&blocks, t]
+        {
+            for (size_t i = t * 1000; i < (t + 1) * 1000; ++i)
+            {
+                blocks[i] = block { static_cast<unsigned char*>(pplx::details::_Allocate_pooled(32)), 32, static_cast<unsigned char>(i) };
+                fill(blocks[i]);
+            }
+            // Leaves something in the cache of the exiting thread.
+            pplx::details::_Free_pooled(pplx::details::_Allocate_pooled(32), 32);
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    for (const auto& b : blocks)
+    {
+        VERIFY_IS_TRUE(intact(b));
+        pplx::details::_Free_pooled(b.data, b.size);
+    }
+}
+
+TEST(overaligned_types_bypass_the_pool)
+{
+    pplx::details::_Pool_allocator<overaligned> allocator;
+    std::vector<overaligned*> items;
+    for (int i = 0; i < 100; ++i)
+    {
+        items.push_back(allocator.allocate(1));
+        VERIFY_ARE_EQUAL(0u, reinterpret_cast<uintptr_t>(items.back()) % alignof(overaligned));
+    }
+    for (auto item : items)
+    {
+        allocator.deallocate(item, 1);
+    }
+
+    auto shared = pplx::details::_Make_pooled_shared<overaligned>();
+    VERIFY_ARE_EQUAL(0u, reinterpret_cast<uintptr_t>(shared.get()) % alignof(overaligned));
+}
+
+TEST(tasks_created_and_destroyed_across_threads)
+{
+    // Each thread builds continuation chains on events that another thread sets, and drops its tasks while
+    // the continuations still run elsewhere.
+    const int chains = 2000;
+    std::vector<std::vector<pplx::task_completion_event<int>>> events(thread_count);
+    std::vector<std::mutex> locks(thread_count);
+    std::atomic<long long> total(0);
+    std::atomic<size_t> ready(0);
+
+    std::vector<std::thread> threads;
+    for (size_t t = 0; t < thread_count; ++t)
+    {
+        threads.emplace_back([&, t]
+        {
+            std::vector<pplx::task<void>> tails;
+            for (int i = 0; i < chains; ++i)
+            {
+                pplx::task_completion_event<int> tce;
+                tails.push_back(pplx::create_task(tce)
+                    .then([](int value) { return value + 1; })
+                    .then([](pplx::task<int> previous) { return previous.get() * 2; })
+                    .then([&total](int value) { total += value; }));
+                std::lock_guard<std::mutex> lock(locks[(t + 1) % thread_count]);
+                events[(t + 1) % thread_count].push_back(tce);
+            }
+            ++ready;
+            while (ready < thread_count)
+            {
+                std::this_thread::yield();
+            }
+
+            std::vector<pplx::task_completion_event<int>> mine;
+            {
+                std::lock_guard<std::mutex> lock(locks[t]);
+                mine.swap(events[t]);
+            }
+            for (auto& tce : mine)
+            {
+                tce.set(1);
+            }
+            pplx::when_all(tails.begin(), tails.end()).wait();
+        });
+    }
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+    VERIFY_ARE_EQUAL(static_cast<long long>(thread_count) * chains * 4, total.load());
+}
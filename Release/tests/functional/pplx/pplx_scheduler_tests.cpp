@@ -0,0 +1,99 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Tests for the work-stealing scheduler, with more tasks blocking on each other than it has workers.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "test_harness.h"
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <future>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "pplx/pplxtasks.h"
+#include "pplx/work_stealing_scheduler.h"
+
+namespace
+{
+    const size_t worker_count = 2;
+    const std::chrono::seconds deadlock_timeout(60);
+
+    // Runs the tasks that start creates on a scheduler of its own, and waits for them without blocking forever, so
+    // a deadlock fails the test instead of hanging ctest.
+    void verify_completes(const std::function<pplx::task<void>(const pplx::task_options&)>& start)
+    {
+        auto scheduler = std::make_shared<pplx::work_stealing_scheduler>(worker_count);
+        auto finished = std::make_shared<std::promise<void>>();
+        auto future = finished->get_future();
+        start(pplx::task_options(scheduler)).then([finished](pplx::task<void> t)
+        {
+            t.get();
+            finished->set_value();
+        });
+        if (future.wait_for(deadlock_timeout) != std::future_status::ready)
+        {
+            // The deadlocked workers never return, so the scheduler is leaked rather than joined.
+            new std::shared_ptr<pplx::work_stealing_scheduler>(scheduler);
+            VERIFY_IS_TRUE(!"the tasks deadlocked");
+        }
+        future.get();
+
+        // The task impls hold the scheduler until the workers free them, just after the last continuation. The
+        // destructor joins the workers, so the last reference must go on this thread.
+        while (scheduler.use_count() > 1)
+            std::this_thread::yield();
+    }
+
+    size_t nested_sum(const pplx::task_options& options, size_t depth)
+    {
+        if (depth == 0)
+            return 1;
+        auto left = pplx::create_task([options, depth] { return nested_sum(options, depth - 1); }, options);
+        auto right = pplx::create_task([options, depth] { return nested_sum(options, depth - 1); }, options);
+        return left.get() + right.get();
+    }
+}
+
+TEST(blocked_chain_longer_than_the_workers)
+{
+    verify_completes([](const pplx::task_options& options)
+    {
+        // Task i waits for task i + 1, which is queued behind it.
+        const size_t task_count = 16 * worker_count;
+        auto events = std::make_shared<std::vector<pplx::task_completion_event<void>>>(task_count);
+        std::vector<pplx::task<void>> tasks;
+        for (size_t i = 0; i < task_count; ++i)
+        {
+            tasks.push_back(pplx::create_task([events, i, task_count]
+            {
+                if (i + 1 < task_count)
+                    pplx::create_task((*events)[i + 1]).wait();
+                (*events)[i].set();
+            }, options));
+        }
+        return pplx::when_all(tasks.begin(), tasks.end());
+    });
+}
+
+TEST(nested_waits_from_the_workers)
+{
+    // A tree of tasks that each wait for their two children: every worker ends up blocked in a wait.
+    const size_t depth = 8;
+    auto sum = std::make_shared<std::atomic<size_t>>(0);
+    verify_completes([depth, sum](const pplx::task_options& options)
+    {
+        return pplx::create_task([options, depth, sum] { sum->store(nested_sum(options, depth)); }, options);
+    });
+    VERIFY_ARE_EQUAL(static_cast<size_t>(1) << depth, sum->load());
+}
@@ -0,0 +1,135 @@
+/***
+* Copyright (C) Microsoft. All rights reserved.
+* Licensed under the MIT license. See LICENSE.txt file in the project root for full license information.
+*
+* =+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+=+
+*
+* Tests for the read-ahead window behind streambuf_from_Stream, fed from a memory source instead of a .Net Stream.
+*
+* For the latest on this and related APIs, please see: https://github.com/Microsoft/cpprestsdk
+*
+* =-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-=-
+****/
+
+#include "test_harness.h"
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <vector>
+
+#include "cpprest/details/read_window.h"
+
+using Concurrency::streams::details::read_window;
+
+namespace
+{
+    // Hands out at most max_read bytes per call, like a Stream that returns short reads.
+    class memory_source
+    {
+    public:
+        memory_source(size_t size, size_t max_read) : m_data(size), m_offset(0), m_max_read(max_read), m_reads(0)
+        {
+            for (size_t i = 0; i < size; ++i)
+                m_data[i] = static_cast<uint8_t>((i * 7 + i / 251) & 0xff);
+        }
+
+        size_t operator()(uint8_t* ptr, size_t count)
+        {
+            ++m_reads;
+            const auto stored = (std::min)({ count, m_max_read, m_data.size() - m_offset });
+            std::memcpy(ptr, m_data.data() + m_offset, stored);
+            m_offset += stored;
+            return stored;
+        }
+
+        const std::vector<uint8_t>& data() const { return m_data; }
+        size_t reads() const { return m_reads; }
+
+    private:
+        std::vector<uint8_t> m_data;
+        size_t m_offset;
+        size_t m_max_read;
+        size_t m_reads;
+    };
+
+    // Reads the next size bytes the way sbumpcn does and checks them against the source at offset.
+    size_t take(read_window& window, memory_source& source, size_t offset, size_t size)
+    {
+        window.fill(size, std::ref(source));
+        const auto available = (std::min)(size, window.size());
+        std::vector<uint8_t> bytes(available);
+        window.copy_to(bytes.data(), available);
+        window.consume(available);
+        VERIFY_IS_TRUE(std::equal(bytes.begin(), bytes.end(), source.data().begin() + offset));
+        return available;
+    }
+}
+
+TEST(reads_wrap_around_the_ring)
+{
+    memory_source source(10 * read_window::initial_capacity, 3000);
+    read_window window;
+
+    // 5000 does not divide the capacity, so reads keep straddling the end of the ring
+    size_t offset = 0;
+    while (offset < source.data().size())
+    {
+        offset += take(window, source, offset, 5000);
+        VERIFY_ARE_EQUAL(static_cast<size_t>(read_window::initial_capacity), window.capacity());
+    }
+    VERIFY_ARE_EQUAL(source.data().size(), offset);
+}
+
+TEST(growth_keeps_buffered_bytes_in_order)
+{
+    memory_source source(4 * read_window::initial_capacity, 1000);
+    read_window window;
+
+    // Leave the head in the middle of the ring, with bytes wrapped past its end
+    size_t offset = take(window, source, 0, read_window::initial_capacity - 100);
+    window.fill(500, std::ref(source));
+    VERIFY_IS_TRUE(window.size() >= 500);
+
+    offset += take(window, source, offset, 3 * read_window::initial_capacity);
+    VERIFY_ARE_EQUAL(static_cast<size_t>(4 * read_window::initial_capacity), window.capacity());
+    offset += take(window, source, offset, read_window::initial_capacity);
+    VERIFY_ARE_EQUAL(source.data().size(), offset);
+}
+
+TEST(partial_read_at_the_end_of_the_source)
+{
+    memory_source source(1000, 64 * 1024);
+    read_window window;
+
+    VERIFY_ARE_EQUAL(600u, take(window, source, 0, 600));
+    VERIFY_ARE_EQUAL(400u, take(window, source, 600, 600));
+    VERIFY_ARE_EQUAL(0u, take(window, source, 1000, 600));
+
+    // Once the source has ended it is not read again
+    const auto reads = source.reads();
+    window.fill(1, std::ref(source));
+    VERIFY_ARE_EQUAL(reads, source.reads());
+}
+
+TEST(head_resets_when_the_window_empties)
+{
+    memory_source source(read_window::initial_capacity, 100);
+    read_window window;
+
+    window.fill(100, std::ref(source));
+    size_t count = 0;
+    const uint8_t* start = window.contiguous(count);
+    VERIFY_ARE_EQUAL(100u, count);
+
+    window.consume(10);
+    VERIFY_IS_TRUE(window.contiguous(count) == start + 10);
+    VERIFY_ARE_EQUAL(90u, count);
+
+    // Emptied, the next read lands at the start of the ring again instead of wrapping later
+    window.consume(90);
+    VERIFY_IS_TRUE(window.contiguous(count) == nullptr);
+    window.fill(100, std::ref(source));
+    VERIFY_IS_TRUE(window.contiguous(count) == start);
+    VERIFY_ARE_EQUAL(100u, count);
+}